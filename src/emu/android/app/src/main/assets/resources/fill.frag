@@ -1,10 +0,0 @@
-#version 300 es
-
-precision mediump float;
-
-uniform vec4 u_color;
-out vec4 o_color;
-
-void main() {
-    o_color = (u_color / 255.0);
-}
\ No newline at end of file
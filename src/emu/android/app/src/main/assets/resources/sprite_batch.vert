@@ -0,0 +1,21 @@
+#version 300 es
+
+precision mediump float;
+
+layout (location = 0) in vec2 in_corner;
+layout (location = 1) in vec4 in_dest;
+layout (location = 2) in vec4 in_source;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in float in_flip;
+
+out vec2 r_texcoord;
+out vec4 r_color;
+
+uniform mat4 u_proj;
+
+void main() {
+    gl_Position = u_proj * vec4(in_dest.xy + in_corner * in_dest.zw, 0.0, 1.0);
+    gl_Position.y *= in_flip;
+    r_texcoord = in_source.xy + in_corner * in_source.zw;
+    r_color = in_color;
+}
\ No newline at end of file
@@ -194,13 +194,11 @@ namespace eka2l1::android {
                 cmd_builder->load_backup_state();
             }
 
-            int wait_status = -100;
-
             // Submit, present, and wait for the presenting
-            cmd_builder->present(&wait_status);
+            cmd_builder->present(nullptr);
 
-            state.graphics_driver->submit_command_list(*cmd_list);
-            state.graphics_driver->wait_for(&wait_status);
+            const std::uint64_t present_fence = state.graphics_driver->submit_command_list(*cmd_list);
+            state.graphics_driver->wait_fence(present_fence);
 
             // Recreate the list and builder
             cmd_list = state.graphics_driver->new_command_list();
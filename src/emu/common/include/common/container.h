@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <vector>
 
@@ -79,7 +81,14 @@ namespace eka2l1::common {
         }
 
         iterator begin() {
-            return iterator(this, data_.begin());
+            auto ite = data_.begin();
+
+            // Skip freed slots at the front too, not just in between
+            while ((ite != data_.end()) && check_(*ite)) {
+                ite++;
+            }
+
+            return iterator(this, ite);
         }
 
         iterator end() {
@@ -115,4 +124,165 @@ namespace eka2l1::common {
             return &data_[elem_id - 1];
         }
     };
-}
\ No newline at end of file
+
+    static constexpr std::size_t INVALID_SLAB_SLOT = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief A growable array of slots with an intrusive free list.
+     *
+     * Index of an element stays the same for its whole lifetime, so it can be baked into handles.
+     * Adding, removing and looking up elements are all O(1) (adding is amortized, because the
+     * slot array may grow). Freed slots are reused before the array grows.
+     */
+    template <typename T>
+    class slab_container {
+    public:
+        static constexpr std::size_t INVALID_SLOT = INVALID_SLAB_SLOT;
+
+    protected:
+        struct slot {
+            T data_;
+            std::size_t next_free_ = INVALID_SLOT;
+            bool used_ = false;
+        };
+
+        std::vector<slot> slots_;
+        std::size_t free_head_;
+        std::size_t max_slots_;
+        std::size_t count_;
+
+        bool grow_to(const std::size_t slot_count) {
+            if (slot_count > max_slots_) {
+                return false;
+            }
+
+            // Push new slots to the free list in reverse, so lower ones get used first
+            const std::size_t old_count = slots_.size();
+            slots_.resize(slot_count);
+
+            for (std::size_t i = slot_count; i > old_count; i--) {
+                slots_[i - 1].next_free_ = free_head_;
+                free_head_ = i - 1;
+            }
+
+            return true;
+        }
+
+    public:
+        explicit slab_container(const std::size_t max_slots = INVALID_SLOT)
+            : free_head_(INVALID_SLOT)
+            , max_slots_(max_slots)
+            , count_(0) {
+        }
+
+        /**
+         * @brief   Put an element into a free slot.
+         *
+         * @param   elem    The element to add.
+         * @returns Index of the slot holding the element, INVALID_SLOT if the container is full.
+         */
+        std::size_t add(T elem) {
+            if (free_head_ == INVALID_SLOT) {
+                const std::size_t new_count = std::min(max_slots_, std::max<std::size_t>(16, slots_.size() * 2));
+
+                if ((new_count <= slots_.size()) || !grow_to(new_count)) {
+                    return INVALID_SLOT;
+                }
+            }
+
+            const std::size_t index = free_head_;
+            slot &target = slots_[index];
+
+            free_head_ = target.next_free_;
+
+            target.data_ = std::move(elem);
+            target.next_free_ = INVALID_SLOT;
+            target.used_ = true;
+
+            count_++;
+            return index;
+        }
+
+        /**
+         * @brief   Put an element into a specific slot.
+         *
+         * This walks the free list to take the slot out of it, so it is not O(1). Meant for restoring
+         * a saved state, where the indexes must stay the same.
+         *
+         * @returns False if the slot is already used or out of the container's limit.
+         */
+        bool add_at(const std::size_t index, T elem) {
+            if ((index >= slots_.size()) && !grow_to(index + 1)) {
+                return false;
+            }
+
+            if (slots_[index].used_) {
+                return false;
+            }
+
+            std::size_t *link = &free_head_;
+
+            while (*link != index) {
+                link = &slots_[*link].next_free_;
+            }
+
+            *link = slots_[index].next_free_;
+
+            slots_[index].data_ = std::move(elem);
+            slots_[index].next_free_ = INVALID_SLOT;
+            slots_[index].used_ = true;
+
+            count_++;
+            return true;
+        }
+
+        bool remove(const std::size_t index) {
+            if ((index >= slots_.size()) || !slots_[index].used_) {
+                return false;
+            }
+
+            slot &target = slots_[index];
+
+            target.data_ = T{};
+            target.used_ = false;
+            target.next_free_ = free_head_;
+
+            free_head_ = index;
+            count_--;
+
+            return true;
+        }
+
+        T *get(const std::size_t index) {
+            if ((index >= slots_.size()) || !slots_[index].used_) {
+                return nullptr;
+            }
+
+            return &slots_[index].data_;
+        }
+
+        /*! \brief Call the function on every used slot, with its index and element. */
+        template <typename F>
+        void for_each(F func) {
+            for (std::size_t i = 0; i < slots_.size(); i++) {
+                if (slots_[i].used_) {
+                    func(i, slots_[i].data_);
+                }
+            }
+        }
+
+        void clear() {
+            slots_.clear();
+            free_head_ = INVALID_SLOT;
+            count_ = 0;
+        }
+
+        std::size_t size() const {
+            return count_;
+        }
+
+        std::size_t capacity() const {
+            return slots_.size();
+        }
+    };
+}
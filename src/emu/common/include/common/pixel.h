@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eka2l1::common {
+    /**
+     * Pixel format conversion of bitmap rows.
+     *
+     * All functions convert to 32-bit pixels, with bytes ordered as B, G, R, A in memory. They use SSE2 or
+     * NEON where available, and fall back to plain C++ on other architectures.
+     */
+
+    /**
+     * \brief Convert a row of palette indexed pixels.
+     *
+     * Indices smaller than a byte are packed starting from the least significant bits, like Symbian does.
+     *
+     * \param dest              Destination row.
+     * \param source            Row of indices.
+     * \param count             Number of pixels to convert.
+     * \param bits_per_pixel    Bits per index. Must be 1, 2, 4 or 8.
+     * \param palette           Pixel values for each index, written to the destination as is.
+     */
+    void convert_palette_row_to_bgra32(std::uint32_t *dest, const std::uint8_t *source, const std::size_t count,
+        const int bits_per_pixel, const std::uint32_t *palette);
+
+    /**
+     * \brief Convert a row of 12-bit pixels, stored as 16-bit words with 4 bits per channel in XRGB order.
+     */
+    void convert_xrgb4444_row_to_bgra32(std::uint32_t *dest, const std::uint16_t *source, const std::size_t count);
+
+    /**
+     * \brief Convert a row of 16-bit RGB565 pixels.
+     */
+    void convert_rgb565_row_to_bgra32(std::uint32_t *dest, const std::uint16_t *source, const std::size_t count);
+
+    /**
+     * \brief Convert a row of 24-bit pixels, with bytes ordered as B, G, R.
+     */
+    void convert_bgr24_row_to_bgra32(std::uint32_t *dest, const std::uint8_t *source, const std::size_t count);
+
+    /**
+     * \brief Convert a row of 32-bit pixels whose alpha byte is unused, making them opaque.
+     */
+    void convert_bgrx32_row_to_bgra32(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::common {
+    /**
+     * @brief Latency histogram with power-of-two buckets, in nanoseconds.
+     *
+     * Bucket N holds samples in range [2^N, 2^(N + 1)) ns. Bucket 0 also holds 0ns samples.
+     */
+    struct latency_histogram {
+        static constexpr std::size_t BUCKET_COUNT = 40;
+
+        std::uint64_t count_ = 0;
+        std::uint64_t total_ns_ = 0;
+        std::uint64_t min_ns_ = 0;
+        std::uint64_t max_ns_ = 0;
+
+        std::array<std::uint64_t, BUCKET_COUNT> buckets_{};
+
+        void record(const std::uint64_t ns);
+
+        /**
+         * @brief   Estimate a percentile of the recorded samples.
+         *
+         * @param   fraction        The percentile, in range of [0, 1].
+         * @returns Upper bound of the bucket containing the percentile, clamped to the maximum sample.
+         */
+        std::uint64_t percentile(const double fraction) const;
+
+        std::uint64_t average() const {
+            return count_ ? (total_ns_ / count_) : 0;
+        }
+    };
+
+    enum call_profile_category {
+        call_profile_category_svc = 0,
+        call_profile_category_ipc = 1,
+        call_profile_category_dispatch = 2,
+        call_profile_category_count
+    };
+
+    const char *call_profile_category_name(const call_profile_category category);
+
+    struct call_profile_entry {
+        call_profile_category category_;
+
+        std::uint32_t owner_;           ///< For IPC, the unique ID of the server. Else 0.
+        std::uint32_t ordinal_;         ///< SVC number, IPC opcode or dispatch function number.
+
+        std::string group_;             ///< For IPC, the name of the server. Else empty.
+        std::string name_;              ///< Name of the function, may be empty if not known.
+
+        latency_histogram histogram_;
+    };
+
+    /**
+     * @brief Collect call count and latency of HLE calls (SVCs, IPC opcodes and dispatch functions).
+     *
+     * Recording is skipped with a single atomic load when the profiler is disabled. Entries are
+     * only allocated the first time a call is seen; names are copied at that moment.
+     */
+    class call_profiler {
+        std::atomic<bool> enabled_;
+
+        mutable std::mutex lock_;
+        std::unordered_map<std::uint64_t, call_profile_entry> entries_;
+
+    public:
+        explicit call_profiler(const bool enabled = false);
+
+        void set_enabled(const bool enabled) {
+            enabled_.store(enabled, std::memory_order_relaxed);
+        }
+
+        bool is_enabled() const {
+            return enabled_.load(std::memory_order_relaxed);
+        }
+
+        void record(const call_profile_category category, const std::uint32_t owner, const std::uint32_t ordinal,
+            const std::string &group, const std::string &name, const std::uint64_t ns);
+
+        /**
+         * @brief Copy all entries out, ordered by total time spent descending.
+         */
+        std::vector<call_profile_entry> snapshot() const;
+
+        void reset();
+        bool empty() const;
+
+        bool dump_json(const std::string &path) const;
+        bool dump_csv(const std::string &path) const;
+    };
+
+    /**
+     * @brief Time the enclosing scope and record it to a call profiler.
+     *
+     * The group and name strings are copied, and only when the profiler is enabled.
+     */
+    class call_profile_scope {
+        call_profiler *profiler_;
+        call_profile_category category_;
+        std::uint32_t owner_;
+        std::uint32_t ordinal_;
+        std::string group_;
+        std::string name_;
+
+        std::chrono::steady_clock::time_point start_;
+
+    public:
+        explicit call_profile_scope(call_profiler *profiler, const call_profile_category category, const std::uint32_t owner,
+            const std::uint32_t ordinal, const std::string &group, const std::string &name)
+            : profiler_((profiler && profiler->is_enabled()) ? profiler : nullptr)
+            , category_(category)
+            , owner_(owner)
+            , ordinal_(ordinal) {
+            if (profiler_) {
+                group_ = group;
+                name_ = name;
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~call_profile_scope() {
+            if (profiler_) {
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                profiler_->record(category_, owner_, ordinal_, group_, name_,
+                    static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+    };
+}
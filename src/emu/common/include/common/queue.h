@@ -3,9 +3,13 @@
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstring>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <type_traits>
+#include <vector>
 
 namespace eka2l1 {
     /*! \brief A modified queue from std::priority_queue.
@@ -188,6 +192,24 @@ namespace eka2l1 {
             queue_empty_cond_.notify_one();
         }
 
+        void push(T &&item) {
+            {
+                std::unique_lock<std::mutex> ulock(queue_mut_);
+
+                while (!abort_ && queue_.size() == max_pending_count_) {
+                    queue_cond_.wait(ulock);
+                }
+
+                if (abort_) {
+                    return;
+                }
+
+                queue_.push(std::move(item));
+            }
+
+            queue_empty_cond_.notify_one();
+        }
+
         std::optional<T> pop(const int ms = 0) {
             T item{ T() };
 
@@ -208,7 +230,7 @@ namespace eka2l1 {
                     return std::nullopt;
                 }
 
-                item = queue_.front();
+                item = std::move(queue_.front());
                 queue_.pop();
             }
 
@@ -227,4 +249,109 @@ namespace eka2l1 {
             abort_ = false;
         }
     };
+
+    /**
+     * \brief Lock-free ring buffer for one producer thread and one consumer thread.
+     *
+     * Elements are copied in and out in bulk, nothing blocks. Suitable for feeding real-time
+     * callbacks. The capacity is rounded up to a power of two.
+     */
+    template <typename T>
+    class spsc_ring {
+        static_assert(std::is_trivially_copyable_v<T>, "Ring elements must be trivially copyable");
+
+        std::vector<T> data_;
+        std::size_t mask_;
+
+        std::atomic<std::size_t> read_pos_;
+        std::atomic<std::size_t> write_pos_;
+
+    public:
+        explicit spsc_ring(const std::size_t capacity)
+            : read_pos_(0)
+            , write_pos_(0) {
+            std::size_t rounded = 1;
+
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+
+            data_.resize(rounded);
+            mask_ = rounded - 1;
+        }
+
+        std::size_t capacity() const {
+            return data_.size();
+        }
+
+        /**
+         * \brief Get the number of elements available to read.
+         */
+        std::size_t size() const {
+            return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * \brief Get the number of elements that can be written without overwriting unread ones.
+         */
+        std::size_t space() const {
+            return capacity() - size();
+        }
+
+        /**
+         * \brief Copy elements in. Only call from the producer thread.
+         * \returns Number of elements written, which is less than count when the ring is full.
+         */
+        std::size_t write(const T *items, const std::size_t count) {
+            const std::size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+            const std::size_t read_pos = read_pos_.load(std::memory_order_acquire);
+            const std::size_t total = std::min(count, capacity() - (write_pos - read_pos));
+
+            const std::size_t start = write_pos & mask_;
+            const std::size_t first_part = std::min(total, capacity() - start);
+
+            std::memcpy(data_.data() + start, items, first_part * sizeof(T));
+            std::memcpy(data_.data(), items + first_part, (total - first_part) * sizeof(T));
+
+            write_pos_.store(write_pos + total, std::memory_order_release);
+            return total;
+        }
+
+        /**
+         * \brief Copy elements out. Only call from the consumer thread.
+         * \returns Number of elements read, which is less than count when the ring runs dry.
+         */
+        std::size_t read(T *items, const std::size_t count) {
+            const std::size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+            const std::size_t write_pos = write_pos_.load(std::memory_order_acquire);
+            const std::size_t total = std::min(count, write_pos - read_pos);
+
+            const std::size_t start = read_pos & mask_;
+            const std::size_t first_part = std::min(total, capacity() - start);
+
+            std::memcpy(items, data_.data() + start, first_part * sizeof(T));
+            std::memcpy(items + first_part, data_.data(), (total - first_part) * sizeof(T));
+
+            read_pos_.store(read_pos + total, std::memory_order_release);
+            return total;
+        }
+
+        /**
+         * \brief Get the total number of elements written so far, to be used as a mark for discard_until.
+         */
+        std::size_t write_mark() const {
+            return write_pos_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * \brief Drop unread elements written before the given mark. Only call from the consumer thread.
+         */
+        void discard_until(const std::size_t mark) {
+            const std::size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+
+            if (static_cast<std::ptrdiff_t>(mark - read_pos) > 0) {
+                read_pos_.store(mark, std::memory_order_release);
+            }
+        }
+    };
 }
@@ -40,6 +40,19 @@ namespace eka2l1 {
     template <size_t BIT>
     bool compress_rle(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size);
 
+    /**
+     * \brief Compress a buffer to RLEd in a single pass.
+     * 
+     * The compressed data is appended to the destination, so one buffer can be reused as scratch
+     * across many calls.
+     * 
+     * \param source        Pointer to the original data.
+     * \param source_size   Size of the original data in bytes. Bytes not forming a whole pixel are ignored.
+     * \param dest          Buffer which the compressed data will be appended to.
+     */
+    template <size_t BIT>
+    void compress_rle(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest);
+
     /**
      * \brief Decompress RLE compressed data.
      * 
@@ -48,4 +61,20 @@ namespace eka2l1 {
      */
     template <size_t BIT>
     void decompress_rle(common::ro_stream *source, common::wo_stream *dest);
+
+    /**
+     * \brief Decompress RLE compressed data in memory.
+     * 
+     * Decoding stops when either the source is exhausted or the destination is full.
+     * 
+     * \param source        Pointer to the compressed data.
+     * \param source_size   Size of the compressed data in bytes.
+     * \param dest          Destination buffer. Can be null to only calculate the decompressed size.
+     * \param dest_size     Size of the destination buffer in bytes.
+     * 
+     * \returns Number of bytes decompressed.
+     */
+    template <size_t BIT>
+    std::size_t decompress_rle(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest,
+        const std::size_t dest_size);
 }
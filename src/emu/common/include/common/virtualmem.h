@@ -106,4 +106,53 @@ namespace eka2l1::common {
      * \brief Returns true if the platform doesn't allow write and executable memory at the same time.
     */
     bool is_memory_wx_exclusive();
+
+    using shared_memory_handle = int;
+    static constexpr shared_memory_handle INVALID_SHARED_MEMORY_HANDLE = -1;
+
+    /**
+     * \brief Check if memory objects that can be viewed from multiple host addresses are supported.
+    */
+    bool is_shared_memory_supported();
+
+    /**
+     * \brief Create an anonymous memory object, which can be mapped at multiple host addresses at once.
+     *
+     * \param size The size of the memory object.
+     * 
+     * \returns INVALID_SHARED_MEMORY_HANDLE on failure, else the handle to the memory object.
+    */
+    shared_memory_handle create_shared_memory(const std::size_t size);
+
+    /**
+     * \brief Destroy a memory object. Existing views of it stay valid until they are unmapped.
+    */
+    void destroy_shared_memory(shared_memory_handle handle);
+
+    /**
+     * \brief Map a view of a memory object.
+     *
+     * \param handle The handle to the memory object.
+     * \param offset Offset of the view in the memory object. Must be host page aligned.
+     * \param size   Size of the view.
+     * \param target Host address to put the view at, replacing what's already there. Nullptr to let
+     *               the host choose.
+     * \param perm   The protection of the view.
+     *
+     * \returns Nullptr on failure, else pointer to the view.
+    */
+    void *map_shared_memory(shared_memory_handle handle, const std::size_t offset, const std::size_t size,
+        void *target, const prot perm);
+
+    /**
+     * \brief Unmap a view of a memory object.
+     *
+     * \param ptr           Pointer to the view.
+     * \param size          Size of the view.
+     * \param keep_reserved If true, the address range stays reserved as inaccessible memory, so
+     *                      that it can be filled with other views later.
+     *
+     * \returns True on success.
+    */
+    bool unmap_shared_memory(void *ptr, const std::size_t size, const bool keep_reserved);
 }
@@ -133,6 +133,7 @@ namespace eka2l1::common {
 
     dir_iterator::dir_iterator(const std::string &name)
         : handle(nullptr)
+        , find_data(nullptr)
         , eof(false)
         , detail(false)
         , dir_name(name) {
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/pixel.h>
+#include <common/platform.h>
+
+#include <cstring>
+
+#if EKA2L1_ARCH(X64) || defined(__SSE2__)
+#define EKA2L1_PIXEL_SSE2 1
+#include <emmintrin.h>
+#elif EKA2L1_ARCH(ARM64) || defined(__ARM_NEON)
+#define EKA2L1_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace eka2l1::common {
+    static constexpr std::uint32_t ALPHA_MASK = 0xFF000000;
+
+    static inline std::uint32_t expand_xrgb4444(const std::uint16_t word) {
+        const std::uint32_t r = (word >> 8) & 0xF;
+        const std::uint32_t g = (word >> 4) & 0xF;
+        const std::uint32_t b = word & 0xF;
+
+        return ALPHA_MASK | (r * 0x11 << 16) | (g * 0x11 << 8) | (b * 0x11);
+    }
+
+    static inline std::uint32_t expand_rgb565(const std::uint16_t word) {
+        const std::uint32_t r = word >> 11;
+        const std::uint32_t g = (word >> 5) & 0x3F;
+        const std::uint32_t b = word & 0x1F;
+
+        // Replicate the top bits into the new low bits, so full intensity stays full
+        return ALPHA_MASK | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+    }
+
+    static void convert_one_bpp_row(std::uint32_t *dest, const std::uint8_t *source, const std::size_t count,
+        const std::uint32_t *palette) {
+        std::size_t i = 0;
+
+#if EKA2L1_PIXEL_SSE2
+        const __m128i color_zero = _mm_set1_epi32(static_cast<int>(palette[0]));
+        const __m128i color_one = _mm_set1_epi32(static_cast<int>(palette[1]));
+        const __m128i bits_lo = _mm_set_epi32(8, 4, 2, 1);
+        const __m128i bits_hi = _mm_set_epi32(128, 64, 32, 16);
+
+        for (; i + 8 <= count; i += 8) {
+            const __m128i value = _mm_set1_epi32(source[i >> 3]);
+
+            const __m128i mask_lo = _mm_cmpeq_epi32(_mm_and_si128(value, bits_lo), bits_lo);
+            const __m128i mask_hi = _mm_cmpeq_epi32(_mm_and_si128(value, bits_hi), bits_hi);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i),
+                _mm_or_si128(_mm_and_si128(mask_lo, color_one), _mm_andnot_si128(mask_lo, color_zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i + 4),
+                _mm_or_si128(_mm_and_si128(mask_hi, color_one), _mm_andnot_si128(mask_hi, color_zero)));
+        }
+#elif EKA2L1_PIXEL_NEON
+        static const std::uint32_t bits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+        const uint32x4_t color_zero = vdupq_n_u32(palette[0]);
+        const uint32x4_t color_one = vdupq_n_u32(palette[1]);
+        const uint32x4_t bits_lo = vld1q_u32(bits);
+        const uint32x4_t bits_hi = vld1q_u32(bits + 4);
+
+        for (; i + 8 <= count; i += 8) {
+            const uint32x4_t value = vdupq_n_u32(source[i >> 3]);
+
+            vst1q_u32(dest + i, vbslq_u32(vtstq_u32(value, bits_lo), color_one, color_zero));
+            vst1q_u32(dest + i + 4, vbslq_u32(vtstq_u32(value, bits_hi), color_one, color_zero));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = palette[(source[i >> 3] >> (i & 7)) & 1];
+        }
+    }
+
+    void convert_palette_row_to_bgra32(std::uint32_t *dest, const std::uint8_t *source, const std::size_t count,
+        const int bits_per_pixel, const std::uint32_t *palette) {
+        // There is no gather on SSE2 nor NEON, so lookups of wider indices stay scalar.
+        // They are unrolled per source byte instead.
+        std::size_t i = 0;
+
+        switch (bits_per_pixel) {
+        case 1:
+            convert_one_bpp_row(dest, source, count, palette);
+            break;
+
+        case 2:
+            for (; i + 4 <= count; i += 4) {
+                const std::uint8_t value = source[i >> 2];
+
+                dest[i] = palette[value & 3];
+                dest[i + 1] = palette[(value >> 2) & 3];
+                dest[i + 2] = palette[(value >> 4) & 3];
+                dest[i + 3] = palette[value >> 6];
+            }
+
+            for (; i < count; i++) {
+                dest[i] = palette[(source[i >> 2] >> ((i & 3) * 2)) & 3];
+            }
+
+            break;
+
+        case 4:
+            for (; i + 2 <= count; i += 2) {
+                const std::uint8_t value = source[i >> 1];
+
+                dest[i] = palette[value & 0xF];
+                dest[i + 1] = palette[value >> 4];
+            }
+
+            if (i < count) {
+                dest[i] = palette[source[i >> 1] & 0xF];
+            }
+
+            break;
+
+        case 8:
+            for (; i < count; i++) {
+                dest[i] = palette[source[i]];
+            }
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void convert_xrgb4444_row_to_bgra32(std::uint32_t *dest, const std::uint16_t *source, const std::size_t count) {
+        std::size_t i = 0;
+
+#if EKA2L1_PIXEL_SSE2
+        const __m128i nibble = _mm_set1_epi16(0xF);
+        const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+        for (; i + 8 <= count; i += 8) {
+            const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+
+            const __m128i b = _mm_and_si128(words, nibble);
+            const __m128i g = _mm_and_si128(_mm_srli_epi16(words, 4), nibble);
+            const __m128i r = _mm_and_si128(_mm_srli_epi16(words, 8), nibble);
+
+            // Each 16-bit lane holds two bytes: blue and green, then red and alpha
+            const __m128i bg = _mm_or_si128(_mm_or_si128(b, _mm_slli_epi16(b, 4)), _mm_or_si128(_mm_slli_epi16(g, 8), _mm_slli_epi16(g, 12)));
+            const __m128i ra = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi16(r, 4)), alpha);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_unpacklo_epi16(bg, ra));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i + 4), _mm_unpackhi_epi16(bg, ra));
+        }
+#elif EKA2L1_PIXEL_NEON
+        const uint16x8_t nibble = vdupq_n_u16(0xF);
+
+        for (; i + 8 <= count; i += 8) {
+            const uint16x8_t words = vld1q_u16(source + i);
+
+            const uint16x8_t b = vandq_u16(words, nibble);
+            const uint16x8_t g = vandq_u16(vshrq_n_u16(words, 4), nibble);
+            const uint16x8_t r = vandq_u16(vshrq_n_u16(words, 8), nibble);
+
+            uint8x8x4_t pixels;
+            pixels.val[0] = vmovn_u16(vorrq_u16(b, vshlq_n_u16(b, 4)));
+            pixels.val[1] = vmovn_u16(vorrq_u16(g, vshlq_n_u16(g, 4)));
+            pixels.val[2] = vmovn_u16(vorrq_u16(r, vshlq_n_u16(r, 4)));
+            pixels.val[3] = vdup_n_u8(0xFF);
+
+            vst4_u8(reinterpret_cast<std::uint8_t *>(dest + i), pixels);
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = expand_xrgb4444(source[i]);
+        }
+    }
+
+    void convert_rgb565_row_to_bgra32(std::uint32_t *dest, const std::uint16_t *source, const std::size_t count) {
+        std::size_t i = 0;
+
+#if EKA2L1_PIXEL_SSE2
+        const __m128i five_bits = _mm_set1_epi16(0x1F);
+        const __m128i six_bits = _mm_set1_epi16(0x3F);
+        const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+        for (; i + 8 <= count; i += 8) {
+            const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+
+            const __m128i r5 = _mm_srli_epi16(words, 11);
+            const __m128i g6 = _mm_and_si128(_mm_srli_epi16(words, 5), six_bits);
+            const __m128i b5 = _mm_and_si128(words, five_bits);
+
+            const __m128i r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+            const __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+            const __m128i b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+
+            const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+            const __m128i ra = _mm_or_si128(r, alpha);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_unpacklo_epi16(bg, ra));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i + 4), _mm_unpackhi_epi16(bg, ra));
+        }
+#elif EKA2L1_PIXEL_NEON
+        const uint16x8_t five_bits = vdupq_n_u16(0x1F);
+        const uint16x8_t six_bits = vdupq_n_u16(0x3F);
+
+        for (; i + 8 <= count; i += 8) {
+            const uint16x8_t words = vld1q_u16(source + i);
+
+            const uint16x8_t r5 = vshrq_n_u16(words, 11);
+            const uint16x8_t g6 = vandq_u16(vshrq_n_u16(words, 5), six_bits);
+            const uint16x8_t b5 = vandq_u16(words, five_bits);
+
+            uint8x8x4_t pixels;
+            pixels.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2)));
+            pixels.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g6, 2), vshrq_n_u16(g6, 4)));
+            pixels.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2)));
+            pixels.val[3] = vdup_n_u8(0xFF);
+
+            vst4_u8(reinterpret_cast<std::uint8_t *>(dest + i), pixels);
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = expand_rgb565(source[i]);
+        }
+    }
+
+    void convert_bgr24_row_to_bgra32(std::uint32_t *dest, const std::uint8_t *source, const std::size_t count) {
+        std::size_t i = 0;
+
+#if EKA2L1_PIXEL_NEON
+        const uint8x16_t alpha = vdupq_n_u8(0xFF);
+
+        for (; i + 16 <= count; i += 16) {
+            const uint8x16x3_t bgr = vld3q_u8(source + i * 3);
+
+            uint8x16x4_t pixels;
+            pixels.val[0] = bgr.val[0];
+            pixels.val[1] = bgr.val[1];
+            pixels.val[2] = bgr.val[2];
+            pixels.val[3] = alpha;
+
+            vst4q_u8(reinterpret_cast<std::uint8_t *>(dest + i), pixels);
+        }
+#endif
+
+        // Read the pixel with the first byte of the next one, then replace that byte with the alpha.
+        // SSE2 has no byte shuffle, this already lets the compiler use plain 32-bit loads.
+        for (; i + 1 < count; i++) {
+            std::uint32_t value = 0;
+            std::memcpy(&value, source + i * 3, sizeof(value));
+
+            dest[i] = value | ALPHA_MASK;
+        }
+
+        if (i < count) {
+            dest[i] = ALPHA_MASK | (static_cast<std::uint32_t>(source[i * 3 + 2]) << 16)
+                | (static_cast<std::uint32_t>(source[i * 3 + 1]) << 8) | source[i * 3];
+        }
+    }
+
+    void convert_bgrx32_row_to_bgra32(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count) {
+        std::size_t i = 0;
+
+#if EKA2L1_PIXEL_SSE2
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_or_si128(pixels, alpha));
+        }
+#elif EKA2L1_PIXEL_NEON
+        const uint32x4_t alpha = vdupq_n_u32(ALPHA_MASK);
+
+        for (; i + 4 <= count; i += 4) {
+            vst1q_u32(dest + i, vorrq_u32(vld1q_u32(source + i), alpha));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = source[i] | ALPHA_MASK;
+        }
+    }
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/profiler.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace eka2l1::common {
+    static std::size_t latency_bucket_index(const std::uint64_t ns) {
+        std::size_t index = 0;
+        std::uint64_t value = ns >> 1;
+
+        while (value && (index < latency_histogram::BUCKET_COUNT - 1)) {
+            value >>= 1;
+            index++;
+        }
+
+        return index;
+    }
+
+    void latency_histogram::record(const std::uint64_t ns) {
+        if (count_ == 0) {
+            min_ns_ = ns;
+            max_ns_ = ns;
+        } else {
+            min_ns_ = std::min(min_ns_, ns);
+            max_ns_ = std::max(max_ns_, ns);
+        }
+
+        count_++;
+        total_ns_ += ns;
+        buckets_[latency_bucket_index(ns)]++;
+    }
+
+    std::uint64_t latency_histogram::percentile(const double fraction) const {
+        if (count_ == 0) {
+            return 0;
+        }
+
+        const std::uint64_t target = std::max<std::uint64_t>(1,
+            static_cast<std::uint64_t>(fraction * static_cast<double>(count_) + 0.5));
+        std::uint64_t accumulated = 0;
+
+        for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+            accumulated += buckets_[i];
+
+            if (accumulated >= target) {
+                return std::min<std::uint64_t>(max_ns_, (2ULL << i) - 1);
+            }
+        }
+
+        return max_ns_;
+    }
+
+    const char *call_profile_category_name(const call_profile_category category) {
+        switch (category) {
+        case call_profile_category_svc:
+            return "svc";
+
+        case call_profile_category_ipc:
+            return "ipc";
+
+        case call_profile_category_dispatch:
+            return "dispatch";
+
+        default:
+            break;
+        }
+
+        return "unknown";
+    }
+
+    call_profiler::call_profiler(const bool enabled)
+        : enabled_(enabled) {
+    }
+
+    void call_profiler::record(const call_profile_category category, const std::uint32_t owner, const std::uint32_t ordinal,
+        const std::string &group, const std::string &name, const std::uint64_t ns) {
+        const std::uint64_t key = (static_cast<std::uint64_t>(category) << 56) | (static_cast<std::uint64_t>(owner & 0xFFFFFF) << 32)
+            | ordinal;
+
+        const std::lock_guard<std::mutex> guard(lock_);
+        auto ite = entries_.find(key);
+
+        if (ite == entries_.end()) {
+            call_profile_entry entry;
+            entry.category_ = category;
+            entry.owner_ = owner;
+            entry.ordinal_ = ordinal;
+            entry.group_ = group;
+            entry.name_ = name;
+
+            ite = entries_.emplace(key, std::move(entry)).first;
+        }
+
+        ite->second.histogram_.record(ns);
+    }
+
+    std::vector<call_profile_entry> call_profiler::snapshot() const {
+        std::vector<call_profile_entry> result;
+
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            result.reserve(entries_.size());
+
+            for (const auto &[key, entry] : entries_) {
+                result.push_back(entry);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const call_profile_entry &lhs, const call_profile_entry &rhs) {
+            return lhs.histogram_.total_ns_ > rhs.histogram_.total_ns_;
+        });
+
+        return result;
+    }
+
+    void call_profiler::reset() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        entries_.clear();
+    }
+
+    bool call_profiler::empty() const {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return entries_.empty();
+    }
+
+    static std::string escape_json_string(const std::string &str) {
+        std::string result;
+        result.reserve(str.size());
+
+        for (const char c : str) {
+            switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+
+            case '\\':
+                result += "\\\\";
+                break;
+
+            case '\n':
+                result += "\\n";
+                break;
+
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    continue;
+                }
+
+                result += c;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    static std::string escape_csv_string(const std::string &str) {
+        if (str.find_first_of(",\"\n") == std::string::npos) {
+            return str;
+        }
+
+        std::string result = "\"";
+
+        for (const char c : str) {
+            if (c == '"') {
+                result += '"';
+            }
+
+            result += c;
+        }
+
+        result += '"';
+        return result;
+    }
+
+    bool call_profiler::dump_json(const std::string &path) const {
+        std::ofstream out(path);
+
+        if (!out) {
+            return false;
+        }
+
+        const std::vector<call_profile_entry> entries = snapshot();
+
+        out << "{\n    \"entries\": [";
+
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            const call_profile_entry &entry = entries[i];
+            const latency_histogram &hist = entry.histogram_;
+
+            out << (i == 0 ? "\n" : ",\n");
+            out << "        {\n";
+            out << "            \"category\": \"" << call_profile_category_name(entry.category_) << "\",\n";
+            out << "            \"group\": \"" << escape_json_string(entry.group_) << "\",\n";
+            out << "            \"name\": \"" << escape_json_string(entry.name_) << "\",\n";
+            out << "            \"ordinal\": " << entry.ordinal_ << ",\n";
+            out << "            \"count\": " << hist.count_ << ",\n";
+            out << "            \"total_ns\": " << hist.total_ns_ << ",\n";
+            out << "            \"min_ns\": " << hist.min_ns_ << ",\n";
+            out << "            \"avg_ns\": " << hist.average() << ",\n";
+            out << "            \"p50_ns\": " << hist.percentile(0.5) << ",\n";
+            out << "            \"p99_ns\": " << hist.percentile(0.99) << ",\n";
+            out << "            \"max_ns\": " << hist.max_ns_ << ",\n";
+            out << "            \"buckets\": [";
+
+            // Trim trailing empty buckets, they are implied
+            std::size_t bucket_count = latency_histogram::BUCKET_COUNT;
+
+            while (bucket_count > 0 && hist.buckets_[bucket_count - 1] == 0) {
+                bucket_count--;
+            }
+
+            for (std::size_t j = 0; j < bucket_count; j++) {
+                out << (j == 0 ? "" : ", ") << hist.buckets_[j];
+            }
+
+            out << "]\n        }";
+        }
+
+        out << "\n    ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    bool call_profiler::dump_csv(const std::string &path) const {
+        std::ofstream out(path);
+
+        if (!out) {
+            return false;
+        }
+
+        const std::vector<call_profile_entry> entries = snapshot();
+
+        out << "category,group,name,ordinal,count,total_ns,min_ns,avg_ns,p50_ns,p99_ns,max_ns\n";
+
+        for (const call_profile_entry &entry : entries) {
+            const latency_histogram &hist = entry.histogram_;
+
+            out << call_profile_category_name(entry.category_) << ',' << escape_csv_string(entry.group_) << ','
+                << escape_csv_string(entry.name_) << ',' << entry.ordinal_ << ',' << hist.count_ << ','
+                << hist.total_ns_ << ',' << hist.min_ns_ << ',' << hist.average() << ',' << hist.percentile(0.5) << ','
+                << hist.percentile(0.99) << ',' << hist.max_ns_ << '\n';
+        }
+
+        return static_cast<bool>(out);
+    }
+}
@@ -41,8 +41,12 @@ namespace eka2l1::common {
         return eka2l1::rect { tl, br - tl };
     }
 
+    static bool is_rect_area_empty(const eka2l1::rect &rect) {
+        return (rect.size.x <= 0) || (rect.size.y <= 0);
+    }
+
     bool region::add_rect(const eka2l1::rect &rect) {
-        if (rect.empty()) {
+        if (is_rect_area_empty(rect)) {
             return true;
         }
 
@@ -63,32 +67,24 @@ namespace eka2l1::common {
                 (rects_[i].top.y + rects_[i].size.y <= rect.top.y) || (rects_[i].top.y >= rect.top.y + rect.size.y))
                 continue;
 
-            if ((rects_[i].top.x <= rect.top.x) && (rects_[i].top.y <= rect.top.y) && 
-                (rects_[i].top.x + rects_[i].size.x >= rect.top.x + rect.size.x) && 
-                (rects_[i].top.y + rects_[i].size.y >= rect.top.y + rect.size.y)) {
+            if (rects_[i].contains(rect)) {
                 // This rectangle already covers the new rectangle, no modification done
                 return false;
             }
 
-            eka2l1::rect intersector;
-            intersector = rect.intersect(rects_[i]);
-
-            if (intersector.top.y + intersector.size.y != rect.top.y + rect.size.y)
-                rects_.push_back(eka2l1::rect( { rect.top.x, intersector.top.y }, { rect.size.x, rect.size.y + rect.top.y - intersector.top.y }));
+            // Only add the parts of the new rectangle that are not covered yet. Those parts
+            // may still overlap with other rectangles, so add them one by one.
+            region remaining;
+            remaining.rects_.push_back(rect);
+            remaining.eliminate(rects_[i]);
 
-            if (intersector.top.y != rect.top.y)
-                rects_.push_back(eka2l1::rect( { rect.top.x, rect.top.y }, { rect.size.x, intersector.top.y - rect.top.y }));
+            bool modified = false;
 
-			if (intersector.top.x + intersector.size.x != rect.top.x + rect.size.x)
-				rects_.push_back(eka2l1::rect({ intersector.top.x + intersector.size.x, intersector.top.y },
-                    { rect.top.x + rect.size.x - intersector.top.x - intersector.size.x, intersector.size.y }));
-
-            if (intersector.top.x != rect.top.x)
-                rects_.push_back(eka2l1::rect( { rect.top.x, intersector.top.y }, { intersector.top.x - rect.top.x,
-                    intersector.size.y}));
+            for (const eka2l1::rect &part : remaining.rects_) {
+                modified |= add_rect(part);
+            }
 
-            rects_.erase(rects_.begin() + i);
-            return true;
+            return modified;
         }
 
         rects_.push_back(rect);
@@ -96,50 +92,44 @@ namespace eka2l1::common {
     }
 
     void region::eliminate(const eka2l1::rect &rect) {
-        if (rect.empty()) {
+        if (is_rect_area_empty(rect)) {
             return;
         }
 
-        std::size_t limit = rects_.size();
+        std::vector<eka2l1::rect> result;
+        result.reserve(rects_.size() + 4);
 
-        for (std::size_t i = 0; i < limit; i++) {
-            if ((rect.top == rects_[i].top) && (rect.size == rects_[i].size)) {
-                rects_.erase(rects_.begin() + i);
-                return;
-            }
-            
-            const eka2l1::rect intersection_reg = rect.intersect(rects_[i]);
+        for (const eka2l1::rect &original_iterate : rects_) {
+            const eka2l1::rect intersection_reg = rect.intersect(original_iterate);
 
-            if (!intersection_reg.empty()) {
-                const eka2l1::rect original_iterate = rects_[i];
-                rects_.erase(rects_.begin() + i);
-
-                const eka2l1::vec2 intersect_reg_br = intersection_reg.bottom_right();
-                const eka2l1::vec2 iterate_br = original_iterate.bottom_right();
+            if (is_rect_area_empty(intersection_reg)) {
+                result.push_back(original_iterate);
+                continue;
+            }
 
-                if (iterate_br.y != intersect_reg_br.y) {
-                    rects_.push_back(eka2l1::rect({ original_iterate.top.x, intersect_reg_br.y }, { iterate_br.x, iterate_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+            // Split what's left of the rectangle into at most 4 pieces: the bands above and below
+            // the intersection, and the parts left and right of it.
+            const eka2l1::vec2 intersect_reg_br = intersection_reg.bottom_right();
+            const eka2l1::vec2 iterate_br = original_iterate.bottom_right();
 
-                if (iterate_br.x != intersect_reg_br.x) {
-                    rects_.push_back(eka2l1::rect({ intersect_reg_br.x, intersection_reg.top.y }, { iterate_br.x, intersect_reg_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+            if (intersection_reg.top.y != original_iterate.top.y) {
+                result.emplace_back(original_iterate.top, eka2l1::vec2(original_iterate.size.x, intersection_reg.top.y - original_iterate.top.y));
+            }
 
-                if (intersection_reg.top.x != original_iterate.top.x) {
-                    rects_.push_back(eka2l1::rect({ original_iterate.top.x, intersection_reg.top.y }, { intersection_reg.top.x, intersect_reg_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+            if (iterate_br.y != intersect_reg_br.y) {
+                result.emplace_back(eka2l1::vec2(original_iterate.top.x, intersect_reg_br.y), eka2l1::vec2(original_iterate.size.x, iterate_br.y - intersect_reg_br.y));
+            }
 
-                if (intersection_reg.top.y != original_iterate.top.y) {
-                    rects_.push_back(eka2l1::rect(original_iterate.top, { iterate_br.x, intersection_reg.top.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+            if (intersection_reg.top.x != original_iterate.top.x) {
+                result.emplace_back(eka2l1::vec2(original_iterate.top.x, intersection_reg.top.y), eka2l1::vec2(intersection_reg.top.x - original_iterate.top.x, intersection_reg.size.y));
+            }
 
-                limit--;
+            if (iterate_br.x != intersect_reg_br.x) {
+                result.emplace_back(eka2l1::vec2(intersect_reg_br.x, intersection_reg.top.y), eka2l1::vec2(iterate_br.x - intersect_reg_br.x, intersection_reg.size.y));
             }
         }
+
+        rects_ = std::move(result);
     }
 
     void region::eliminate(const region &reg) {
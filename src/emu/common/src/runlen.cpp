@@ -21,163 +21,309 @@
 #include <common/algorithm.h>
 #include <common/buffer.h>
 #include <common/log.h>
+#include <common/platform.h>
 #include <common/runlen.h>
 
-namespace eka2l1 {
-    template <size_t BIT>
-    bool compress_rle(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size) {
-        static_assert(BIT % 8 == 0, "This RLE compress function don't support unaligned bit decompress!");
-        dest_size = 0;
+#include <cstring>
 
-        while (source->valid() && (!dest || dest->valid())) {
-            // Read 3 bytes
-            static constexpr std::int32_t BYTE_COUNT = BIT / 8;
+#if EKA2L1_ARCH(X64) || defined(__SSE2__)
+#define EKA2L1_RUNLEN_SSE2 1
+#include <emmintrin.h>
+#endif
 
-            std::uint8_t bytes[BYTE_COUNT];
-            std::uint64_t last_position = source->tell();
+namespace eka2l1 {
+    static inline int first_set_bit(const std::uint32_t mask) {
+        return common::count_bit_set((mask & (~mask + 1)) - 1);
+    }
+
+    /**
+     * \brief Find where a run of equal pixels starting at the given pixel ends.
+     * \returns Index of the first pixel not equal to the one before it, or the pixel count.
+     */
+    template <std::size_t BYTE_COUNT>
+    static std::size_t find_run_end(const std::uint8_t *source, const std::size_t start, const std::size_t count) {
+        // Equal pixels one after another means every byte equals the byte one pixel before it
+        std::size_t offset = (start + 1) * BYTE_COUNT;
+        const std::size_t end = count * BYTE_COUNT;
+
+#if EKA2L1_RUNLEN_SSE2
+        for (; offset + 16 <= end; offset += 16) {
+            const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + offset));
+            const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + offset - BYTE_COUNT));
+            const std::uint32_t equal_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)));
+
+            if (equal_mask != 0xFFFF) {
+                return (offset + first_set_bit(~equal_mask & 0xFFFF)) / BYTE_COUNT;
+            }
+        }
+#endif
 
-            if (source->read(bytes, BYTE_COUNT) != BYTE_COUNT) {
-                return false;
+        for (; offset < end; offset++) {
+            if (source[offset] != source[offset - BYTE_COUNT]) {
+                return offset / BYTE_COUNT;
             }
+        }
+
+        return count;
+    }
+
+    /**
+     * \brief Find where a sequence of unique pixels starting at the given pixel ends.
+     * 
+     * The sequence keeps the first pixel of the equal pair that stops it. A pair made
+     * of the last two pixels does not stop it.
+     * 
+     * \returns Index of the first pixel after the sequence.
+     */
+    template <std::size_t BYTE_COUNT>
+    static std::size_t find_unique_end(const std::uint8_t *source, const std::size_t start, const std::size_t count) {
+        if (count < start + 3) {
+            return count;
+        }
 
-            std::uint8_t temp_bytes[BYTE_COUNT];
+        // Looking for pixel k where pixel k equals pixel k + 1, and k + 2 is still in range
+        const std::size_t limit = count - 2;
+        std::size_t k = start + 1;
 
-            if ((source->read(temp_bytes, BYTE_COUNT) == BYTE_COUNT) && std::equal(bytes, bytes + BYTE_COUNT, temp_bytes)) {
-                // Seek back BYTE_COUNT in prepare of the do while loop
-                source->seek(-BYTE_COUNT, common::seek_where::cur);
+#if EKA2L1_RUNLEN_SSE2
+        if constexpr ((BYTE_COUNT == 1) || (BYTE_COUNT == 2) || (BYTE_COUNT == 4)) {
+            static constexpr std::size_t PIXELS_PER_LOOP = 16 / BYTE_COUNT;
 
-                do {
-                    source->read(temp_bytes, static_cast<std::uint64_t>(BYTE_COUNT));
-                } while (source->valid() && std::equal(bytes, bytes + BYTE_COUNT, temp_bytes));
+            for (; k + PIXELS_PER_LOOP <= limit; k += PIXELS_PER_LOOP) {
+                const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + k * BYTE_COUNT));
+                const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + (k + 1) * BYTE_COUNT));
 
-                // Seek back again, to evade the unequal sequence
-                if (source->valid()) {
-                    source->seek(-BYTE_COUNT, common::seek_where::cur);
+                __m128i equal;
+
+                if constexpr (BYTE_COUNT == 1) {
+                    equal = _mm_cmpeq_epi8(current, next);
+                } else if constexpr (BYTE_COUNT == 2) {
+                    equal = _mm_cmpeq_epi16(current, next);
+                } else {
+                    equal = _mm_cmpeq_epi32(current, next);
                 }
 
-                const std::uint64_t total_bytes_repeated = source->tell() - last_position;
-                assert(total_bytes_repeated % BYTE_COUNT == 0);
+                const std::uint32_t equal_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(equal));
+
+                if (equal_mask != 0) {
+                    return k + first_set_bit(equal_mask) / BYTE_COUNT + 1;
+                }
+            }
+        }
+#endif
+
+        for (; k < limit; k++) {
+            if (std::memcmp(source + k * BYTE_COUNT, source + (k + 1) * BYTE_COUNT, BYTE_COUNT) == 0) {
+                return k + 1;
+            }
+        }
+
+        return count;
+    }
+
+    template <size_t BIT>
+    void compress_rle(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest) {
+        static_assert(BIT % 8 == 0, "This RLE compress function don't support unaligned bit decompress!");
+        static constexpr std::size_t BYTE_COUNT = BIT / 8;
+
+        const std::size_t count = source_size / BYTE_COUNT;
+
+        // Worst case is a header byte for every pixel. Only reserve it, so nothing gets zero-filled
+        dest.reserve(dest.size() + count * (BYTE_COUNT + 1));
 
-                std::int64_t total_pair = static_cast<std::int64_t>(total_bytes_repeated / BYTE_COUNT);
+        std::size_t i = 0;
+
+        while (i < count) {
+            const std::uint8_t *pixel = source + i * BYTE_COUNT;
+
+            if ((i + 1 < count) && (std::memcmp(pixel, pixel + BYTE_COUNT, BYTE_COUNT) == 0)) {
+                const std::size_t end = find_run_end<BYTE_COUNT>(source, i, count);
+                std::size_t total_pair = end - i;
 
                 while (total_pair > 0) {
-                    std::uint8_t total_this_session = (total_pair > 128) ? 127 : static_cast<std::uint8_t>(total_pair - 1);
+                    const std::size_t total_this_session = common::min<std::size_t>(total_pair, 128);
 
-                    if (dest) {
-                        dest->write(&total_this_session, 1);
-                        dest->write(bytes, BYTE_COUNT);
-                    }
+                    dest.push_back(static_cast<std::uint8_t>(total_this_session - 1));
+                    dest.insert(dest.end(), pixel, pixel + BYTE_COUNT);
 
-                    dest_size += BYTE_COUNT + 1;
-                    total_pair -= (total_this_session + 1);
+                    total_pair -= total_this_session;
                 }
-            } else {
-                // Seek back BYTE_COUNT in prepare of the do while loop
-                source->seek(-BYTE_COUNT, common::seek_where::cur);
 
-                bool should_copy = false;
+                i = end;
+            } else {
+                const std::size_t end = find_unique_end<BYTE_COUNT>(source, i, count);
+                std::size_t total_pair = end - i;
 
-                do {
-                    if (should_copy)
-                        std::copy(temp_bytes, temp_bytes + BYTE_COUNT, bytes);
+                while (total_pair > 0) {
+                    const std::size_t total_this_session = common::min<std::size_t>(total_pair, 128);
+                    const std::size_t total_bytes = total_this_session * BYTE_COUNT;
 
-                    source->read(temp_bytes, static_cast<std::uint64_t>(BYTE_COUNT));
-                    should_copy = true;
-                } while (source->valid() && !std::equal(bytes, bytes + BYTE_COUNT, temp_bytes));
+                    dest.push_back(static_cast<std::uint8_t>(-static_cast<std::int32_t>(total_this_session)));
+                    dest.insert(dest.end(), pixel, pixel + total_bytes);
 
-                if (source->valid()) {
-                    source->seek(-BYTE_COUNT, common::seek_where::cur);
+                    pixel += total_bytes;
+                    total_pair -= total_this_session;
                 }
 
-                const std::uint64_t total_bytes_repeated = source->tell() - last_position;
-                std::int64_t total_pair = static_cast<std::int64_t>(total_bytes_repeated / BYTE_COUNT);
+                i = end;
+            }
+        }
+    }
 
-                if (dest) {
-                    source->seek(last_position, common::seek_where::beg);
-                }
+    template <size_t BIT>
+    bool compress_rle(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size) {
+        static constexpr std::uint64_t BYTE_COUNT = BIT / 8;
 
-                std::vector<std::uint8_t> temp_data;
+        std::vector<std::uint8_t> source_data(static_cast<std::size_t>(source->left()));
+        dest_size = 0;
 
-                while (total_pair > 0) {
-                    std::int8_t total_this_session = (total_pair > 128) ? -128 : static_cast<std::int8_t>(-total_pair);
+        if (!source_data.empty() && (source->read(source_data.data(), source_data.size()) != source_data.size())) {
+            return false;
+        }
 
-                    if (dest) {
-                        dest->write(&total_this_session, 1);
+        std::vector<std::uint8_t> compressed;
+        compress_rle<BIT>(source_data.data(), source_data.size(), compressed);
+
+        dest_size = compressed.size();
+
+        if (dest && !compressed.empty() && (dest->write(compressed.data(), compressed.size()) != compressed.size())) {
+            return false;
+        }
+
+        return (source_data.size() % BYTE_COUNT) == 0;
+    }
 
-                        // Read the source
-                        temp_data.resize(total_this_session * -BYTE_COUNT);
-                        source->read(&temp_data[0], temp_data.size());
-                        dest->write(&temp_data[0], static_cast<std::uint32_t>(temp_data.size()));
-                    }
+    /**
+     * \brief Fill the destination with copies of a pixel.
+     * 
+     * The pixel is repeated into a pattern block first, so the run is written with
+     * wide stores instead of pixel by pixel.
+     */
+    template <std::size_t BYTE_COUNT>
+    static void fill_run(std::uint8_t *dest, const std::uint8_t *pixel, const std::size_t total_bytes) {
+        if constexpr (BYTE_COUNT == 1) {
+            std::memset(dest, *pixel, total_bytes);
+        } else {
+            // Smallest block that holds whole pixels and is a multiple of 16 bytes
+            static constexpr std::size_t BLOCK_SIZE = (BYTE_COUNT == 3) ? 48 : 16;
+            std::size_t offset = 0;
+
+            if (total_bytes >= BLOCK_SIZE) {
+                std::uint8_t pattern[BLOCK_SIZE];
+
+                for (std::size_t i = 0; i < BLOCK_SIZE; i += BYTE_COUNT) {
+                    std::memcpy(pattern + i, pixel, BYTE_COUNT);
+                }
 
-                    dest_size += 1 + static_cast<std::size_t>(total_this_session * -BYTE_COUNT);
+                for (; offset + BLOCK_SIZE <= total_bytes; offset += BLOCK_SIZE) {
+                    std::memcpy(dest + offset, pattern, BLOCK_SIZE);
+                }
 
-                    // Negative already!
-                    total_pair += total_this_session;
+                if ((offset < total_bytes) && (total_bytes % BYTE_COUNT == 0)) {
+                    // Ending on a pixel boundary, the last block can overlap the previous one
+                    std::memcpy(dest + total_bytes - BLOCK_SIZE, pattern, BLOCK_SIZE);
+                    return;
                 }
             }
-        }
 
-        return true;
+            for (; offset + BYTE_COUNT <= total_bytes; offset += BYTE_COUNT) {
+                std::memcpy(dest + offset, pixel, BYTE_COUNT);
+            }
+        }
     }
 
     template <size_t BIT>
-    void decompress_rle(common::ro_stream *source, common::wo_stream *dest) {
+    std::size_t decompress_rle(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest,
+        const std::size_t dest_size) {
         static_assert(BIT % 8 == 0, "This RLE decompress function don't support unaligned bit decompress!");
+        static constexpr std::size_t BYTE_COUNT = BIT / 8;
 
-        while (source->valid() && dest->valid()) {
-            std::int8_t count8 = 0;
-            source->read(&count8, 1);
-
-            std::int32_t count = count8;
+        const std::uint8_t *source_end = source + source_size;
+        std::size_t written = 0;
 
-            constexpr int BYTE_COUNT = static_cast<int>(BIT) / 8;
+        while ((source < source_end) && (written < dest_size)) {
+            const std::int32_t count = static_cast<std::int8_t>(*source++);
 
             if (count >= 0) {
-                count = common::min(count, static_cast<const std::int32_t>(dest->left() / BYTE_COUNT));
-                std::uint8_t comp[BYTE_COUNT];
+                if (source_end - source < static_cast<std::ptrdiff_t>(BYTE_COUNT)) {
+                    break;
+                }
 
-                for (std::size_t i = 0; i < BYTE_COUNT; i++) {
-                    source->read(&comp[i], 1);
+                const std::size_t total_bytes = common::min<std::size_t>((count + 1) * BYTE_COUNT,
+                    (dest_size - written) / BYTE_COUNT * BYTE_COUNT);
+
+                if (dest) {
+                    fill_run<BYTE_COUNT>(dest + written, source, total_bytes);
                 }
 
-                while (count >= 0) {
-                    for (std::size_t i = 0; i < BYTE_COUNT; i++) {
-                        dest->write(&comp[i], 1);
-                    }
+                source += BYTE_COUNT;
+                written += total_bytes;
 
-                    count--;
+                if (total_bytes == 0) {
+                    break;
                 }
             } else {
-                std::uint32_t num_bytes_to_copy = static_cast<std::uint32_t>(count * -BYTE_COUNT);
-                num_bytes_to_copy = common::min(num_bytes_to_copy, static_cast<const std::uint32_t>(dest->left()));
+                std::size_t total_bytes = common::min<std::size_t>(static_cast<std::size_t>(-count) * BYTE_COUNT,
+                    dest_size - written);
 
-                std::vector<std::uint8_t> temp_buf_holder;
-                temp_buf_holder.resize(num_bytes_to_copy);
+                total_bytes = common::min<std::size_t>(total_bytes, source_end - source);
 
-                source->read(&temp_buf_holder[0], num_bytes_to_copy);
-                dest->write(temp_buf_holder.data(), num_bytes_to_copy);
+                if (dest) {
+                    std::memcpy(dest + written, source, total_bytes);
+                }
+
+                source += total_bytes;
+                written += total_bytes;
             }
         }
+
+        return written;
     }
 
     template <>
-    void decompress_rle<12>(common::ro_stream *source, common::wo_stream *dest) {
-        while (source->valid() && dest->valid()) {
+    std::size_t decompress_rle<12>(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest,
+        const std::size_t dest_size) {
+        const std::uint8_t *source_end = source + (source_size & ~1);
+        std::size_t written = 0;
+
+        while ((source < source_end) && (written + 2 <= dest_size)) {
             std::uint16_t val = 0;
-            if (source->read(&val, 2) != 2) {
-                return;
-            }
+            std::memcpy(&val, source, 2);
 
-            std::uint32_t repeat_count = common::min<std::uint32_t>(static_cast<std::uint32_t>((val >> 12) & 0xF),
-                static_cast<const std::uint32_t>(dest->left() / 2));
+            source += 2;
 
-            val &= 0x0FFF;
+            const std::size_t total_bytes = common::min<std::size_t>((((val >> 12) & 0xF) + 1) * 2,
+                (dest_size - written) & ~1);
 
-            for (std::uint32_t i = 0; i <= repeat_count; i++) {
-                dest->write(&val, 2);
+            if (dest) {
+                val &= 0x0FFF;
+                fill_run<2>(dest + written, reinterpret_cast<const std::uint8_t *>(&val), total_bytes);
             }
+
+            written += total_bytes;
+        }
+
+        return written;
+    }
+
+    template <size_t BIT>
+    void decompress_rle(common::ro_stream *source, common::wo_stream *dest) {
+        std::vector<std::uint8_t> source_data(static_cast<std::size_t>(source->left()));
+
+        if (source_data.empty()) {
+            return;
         }
+
+        source_data.resize(static_cast<std::size_t>(source->read(source_data.data(), source_data.size())));
+
+        // Measure first, the destination may claim far more space than the data needs
+        const std::size_t dest_size = static_cast<std::size_t>(common::min<std::uint64_t>(dest->left(),
+            decompress_rle<BIT>(source_data.data(), source_data.size(), nullptr, static_cast<std::size_t>(dest->left()))));
+
+        std::vector<std::uint8_t> dest_data(dest_size);
+        decompress_rle<BIT>(source_data.data(), source_data.size(), dest_data.data(), dest_size);
+
+        dest->write(dest_data.data(), dest_size);
     }
 
     template bool compress_rle<8>(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size);
@@ -185,8 +331,19 @@ namespace eka2l1 {
     template bool compress_rle<24>(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size);
     template bool compress_rle<32>(common::ro_stream *source, common::wo_stream *dest, std::size_t &dest_size);
 
+    template void compress_rle<8>(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest);
+    template void compress_rle<16>(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest);
+    template void compress_rle<24>(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest);
+    template void compress_rle<32>(const std::uint8_t *source, const std::size_t source_size, std::vector<std::uint8_t> &dest);
+
     template void decompress_rle<8>(common::ro_stream *source, common::wo_stream *dest);
+    template void decompress_rle<12>(common::ro_stream *source, common::wo_stream *dest);
     template void decompress_rle<16>(common::ro_stream *source, common::wo_stream *dest);
     template void decompress_rle<24>(common::ro_stream *source, common::wo_stream *dest);
     template void decompress_rle<32>(common::ro_stream *source, common::wo_stream *dest);
+
+    template std::size_t decompress_rle<8>(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest, const std::size_t dest_size);
+    template std::size_t decompress_rle<16>(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest, const std::size_t dest_size);
+    template std::size_t decompress_rle<24>(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest, const std::size_t dest_size);
+    template std::size_t decompress_rle<32>(const std::uint8_t *source, const std::size_t source_size, std::uint8_t *dest, const std::size_t dest_size);
 }
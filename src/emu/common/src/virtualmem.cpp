@@ -29,6 +29,13 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+
+#if EKA2L1_PLATFORM(UNIX) || EKA2L1_PLATFORM(ANDROID)
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
+#include <string>
 #endif
 
 namespace eka2l1::common {
@@ -255,4 +262,88 @@ namespace eka2l1::common {
 
         return true;
     }
+
+    bool is_shared_memory_supported() {
+        // Windows can only place views inside a reserved region through placeholders, which
+        // we don't use yet.
+#if EKA2L1_PLATFORM(WIN32)
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    shared_memory_handle create_shared_memory(const std::size_t size) {
+#if EKA2L1_PLATFORM(WIN32)
+        return INVALID_SHARED_MEMORY_HANDLE;
+#else
+        int fd = -1;
+
+#if (EKA2L1_PLATFORM(UNIX) || EKA2L1_PLATFORM(ANDROID)) && defined(__NR_memfd_create)
+        fd = static_cast<int>(syscall(__NR_memfd_create, "eka2l1-shmem", 0));
+#endif
+
+        if (fd == -1) {
+            // Fallback to a POSIX shared memory object, which name is dropped right away
+            static std::atomic<std::uint32_t> shmem_counter{ 0 };
+            const std::string name = "/eka2l1-shmem-" + std::to_string(getpid()) + "-" + std::to_string(shmem_counter++);
+
+            fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+            if (fd == -1) {
+                return INVALID_SHARED_MEMORY_HANDLE;
+            }
+
+            shm_unlink(name.c_str());
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+            close(fd);
+            return INVALID_SHARED_MEMORY_HANDLE;
+        }
+
+        return fd;
+#endif
+    }
+
+    void destroy_shared_memory(shared_memory_handle handle) {
+#if !EKA2L1_PLATFORM(WIN32)
+        if (handle != INVALID_SHARED_MEMORY_HANDLE) {
+            close(handle);
+        }
+#endif
+    }
+
+    void *map_shared_memory(shared_memory_handle handle, const std::size_t offset, const std::size_t size,
+        void *target, const prot perm) {
+#if EKA2L1_PLATFORM(WIN32)
+        return nullptr;
+#else
+        if (handle == INVALID_SHARED_MEMORY_HANDLE) {
+            return nullptr;
+        }
+
+        void *result = mmap(target, size, translate_protection(perm), MAP_SHARED | (target ? MAP_FIXED : 0),
+            handle, static_cast<off_t>(offset));
+
+        if (result == MAP_FAILED) {
+            return nullptr;
+        }
+
+        return result;
+#endif
+    }
+
+    bool unmap_shared_memory(void *ptr, const std::size_t size, const bool keep_reserved) {
+#if EKA2L1_PLATFORM(WIN32)
+        return false;
+#else
+        if (keep_reserved) {
+            return mmap(ptr, size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED | MAP_NORESERVE, -1, 0)
+                != MAP_FAILED;
+        }
+
+        return munmap(ptr, size) == 0;
+#endif
+    }
 }
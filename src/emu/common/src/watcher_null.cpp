@@ -28,7 +28,8 @@ namespace eka2l1::common {
 
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t mask) {
-        return 1;
+        // Can't watch anything here, don't pretend so
+        return 0;
     }
 
     bool directory_watcher_impl::unwatch(const std::int32_t watch_handle) {
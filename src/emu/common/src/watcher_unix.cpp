@@ -22,11 +22,15 @@
 
 #include <sys/inotify.h>
 
+#include <algorithm>
+
 namespace eka2l1::common {
     static constexpr std::size_t EVENT_MAX_SIZE = sizeof(struct inotify_event) + 16;
 
     directory_watcher_impl::directory_watcher_impl()
-        : should_stop(false) {
+        : stop_event_(-1)
+        , should_stop(false)
+        , next_handle_(1) {
         instance_ = inotify_init();
 
         if (instance_ == -1) {
@@ -34,30 +38,58 @@ namespace eka2l1::common {
             return;
         }
 
+        // Wakes the wait thread up on destruction, even if nothing is watched anymore
+        stop_event_ = eventfd(0, 0);
+
         // 512 is maximum event count
         events_.resize(EVENT_MAX_SIZE * 512);
 
         wait_thread_ = std::make_unique<std::thread>([this]() {
             std::vector<directory_change> changes;
 
+            std::vector<directory_watcher_callback_pair> callbacks;
+            directory_changes changes_copy;
+
             auto flush_changes = [&](const int wd) {
-                // Flush changes
-                auto ite = std::find(container_.begin(), container_.end(), wd);
+                {
+                    const std::lock_guard<std::mutex> guard(lock_);
 
-                if (ite != container_.end()) {
-                    auto &callback = callbacks_[std::distance(container_.begin(), ite)];
-                    callback.callback_pair_.first(callback.callback_pair_.second, changes);
+                    for (std::size_t i = 0; i < container_.size(); i++) {
+                        if (container_[i] == wd) {
+                            callbacks.push_back(callbacks_[i].callback_pair_);
+                        }
+                    }
+                }
 
-                    changes.clear();
+                // The callbacks may watch or unwatch, so they are called without the lock.
+                // Each one gets its own copy, since they are allowed to modify the changes.
+                for (directory_watcher_callback_pair &callback : callbacks) {
+                    changes_copy = changes;
+                    callback.first(callback.second, changes_copy);
                 }
+
+                callbacks.clear();
+                changes.clear();
             };
 
             while (!should_stop) {
+                struct pollfd fds[2] = { { instance_, POLLIN, 0 }, { stop_event_, POLLIN, 0 } };
+
+                if (poll(fds, (stop_event_ == -1) ? 1 : 2, -1) == -1) {
+                    continue;
+                }
+
+                if (should_stop || !(fds[0].revents & POLLIN)) {
+                    continue;
+                }
+
                 const ssize_t length = read(instance_, &events_[0], events_.size());
 
                 if (length == -1) {
                     LOG_ERROR("Error reading notify event!");
                     should_stop = true;
+
+                    continue;
                 }
 
                 std::size_t i = 0;
@@ -100,12 +132,13 @@ namespace eka2l1::common {
                         change.change_ |= directory_change_action_modified;
                     }
 
-                    changes.push_back(change);
-
+                    // Changes are batched per watched directory
                     if ((last_wd != -1) && (last_wd != evt->wd)) {
-                        flush_changes(evt->wd);
+                        flush_changes(last_wd);
                     }
 
+                    changes.push_back(change);
+
                     last_wd = evt->wd;
                     i += evt->len + sizeof(struct inotify_event);
                 }
@@ -118,30 +151,57 @@ namespace eka2l1::common {
     }
 
     directory_watcher_impl::~directory_watcher_impl() {
-        for (auto &wd : container_) {
-            inotify_rm_watch(instance_, wd);
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+
+            std::vector<int> removed;
+
+            for (const int wd : container_) {
+                if (std::find(removed.begin(), removed.end(), wd) == removed.end()) {
+                    inotify_rm_watch(instance_, wd);
+                    removed.push_back(wd);
+                }
+            }
         }
 
         should_stop = true;
+
+        if (stop_event_ != -1) {
+            const std::uint64_t signal = 1;
+            [[maybe_unused]] const ssize_t written = write(stop_event_, &signal, sizeof(signal));
+        }
+
         wait_thread_->join();
 
         close(instance_);
+
+        if (stop_event_ != -1) {
+            close(stop_event_);
+        }
     }
 
     bool directory_watcher_impl::unwatch(const std::int32_t watch_handle) {
-        // Find in container
-        auto ite = std::find(container_.begin(), container_.end(), watch_handle);
+        const std::lock_guard<std::mutex> guard(lock_);
 
-        if (ite == container_.end()) {
+        auto ite = std::find(handles_.begin(), handles_.end(), watch_handle);
+
+        if (ite == handles_.end()) {
             return false;
         }
 
-        auto callback_ite = callbacks_.begin() + std::distance(container_.begin(), ite);
+        const std::size_t index = std::distance(handles_.begin(), ite);
+        const int wd = container_[index];
 
-        callbacks_.erase(callback_ite);
-        container_.erase(ite);
+        handles_.erase(ite);
+        container_.erase(container_.begin() + index);
+        callbacks_.erase(callbacks_.begin() + index);
 
-        const bool remove_result = (inotify_rm_watch(instance_, watch_handle) != -1);
+        // Other watches of the same directory still need the descriptor
+        if (std::find(container_.begin(), container_.end(), wd) != container_.end()) {
+            return true;
+        }
+
+        const bool remove_result = (inotify_rm_watch(instance_, wd) != -1);
 
         if (!remove_result) {
             LOG_WARN("Can not removing watch from inotify!");
@@ -174,16 +234,24 @@ namespace eka2l1::common {
 
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t mask) {
-        const int wd_handle = inotify_add_watch(instance_, folder.c_str(), IN_CREATE | IN_DELETE | IN_MODIFY);
+        // Creation, deletion and modification are always reported, plus what the caller asked for.
+        // If the directory is already watched, the same descriptor is returned, so add to its mask
+        // rather than replacing what the other watches asked for.
+        const int wd_handle = inotify_add_watch(instance_, folder.c_str(), IN_MASK_ADD | IN_CREATE | IN_DELETE | IN_MODIFY | convert_to_unix_notify_mask(mask));
 
         if (wd_handle == -1) {
             LOG_ERROR("Error creating new inotify watch!");
             return 0;
         }
 
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        const std::int32_t handle = next_handle_++;
+
+        handles_.push_back(handle);
         container_.push_back(wd_handle);
         callbacks_.emplace_back(callback, callback_userdata, convert_to_unix_notify_mask(mask));
 
-        return wd_handle;
+        return handle;
     }
 }
\ No newline at end of file
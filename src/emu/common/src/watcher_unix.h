@@ -28,6 +28,7 @@
 #include <thread>
 #include <vector>
 
+#include <poll.h>
 #include <sys/eventfd.h>
 #include <sys/inotify.h>
 #include <sys/types.h>
@@ -39,11 +40,16 @@ namespace eka2l1::common {
         std::vector<std::uint8_t> events_;
 
         int instance_;
+        int stop_event_;
 
         std::atomic<bool> should_stop;
 
+        // One entry per watch call. Directories watched more than once share an inotify
+        // descriptor, so the descriptor is only removed when its last watch goes away.
+        std::vector<std::int32_t> handles_;
         std::vector<int> container_;
         std::vector<directory_watcher_data> callbacks_;
+        std::int32_t next_handle_;
 
         std::mutex lock_;
 
@@ -178,7 +178,7 @@ namespace eka2l1::common {
         DWORD result = 0;
 
         if (masks & directory_change_move) {
-            result |= FILE_NOTIFY_CHANGE_FILE_NAME;
+            result |= FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
         }
 
         if (masks & directory_change_attrib) {
@@ -203,7 +203,8 @@ namespace eka2l1::common {
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t masks) {
         const std::lock_guard<std::mutex> guard(lock_);
-        HANDLE h = FindFirstChangeNotificationA(folder.c_str(), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+        HANDLE h = FindFirstChangeNotificationA(folder.c_str(), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME
+            | FILE_NOTIFY_CHANGE_LAST_WRITE);
 
         if (!h || h == INVALID_HANDLE_VALUE) {
             LOG_ERROR("Can't create directory watch of folder {}", folder);
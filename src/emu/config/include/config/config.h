@@ -59,7 +59,12 @@ namespace eka2l1::config {
         bool log_passed{ false };
         bool log_exports{ false };
 
+        bool profile_calls{ false };
+        std::string profile_dump_path{ "calls_profile" };
+
         std::string cpu_backend{ "dynarmic" };
+        bool cpu_fastmem{ false };
+        int cpu_core_count{ 1 }; ///< The gdb stub and scripts only inspect and step the first core.
         int device{ 0 };
         int language{ -1 };
         int emulator_language{ -1 };
@@ -96,6 +101,9 @@ namespace eka2l1::config {
         std::atomic<bool> stepping { false };
         std::string rtos_level;
 
+        std::string graphics_backend{ "opengl" };
+        std::string frame_dump_folder; ///< Where the software graphics backend dumps frames. Empty to not dump.
+
         std::vector<keybind> keybinds;
 
         void serialize();
@@ -31,7 +31,11 @@ OPTION(log-ipc, log_ipc, false)
 OPTION(log-svc, log_svc, false)
 OPTION(log-passed, log_passed, false)
 OPTION(log-exports, log_exports, false)
+OPTION(profile-calls, profile_calls, false)
+OPTION(profile-dump-path, profile_dump_path, "calls_profile")
 OPTION(cpu, cpu_backend, 0)
+OPTION(cpu-fastmem, cpu_fastmem, false)
+OPTION(cpu-core-count, cpu_core_count, 1)
 OPTION(device, device, 0)
 OPTION(language, language, -1)
 OPTION(emulator-language, emulator_language, -1)
@@ -60,6 +64,8 @@ OPTION(enable-nearest-neighbor-filter, nearest_neighbor_filtering, true)
 OPTION(integer-scaling, integer_scaling, true)
 OPTION(cpu-load-save, cpu_load_save, true)
 OPTION(rtos-level, rtos_level, "mid")
+OPTION(graphics-backend, graphics_backend, "opengl")
+OPTION(frame-dump-folder, frame_dump_folder, "")
 
 #ifdef OPTION
 #undef OPTION
@@ -34,6 +34,8 @@ bool rpkg_unpack_option_handler(eka2l1::common::arg_parser *parser, void *userda
 bool list_app_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
 bool list_devices_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
 bool fullscreen_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
+bool graphics_backend_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
+bool frame_dump_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
 
 #if ENABLE_SCRIPTING
 bool python_docgen_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err);
@@ -248,6 +248,34 @@ bool fullscreen_option_handler(eka2l1::common::arg_parser *parser, void *userdat
     return true;
 }
 
+bool graphics_backend_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *backend = parser->next_token();
+
+    if (!backend) {
+        *err = "Request to change graphics backend, but backend name not given";
+        return false;
+    }
+
+    desktop::emulator *emu = reinterpret_cast<desktop::emulator *>(userdata);
+    emu->conf.graphics_backend = backend;
+
+    return true;
+}
+
+bool frame_dump_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *folder = parser->next_token();
+
+    if (!folder) {
+        *err = "Request to dump frames, but folder not given";
+        return false;
+    }
+
+    desktop::emulator *emu = reinterpret_cast<desktop::emulator *>(userdata);
+    emu->conf.frame_dump_folder = folder;
+
+    return true;
+}
+
 #if ENABLE_SCRIPTING
 bool python_docgen_option_handler(eka2l1::common::arg_parser *parser, void *userdata, std::string *err) {
     try {
@@ -35,6 +35,7 @@
 #include <debugger/logger.h>
 #include <debugger/renderer/renderer.h>
 
+#include <drivers/graphics/backend/software/graphics_software.h>
 #include <drivers/graphics/emu_window.h>
 #include <drivers/graphics/graphics.h>
 #include <drivers/input/common.h>
@@ -44,6 +45,8 @@
 
 #include <kernel/kernel.h>
 
+#include <algorithm>
+
 #if EKA2L1_PLATFORM(WIN32)
 #include <Windows.h>
 #endif
@@ -250,10 +253,17 @@ namespace eka2l1::desktop {
         state.window->make_current();
 
         // We got window and context ready (OpenGL, let makes stuff now)
-        // TODO: Configurable
-        state.graphics_driver = drivers::create_graphics_driver(drivers::graphic_api::opengl);
+        const drivers::graphic_api api = drivers::string_to_graphic_api(state.conf.graphics_backend);
+
+        state.graphics_driver = drivers::create_graphics_driver(api);
         state.symsys->set_graphics_driver(state.graphics_driver.get());
 
+        if (api == drivers::graphic_api::software) {
+            // Nothing is shown on the window, frames can only be seen by dumping them
+            static_cast<drivers::software_graphics_driver *>(state.graphics_driver.get())->set_frame_dump_folder(
+                state.conf.frame_dump_folder);
+        }
+
         drivers::emu_window *window = state.window.get();
 
         switch (state.graphics_driver->get_current_api()) {
@@ -436,7 +446,9 @@ namespace eka2l1::desktop {
         std::unique_ptr<drivers::graphics_command_list> cmd_list = state.graphics_driver->new_command_list();
         std::unique_ptr<drivers::graphics_command_list_builder> cmd_builder = state.graphics_driver->new_command_builder(cmd_list.get());
 
-        state.deb_renderer->deinit(cmd_builder.get());
+        if (state.graphics_driver->get_current_api() != drivers::graphic_api::software) {
+            state.deb_renderer->deinit(cmd_builder.get());
+        }
 
         // Submit destroy to driver. UI thread resources
         state.graphics_driver->submit_command_list(*cmd_list);
@@ -447,6 +459,55 @@ namespace eka2l1::desktop {
         return 0;
     }
 
+    // The debugger UI needs shaders, which the software driver does not have. Draw the screens
+    // side by side instead, so the frames still show what the guest renders.
+    static void ui_thread_draw_screens(emulator &state, drivers::graphics_command_list_builder *builder) {
+        epoc::screen *first_screen = state.winserv ? state.winserv->get_screens() : nullptr;
+        eka2l1::vec2 swapchain_size(0, 0);
+
+        for (epoc::screen *scr = first_screen; scr && scr->screen_texture; scr = scr->next) {
+            const std::lock_guard<std::mutex> guard(scr->screen_mutex);
+            const eka2l1::vec2 size = scr->current_mode().size;
+
+            swapchain_size.x += size.x;
+            swapchain_size.y = std::max(swapchain_size.y, size.y);
+        }
+
+        if ((swapchain_size.x == 0) || (swapchain_size.y == 0)) {
+            return;
+        }
+
+        builder->set_swapchain_size(swapchain_size);
+        builder->backup_state();
+
+        builder->clear({ 0xFF, 0xD0, 0xD0, 0xD0 }, drivers::draw_buffer_bit_color_buffer);
+        builder->set_viewport(eka2l1::rect({ 0, 0 }, swapchain_size));
+
+        int x = 0;
+
+        for (epoc::screen *scr = first_screen; scr && scr->screen_texture; scr = scr->next) {
+            const std::lock_guard<std::mutex> guard(scr->screen_mutex);
+
+            const eka2l1::vec2 size = scr->current_mode().size;
+            const eka2l1::rect source_rect({ 0, 0 }, size);
+            const eka2l1::rect dest_rect({ x, 0 }, size);
+
+            scr->scale_x = 1.0f;
+            scr->scale_y = 1.0f;
+            scr->absolute_pos = eka2l1::vec2(x, 0);
+
+            builder->draw_bitmap(scr->screen_texture, 0, dest_rect, source_rect, drivers::bitmap_draw_flag_no_flip);
+
+            if (scr->dsa_texture) {
+                builder->draw_bitmap(scr->dsa_texture, 0, dest_rect, source_rect, drivers::bitmap_draw_flag_no_flip);
+            }
+
+            x += size.x;
+        }
+
+        builder->load_backup_state();
+    }
+
     static ImFont *ui_thread_get_use_font(emulator &state) {
         return state.normal_font;
     }
@@ -464,8 +525,12 @@ namespace eka2l1::desktop {
         std::unique_ptr<drivers::graphics_command_list> cmd_list = state.graphics_driver->new_command_list();
         std::unique_ptr<drivers::graphics_command_list_builder> cmd_builder = state.graphics_driver->new_command_builder(cmd_list.get());
 
-        state.deb_renderer->init(state.graphics_driver.get(), cmd_builder.get(), state.debugger.get());
-        
+        const bool use_debugger_ui = (state.graphics_driver->get_current_api() != drivers::graphic_api::software);
+
+        if (use_debugger_ui) {
+            state.deb_renderer->init(state.graphics_driver.get(), cmd_builder.get(), state.debugger.get());
+        }
+
         state.deb_renderer->set_fullscreen(state.init_fullscreen);
         state.debugger->set_logger_visbility(!state.init_fullscreen);
 
@@ -548,15 +613,23 @@ namespace eka2l1::desktop {
             state.debugger->set_font_to_use(ui_thread_get_use_font(state));
             
             // Render the graphics
-            state.deb_renderer->draw(state.graphics_driver.get(), cmd_builder.get(), nws.x, nws.y, nwsb.x, nwsb.y);
+            if (use_debugger_ui) {
+                state.deb_renderer->draw(state.graphics_driver.get(), cmd_builder.get(), nws.x, nws.y, nwsb.x, nwsb.y);
+            } else if (state.symsys) {
+                kernel_system *kern = state.symsys->get_kernel_system();
 
-            int wait_status = -100;
+                if (kern) {
+                    kern->lock();
+                    ui_thread_draw_screens(state, cmd_builder.get());
+                    kern->unlock();
+                }
+            }
 
             // Submit, present, and wait for the presenting
-            cmd_builder->present(&wait_status);
+            cmd_builder->present(nullptr);
 
-            state.graphics_driver->submit_command_list(*cmd_list);
-            state.graphics_driver->wait_for(&wait_status);
+            const std::uint64_t present_fence = state.graphics_driver->submit_command_list(*cmd_list);
+            state.graphics_driver->wait_fence(present_fence);
 
             io.MouseWheel = 0;
 
@@ -652,6 +725,10 @@ namespace eka2l1::desktop {
         parser.add("--install, --i", "Install a SIS.", app_install_option_handler);
         parser.add("--remove, --r", "Remove an package.", package_remove_option_handler);
         parser.add("--fullscreen", "Display the emulator in fullscreen.", fullscreen_option_handler);
+        parser.add("--graphics-backend", "Graphics backend to use: opengl, or software to draw on the CPU.\n"
+                                         "\t\t\t  Nothing is shown on the window with software, dump the frames to see them.",
+            graphics_backend_option_handler);
+        parser.add("--dump-frames", "Folder to dump each frame to as PNG, with the software graphics backend.", frame_dump_option_handler);
 
 #if ENABLE_SCRIPTING
         parser.add("--gendocs", "Generate Python documentation", python_docgen_option_handler);
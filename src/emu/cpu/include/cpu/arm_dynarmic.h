@@ -24,29 +24,88 @@
 #include <dynarmic/A32/a32.h>
 #include <dynarmic/A32/config.h>
 
-#include <map>
+#if DYNARMIC_HAS_GLOBAL_MONITOR
+#include <dynarmic/exclusive_monitor.h>
+#endif
+
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace eka2l1 {
     class ntimer;
 
     namespace arm {
         class dynarmic_core_callback;
+        class dynarmic_core_cp15;
+
+        class dynarmic_exclusive_monitor : public exclusive_monitor {
+        public:
+#if DYNARMIC_HAS_GLOBAL_MONITOR
+            Dynarmic::ExclusiveMonitor monitor;
+
+            explicit dynarmic_exclusive_monitor(const std::size_t core_count)
+                : monitor(core_count) {
+            }
+#endif
+        };
 
         class dynarmic_core : public core {
             friend class dynarmic_core_callback;
 
-            std::unique_ptr<Dynarmic::A32::Jit> jit;
+            using page_table_type = std::array<std::uint8_t *, Dynarmic::A32::UserConfig::NUM_PAGE_TABLE_ENTRIES>;
+
+            /**
+             * \brief Page table and JIT instance of an address space.
+             * 
+             * Each JIT is built with its address space's page table, so switching address space only
+             * swaps the current JIT.
+             */
+            struct address_space {
+                std::int32_t id;
+                page_table_type *page_table;
+                std::unique_ptr<Dynarmic::A32::Jit> jit;
+
+                std::vector<bool> touched; ///< Host pages of the page table that have been written to.
+                bool stale_code; ///< Translated code must be dropped before running it again.
+
+                explicit address_space(const std::int32_t id);
+                ~address_space();
+            };
+
+            std::unordered_map<std::int32_t, std::unique_ptr<address_space>> addr_spaces;
+            address_space *crr_addr_space;
+            address_space *global_addr_space;
+
+            Dynarmic::A32::Jit *jit; ///< JIT of the current address space.
+
+            std::mutex halt_lock; ///< Guards the running JIT against halts from other host threads.
+            Dynarmic::A32::Jit *running_jit; ///< JIT being run at the moment, nullptr if none.
+
+            dynarmic_exclusive_monitor *monitor; ///< Exclusive monitor shared with other cores, nullptr if alone.
+            std::size_t processor_id;
             std::unique_ptr<dynarmic_core_callback> cb;
+            std::shared_ptr<dynarmic_core_cp15> cp15;
+
+            std::int32_t pending_free_id; ///< Address space freed while in use, to release once switched away from.
 
-            std::array<std::uint8_t *, Dynarmic::A32::UserConfig::NUM_PAGE_TABLE_ENTRIES>
-                page_dyn;
+            std::uint8_t *fastmem_arena; ///< Host region mirroring the 4GB guest address space. Nullptr if disabled.
+
+            std::unique_ptr<Dynarmic::A32::Jit> make_jit(page_table_type *table, void *fastmem);
+            void set_running_jit(Dynarmic::A32::Jit *new_running);
+            address_space *get_or_create_address_space(const std::int32_t id);
+            void reset_address_space(address_space *space);
+            void drop_stale_code();
+            void modify_page_tables(address vaddr, std::size_t size, std::uint8_t *ptr, const std::int32_t id);
 
             std::uint32_t ticks_executed{ 0 };
             std::uint32_t ticks_target{ 0 };
 
         public:
-            explicit dynarmic_core();
+            explicit dynarmic_core(const bool enable_fastmem, dynarmic_exclusive_monitor *monitor = nullptr,
+                const std::size_t processor_id = 0);
             ~dynarmic_core() override;
 
             void run(const std::uint32_t instruction_count) override;
@@ -84,9 +143,25 @@ namespace eka2l1 {
 
             void page_table_changed() override;
 
-            void map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection) override;
+            void map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection, const std::int32_t addr_space) override;
+
+            void unmap_memory(address addr, size_t size, const std::int32_t addr_space) override;
+
+            bool has_address_space_tables() const override {
+                // The fastmem arena mirrors one address space only
+                return fastmem_arena == nullptr;
+            }
+
+            bool set_address_space(const std::int32_t id) override;
+            void free_address_space(const std::int32_t id) override;
+
+            std::int32_t current_address_space() const override;
+
+            bool has_fastmem() const override {
+                return fastmem_arena != nullptr;
+            }
 
-            void unmap_memory(address addr, size_t size) override;
+            bool map_fastmem(address vaddr, size_t size, common::shared_memory_handle handle, std::size_t offset) override;
 
             void clear_instruction_cache() override;
 
@@ -95,7 +170,9 @@ namespace eka2l1 {
             std::uint32_t get_num_instruction_executed() override;
 
             bool should_clear_old_memory_map() const override {
-                return false;
+                // The fastmem arena mirrors the address space being run, what the old one left there
+                // must not stay reachable
+                return fastmem_arena != nullptr;
             }
         };
     }
@@ -26,6 +26,7 @@ namespace eka2l1 {
     namespace arm {
         class core;
         using core_instance = std::unique_ptr<core>;
+        using exclusive_monitor_instance = std::unique_ptr<exclusive_monitor>;
 
         /**
          * \brief Create a new ARM CPU core.
@@ -33,8 +34,25 @@ namespace eka2l1 {
          * This factory methods provide various CPU translator backend for you to choose. The CPU must accompanies
          * with other system like kernel or timing, in order to help for emulation.
          * 
+         * \param arm_type       The CPU translator backend.
+         * \param enable_fastmem Let the backend access guest memory through a host region mirroring the guest
+         *                       address space, if it supports it.
+         * \param monitor        The exclusive monitor shared with other cores. Nullptr if the core runs alone.
+         * \param processor_id   Index of the core in the exclusive monitor.
+         * 
          * \returns An instance to the CPU executor.
          */
-        core_instance create_core(arm_emulator_type arm_type);
+        core_instance create_core(arm_emulator_type arm_type, const bool enable_fastmem = false,
+            exclusive_monitor *monitor = nullptr, const std::size_t processor_id = 0);
+
+        /**
+         * \brief Create an exclusive monitor to be shared between cores of a backend.
+         * 
+         * \param arm_type   The CPU translator backend of the cores.
+         * \param core_count The number of cores sharing the monitor.
+         * 
+         * \returns Nullptr if the backend does not support it.
+         */
+        exclusive_monitor_instance create_exclusive_monitor(arm_emulator_type arm_type, const std::size_t core_count);
     }
 }
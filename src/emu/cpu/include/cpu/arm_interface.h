@@ -20,10 +20,12 @@
 #pragma once
 
 #include <array>
+#include <cstring>
 #include <memory>
 #include <functional>
 
 #include <common/types.h>
+#include <common/virtualmem.h>
 
 namespace eka2l1::arm {
     enum exception_type {
@@ -44,6 +46,32 @@ namespace eka2l1::arm {
     using system_call_handler_func = std::function<void(const std::uint32_t)>;
     using handle_exception_func = std::function<void(exception_type, const std::uint32_t)>;
 
+    class core;
+
+    /**
+     * \brief Work to be done on a CPU core, from the host thread driving it.
+     */
+    using core_work_func = std::function<void(core *)>;
+
+    constexpr std::uint32_t CORE_PAGE_BITS = 12;
+    constexpr std::uint32_t CORE_PAGE_SIZE = 1 << CORE_PAGE_BITS;
+    constexpr std::uint32_t CORE_PAGE_MASK = CORE_PAGE_SIZE - 1;
+    constexpr std::uint32_t CORE_PAGE_TABLE_ENTRIES = 1 << (32 - CORE_PAGE_BITS);
+
+    constexpr std::int32_t CORE_ADDR_SPACE_CURRENT = -1; ///< Target the address space the core is running with.
+    constexpr std::int32_t CORE_ADDR_SPACE_GLOBAL = 0; ///< Target every address space.
+
+    /**
+     * \brief Monitor of exclusive accesses, shared between all cores of the system.
+     * 
+     * An exclusive store on a core fails if another core has touched the reserved address since
+     * the exclusive load. The content is backend-specific.
+     */
+    class exclusive_monitor {
+    public:
+        virtual ~exclusive_monitor() {}
+    };
+
     class core {
     public:
         memory_operation_8bit_func read_8bit;
@@ -61,6 +89,18 @@ namespace eka2l1::arm {
         system_call_handler_func system_call_handler;
         handle_exception_func exception_handler;
 
+        /**
+         * \brief Host pointer of each guest page, indexed by (address >> CORE_PAGE_BITS).
+         * 
+         * The table is kept in sync by map_backing_mem and unmap_memory. The JIT serves plain accesses
+         * from it by itself, so the memory callbacks above only see the ones it missed. It's used for
+         * exclusive writes, which must be done atomically on the host memory.
+         */
+        std::uint8_t **page_table_fast{ nullptr };
+
+        const bool *trace_read{ nullptr }; ///< If this is set and true, reads always go through the callbacks.
+        const bool *trace_write{ nullptr }; ///< If this is set and true, writes always go through the callbacks.
+
         /**
          *  Stores register value and some pointer of the CPU.
         */
@@ -80,7 +120,7 @@ namespace eka2l1::arm {
         /*! Run the CPU */
         virtual void run(const std::uint32_t instruction_count) = 0;
 
-        /*! Stop the CPU */
+        /*! Stop the CPU. This can be called from any host thread. */
         virtual void stop() = 0;
 
         /*! Step the CPU. Each step execute one instruction. */
@@ -135,9 +175,68 @@ namespace eka2l1::arm {
 
         virtual void page_table_changed() = 0;
 
-        virtual void map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection) = 0;
+        virtual void map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection, const std::int32_t addr_space) = 0;
 
-        virtual void unmap_memory(address addr, size_t size) = 0;
+        virtual void unmap_memory(address addr, size_t size, const std::int32_t addr_space) = 0;
+
+        /**
+         * \brief Check if the core keeps a separate page table for each address space.
+         * 
+         * If it does, memory can be mapped to any address space at any time, and switching to another
+         * address space is done with set_address_space, without remapping anything. Else, the address space
+         * argument of map_backing_mem and unmap_memory is ignored, and the memory model must remap memory
+         * itself when the address space changes.
+         */
+        virtual bool has_address_space_tables() const {
+            return false;
+        }
+
+        /**
+         * \brief Switch the core to the page table of another address space.
+         * 
+         * \returns False if the core does not keep a page table for each address space.
+         */
+        virtual bool set_address_space(const std::int32_t id) {
+            return false;
+        }
+
+        /**
+         * \brief Get the address space whose page table the core is currently using.
+         * 
+         * \returns CORE_ADDR_SPACE_CURRENT if the core does not keep a page table for each address space.
+         */
+        virtual std::int32_t current_address_space() const {
+            return CORE_ADDR_SPACE_CURRENT;
+        }
+
+        /**
+         * \brief Release the page table of an address space that will no longer be used.
+         */
+        virtual void free_address_space(const std::int32_t id) {
+        }
+
+        /**
+         * \brief Check if the core accesses guest memory through a host region mirroring the guest address space.
+         */
+        virtual bool has_fastmem() const {
+            return false;
+        }
+
+        /**
+         * \brief Map a view of a shared memory object to the fastmem region.
+         * 
+         * This is done in addition to map_backing_mem. The view is removed by unmap_memory.
+         * 
+         * \param vaddr  The guest address to map the view at.
+         * \param size   Size of the view.
+         * \param handle The shared memory object backing the guest memory.
+         * \param offset Offset of the view in the shared memory object.
+         * 
+         * \returns False if the core has no fastmem region, or the view can't be mapped.
+         */
+        virtual bool map_fastmem(address vaddr, size_t size, common::shared_memory_handle handle, std::size_t offset) {
+            return false;
+        }
 
         virtual void clear_instruction_cache() = 0;
 
@@ -148,5 +247,56 @@ namespace eka2l1::arm {
         }
 
         virtual std::uint32_t get_num_instruction_executed() = 0;
+
+        /**
+         * \brief Get the host pointer of a guest access from the fast page table.
+         * 
+         * \param addr  The guest address of the access.
+         * \param trace Tracing flag that forces the access to take the slow path.
+         * 
+         * \returns Nullptr if the access must be done through the memory callbacks, for example when
+         *          the page is not mapped, or the access straddles two pages.
+         */
+        template <typename T>
+        std::uint8_t *get_fast_pointer(const address addr, const bool *trace) const {
+            if (!page_table_fast || (trace && *trace)) {
+                return nullptr;
+            }
+
+            if ((addr & CORE_PAGE_MASK) > CORE_PAGE_SIZE - sizeof(T)) {
+                return nullptr;
+            }
+
+            std::uint8_t *page = page_table_fast[addr >> CORE_PAGE_BITS];
+            return page ? (page + (addr & CORE_PAGE_MASK)) : nullptr;
+        }
+
+        template <typename T>
+        bool read_memory(const address addr, T *data) {
+            if constexpr (sizeof(T) == 1) {
+                return read_8bit(addr, reinterpret_cast<std::uint8_t *>(data));
+            } else if constexpr (sizeof(T) == 2) {
+                return read_16bit(addr, reinterpret_cast<std::uint16_t *>(data));
+            } else if constexpr (sizeof(T) == 4) {
+                return read_32bit(addr, reinterpret_cast<std::uint32_t *>(data));
+            } else {
+                static_assert(sizeof(T) == 8, "Unsupported memory access size!");
+                return read_64bit(addr, reinterpret_cast<std::uint64_t *>(data));
+            }
+        }
+
+        template <typename T>
+        bool write_memory(const address addr, T *data) {
+            if constexpr (sizeof(T) == 1) {
+                return write_8bit(addr, reinterpret_cast<std::uint8_t *>(data));
+            } else if constexpr (sizeof(T) == 2) {
+                return write_16bit(addr, reinterpret_cast<std::uint16_t *>(data));
+            } else if constexpr (sizeof(T) == 4) {
+                return write_32bit(addr, reinterpret_cast<std::uint32_t *>(data));
+            } else {
+                static_assert(sizeof(T) == 8, "Unsupported memory access size!");
+                return write_64bit(addr, reinterpret_cast<std::uint64_t *>(data));
+            }
+        }
     };
 }
@@ -20,6 +20,7 @@
 #include <common/algorithm.h>
 #include <common/configure.h>
 #include <common/log.h>
+#include <common/virtualmem.h>
 
 #include <cpu/arm_dynarmic.h>
 #include <cpu/arm_utils.h>
@@ -27,7 +28,14 @@
 #include <dynarmic/A32/context.h>
 #include <dynarmic/A32/coprocessor.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace eka2l1::arm {
+    static_assert(Dynarmic::A32::UserConfig::NUM_PAGE_TABLE_ENTRIES == CORE_PAGE_TABLE_ENTRIES,
+        "Dynarmic page table must match the core's fast page table layout!");
+
     class dynarmic_core_cp15 : public Dynarmic::A32::Coprocessor {
         std::uint32_t wrwr;
 
@@ -88,6 +96,24 @@ namespace eka2l1::arm {
         }
     };
 
+    template <typename T>
+    static bool compare_and_swap(T *ptr, const T expected, const T desired) {
+#if defined(__GNUC__) || defined(__clang__)
+        T expected_copy = expected;
+        return __atomic_compare_exchange_n(ptr, &expected_copy, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+        if constexpr (sizeof(T) == 1) {
+            return _InterlockedCompareExchange8(reinterpret_cast<volatile char *>(ptr), desired, expected) == static_cast<char>(expected);
+        } else if constexpr (sizeof(T) == 2) {
+            return _InterlockedCompareExchange16(reinterpret_cast<volatile short *>(ptr), desired, expected) == static_cast<short>(expected);
+        } else if constexpr (sizeof(T) == 4) {
+            return _InterlockedCompareExchange(reinterpret_cast<volatile long *>(ptr), desired, expected) == static_cast<long>(expected);
+        } else {
+            return _InterlockedCompareExchange64(reinterpret_cast<volatile __int64 *>(ptr), desired, expected) == static_cast<__int64>(expected);
+        }
+#endif
+    }
+
     class dynarmic_core_callback : public Dynarmic::A32::UserCallbacks {
         std::shared_ptr<dynarmic_core_cp15> cp15;
 
@@ -128,7 +154,7 @@ namespace eka2l1::arm {
             std::uint32_t code_result = 0;
             constexpr std::uint32_t UNDEFINED_WORD = 0xE11EFF2F;
 
-            bool status = parent.read_32bit(addr, &code_result);
+            bool status = parent.read_memory(addr, &code_result);
             handle_read_status(status, addr);
 
             return status ? code_result : UNDEFINED_WORD;
@@ -136,48 +162,91 @@ namespace eka2l1::arm {
 
         uint8_t MemoryRead8(Dynarmic::A32::VAddr addr) override {
             std::uint8_t ret = 0;
-            handle_read_status(parent.read_8bit(addr, &ret), addr);
+            handle_read_status(parent.read_memory(addr, &ret), addr);
 
             return ret;
         }
 
         uint16_t MemoryRead16(Dynarmic::A32::VAddr addr) override {
             std::uint16_t ret = 0;
-            handle_read_status(parent.read_16bit(addr, &ret), addr);
+            handle_read_status(parent.read_memory(addr, &ret), addr);
 
             return ret;
         }
 
         uint32_t MemoryRead32(Dynarmic::A32::VAddr addr) override {
             std::uint32_t ret = 0;
-            handle_read_status(parent.read_32bit(addr, &ret), addr);
+            handle_read_status(parent.read_memory(addr, &ret), addr);
 
             return ret;
         }
 
         uint64_t MemoryRead64(Dynarmic::A32::VAddr addr) override {
             std::uint64_t ret = 0;
-            handle_read_status(parent.read_64bit(addr, &ret), addr);
+            handle_read_status(parent.read_memory(addr, &ret), addr);
 
             return ret;
         }
 
         void MemoryWrite8(Dynarmic::A32::VAddr addr, uint8_t value) override {
-            handle_write_status(parent.write_8bit(addr, &value), addr);
+            handle_write_status(parent.write_memory(addr, &value), addr);
         }
 
         void MemoryWrite16(Dynarmic::A32::VAddr addr, uint16_t value) override {
-            handle_write_status(parent.write_16bit(addr, &value), addr);
+            handle_write_status(parent.write_memory(addr, &value), addr);
         }
 
         void MemoryWrite32(Dynarmic::A32::VAddr addr, uint32_t value) override {
-            handle_write_status(parent.write_32bit(addr, &value), addr);
+            handle_write_status(parent.write_memory(addr, &value), addr);
         }
 
         void MemoryWrite64(Dynarmic::A32::VAddr addr, uint64_t value) override {
-            handle_write_status(parent.write_64bit(addr, &value), addr);
+            handle_write_status(parent.write_memory(addr, &value), addr);
+        }
+
+#if DYNARMIC_HAS_GLOBAL_MONITOR
+        template <typename T>
+        bool write_exclusive(const Dynarmic::A32::VAddr addr, const T value, const T expected) {
+            if (std::uint8_t *ptr = parent.get_fast_pointer<T>(addr, parent.trace_write)) {
+                // Other cores may store to the same address at the same time
+                return compare_and_swap(reinterpret_cast<T *>(ptr), expected, value);
+            }
+
+            // Accesses through the callbacks can't be made atomic, but these are only traced or unmapped ones
+            T current = 0;
+
+            if (!parent.read_memory(addr, &current)) {
+                invalid_memory_read(addr);
+                return false;
+            }
+
+            if (current != expected) {
+                return false;
+            }
+
+            T value_copy = value;
+            handle_write_status(parent.write_memory(addr, &value_copy), addr);
+
+            return true;
         }
 
+        bool MemoryWriteExclusive8(Dynarmic::A32::VAddr addr, std::uint8_t value, std::uint8_t expected) override {
+            return write_exclusive(addr, value, expected);
+        }
+
+        bool MemoryWriteExclusive16(Dynarmic::A32::VAddr addr, std::uint16_t value, std::uint16_t expected) override {
+            return write_exclusive(addr, value, expected);
+        }
+
+        bool MemoryWriteExclusive32(Dynarmic::A32::VAddr addr, std::uint32_t value, std::uint32_t expected) override {
+            return write_exclusive(addr, value, expected);
+        }
+
+        bool MemoryWriteExclusive64(Dynarmic::A32::VAddr addr, std::uint64_t value, std::uint64_t expected) override {
+            return write_exclusive(addr, value, expected);
+        }
+#endif
+
         void InterpreterFallback(Dynarmic::A32::VAddr addr, size_t num_insts) override {
             LOG_ERROR("Interpreter fallback!");
         }
@@ -220,41 +289,185 @@ namespace eka2l1::arm {
         }
     };
 
-    std::unique_ptr<Dynarmic::A32::Jit> make_jit(std::unique_ptr<dynarmic_core_callback> &callback, void *table,
-        std::shared_ptr<dynarmic_core_cp15> cp15) {
+    // Whole 32-bit guest address space, plus one guard page for accesses crossing the end of it
+    static constexpr std::uint64_t FASTMEM_ARENA_SIZE = (1ULL << 32) + CORE_PAGE_SIZE;
+
+    // Number of page table entries fitting in a host page of the table
+    static constexpr std::uint32_t TABLE_ENTRIES_PER_HOST_PAGE = 0x1000 / sizeof(std::uint8_t *);
+
+    dynarmic_core::address_space::address_space(const std::int32_t id)
+        : id(id)
+        , page_table(nullptr)
+        , touched(CORE_PAGE_TABLE_ENTRIES / TABLE_ENTRIES_PER_HOST_PAGE, false)
+        , stale_code(false) {
+        // The table is large, so let the host commit it lazily. Fresh pages are zero-filled,
+        // which leaves every entry unmapped.
+        void *table = common::map_memory(sizeof(page_table_type));
+
+        if (table && common::commit(table, sizeof(page_table_type), prot::read_write)) {
+            page_table = reinterpret_cast<page_table_type *>(table);
+        } else {
+            LOG_ERROR("Unable to allocate JIT page table!");
+        }
+    }
+
+    dynarmic_core::address_space::~address_space() {
+        // The JIT refers to the table, destroy it first
+        jit.reset();
+
+        if (page_table) {
+            common::unmap_memory(page_table, sizeof(page_table_type));
+        }
+    }
+
+    dynarmic_core::dynarmic_core(const bool enable_fastmem, dynarmic_exclusive_monitor *monitor, const std::size_t processor_id)
+        : crr_addr_space(nullptr)
+        , global_addr_space(nullptr)
+        , jit(nullptr)
+        , running_jit(nullptr)
+        , monitor(monitor)
+        , processor_id(processor_id)
+        , pending_free_id(-1)
+        , fastmem_arena(nullptr) {
+        cp15 = std::make_shared<dynarmic_core_cp15>();
+        cb = std::make_unique<dynarmic_core_callback>(*this, cp15);
+
+        if (enable_fastmem) {
+            if ((sizeof(void *) == 8) && common::is_shared_memory_supported()) {
+                fastmem_arena = reinterpret_cast<std::uint8_t *>(common::map_memory(FASTMEM_ARENA_SIZE));
+            }
+
+            if (!fastmem_arena) {
+                LOG_WARN("Unable to reserve fastmem arena, guest memory will be accessed through the page table only");
+            }
+        }
+
+        // Start with the global address space
+        global_addr_space = get_or_create_address_space(CORE_ADDR_SPACE_GLOBAL);
+        crr_addr_space = global_addr_space;
+        crr_addr_space->jit = make_jit(crr_addr_space->page_table, fastmem_arena);
+
+        jit = crr_addr_space->jit.get();
+        page_table_fast = crr_addr_space->page_table->data();
+    }
+
+    dynarmic_core::~dynarmic_core() {
+        addr_spaces.clear();
+
+        if (fastmem_arena) {
+            common::unmap_memory(fastmem_arena, FASTMEM_ARENA_SIZE);
+        }
+    }
+
+    std::unique_ptr<Dynarmic::A32::Jit> dynarmic_core::make_jit(page_table_type *table, void *fastmem) {
         Dynarmic::A32::UserConfig config;
-        config.callbacks = callback.get();
+        config.callbacks = cb.get();
         config.coprocessors[15] = cp15;
         config.page_table = reinterpret_cast<decltype(config.page_table)>(table);
 
+        // Unmapped fastmem accesses fault back to the memory callbacks, then recompile without fastmem
+        config.fastmem_pointer = fastmem;
+        config.recompile_on_fastmem_failure = true;
+
+#if DYNARMIC_HAS_GLOBAL_MONITOR
+        if (monitor) {
+            // Exclusive accesses of all cores go through the same monitor, so LDREX/STREX work across cores
+            config.global_monitor = &monitor->monitor;
+            config.processor_id = processor_id;
+        }
+#endif
+
         return std::make_unique<Dynarmic::A32::Jit>(config);
     }
 
-    dynarmic_core::dynarmic_core() {
-        std::shared_ptr<dynarmic_core_cp15> cp15 = std::make_shared<dynarmic_core_cp15>();
-        cb = std::make_unique<dynarmic_core_callback>(*this, cp15);
+    dynarmic_core::address_space *dynarmic_core::get_or_create_address_space(const std::int32_t id) {
+        auto space_ite = addr_spaces.find(id);
 
-        std::fill(page_dyn.begin(), page_dyn.end(), nullptr);
+        if (space_ite != addr_spaces.end()) {
+            if (id == pending_free_id) {
+                // The ID got reused while still in use. It was reset when freed, so just keep it.
+                pending_free_id = -1;
+            }
 
-        jit = make_jit(cb, &page_dyn, cp15);
+            return space_ite->second.get();
+        }
+
+        std::unique_ptr<address_space> space = std::make_unique<address_space>(id);
+        address_space *result = space.get();
+
+        addr_spaces.emplace(id, std::move(space));
+        reset_address_space(result);
+
+        return result;
     }
 
-    dynarmic_core::~dynarmic_core() {
+    void dynarmic_core::reset_address_space(address_space *space) {
+        if (space == global_addr_space) {
+            return;
+        }
+
+        // Go back to global mappings only. Only the parts of the tables that were ever written to are
+        // touched, so untouched parts of the table stay uncommitted.
+        for (std::size_t i = 0; i < space->touched.size(); i++) {
+            const bool global_touched = global_addr_space && global_addr_space->touched[i];
+
+            if (!space->touched[i] && !global_touched) {
+                continue;
+            }
+
+            auto dest = space->page_table->begin() + i * TABLE_ENTRIES_PER_HOST_PAGE;
+
+            if (global_touched) {
+                page_table_type &global_table = *global_addr_space->page_table;
+                std::copy(global_table.begin() + i * TABLE_ENTRIES_PER_HOST_PAGE, global_table.begin() + (i + 1) * TABLE_ENTRIES_PER_HOST_PAGE,
+                    dest);
+            } else {
+                std::fill(dest, dest + TABLE_ENTRIES_PER_HOST_PAGE, nullptr);
+            }
+
+            space->touched[i] = global_touched;
+        }
+
+        // This may be called from other threads, so the JIT is only told to drop code later
+        space->stale_code = (space->jit != nullptr);
+    }
+
+    void dynarmic_core::drop_stale_code() {
+        if (crr_addr_space->stale_code) {
+            jit->ClearCache();
+            crr_addr_space->stale_code = false;
+        }
     }
 
     void dynarmic_core::run(const std::uint32_t instruction_count) {
         ticks_executed = 0;
         ticks_target = instruction_count;
 
+        drop_stale_code();
+        set_running_jit(jit);
         jit->Run();
+        set_running_jit(nullptr);
     }
 
     void dynarmic_core::stop() {
-        jit->HaltExecution();
+        // The current JIT is swapped on address space switch, so only halt the one being run
+        const std::lock_guard<std::mutex> guard(halt_lock);
+
+        if (running_jit) {
+            running_jit->HaltExecution();
+        }
     }
 
     void dynarmic_core::step() {
+        drop_stale_code();
+        set_running_jit(jit);
         jit->Step();
+        set_running_jit(nullptr);
+    }
+
+    void dynarmic_core::set_running_jit(Dynarmic::A32::Jit *new_running) {
+        const std::lock_guard<std::mutex> guard(halt_lock);
+        running_jit = new_running;
     }
 
     uint32_t dynarmic_core::get_reg(size_t idx) {
@@ -363,30 +576,141 @@ namespace eka2l1::arm {
     void dynarmic_core::page_table_changed() {
     }
 
-    void dynarmic_core::map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection) {
-        const std::uint32_t psize = 0x1000;
-        const std::uint32_t pstart = vaddr / psize;
+    static void fill_page_table(std::uint8_t **table, address vaddr, std::size_t size, std::uint8_t *ptr) {
+        const std::uint32_t pstart = vaddr >> CORE_PAGE_BITS;
 
-        for (std::size_t i = 0; i < size / psize; i++) {
-            page_dyn[pstart + i] = ptr + i * psize;
+        for (std::size_t i = 0; i < (size >> CORE_PAGE_BITS); i++) {
+            table[pstart + i] = ptr ? (ptr + (i << CORE_PAGE_BITS)) : nullptr;
         }
     }
 
-    void dynarmic_core::unmap_memory(address addr, size_t size) {
-        const std::uint32_t psize = 0x1000;
-        const std::uint32_t pstart = addr / psize;
+    static void mark_table_touched(std::vector<bool> &touched, address vaddr, std::size_t size) {
+        const std::uint32_t pstart = vaddr >> CORE_PAGE_BITS;
+        const std::uint32_t pend = static_cast<std::uint32_t>(pstart + (size >> CORE_PAGE_BITS));
 
-        for (std::size_t i = 0; i < size / psize; i++) {
-            page_dyn[pstart + i] = nullptr;
+        for (std::uint32_t i = pstart / TABLE_ENTRIES_PER_HOST_PAGE; i < (pend + TABLE_ENTRIES_PER_HOST_PAGE - 1) / TABLE_ENTRIES_PER_HOST_PAGE; i++) {
+            touched[i] = true;
         }
     }
 
+    void dynarmic_core::modify_page_tables(address vaddr, std::size_t size, std::uint8_t *ptr, const std::int32_t id) {
+        address_space *target = crr_addr_space;
+
+        if (has_address_space_tables() && (id != CORE_ADDR_SPACE_CURRENT)) {
+            if (id == CORE_ADDR_SPACE_GLOBAL) {
+                // Global memory is visible from every address space
+                for (auto &[space_id, space] : addr_spaces) {
+                    if (space.get() != global_addr_space) {
+                        fill_page_table(space->page_table->data(), vaddr, size, ptr);
+                        mark_table_touched(space->touched, vaddr, size);
+                    }
+                }
+
+                target = global_addr_space;
+            } else {
+                target = get_or_create_address_space(id);
+            }
+        }
+
+        fill_page_table(target->page_table->data(), vaddr, size, ptr);
+        mark_table_touched(target->touched, vaddr, size);
+    }
+
+    void dynarmic_core::map_backing_mem(address vaddr, size_t size, uint8_t *ptr, prot protection, const std::int32_t addr_space) {
+        modify_page_tables(vaddr, size, ptr, addr_space);
+    }
+
+    void dynarmic_core::unmap_memory(address addr, size_t size, const std::int32_t addr_space) {
+        modify_page_tables(addr, size, nullptr, addr_space);
+
+        if (fastmem_arena) {
+            // Keep the range reserved, so that accesses to it fault instead of hitting random host memory
+            common::unmap_shared_memory(fastmem_arena + addr, size, true);
+        }
+    }
+
+    bool dynarmic_core::set_address_space(const std::int32_t id) {
+        if (!has_address_space_tables()) {
+            return false;
+        }
+
+        address_space *space = get_or_create_address_space(id);
+
+        if (!space->jit) {
+            // Only reached without an arena, since the arena can only mirror one address space
+            space->jit = make_jit(space->page_table, fastmem_arena);
+        }
+
+        address_space *old_space = crr_addr_space;
+
+        crr_addr_space = space;
+        jit = space->jit.get();
+        page_table_fast = space->page_table->data();
+
+        if ((old_space != space) && (old_space->id == pending_free_id) && (old_space->jit.get() != running_jit)) {
+            // It was freed while we were running with it
+            pending_free_id = -1;
+            addr_spaces.erase(old_space->id);
+        }
+
+        return true;
+    }
+
+    std::int32_t dynarmic_core::current_address_space() const {
+        if (!has_address_space_tables()) {
+            return CORE_ADDR_SPACE_CURRENT;
+        }
+
+        return crr_addr_space->id;
+    }
+
+    void dynarmic_core::free_address_space(const std::int32_t id) {
+        if (id == CORE_ADDR_SPACE_GLOBAL) {
+            return;
+        }
+
+        auto space_ite = addr_spaces.find(id);
+
+        if (space_ite == addr_spaces.end()) {
+            return;
+        }
+
+        if (space_ite->second.get() == crr_addr_space) {
+            // Still running with it, release it once switched away. Drop its mappings now, in case the ID
+            // gets reused before that.
+            reset_address_space(crr_addr_space);
+            pending_free_id = id;
+
+            return;
+        }
+
+        addr_spaces.erase(space_ite);
+    }
+
+    bool dynarmic_core::map_fastmem(address vaddr, size_t size, common::shared_memory_handle handle, std::size_t offset) {
+        if (!fastmem_arena) {
+            return false;
+        }
+
+        // Guest protection is not enforced by the page table path either, so keep the views writable
+        return common::map_shared_memory(handle, offset, size, fastmem_arena + vaddr, prot::read_write) != nullptr;
+    }
+
     void dynarmic_core::clear_instruction_cache() {
-        jit->ClearCache();
+        for (auto &[id, space] : addr_spaces) {
+            if (space->jit) {
+                space->jit->ClearCache();
+            }
+        }
     }
 
     void dynarmic_core::imb_range(address addr, std::size_t size) {
-        jit->InvalidateCacheRange(addr, size);
+        // Code may be shared between address spaces
+        for (auto &[id, space] : addr_spaces) {
+            if (space->jit) {
+                space->jit->InvalidateCacheRange(addr, size);
+            }
+        }
     }
 
     std::uint32_t dynarmic_core::get_num_instruction_executed() {
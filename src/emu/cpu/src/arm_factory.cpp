@@ -22,17 +22,35 @@
 #include <cpu/arm_factory.h>
 
 namespace eka2l1::arm {
-    core_instance create_core(arm_emulator_type arm_type) {
+    core_instance create_core(arm_emulator_type arm_type, const bool enable_fastmem, exclusive_monitor *monitor,
+        const std::size_t processor_id) {
         switch (arm_type) {
         case arm_emulator_type::unicorn:
             return nullptr;
 
         case arm_emulator_type::dynarmic:
-            return std::make_unique<dynarmic_core>();
+            return std::make_unique<dynarmic_core>(enable_fastmem, static_cast<dynarmic_exclusive_monitor *>(monitor),
+                processor_id);
         default:
             break;
         }
 
         return nullptr;
     }
-}
\ No newline at end of file
+
+    exclusive_monitor_instance create_exclusive_monitor(arm_emulator_type arm_type, const std::size_t core_count) {
+        switch (arm_type) {
+        case arm_emulator_type::dynarmic:
+#if DYNARMIC_HAS_GLOBAL_MONITOR
+            return std::make_unique<dynarmic_exclusive_monitor>(core_count);
+#else
+            return nullptr;
+#endif
+
+        default:
+            break;
+        }
+
+        return nullptr;
+    }
+}
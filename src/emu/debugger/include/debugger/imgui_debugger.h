@@ -60,6 +60,9 @@ namespace eka2l1 {
         bool should_show_chunks;
         bool should_show_window_tree;
         bool should_show_rendered_bitmap;
+        bool should_show_call_profiler;
+
+        std::uint64_t call_profile_selected_key;
 
         bool should_pause;
         bool should_stop;
@@ -173,6 +176,7 @@ namespace eka2l1 {
         void show_chunks();
         void show_timers();
         void show_disassembler();
+        void show_call_profiler();
         void show_menu();
         void show_preferences();
         void show_package_manager();
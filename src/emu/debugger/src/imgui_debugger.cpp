@@ -70,6 +70,7 @@
 #include <common/language.h>
 #include <common/path.h>
 #include <common/platform.h>
+#include <common/profiler.h>
 
 #include <chrono>
 #include <mutex>
@@ -109,6 +110,8 @@ namespace eka2l1 {
         , should_show_mutexs(false)
         , should_show_chunks(false)
         , should_show_window_tree(false)
+        , should_show_call_profiler(false)
+        , call_profile_selected_key(0)
         , should_show_disassembler(false)
         , should_show_logger(true)
         , should_show_preferences(false)
@@ -457,6 +460,84 @@ namespace eka2l1 {
     void imgui_debugger::show_timers() {
     }
 
+    static std::uint64_t call_profile_entry_key(const common::call_profile_entry &entry) {
+        return (static_cast<std::uint64_t>(entry.category_ + 1) << 56) | (static_cast<std::uint64_t>(entry.owner_ & 0xFFFFFF) << 32)
+            | entry.ordinal_;
+    }
+
+    void imgui_debugger::show_call_profiler() {
+        if (ImGui::Begin("Call profiler", &should_show_call_profiler)) {
+            common::call_profiler *profiler = sys->get_kernel_system()->get_call_profiler();
+            bool enabled = profiler->is_enabled();
+
+            if (ImGui::Checkbox("Enabled", &enabled)) {
+                profiler->set_enabled(enabled);
+                conf->profile_calls = enabled;
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Reset")) {
+                profiler->reset();
+                call_profile_selected_key = 0;
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Dump")) {
+                if (!profiler->dump_json(conf->profile_dump_path + ".json") || !profiler->dump_csv(conf->profile_dump_path + ".csv")) {
+                    LOG_ERROR("Failed to dump call profile to {}", conf->profile_dump_path);
+                }
+            }
+
+            const std::vector<common::call_profile_entry> entries = profiler->snapshot();
+            const common::call_profile_entry *selected = nullptr;
+
+            ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-8s    %-40s    %-10s    %-10s    %-10s    %-10s    %-10s", "Type",
+                "Name", "Count", "Total (ms)", "Avg (us)", "P99 (us)", "Max (us)");
+
+            if (ImGui::BeginChild("##CallProfileEntries", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.7f))) {
+                for (const common::call_profile_entry &entry : entries) {
+                    const common::latency_histogram &hist = entry.histogram_;
+                    const std::uint64_t key = call_profile_entry_key(entry);
+
+                    std::string name = entry.name_.empty() ? fmt::format("0x{:X}", entry.ordinal_) : entry.name_;
+
+                    if (!entry.group_.empty()) {
+                        name = entry.group_ + ": " + name;
+                    }
+
+                    const std::string row = fmt::format("{:<8}    {:<40}    {:<10}    {:<10.3f}    {:<10.2f}    {:<10.2f}    {:<10.2f}",
+                        common::call_profile_category_name(entry.category_), name, hist.count_, hist.total_ns_ / 1000000.0,
+                        hist.average() / 1000.0, hist.percentile(0.99) / 1000.0, hist.max_ns_ / 1000.0);
+
+                    if (ImGui::Selectable(fmt::format("{}##{}", row, key).c_str(), call_profile_selected_key == key)) {
+                        call_profile_selected_key = key;
+                    }
+
+                    if (call_profile_selected_key == key) {
+                        selected = &entry;
+                    }
+                }
+            }
+
+            ImGui::EndChild();
+
+            if (selected) {
+                // Plot the histogram in log2 nanosecond buckets
+                std::array<float, common::latency_histogram::BUCKET_COUNT> bucket_values;
+                for (std::size_t i = 0; i < bucket_values.size(); i++) {
+                    bucket_values[i] = static_cast<float>(selected->histogram_.buckets_[i]);
+                }
+
+                ImGui::PlotHistogram("##CallProfileHistogram", bucket_values.data(), static_cast<int>(bucket_values.size()),
+                    0, "Latency (log2 ns buckets)", 0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y));
+            }
+        }
+
+        ImGui::End();
+    }
+
     void imgui_debugger::show_disassembler() {
         if (ImGui::Begin("Disassembler", &should_show_disassembler)) {
             thread_ptr debug_thread = nullptr;
@@ -2042,7 +2123,11 @@ namespace eka2l1 {
                 const std::string object_submenu_name = common::get_localised_string(localised_strings,
                     "debugger_menu_objects_item_name");
 
+                const std::string call_profiler_item_name = common::get_localised_string(localised_strings,
+                    "debugger_menu_call_profiler_item_name");
+
                 ImGui::MenuItem(disassembler_item_name.c_str(), nullptr, &should_show_disassembler);
+                ImGui::MenuItem(call_profiler_item_name.c_str(), nullptr, &should_show_call_profiler);
 
                 if (ImGui::BeginMenu(object_submenu_name.c_str())) {
                     const std::string threads_item_name = common::get_localised_string(localised_strings,
@@ -3003,6 +3088,10 @@ namespace eka2l1 {
             show_disassembler();
         }
 
+        if (should_show_call_profiler) {
+            show_call_profiler();
+        }
+
         if (should_show_preferences) {
             show_preferences();
         }
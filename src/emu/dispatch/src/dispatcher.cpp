@@ -26,6 +26,7 @@
 #include <utils/err.h>
 
 #include <common/log.h>
+#include <common/profiler.h>
 #include <system/epoc.h>
 
 namespace eka2l1::dispatch {
@@ -50,7 +51,14 @@ namespace eka2l1::dispatch {
             return;
         }
 
-        dispatch_find_result->second(sys, sys->get_kernel_system()->crr_process(), sys->get_cpu());
+        kernel_system *kern = sys->get_kernel_system();
+
+        // Dispatch functions are not named, only the ordinal is recorded
+        static const std::string NO_NAME;
+        common::call_profile_scope profile_scope(kern->get_call_profiler(), common::call_profile_category_dispatch, 0,
+            function_ord, NO_NAME, NO_NAME);
+
+        dispatch_find_result->second(sys, kern->crr_process(), kern->get_cpu());
     }
 
     void dispatcher::shutdown() {
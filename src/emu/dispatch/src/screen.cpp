@@ -18,6 +18,7 @@
  */
 
 #include <common/log.h>
+#include <common/region.h>
 #include <dispatch/dispatcher.h>
 #include <dispatch/screen.h>
 
@@ -27,11 +28,61 @@
 #include <services/window/common.h>
 #include <services/window/window.h>
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <vector>
 
 namespace eka2l1::dispatch {
     static constexpr std::uint32_t FPS_LIMIT = 60;
 
+    // Above this number of rectangles, upload their bounding rectangle in one go
+    static constexpr std::size_t MAX_DSA_UPLOAD_RECTS = 8;
+
+    /**
+     * \brief Turn the list of rectangles updated by the guest into a small set of areas to upload.
+     *
+     * \param screen_size  Size of the screen, in pixels.
+     * \param num_rects    Number of rectangles in the list. If 0, the whole screen is updated.
+     * \param rect_list    Rectangles in guest format.
+     * \param x_align      Alignment in pixels of the horizontal start and end of each area.
+     * \param result       The areas to upload, not overlapping each other.
+     */
+    static void get_dsa_upload_region(const eka2l1::vec2 &screen_size, const std::uint32_t num_rects,
+        const eka2l1::rect *rect_list, const int x_align, common::region &result) {
+        const eka2l1::rect screen_rect({ 0, 0 }, screen_size);
+
+        if ((num_rects == 0) || !rect_list) {
+            result.add_rect(screen_rect);
+            return;
+        }
+
+        for (std::uint32_t i = 0; i < num_rects; i++) {
+            eka2l1::rect updated = rect_list[i];
+            updated.transform_from_symbian_rectangle();
+            updated = updated.intersect(screen_rect);
+
+            if ((updated.size.x <= 0) || (updated.size.y <= 0)) {
+                continue;
+            }
+
+            const int left = (updated.top.x / x_align) * x_align;
+            const int right = std::min<int>(((updated.top.x + updated.size.x + x_align - 1) / x_align) * x_align, screen_size.x);
+
+            updated.top.x = left;
+            updated.size.x = right - left;
+
+            result.add_rect(updated);
+        }
+
+        if (result.rects_.size() > MAX_DSA_UPLOAD_RECTS) {
+            const eka2l1::rect bound = result.bounding_rect();
+
+            result.make_empty();
+            result.add_rect(bound);
+        }
+    }
+
     BRIDGE_FUNC_DISPATCHER(void, update_screen, const std::uint32_t screen_number, const std::uint32_t num_rects, const eka2l1::rect *rect_list) {
         dispatch::dispatcher *dispatcher = sys->get_dispatcher();
         drivers::graphics_driver *driver = sys->get_graphics_driver();
@@ -44,6 +95,7 @@ namespace eka2l1::dispatch {
                 // Update the DSA screen texture
                 const eka2l1::vec2 screen_size = scr->size();
                 const std::size_t buffer_size = scr->size().x * scr->size().y * 4;
+                const int bpp = epoc::get_bpp_from_display_mode(scr->disp_mode);
 
                 std::uint64_t next_vsync_us = 0;
                 scr->vsync(sys->get_ntimer(), next_vsync_us);
@@ -54,37 +106,71 @@ namespace eka2l1::dispatch {
 
                 std::unique_lock<std::mutex> guard(scr->screen_mutex);
 
-                if (!scr->dsa_texture) {
-                    kern->unlock();
-                    guard.unlock();
+                auto command_list = driver->new_command_list();
+                auto command_builder = driver->new_command_builder(command_list.get());
 
-                    drivers::handle bitmap_handle = drivers::create_bitmap(driver, screen_size, epoc::get_bpp_from_display_mode(scr->disp_mode));
-                    
-                    kern->lock();
-                    guard.lock();
+                // A new texture has nothing in it, so it must be filled whole
+                const bool first_upload = (scr->dsa_texture == 0);
 
-                    scr->dsa_texture = bitmap_handle;
+                if (!scr->dsa_texture) {
+                    // Bitmap creation does not wait for the driver, so it's fine to keep the locks
+                    scr->dsa_texture = drivers::create_bitmap(driver, screen_size, bpp);
+
+                    // NOTE: This is a hack for some apps that dont fill alpha
+                    // TODO: Figure out why or better solution (maybe the display mode is not really correct?)
+                    // Uploads don't touch the swizzle of these formats, so only set it once.
+                    switch (scr->disp_mode) {
+                    case epoc::display_mode::color16m:
+                    case epoc::display_mode::color16mu:
+                    case epoc::display_mode::color16ma:
+                        command_builder->set_swizzle(scr->dsa_texture, drivers::channel_swizzle::red, drivers::channel_swizzle::green,
+                            drivers::channel_swizzle::blue, drivers::channel_swizzle::one);
+
+                        break;
+
+                    default:
+                        break;
+                    }
                 }
 
-                auto command_list = driver->new_command_list();
-                auto command_builder = driver->new_command_builder(command_list.get());
+                const char *screen_buffer = reinterpret_cast<const char *>(scr->screen_buffer_ptr());
+
+                if ((bpp != 16) && (bpp != 32)) {
+                    // Rows of other formats may be padded. Upload everything, like before.
+                    command_builder->update_bitmap(scr->dsa_texture, screen_buffer, buffer_size, { 0, 0 }, screen_size);
+                } else {
+                    // Only move the pixels the guest said it changed
+                    const std::size_t bytes_per_pixel = bpp >> 3;
+                    const std::size_t stride = screen_size.x * bytes_per_pixel;
+
+                    // Rows are unpacked with 4 bytes alignment, so keep 16-bit rows an even number of pixels wide
+                    common::region upload_region;
+                    get_dsa_upload_region(screen_size, first_upload ? 0 : num_rects, rect_list, (bpp == 16) ? 2 : 1,
+                        upload_region);
+
+                    std::vector<char> packed;
+
+                    for (const eka2l1::rect &area : upload_region.rects_) {
+                        const std::size_t line_size = area.size.x * bytes_per_pixel;
+                        const char *area_start = screen_buffer + area.top.y * stride + area.top.x * bytes_per_pixel;
+
+                        if (area.size.x == screen_size.x) {
+                            // The rows are already contiguous
+                            command_builder->update_bitmap(scr->dsa_texture, area_start, line_size * area.size.y,
+                                area.top, area.size);
 
-                command_builder->update_bitmap(scr->dsa_texture, reinterpret_cast<const char*>(scr->screen_buffer_ptr()),
-                    buffer_size, { 0, 0 }, screen_size);
+                            continue;
+                        }
 
-                // NOTE: This is a hack for some apps that dont fill alpha
-                // TODO: Figure out why or better solution (maybe the display mode is not really correct?)
-                switch (scr->disp_mode) {
-                case epoc::display_mode::color16m:
-                case epoc::display_mode::color16mu:
-                case epoc::display_mode::color16ma:
-                    command_builder->set_swizzle(scr->dsa_texture, drivers::channel_swizzle::red, drivers::channel_swizzle::green,
-                        drivers::channel_swizzle::blue, drivers::channel_swizzle::one);
+                        // Pack the rows, so no bytes outside of the area get copied
+                        packed.resize(line_size * area.size.y);
 
-                    break;
+                        for (int y = 0; y < area.size.y; y++) {
+                            std::memcpy(packed.data() + y * line_size, area_start + y * stride, line_size);
+                        }
 
-                default:
-                    break;
+                        command_builder->update_bitmap(scr->dsa_texture, packed.data(), packed.size(), area.top, area.size);
+                    }
                 }
 
                 driver->submit_command_list(*command_list);
@@ -24,12 +24,22 @@
 
 #include <common/queue.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 namespace eka2l1::drivers {
     using dsp_buffer = std::vector<std::uint8_t>;
 
+    /**
+     * \brief Output stream decoding on a worker thread.
+     *
+     * Encoded buffers are decoded by a worker into a lock-free PCM ring, so the audio
+     * callback only copies samples out and never waits on the decoder.
+     */
     struct dsp_output_stream_shared : public dsp_output_stream {
     protected:
         drivers::audio_driver *aud_;
@@ -40,11 +50,32 @@ namespace eka2l1::drivers {
         dsp_buffer decoded_;
         std::size_t pointer_;
 
+        spsc_ring<std::int16_t> pcm_ring_;
+        std::atomic<std::size_t> flush_mark_;
+
+        std::unique_ptr<std::thread> decode_thread_;
+        std::mutex decode_lock_;
+
+        std::mutex decode_wake_lock_;
+        std::condition_variable decode_wake_cond_;
+        bool decode_wake_;
+        std::atomic<bool> decode_thread_exit_;
+
         std::int16_t last_frame_[2];
         std::mutex callback_lock_;
 
         bool virtual_stop;
 
+        bool decode_step();
+        void decode_thread_loop();
+
+        /**
+         * \brief Stop and join the decode thread.
+         *
+         * Backends must call this first in their destructor, since the thread calls into decode_data.
+         */
+        void stop_decode_thread();
+
     public:
         explicit dsp_output_stream_shared(drivers::audio_driver *aud);
         ~dsp_output_stream_shared() override;
@@ -25,12 +25,25 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+struct SwrContext;
+
 namespace eka2l1::drivers {
     struct dsp_output_stream_ffmpeg : public dsp_output_stream_shared {
     protected:
         AVCodecContext *codec_;
+        AVFrame *frame_;
         std::uint64_t timestamp_in_base_;
 
+        // The resampler is kept as long as the formats it converts between stay the same
+        SwrContext *resampler_;
+        std::uint64_t resampler_in_layout_;
+        int resampler_in_format_;
+        int resampler_in_rate_;
+        std::uint32_t resampler_out_rate_;
+        std::uint32_t resampler_out_channels_;
+
+        SwrContext *get_resampler(const AVFrame *frame);
+
     public:
         explicit dsp_output_stream_ffmpeg(drivers::audio_driver *aud);
         ~dsp_output_stream_ffmpeg() override;
@@ -21,7 +21,14 @@
 #pragma once
 
 #include <common/queue.h>
+
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace eka2l1::drivers {
     static constexpr std::uint32_t MAX_COMMAND_DATA_SIZE = 80;
@@ -33,24 +40,21 @@ namespace eka2l1::drivers {
         std::uint16_t opcode_;
         std::uint8_t data_[MAX_COMMAND_DATA_SIZE];
 
-        command *next_;
         int *status_;
 
         explicit command()
             : opcode_(0)
-            , data_()
-            , next_(nullptr)
             , status_(nullptr) {
         }
 
         explicit command(const std::uint16_t opcode, int *status = nullptr)
             : opcode_(opcode)
-            , data_()
-            , next_(nullptr)
             , status_(status) {
         }
     };
 
+    struct command_list;
+
     struct command_helper {
         std::uint16_t cursor_;
         command *todo_;
@@ -96,44 +100,33 @@ namespace eka2l1::drivers {
 
         template <typename T>
         void finish(T *drv, const int code) {
-            *todo_->status_ = code;
-            drv->cond_.notify_all();
-        }
-
-        bool push_string(const std::u16string &data) {
-            // Alloc memory for the string
-            std::uint16_t length = static_cast<std::uint16_t>(data.length());
-
-            if (!push(length)) {
-                return false;
+            if (todo_->status_) {
+                *todo_->status_ = code;
             }
 
-            char16_t *dat = new char16_t[length];
-            std::copy(data.data(), data.data() + length, dat);
-
-            if (!push(dat)) {
-                return false;
-            }
-
-            return true;
+            drv->cond_.notify_all();
         }
 
+        /**
+         * \brief Push a string, with its content stored in the payload arena of the command list.
+         *
+         * The string data lives until the list is cleared.
+         */
+        bool push_string(command_list &list, const std::u16string &data);
+
         bool pop_string(std::u16string &dat) {
             std::uint16_t length = 0;
             if (!pop(length)) {
                 return false;
             }
 
-            dat.resize(length);
             char16_t *ptr = nullptr;
 
             if (!pop(ptr)) {
                 return false;
             }
 
-            std::copy(ptr, ptr + length, &dat[0]);
-            delete ptr;
-
+            dat.assign(ptr, ptr + length);
             return true;
         }
     };
@@ -147,50 +140,181 @@ namespace eka2l1::drivers {
         }
     }
 
-    template <typename... Args>
-    command *make_command(const std::uint16_t opcode, int *status, Args... arguments) {
-        command *cmd = new command(opcode, status);
-        command_helper helper(cmd);
-
-        if constexpr (sizeof...(Args) > 0)
-            push_arguments(helper, arguments...);
-
-        return cmd;
-    }
-
     /**
-     * \brief A linked list of command.
+     * \brief A list of commands, laid out back-to-back in one contiguous buffer.
+     *
+     * Data that commands point to (bitmap pixels, buffer content, strings...) is copied to a
+     * bump-allocated payload arena owned by the list, and stays valid until the list is cleared.
+     *
+     * Clearing keeps all the storage, so a list recycled through a command_list_pool stops
+     * allocating once it has grown to the usual size of a frame.
      */
     struct command_list {
-        command *first_;
-        command *last_;
+        static constexpr std::size_t PAYLOAD_BLOCK_SIZE = 0x10000;
+        static constexpr std::size_t PAYLOAD_ALIGNMENT = 16;
 
+        std::vector<command> commands_;
+
+    private:
+        std::vector<std::unique_ptr<std::uint8_t[]>> payload_blocks_;
+        std::vector<std::unique_ptr<std::uint8_t[]>> large_payloads_;
+
+        std::size_t payload_block_index_;
+        std::size_t payload_cursor_;
+
+    public:
         explicit command_list()
-            : first_(nullptr) {
+            : payload_block_index_(0)
+            , payload_cursor_(0) {
         }
 
+        command_list(const command_list &rhs) = delete;
+        command_list &operator=(const command_list &rhs) = delete;
+
+        command_list(command_list &&rhs) noexcept;
+        command_list &operator=(command_list &&rhs) noexcept;
+
         bool empty() const {
-            return !first_;
+            return commands_.empty();
         }
 
-        void add(command *cmd_) {
-            if (first_ == nullptr) {
-                first_ = cmd_;
-                last_ = cmd_;
+        std::size_t size() const {
+            return commands_.size();
+        }
 
-                return;
+        /**
+         * \brief Construct a new command at the end of the list.
+         *
+         * \param opcode     The opcode of the command.
+         * \param status     Pointer to the status to be written when the command finishes. Can be null.
+         * \param arguments  Arguments to be packed into the command data.
+         *
+         * \returns Reference to the new command. Valid until another command is added.
+         */
+        template <typename... Args>
+        command &add(const std::uint16_t opcode, int *status, Args... arguments) {
+            command &cmd = commands_.emplace_back(opcode, status);
+
+            if constexpr (sizeof...(Args) > 0) {
+                command_helper helper(&cmd);
+                push_arguments(helper, arguments...);
             }
 
-            last_->next_ = cmd_;
-            last_ = cmd_;
+            return cmd;
+        }
+
+        /**
+         * \brief Allocate memory from the payload arena of this list.
+         *
+         * The memory is aligned to PAYLOAD_ALIGNMENT and valid until the list is cleared.
+         */
+        std::uint8_t *allocate_payload(const std::size_t size);
+
+        /**
+         * \brief Copy data to the payload arena of this list.
+         * \returns Pointer to the copy, valid until the list is cleared.
+         */
+        void *copy_payload(const void *data, const std::size_t size);
+
+        /**
+         * \brief Remove all commands and payload, keeping the storage for reuse.
+         */
+        void clear();
+
+        command *begin() {
+            return commands_.data();
+        }
+
+        command *end() {
+            return commands_.data() + commands_.size();
         }
     };
 
+    /**
+     * \brief Pool of cleared command lists, so their storage can be reused by the next list.
+     *
+     * Thread-safe. Lists are usually built on the OS thread and released by the driver thread.
+     */
+    class command_list_pool {
+        std::mutex lock_;
+        std::vector<command_list> free_;
+
+        std::size_t max_free_;
+
+    public:
+        explicit command_list_pool(const std::size_t max_free = 16)
+            : max_free_(max_free) {
+        }
+
+        /**
+         * \brief Get an empty list, reusing the storage of a released one if possible.
+         */
+        command_list acquire();
+
+        /**
+         * \brief Clear the list and keep its storage for later acquires.
+         */
+        void release(command_list &&list);
+    };
+
+    /**
+     * \brief Base of all drivers.
+     *
+     * Work submitted to a driver is tracked by a timeline of fences. Each submission gets the next
+     * fence value, and the driver signals fences in submission order once the work is done. Clients
+     * only need to wait on a fence when they really need the result of the work.
+     */
     class driver {
+    protected:
+        std::mutex submit_lock_;
+        std::uint64_t fence_submitted_;
+        std::atomic<std::uint64_t> fence_completed_;
+
+        /**
+         * \brief Get the fence value for a new submission. Must be called with submit_lock_ held,
+         *        in the same order the submissions are queued.
+         */
+        std::uint64_t next_fence() {
+            return ++fence_submitted_;
+        }
+
+        /**
+         * \brief Signal the oldest pending fence. Called by the driver thread after each submission is done.
+         */
+        void signal_next_fence() {
+            {
+                const std::lock_guard<std::mutex> guard(mut_);
+
+                // Saturate, all fences stay signaled once the driver has stopped
+                if (fence_completed_.load(std::memory_order_relaxed) != ~0ULL) {
+                    fence_completed_++;
+                }
+            }
+
+            cond_.notify_all();
+        }
+
+        /**
+         * \brief Signal every fence, now and in the future. Used when the driver stops, so no client waits forever.
+         */
+        void signal_all_fences() {
+            {
+                const std::lock_guard<std::mutex> guard(mut_);
+                fence_completed_ = ~0ULL;
+            }
+
+            cond_.notify_all();
+        }
+
     public:
         std::mutex mut_;
         std::condition_variable cond_;
 
+        explicit driver()
+            : fence_submitted_(0)
+            , fence_completed_(0) {
+        }
+
         virtual ~driver() {}
         virtual void run() = 0;
         virtual void abort() = 0;
@@ -199,13 +323,23 @@ namespace eka2l1::drivers {
             cond_.notify_all();
         }
 
-        void wait_for(int *status) {
-            if (*status == 0) {
+        /**
+         * \brief Check if the work associated with a fence, and all work submitted before it, is done.
+         */
+        bool is_fence_signaled(const std::uint64_t fence) const {
+            return fence_completed_.load(std::memory_order_acquire) >= fence;
+        }
+
+        /**
+         * \brief Block until the fence is signaled.
+         */
+        void wait_fence(const std::uint64_t fence) {
+            if (is_fence_signaled(fence)) {
                 return;
             }
 
             std::unique_lock<std::mutex> ulock(mut_);
-            cond_.wait(ulock, [&]() { return *status != -100; });
+            cond_.wait(ulock, [&]() { return is_fence_signaled(fence); });
         }
     };
 }
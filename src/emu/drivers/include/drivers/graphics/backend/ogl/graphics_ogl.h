@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <queue>
+#include <vector>
 
 namespace eka2l1::drivers {
     struct ogl_state {
@@ -52,27 +53,35 @@ namespace eka2l1::drivers {
         GLboolean last_enable_scissor_test;
     };
 
+    /**
+     * \brief A sprite queued for drawing in a batch.
+     *
+     * Each sprite is one instance of a unit quad. Rectangle fills are sprites that sample a white texture.
+     */
+    struct ogl_sprite_instance {
+        float dest[4]; ///< Destination position and size, in pixels.
+        float source[4]; ///< Source position and size, in normalized texture coordinates.
+        float color[4]; ///< Color to multiply with, from 0 to 255.
+        float flip; ///< Multiplier of the final Y coordinate.
+    };
+
     class ogl_graphics_driver : public shared_graphics_driver {
         eka2l1::request_queue<server_graphics_command_list> list_queue;
-        std::unique_ptr<ogl_shader> sprite_program;
-        std::unique_ptr<ogl_shader> fill_program;
+        command_list_pool list_pool;
         std::unique_ptr<ogl_shader> mask_program;
+        std::unique_ptr<ogl_shader> batch_program;
 
         GLuint sprite_vao;
         GLuint sprite_vbo;
         GLuint sprite_ibo;
 
-        GLuint fill_vao;
-        GLuint fill_vbo;
-
-        GLint color_loc;
-        GLint proj_loc;
-        GLint model_loc;
-        GLint flip_loc;
+        GLuint batch_vao;
+        GLuint batch_quad_vbo;
+        GLuint batch_instance_vbo;
+        GLuint batch_white_texture;
 
-        GLint color_loc_fill;
-        GLint proj_loc_fill;
-        GLint model_loc_fill;
+        std::vector<ogl_sprite_instance> batch_sprites;
+        GLuint batch_texture;
 
         GLint color_loc_mask;
         GLint proj_loc_mask;
@@ -82,6 +91,9 @@ namespace eka2l1::drivers {
         GLint mask_loc_mask;
         GLint flip_loc_mask;
 
+        GLint proj_loc_batch;
+        GLint source_loc_batch;
+
         ogl_state backup;
         std::atomic_bool should_stop;
 
@@ -109,13 +121,26 @@ namespace eka2l1::drivers {
         void save_gl_state();
         void load_gl_state();
 
+        /**
+         * \brief Queue a sprite to be drawn with the given texture.
+         *
+         * Sprites sharing the same texture are drawn with a single instanced draw call. The batch is
+         * flushed when the texture changes, when it's full, or before any other command runs.
+         */
+        void queue_sprite(const GLuint texture, const ogl_sprite_instance &sprite);
+
+        /**
+         * \brief Draw all sprites queued so far.
+         */
+        void flush_sprite_batch();
+
     public:
         explicit ogl_graphics_driver();
         ~ogl_graphics_driver() override {}
 
         void set_viewport(const eka2l1::rect &viewport) override;
         std::unique_ptr<graphics_command_list> new_command_list() override;
-        void submit_command_list(graphics_command_list &command_list) override;
+        std::uint64_t submit_command_list(graphics_command_list &command_list) override;
         std::unique_ptr<graphics_command_list_builder> new_command_builder(graphics_command_list *list) override;
 
         void run() override;
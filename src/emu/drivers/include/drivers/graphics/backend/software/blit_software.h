@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <drivers/graphics/common.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eka2l1::drivers::software {
+    /**
+     * \brief Blending state of the software rasterizer. Mirrors the fixed function blending of GPU APIs.
+     */
+    struct blend_state {
+        bool enabled = false;
+
+        blend_equation rgb_equation = blend_equation::add;
+        blend_equation a_equation = blend_equation::add;
+
+        blend_factor rgb_frag_out_factor = blend_factor::one;
+        blend_factor rgb_current_factor = blend_factor::zero;
+        blend_factor a_frag_out_factor = blend_factor::one;
+        blend_factor a_current_factor = blend_factor::zero;
+    };
+
+    /**
+     * Pixels handled by the functions below are 32-bit, with bytes ordered as B, G, R, A in memory.
+     *
+     * All functions use SSE2 where available, and fall back to plain C++ on other architectures.
+     */
+
+    /**
+     * \brief Pack color components in range of 0 to 255 into a pixel.
+     */
+    inline std::uint32_t pack_pixel(const std::uint8_t r, const std::uint8_t g, const std::uint8_t b, const std::uint8_t a) {
+        return (static_cast<std::uint32_t>(a) << 24) | (static_cast<std::uint32_t>(r) << 16)
+            | (static_cast<std::uint32_t>(g) << 8) | b;
+    }
+
+    /**
+     * \brief Fill a span with a single pixel value.
+     */
+    void fill_span(std::uint32_t *dest, const std::uint32_t color, const std::size_t count);
+
+    /**
+     * \brief Multiply each channel of a span with the matching channel of another span.
+     *
+     * Channels are treated as numbers from 0 to 1, so multiplying with 255 keeps the value.
+     */
+    void multiply_span(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count);
+
+    /**
+     * \brief Multiply each channel of a span with the matching channel of a pixel value.
+     */
+    void multiply_color_span(std::uint32_t *dest, const std::uint32_t color, const std::size_t count);
+
+    /**
+     * \brief Invert every channel of a span.
+     */
+    void invert_span(std::uint32_t *dest, const std::size_t count);
+
+    /**
+     * \brief Rearrange the channels of every pixel in a span.
+     *
+     * \param dest      Pixels to rearrange. Results are written back here.
+     * \param count     Number of pixels.
+     * \param swizzle   Where the red, green, blue and alpha channels are taken from, in that order.
+     */
+    void swizzle_span(std::uint32_t *dest, const std::size_t count, const channel_swizzle *swizzle);
+
+    /**
+     * \brief Blend a span of source pixels into the destination span.
+     *
+     * If blending is disabled in the state, the source is copied.
+     *
+     * \param dest      Pixels currently in the target. Results are written back here.
+     * \param source    Pixels being drawn.
+     * \param count     Number of pixels.
+     * \param state     Blending state to follow.
+     */
+    void blend_span(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count, const blend_state &state);
+}
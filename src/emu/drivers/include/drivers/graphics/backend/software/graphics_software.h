@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <drivers/graphics/backend/software/blit_software.h>
+#include <drivers/graphics/graphics.h>
+
+#include <common/queue.h>
+#include <common/vecx.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eka2l1::drivers {
+    /**
+     * \brief Bitmap living in host memory, drawn by the CPU.
+     *
+     * Pixels are always stored in 32-bit BGRA, no matter what the bit depth of the bitmap is.
+     * The bit depth is kept to know how to read data uploaded to it.
+     */
+    struct software_bitmap {
+        eka2l1::vec2 size;
+        int bpp;
+        std::vector<std::uint32_t> pixels;
+        std::array<channel_swizzle, 4> swizzle;     ///< Channels sampled for red, green, blue and alpha.
+
+        explicit software_bitmap(const eka2l1::vec2 &size, const int bpp);
+
+        void resize(const eka2l1::vec2 &new_size);
+
+        /**
+         * \brief Check if sampling the bitmap rearranges its channels.
+         */
+        bool swizzled() const;
+
+        std::uint32_t *row(const int y) {
+            return pixels.data() + static_cast<std::size_t>(y) * size.x;
+        }
+    };
+
+    using software_bitmap_ptr = std::unique_ptr<software_bitmap>;
+
+    /**
+     * \brief Graphics driver rasterizing on the CPU.
+     *
+     * Implements the 2D command set used by the window server: bitmaps, bitmap draws with masks, rectangles,
+     * clipping and blending. The programmable pipeline is not supported.
+     *
+     * This needs no GPU nor window, so the emulator can run on headless machines, for example to benchmark
+     * guest performance on build servers. Frames can be dumped to PNG files to check the results.
+     */
+    class software_graphics_driver : public graphics_driver {
+        struct draw_state {
+            eka2l1::rect viewport;
+            eka2l1::rect clip;
+            bool clipping = false;
+            software::blend_state blend;
+        };
+
+        eka2l1::request_queue<server_graphics_command_list> list_queue;
+        command_list_pool list_pool;
+        std::atomic_bool should_stop;
+
+        std::vector<software_bitmap_ptr> bitmaps;
+        software_bitmap swapchain;
+
+        software_bitmap *binding;
+        eka2l1::vec2 swapchain_size;
+        eka2l1::vec2 projection_size;
+
+        draw_state state;
+        draw_state backup;
+        std::uint32_t brush_color;
+
+        // Scratch storage for spans being drawn, kept to not allocate per draw
+        std::vector<std::uint32_t> source_span;
+        std::vector<std::uint32_t> mask_span;
+        std::vector<int> source_columns;
+        std::vector<int> mask_columns;
+
+        std::string frame_dump_folder;
+        std::uint64_t frame_dump_count;
+
+        software_bitmap *get_bitmap(const drivers::handle h);
+        software_bitmap *current_target();
+
+        /**
+         * \brief Transform a rectangle in drawing coordinates to pixels of the current target.
+         *
+         * \param draw_rect     Rectangle to transform.
+         * \param no_flip       True if the Y axis should not be flipped.
+         * \param x0            Start column, inclusive.
+         * \param x1            End column, exclusive.
+         * \param y0            Start row, inclusive.
+         * \param y1            End row, exclusive.
+         * \param mirrored      True if rows are placed in reverse order.
+         *
+         * \returns False if the rectangle is empty.
+         */
+        bool transform_rect(const eka2l1::rect &draw_rect, const bool no_flip, float &x0, float &x1, float &y0, float &y1,
+            bool &mirrored);
+
+        /**
+         * \brief Get the area of the target that can be drawn to, with clipping applied.
+         */
+        eka2l1::rect drawable_area(software_bitmap *target);
+
+        void create_bitmap(command_helper &helper);
+        void destroy_bitmap(command_helper &helper);
+        void bind_bitmap(command_helper &helper);
+        void update_bitmap(command_helper &helper);
+        void resize_bitmap(command_helper &helper);
+        void set_brush_color(command_helper &helper);
+        void set_swapchain_size(command_helper &helper);
+        void clear(command_helper &helper);
+        void draw_bitmap(command_helper &helper);
+        void draw_rectangle(command_helper &helper);
+        void set_clipping(command_helper &helper);
+        void clip_rect(command_helper &helper);
+        void set_viewport(command_helper &helper);
+        void set_swizzle(command_helper &helper);
+        void set_blend(command_helper &helper);
+        void blend_formula(command_helper &helper);
+        void display(command_helper &helper);
+
+        void dump_frame();
+
+    public:
+        explicit software_graphics_driver();
+        ~software_graphics_driver() override {}
+
+        void update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset, const eka2l1::vec2 &dim,
+            const void *data, const std::size_t pixels_per_line = 0) override;
+
+        void attach_descriptors(drivers::handle h, const int stride, const bool instance_move, const attribute_descriptor *descriptors,
+            const int descriptor_count) override;
+
+        void set_viewport(const eka2l1::rect &viewport) override;
+        std::unique_ptr<graphics_command_list> new_command_list() override;
+        std::uint64_t submit_command_list(graphics_command_list &command_list) override;
+        std::unique_ptr<graphics_command_list_builder> new_command_builder(graphics_command_list *list) override;
+
+        void run() override;
+        void abort() override;
+        void dispatch(command *cmd);
+
+        /**
+         * \brief Dump the swapchain to a PNG file each time it's displayed.
+         *
+         * Files are named frame_<number>.png. Must be set before the driver starts running.
+         *
+         * \param folder    Folder to write frames to. Empty to stop dumping.
+         */
+        void set_frame_dump_folder(const std::string &folder);
+
+        /**
+         * \brief Save the content of a bitmap to a PNG file.
+         *
+         * The driver must be idle, for example after waiting on the fence of the last submitted list.
+         *
+         * \param h       Handle of the bitmap to save.
+         * \param path    Path of the PNG file to write.
+         *
+         * \returns True on success.
+         */
+        bool save_bitmap(const drivers::handle h, const std::string &path);
+
+        /**
+         * \brief Read back the pixels of a bitmap, in 32-bit BGRA.
+         *
+         * The driver must be idle, for example after waiting on the fence of the last submitted list.
+         *
+         * \param h       Handle of the bitmap to read.
+         * \param pixels  Receives the pixels, row by row from the top.
+         *
+         * \returns True on success.
+         */
+        bool read_bitmap(const drivers::handle h, std::vector<std::uint32_t> &pixels);
+    };
+}
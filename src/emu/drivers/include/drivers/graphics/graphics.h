@@ -28,6 +28,9 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace eka2l1::drivers {
     enum graphics_driver_opcode : std::uint16_t {
@@ -82,12 +85,27 @@ namespace eka2l1::drivers {
 
     using display_hook = std::function<void()>;
 
+    //! Bit set in handles that refer to bitmaps, instead of generic graphics objects.
+    static constexpr drivers::handle HANDLE_BITMAP = 1ULL << 32;
+
     class graphics_driver : public driver {
         graphic_api api_;
 
+        std::mutex bitmap_handle_lock_;
+        std::vector<drivers::handle> free_bitmap_handles_;
+        drivers::handle bitmap_handle_counter_{ 0 };
+
     protected:
         display_hook disp_hook_;
 
+        /**
+         * \brief Give a bitmap handle back for reuse.
+         *
+         * Called by the driver thread once the bitmap is destroyed, so a handle is never reused
+         * by a command that could run before the destroy command.
+         */
+        void release_bitmap_handle(const drivers::handle h);
+
     public:
         explicit graphics_driver(graphic_api api)
             : api_(api) {}
@@ -117,6 +135,14 @@ namespace eka2l1::drivers {
             disp_hook_ = hook;
         }
 
+        /**
+         * \brief Reserve a bitmap handle on the client side.
+         *
+         * The handle can be used in command lists right away. The bitmap behind it exists once
+         * the create command, submitted before any list using it, is executed.
+         */
+        drivers::handle reserve_bitmap_handle();
+
         virtual void update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
             const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line = 0)
             = 0;
@@ -134,15 +160,33 @@ namespace eka2l1::drivers {
         /**
          * \brief Submit a command list.
          * 
-         * The list object will be copied within the function, and can be safely delete after.
+         * The content of the list is moved to the driver. The list object is left empty, and
+         * can be safely deleted or reused after.
+         *
+         * This does not wait for the commands to be executed. Wait on the returned fence
+         * if the results are needed.
          *
          * \param command_list     Command list to submit.
+         * \returns Fence signaled once all commands in the list are executed.
          */
-        virtual void submit_command_list(graphics_command_list &command_list) = 0;
+        virtual std::uint64_t submit_command_list(graphics_command_list &command_list) = 0;
     };
 
     using graphics_driver_ptr = std::unique_ptr<graphics_driver>;
 
+    static constexpr const char *opengl_graphics_backend_name = "opengl"; ///< OpenGL graphics backend name
+    static constexpr const char *software_graphics_backend_name = "software"; ///< CPU rasterizer graphics backend name
+
+    /**
+     * \brief       Translate string to graphics API.
+     *
+     * If the string does not match anything we have, OpenGL is used.
+     *
+     * \param       name        The string to translate.
+     * \returns     A graphics API correspond to the name.
+     */
+    graphic_api string_to_graphic_api(const std::string &name);
+
     bool init_graphics_library(graphic_api api);
 
     graphics_driver_ptr create_graphics_driver(const graphic_api api);
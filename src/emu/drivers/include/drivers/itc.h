@@ -47,6 +47,9 @@ namespace eka2l1::drivers {
       * A bitmap will be created in the server side when using this function. When you bind
       * a bitmap for rendering, a render target will be automatically created for it.
       *
+      * This does not wait for the driver. The returned handle can be used right away in
+      * command lists submitted after this call.
+      *
       * \param initial_size       The initial size of the bitmap.
       * \param bpp                Bits per pixel of the bitmap
       * 
@@ -351,6 +354,9 @@ namespace eka2l1::drivers {
 
         /**
          * \brief Present swapchain to screen.
+         *
+         * \param status Optional pointer to the status of the presentation, can be null.
+         *               Wait on the fence of the submission to know when the presenting is done.
          */
         virtual void present(int *status) = 0;
 
@@ -18,13 +18,27 @@
  */
 
 #include <common/log.h>
+#include <common/thread.h>
 #include <drivers/audio/backend/dsp_shared.h>
 
+#include <chrono>
+
 namespace eka2l1::drivers {
+    // Enough for about 170ms of 48kHz stereo, much more at the rates phones use
+    static constexpr std::size_t PCM_RING_SAMPLE_COUNT = 1 << 14;
+    static constexpr std::size_t NO_FLUSH_MARK = static_cast<std::size_t>(-1);
+
+    // How long the decoder sleeps when it has nothing to do or the ring is full
+    static constexpr std::chrono::milliseconds DECODE_IDLE_WAIT(4);
+
     dsp_output_stream_shared::dsp_output_stream_shared(drivers::audio_driver *aud)
         : dsp_output_stream()
         , aud_(aud)
         , pointer_(0)
+        , pcm_ring_(PCM_RING_SAMPLE_COUNT)
+        , flush_mark_(NO_FLUSH_MARK)
+        , decode_wake_(false)
+        , decode_thread_exit_(false)
         , virtual_stop(true) {
         last_frame_[0] = 0;
         last_frame_[1] = 0;
@@ -34,6 +48,87 @@ namespace eka2l1::drivers {
         if (stream_) {
             stream_->stop();
         }
+
+        stop_decode_thread();
+    }
+
+    void dsp_output_stream_shared::stop_decode_thread() {
+        if (!decode_thread_) {
+            return;
+        }
+
+        {
+            const std::lock_guard<std::mutex> guard(decode_wake_lock_);
+            decode_thread_exit_ = true;
+        }
+
+        decode_wake_cond_.notify_one();
+        decode_thread_->join();
+        decode_thread_.reset();
+    }
+
+    bool dsp_output_stream_shared::decode_step() {
+        const std::lock_guard<std::mutex> guard(decode_lock_);
+
+        if (pointer_ >= decoded_.size()) {
+            std::optional<dsp_buffer> encoded = buffers_.pop();
+
+            if (!encoded) {
+                return false;
+            }
+
+            pointer_ = 0;
+
+            if (format_ == PCM16_FOUR_CC_CODE) {
+                decoded_ = std::move(encoded.value());
+            } else {
+                decoded_.clear();
+                decode_data(encoded.value(), decoded_);
+            }
+
+            // Callback that internal buffer has been copied
+            samples_copied_ += decoded_.size() / sizeof(std::uint16_t);
+
+            const std::lock_guard<std::mutex> callback_guard(callback_lock_);
+            if (buffer_copied_callback_) {
+                buffer_copied_callback_(buffer_copied_userdata_);
+            }
+        }
+
+        // Only push whole frames, so the callback never gets a frame split in two
+        const std::size_t frame_size = channels_ * sizeof(std::int16_t);
+        const std::size_t frame_to_push = std::min<std::size_t>((decoded_.size() - pointer_) / frame_size,
+            pcm_ring_.space() / channels_);
+
+        pointer_ += pcm_ring_.write(reinterpret_cast<const std::int16_t *>(decoded_.data() + pointer_),
+                        frame_to_push * channels_)
+            * sizeof(std::int16_t);
+
+        if ((decoded_.size() - pointer_) < frame_size) {
+            // Drop the incomplete frame at the end, if any
+            pointer_ = decoded_.size();
+            return true;
+        }
+
+        // Ring is full, let the callback drain it
+        return false;
+    }
+
+    void dsp_output_stream_shared::decode_thread_loop() {
+        common::set_thread_name("DSP decode thread");
+
+        while (!decode_thread_exit_) {
+            if (decode_step()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> ulock(decode_wake_lock_);
+            decode_wake_cond_.wait_for(ulock, DECODE_IDLE_WAIT, [this]() {
+                return decode_wake_ || decode_thread_exit_;
+            });
+
+            decode_wake_ = false;
+        }
     }
 
     bool dsp_output_stream_shared::set_properties(const std::uint32_t freq, const std::uint8_t channels) {
@@ -42,6 +137,9 @@ namespace eka2l1::drivers {
             return false;
         }
 
+        // The decode thread reads these, and fills the ring with frames of the old layout
+        const std::lock_guard<std::mutex> guard(decode_lock_);
+
         if ((channels_ == channels) && (freq_ == freq)) {
             return true;
         }
@@ -51,6 +149,17 @@ namespace eka2l1::drivers {
             stream_.reset();
         }
 
+        if (channels_ != channels) {
+            // Samples left would be read as frames of the new layout, so drop them
+            decoded_.clear();
+            pointer_ = 0;
+
+            flush_mark_ = pcm_ring_.write_mark();
+
+            last_frame_[0] = 0;
+            last_frame_[1] = 0;
+        }
+
         channels_ = channels;
         freq_ = freq;
 
@@ -76,6 +185,13 @@ namespace eka2l1::drivers {
         if (!stream_)
             return true;
 
+        if (!decode_thread_) {
+            decode_thread_exit_ = false;
+            decode_thread_ = std::make_unique<std::thread>([this]() {
+                decode_thread_loop();
+            });
+        }
+
         if (virtual_stop) {
             if (!stream_->start()) {
                 return false;
@@ -91,6 +207,7 @@ namespace eka2l1::drivers {
         if (!stream_)
             return true;
 
+        const std::lock_guard<std::mutex> decode_guard(decode_lock_);
         const std::lock_guard<std::mutex> guard(callback_lock_);
 
         // Call the finish callback
@@ -103,6 +220,12 @@ namespace eka2l1::drivers {
         while (auto buffer = buffers_.pop()) {
         }
 
+        // And what was decoded but not played yet. The ring belongs to the callback on that end,
+        // so let it drop the samples itself.
+        decoded_.clear();
+        pointer_ = 0;
+
+        flush_mark_ = pcm_ring_.write_mark();
         return true;
     }
 
@@ -151,63 +274,37 @@ namespace eka2l1::drivers {
         std::memcpy(&buffer[0], data, data_size);
 
         // Push it to the queue
-        buffers_.push(buffer);
+        buffers_.push(std::move(buffer));
 
+        {
+            const std::lock_guard<std::mutex> guard(decode_wake_lock_);
+            decode_wake_ = true;
+        }
+
+        decode_wake_cond_.notify_one();
         return true;
     }
 
     std::size_t dsp_output_stream_shared::data_callback(std::int16_t *buffer, const std::size_t frame_count) {
-        std::size_t frame_wrote = 0;
-
-        while (frame_wrote < frame_count) {
-            std::optional<dsp_buffer> encoded;
-
-            if ((decoded_.size() == 0) || (decoded_.size() == pointer_)) {
-                // Get the next buffer
-                encoded = buffers_.pop();
-
-                if (!encoded) {
-                    break;
-                }
-                
-                pointer_ = 0;
-
-                if (format_ == PCM16_FOUR_CC_CODE) {
-                    decoded_ = encoded.value();
-                } else {
-                    decode_data(encoded.value(), decoded_);
-                }
-                
-                // Callback that internal buffer has been copied
-                {
-                    std::size_t total_sample = (decoded_.size() / sizeof(std::uint16_t));
-                    samples_copied_ += total_sample;
-                    
-                    const std::lock_guard<std::mutex> guard(callback_lock_);
-                    if (buffer_copied_callback_) {
-                        buffer_copied_callback_(buffer_copied_userdata_);
-                    }
-                }
-            }
+        // Runs on the host audio thread: no locks and no decoding here, only copy what the decoder prepared
+        const std::size_t flush_mark = flush_mark_.exchange(NO_FLUSH_MARK);
 
-            // We want to decode more
-            std::size_t frame_to_wrote = ((decoded_.size() - pointer_) / channels_ / sizeof(std::int16_t));
-            frame_to_wrote = std::min<std::size_t>(frame_to_wrote, frame_count - frame_wrote);
+        if (flush_mark != NO_FLUSH_MARK) {
+            pcm_ring_.discard_until(flush_mark);
+        }
 
-            std::memcpy(&buffer[frame_wrote * channels_], &decoded_[pointer_], frame_to_wrote * channels_ * sizeof(std::int16_t));
+        const std::size_t frame_available = std::min<std::size_t>(frame_count, pcm_ring_.size() / channels_);
+        const std::size_t frame_wrote = pcm_ring_.read(buffer, frame_available * channels_) / channels_;
 
+        if (frame_wrote > 0) {
             // Set last frame
-            std::memcpy(last_frame_, &decoded_[pointer_ + (frame_to_wrote - 1) * channels_ * sizeof(std::int16_t)], channels_ * sizeof(std::int16_t));
-
-            pointer_ += frame_to_wrote * channels_ * sizeof(std::int16_t);
-            samples_played_ += frame_to_wrote * channels_;
-
-            frame_wrote += frame_to_wrote;
+            std::memcpy(last_frame_, &buffer[(frame_wrote - 1) * channels_], channels_ * sizeof(std::int16_t));
+            samples_played_ += frame_wrote * channels_;
         }
 
-        for (; frame_wrote < frame_count; frame_wrote++) {
+        for (std::size_t i = frame_wrote; i < frame_count; i++) {
             // We dont want to drain the audio driver, so fill it with last frame
-            std::memcpy(&buffer[frame_wrote * channels_], last_frame_, channels_ * sizeof(std::int16_t));
+            std::memcpy(&buffer[i * channels_], last_frame_, channels_ * sizeof(std::int16_t));
         }
 
         return frame_count;
@@ -18,6 +18,7 @@
  */
 
 #include <drivers/audio/backend/ffmpeg/dsp_ffmpeg.h>
+#include <cstring>
 #include <map>
 
 #include <common/algorithm.h>
@@ -38,11 +39,24 @@ namespace eka2l1::drivers {
     dsp_output_stream_ffmpeg::dsp_output_stream_ffmpeg(drivers::audio_driver *aud)
         : dsp_output_stream_shared(aud)
         , codec_(nullptr)
-        , timestamp_in_base_(0) {
+        , frame_(av_frame_alloc())
+        , timestamp_in_base_(0)
+        , resampler_(nullptr)
+        , resampler_in_layout_(0)
+        , resampler_in_format_(AV_SAMPLE_FMT_NONE)
+        , resampler_in_rate_(0)
+        , resampler_out_rate_(0)
+        , resampler_out_channels_(0) {
         format(PCM16_FOUR_CC_CODE);
     }
 
     dsp_output_stream_ffmpeg::~dsp_output_stream_ffmpeg() {
+        // The decode thread calls into us, stop it before anything goes away
+        stop_decode_thread();
+
+        swr_free(&resampler_);
+        av_frame_free(&frame_);
+
         if (codec_) {
             avcodec_free_context(&codec_);
         }
@@ -69,61 +83,109 @@ namespace eka2l1::drivers {
             return false;
         }
 
-        codec_ = avcodec_alloc_context3(decoder);
+        AVCodecContext *new_codec = avcodec_alloc_context3(decoder);
 
-        if (!codec_) {
+        if (!new_codec) {
             LOG_ERROR("Can't alloc decode context!");
             return false;
         }
 
+        // The decode thread may be using the old context
+        const std::lock_guard<std::mutex> guard(decode_lock_);
+
+        if (codec_) {
+            avcodec_free_context(&codec_);
+        }
+
+        codec_ = new_codec;
+        timestamp_in_base_ = 0;
         format_ = fmt;
+
         return true;
     }
 
+    SwrContext *dsp_output_stream_ffmpeg::get_resampler(const AVFrame *frame) {
+        const std::uint64_t in_layout = frame->channel_layout ? frame->channel_layout
+                                                              : static_cast<std::uint64_t>(av_get_default_channel_layout(frame->channels));
+
+        if (resampler_ && (resampler_in_layout_ == in_layout) && (resampler_in_format_ == frame->format)
+            && (resampler_in_rate_ == frame->sample_rate) && (resampler_out_rate_ == freq_) && (resampler_out_channels_ == channels_)) {
+            return resampler_;
+        }
+
+        swr_free(&resampler_);
+
+        resampler_ = swr_alloc_set_opts(nullptr,
+            av_get_default_channel_layout(channels_), AV_SAMPLE_FMT_S16, freq_,
+            in_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate,
+            0, nullptr);
+
+        if (!resampler_ || (swr_init(resampler_) < 0)) {
+            LOG_ERROR("Error initializing SWR context");
+            swr_free(&resampler_);
+
+            return nullptr;
+        }
+
+        resampler_in_layout_ = in_layout;
+        resampler_in_format_ = frame->format;
+        resampler_in_rate_ = frame->sample_rate;
+        resampler_out_rate_ = freq_;
+        resampler_out_channels_ = channels_;
+
+        return resampler_;
+    }
+
     void dsp_output_stream_ffmpeg::decode_data(dsp_buffer &original, std::vector<std::uint8_t> &dest) {
         AVPacket packet;
         av_init_packet(&packet);
 
-        packet.size = original.size();
+        packet.size = static_cast<int>(original.size());
         packet.data = original.data();
 
-        if (avcodec_send_packet(codec_, &packet) >= 0) {
-            AVFrame *frame = av_frame_alloc();
-
-            if (avcodec_receive_frame(codec_, frame) < 0) {
-                av_frame_free(&frame);
-                return;
-            }
+        if (avcodec_send_packet(codec_, &packet) < 0) {
+            return;
+        }
 
-            dest.resize(2 * frame->nb_samples * sizeof(std::uint16_t));
-            timestamp_in_base_ = frame->best_effort_timestamp;
+        const std::size_t frame_size = channels_ * sizeof(std::int16_t);
 
-            if ((channels_ != codec_->channels) || (frame->format != AV_SAMPLE_FMT_S16)) {
-                SwrContext *swr = swr_alloc_set_opts(nullptr,
-                    AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, freq_,
-                    frame->channel_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate,
-                    0, nullptr);
+        // A packet may carry more than one frame
+        while (avcodec_receive_frame(codec_, frame_) >= 0) {
+            timestamp_in_base_ = frame_->best_effort_timestamp;
+            const std::size_t offset = dest.size();
 
-                if (swr_init(swr) < 0) {
-                    LOG_ERROR("Error initializing SWR context");
-                    av_frame_free(&frame);
+            if ((frame_->channels != static_cast<int>(channels_)) || (frame_->format != AV_SAMPLE_FMT_S16)
+                || (frame_->sample_rate != static_cast<int>(freq_))) {
+                SwrContext *swr = get_resampler(frame_);
 
+                if (!swr) {
+                    av_frame_unref(frame_);
                     return;
                 }
 
-                std::uint8_t *output = &dest[0];
-                const std::uint8_t *source = frame->data[0];
+                const int max_output_samples = swr_get_out_samples(swr, frame_->nb_samples);
+                dest.resize(offset + max_output_samples * frame_size);
 
-                const int result = swr_convert(swr, &output, frame->nb_samples, &source, frame->nb_samples);
-                swr_free(&swr);
+                std::uint8_t *output = &dest[offset];
+                const int result = swr_convert(swr, &output, max_output_samples,
+                    const_cast<const std::uint8_t **>(frame_->extended_data), frame_->nb_samples);
 
                 if (result < 0) {
                     LOG_ERROR("Error resample audio data!");
+
+                    dest.resize(offset);
+                    av_frame_unref(frame_);
+
                     return;
                 }
+
+                dest.resize(offset + result * frame_size);
             } else {
-                std::memcpy(&dest[0], frame->data[0], dest.size());
+                dest.resize(offset + frame_->nb_samples * frame_size);
+                std::memcpy(&dest[offset], frame_->data[0], frame_->nb_samples * frame_size);
             }
+
+            av_frame_unref(frame_);
         }
     }
-}
\ No newline at end of file
+}
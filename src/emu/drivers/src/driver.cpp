@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project 
+ * (see bentokun.github.com/EKA2L1).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/driver.h>
+
+#include <algorithm>
+
+namespace eka2l1::drivers {
+    bool command_helper::push_string(command_list &list, const std::u16string &data) {
+        const std::uint16_t length = static_cast<std::uint16_t>(data.length());
+
+        if (!push(length)) {
+            return false;
+        }
+
+        char16_t *dat = reinterpret_cast<char16_t *>(list.copy_payload(data.data(), length * sizeof(char16_t)));
+        return push(dat);
+    }
+
+    command_list::command_list(command_list &&rhs) noexcept
+        : commands_(std::move(rhs.commands_))
+        , payload_blocks_(std::move(rhs.payload_blocks_))
+        , large_payloads_(std::move(rhs.large_payloads_))
+        , payload_block_index_(rhs.payload_block_index_)
+        , payload_cursor_(rhs.payload_cursor_) {
+        rhs.commands_.clear();
+        rhs.payload_blocks_.clear();
+        rhs.large_payloads_.clear();
+        rhs.payload_block_index_ = 0;
+        rhs.payload_cursor_ = 0;
+    }
+
+    command_list &command_list::operator=(command_list &&rhs) noexcept {
+        commands_ = std::move(rhs.commands_);
+        payload_blocks_ = std::move(rhs.payload_blocks_);
+        large_payloads_ = std::move(rhs.large_payloads_);
+        payload_block_index_ = rhs.payload_block_index_;
+        payload_cursor_ = rhs.payload_cursor_;
+
+        rhs.commands_.clear();
+        rhs.payload_blocks_.clear();
+        rhs.large_payloads_.clear();
+        rhs.payload_block_index_ = 0;
+        rhs.payload_cursor_ = 0;
+
+        return *this;
+    }
+
+    std::uint8_t *command_list::allocate_payload(const std::size_t size) {
+        const std::size_t aligned_size = (size + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+
+        if (aligned_size > PAYLOAD_BLOCK_SIZE) {
+            // Too big for the arena, give it its own block. These are not kept after clear.
+            large_payloads_.push_back(std::make_unique<std::uint8_t[]>(aligned_size));
+            return large_payloads_.back().get();
+        }
+
+        if ((payload_block_index_ < payload_blocks_.size()) && (payload_cursor_ + aligned_size > PAYLOAD_BLOCK_SIZE)) {
+            // Move to the next block
+            payload_block_index_++;
+            payload_cursor_ = 0;
+        }
+
+        if (payload_block_index_ >= payload_blocks_.size()) {
+            payload_blocks_.push_back(std::make_unique<std::uint8_t[]>(PAYLOAD_BLOCK_SIZE));
+            payload_block_index_ = payload_blocks_.size() - 1;
+            payload_cursor_ = 0;
+        }
+
+        std::uint8_t *result = payload_blocks_[payload_block_index_].get() + payload_cursor_;
+        payload_cursor_ += aligned_size;
+
+        return result;
+    }
+
+    void *command_list::copy_payload(const void *data, const std::size_t size) {
+        std::uint8_t *dest = allocate_payload(size);
+        std::copy(reinterpret_cast<const std::uint8_t *>(data), reinterpret_cast<const std::uint8_t *>(data) + size, dest);
+
+        return dest;
+    }
+
+    void command_list::clear() {
+        commands_.clear();
+        large_payloads_.clear();
+
+        payload_block_index_ = 0;
+        payload_cursor_ = 0;
+    }
+
+    command_list command_list_pool::acquire() {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        if (free_.empty()) {
+            return command_list();
+        }
+
+        command_list list = std::move(free_.back());
+        free_.pop_back();
+
+        return list;
+    }
+
+    void command_list_pool::release(command_list &&list) {
+        list.clear();
+
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        if (free_.size() >= max_free_) {
+            // Let it die
+            return;
+        }
+
+        free_.push_back(std::move(list));
+    }
+}
@@ -168,8 +168,6 @@ namespace eka2l1::drivers {
     shared_graphics_driver::~shared_graphics_driver() {
     }
 
-#define HANDLE_BITMAP (1ULL << 32)
-
     bitmap *shared_graphics_driver::get_bitmap(const drivers::handle h) {
         if ((h & HANDLE_BITMAP) == 0) {
             return nullptr;
@@ -288,34 +286,30 @@ namespace eka2l1::drivers {
         helper.pop(pixels_per_line);
 
         update_bitmap(handle, size, offset, dim, data, pixels_per_line);
-
-        delete data;
     }
 
     void shared_graphics_driver::create_bitmap(command_helper &helper) {
         eka2l1::vec2 size;
         std::uint32_t bpp = 0;
-        drivers::handle *result = nullptr;
+        drivers::handle h = 0;
 
         helper.pop(size);
         helper.pop(bpp);
-        helper.pop(result);
+        helper.pop(h);
 
-        // Find free slot
-        auto slot_free = std::find(bmp_textures.begin(), bmp_textures.end(), nullptr);
+        // The handle is reserved by the client already
+        const std::size_t index = static_cast<std::size_t>(h & ~HANDLE_BITMAP);
 
-        if (slot_free != bmp_textures.end()) {
-            *slot_free = std::make_unique<bitmap>(this, size, static_cast<int>(bpp));
-            *result = std::distance(bmp_textures.begin(), slot_free) + 1;
-        } else {
-            bmp_textures.push_back(std::make_unique<bitmap>(this, size, static_cast<int>(bpp)));
-            *result = bmp_textures.size();
+        if (!(h & HANDLE_BITMAP) || (index == 0)) {
+            LOG_ERROR("Invalid bitmap handle to create");
+            return;
         }
 
-        *result |= HANDLE_BITMAP;
+        if (bmp_textures.size() < index) {
+            bmp_textures.resize(index);
+        }
 
-        // Notify
-        helper.finish(this, 0);
+        bmp_textures[index - 1] = std::make_unique<bitmap>(this, size, static_cast<int>(bpp));
     }
 
     void shared_graphics_driver::bind_bitmap(command_helper &helper) {
@@ -361,12 +355,15 @@ namespace eka2l1::drivers {
         drivers::handle h = 0;
         helper.pop(h);
 
-        if ((h & ~HANDLE_BITMAP) > bmp_textures.size()) {
+        const std::size_t index = static_cast<std::size_t>(h & ~HANDLE_BITMAP);
+
+        if (!(h & HANDLE_BITMAP) || (index == 0) || (index > bmp_textures.size())) {
             LOG_ERROR("Invalid bitmap handle to destroy");
             return;
         }
 
-        bmp_textures[(h & ~HANDLE_BITMAP) - 1].reset();
+        bmp_textures[index - 1].reset();
+        release_bitmap_handle(h);
     }
 
     void shared_graphics_driver::resize_bitmap(command_helper &helper) {
@@ -539,8 +536,6 @@ namespace eka2l1::drivers {
         }
 
         shobj->set(this, binding, var_type, data);
-
-        delete data;
     }
 
     void shared_graphics_driver::set_swizzle(command_helper &helper) {
@@ -633,8 +628,6 @@ namespace eka2l1::drivers {
         }
 
         bufobj->update_data(this, data, offset, size);
-
-        delete data;
     }
 
     void shared_graphics_driver::attach_descriptors(drivers::handle h, const int stride, const bool instance_move,
@@ -662,8 +655,6 @@ namespace eka2l1::drivers {
         helper.pop(descriptor_count);
 
         attach_descriptors(h, stride, instance_move, descriptors, descriptor_count);
-
-        delete descriptors;
     }
 
     void shared_graphics_driver::destroy_object(command_helper &helper) {
@@ -32,6 +32,7 @@
 namespace eka2l1::drivers {
     ogl_graphics_driver::ogl_graphics_driver()
         : shared_graphics_driver(graphic_api::opengl)
+        , batch_texture(0)
         , should_stop(false)
         , is_gles(false) {
         init_graphics_library(eka2l1::drivers::graphic_api::opengl);
@@ -74,15 +75,16 @@ namespace eka2l1::drivers {
     }
 
     static constexpr const char *sprite_norm_v_path = "resources//sprite_norm.vert";
-    static constexpr const char *sprite_norm_f_path = "resources//sprite_norm.frag";
     static constexpr const char *sprite_mask_f_path = "resources//sprite_mask.frag";
-    static constexpr const char *fill_v_path = "resources//fill.vert";
-    static constexpr const char *fill_f_path = "resources//fill.frag";
+    static constexpr const char *sprite_batch_v_path = "resources//sprite_batch.vert";
+    static constexpr const char *sprite_batch_f_path = "resources//sprite_batch.frag";
+
+    // Number of sprites that fit in the streaming instance buffer
+    static constexpr std::size_t MAX_BATCH_SPRITES = 1024;
 
     void ogl_graphics_driver::do_init() {
-        sprite_program = std::make_unique<ogl_shader>(sprite_norm_v_path, sprite_norm_f_path);
         mask_program = std::make_unique<ogl_shader>(sprite_norm_v_path, sprite_mask_f_path);
-        fill_program = std::make_unique<ogl_shader>(fill_v_path, fill_f_path);
+        batch_program = std::make_unique<ogl_shader>(sprite_batch_v_path, sprite_batch_f_path);
 
         static GLushort indices[] = {
             0, 1, 2,
@@ -100,28 +102,60 @@ namespace eka2l1::drivers {
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)(2 * sizeof(GLfloat)));
         glBindVertexArray(0);
 
-        // Make fill VAO and VBO
-        glGenVertexArrays(1, &fill_vao);
-        glGenBuffers(1, &fill_vbo);
-        glBindVertexArray(fill_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, fill_vbo);
+        glGenBuffers(1, &sprite_ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        // Make batch VAO. The unit quad is shared, everything else comes per instance
+        static GLfloat quad_corners[] = {
+            0.0f, 1.0f,
+            1.0f, 0.0f,
+            0.0f, 0.0f,
+            1.0f, 1.0f
+        };
+
+        glGenVertexArrays(1, &batch_vao);
+        glGenBuffers(1, &batch_quad_vbo);
+        glGenBuffers(1, &batch_instance_vbo);
+        glBindVertexArray(batch_vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, batch_quad_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad_corners), quad_corners, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid *)0);
-        glBindVertexArray(0);
 
-        glGenBuffers(1, &sprite_ibo);
+        glBindBuffer(GL_ARRAY_BUFFER, batch_instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_SPRITES * sizeof(ogl_sprite_instance), nullptr, GL_STREAM_DRAW);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ogl_sprite_instance), (GLvoid *)offsetof(ogl_sprite_instance, dest));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ogl_sprite_instance), (GLvoid *)offsetof(ogl_sprite_instance, source));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ogl_sprite_instance), (GLvoid *)offsetof(ogl_sprite_instance, color));
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(ogl_sprite_instance), (GLvoid *)offsetof(ogl_sprite_instance, flip));
+        glVertexAttribDivisor(4, 1);
+
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glBindVertexArray(0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        color_loc = sprite_program->get_uniform_location("u_color").value_or(-1);
-        proj_loc = sprite_program->get_uniform_location("u_proj").value_or(-1);
-        model_loc = sprite_program->get_uniform_location("u_model").value_or(-1);
-        flip_loc = sprite_program->get_uniform_location("u_flip").value_or(-1);
+        // Rectangle fills sample this, so they can be batched with bitmaps
+        static const GLubyte white_pixel[] = { 255, 255, 255, 255 };
+
+        glGenTextures(1, &batch_white_texture);
+        glBindTexture(GL_TEXTURE_2D, batch_white_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white_pixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
-        color_loc_fill = fill_program->get_uniform_location("u_color").value_or(-1);
-        proj_loc_fill = fill_program->get_uniform_location("u_proj").value_or(-1);
-        model_loc_fill = fill_program->get_uniform_location("u_model").value_or(-1);
+        batch_sprites.reserve(MAX_BATCH_SPRITES);
 
         color_loc_mask = mask_program->get_uniform_location("u_color").value_or(-1);
         proj_loc_mask = mask_program->get_uniform_location("u_proj").value_or(-1);
@@ -130,6 +164,51 @@ namespace eka2l1::drivers {
         source_loc_mask = mask_program->get_uniform_location("u_tex").value_or(-1);
         mask_loc_mask = mask_program->get_uniform_location("u_mask").value_or(-1);
         flip_loc_mask = mask_program->get_uniform_location("u_flip").value_or(-1);
+
+        proj_loc_batch = batch_program->get_uniform_location("u_proj").value_or(-1);
+        source_loc_batch = batch_program->get_uniform_location("u_tex").value_or(-1);
+    }
+
+    void ogl_graphics_driver::queue_sprite(const GLuint texture, const ogl_sprite_instance &sprite) {
+        if ((texture != batch_texture) || (batch_sprites.size() >= MAX_BATCH_SPRITES)) {
+            flush_sprite_batch();
+        }
+
+        batch_texture = texture;
+        batch_sprites.push_back(sprite);
+    }
+
+    void ogl_graphics_driver::flush_sprite_batch() {
+        if (batch_sprites.empty()) {
+            return;
+        }
+
+        batch_program->use(this);
+
+        glUniformMatrix4fv(proj_loc_batch, 1, false, glm::value_ptr(projection_matrix));
+        glUniform1i(source_loc_batch, 0);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, batch_texture);
+
+        if (batch_texture != batch_white_texture) {
+            // For unknown reason my intel driver go out for an all out attack and garbage the filter...
+            // so i have to set it here...
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        glBindVertexArray(batch_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, batch_instance_vbo);
+
+        // Orphan the old storage, so we don't have to wait for draws still reading from it
+        glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_SPRITES * sizeof(ogl_sprite_instance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, batch_sprites.size() * sizeof(ogl_sprite_instance), batch_sprites.data());
+
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0, static_cast<GLsizei>(batch_sprites.size()));
+        glBindVertexArray(0);
+
+        batch_sprites.clear();
     }
 
     void ogl_graphics_driver::bind_swapchain_framebuf() {
@@ -137,52 +216,34 @@ namespace eka2l1::drivers {
     }
 
     void ogl_graphics_driver::draw_rectangle(command_helper &helper) {
-        if (!fill_program) {
+        if (!batch_program) {
             do_init();
         }
 
         eka2l1::rect fill_rect;
         helper.pop(fill_rect);
 
-        fill_program->use(this);
-
-        // Build model matrix
-        glm::mat4 model_matrix = glm::identity<glm::mat4>();
-        model_matrix = glm::translate(model_matrix, { fill_rect.top.x, fill_rect.top.y, 0.0f });
-        model_matrix = glm::scale(model_matrix, { fill_rect.size.x, fill_rect.size.y, 0.0f });
-
-        glUniformMatrix4fv(model_loc_fill, 1, false, glm::value_ptr(model_matrix));
-        glUniformMatrix4fv(proj_loc_fill, 1, false, glm::value_ptr(projection_matrix));
+        ogl_sprite_instance sprite;
+        sprite.dest[0] = static_cast<float>(fill_rect.top.x);
+        sprite.dest[1] = static_cast<float>(fill_rect.top.y);
+        sprite.dest[2] = static_cast<float>(fill_rect.size.x);
+        sprite.dest[3] = static_cast<float>(fill_rect.size.y);
 
-        // Supply brush
-        glUniform4fv(color_loc_fill, 1, brush_color.elements.data());
-
-        static GLfloat fill_verts_default[] = {
-            0.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-        };
+        sprite.source[0] = 0.0f;
+        sprite.source[1] = 0.0f;
+        sprite.source[2] = 1.0f;
+        sprite.source[3] = 1.0f;
 
-        glBindVertexArray(fill_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, fill_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(fill_verts_default), nullptr, GL_STATIC_DRAW);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(fill_verts_default), fill_verts_default, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid *)0);
+        std::copy(brush_color.elements.begin(), brush_color.elements.end(), sprite.color);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ibo);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+        // Fills are always flipped
+        sprite.flip = -1.0f;
 
-        glBindVertexArray(0);
+        queue_sprite(batch_white_texture, sprite);
     }
 
     void ogl_graphics_driver::draw_bitmap(command_helper &helper) {
-        if (!sprite_program) {
+        if (!mask_program) {
             do_init();
         }
 
@@ -214,98 +275,90 @@ namespace eka2l1::drivers {
         eka2l1::rect dest_rect;
         helper.pop(dest_rect);
 
-        if (mask_bmp) {
-            mask_program->use(this);
-        } else {
-            sprite_program->use(this);
-        }
-
-        // Build texcoords
         eka2l1::rect source_rect;
         helper.pop(source_rect);
 
-        struct sprite_vertex {
-            float top[2];
-            float coord[2];
-        } verts[4];
-
-        static GLfloat verts_default[] = {
-            0.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-            1.0f,
-            1.0f,
-        };
+        std::uint32_t flags = 0;
+        helper.pop(flags);
 
-        void *vert_pointer = verts_default;
+        // Build texcoords
+        const float texel_width = 1.0f / bmp->tex->get_size().x;
+        const float texel_height = 1.0f / bmp->tex->get_size().y;
 
-        if (!source_rect.empty()) {
-            const float texel_width = 1.0f / bmp->tex->get_size().x;
-            const float texel_height = 1.0f / bmp->tex->get_size().y;
+        ogl_sprite_instance sprite;
 
-            // Bottom left
-            verts[0].top[0] = 0.0f;
-            verts[0].top[1] = 1.0f;
+        if (!source_rect.empty()) {
+            sprite.source[0] = source_rect.top.x * texel_width;
+            sprite.source[1] = source_rect.top.y * texel_height;
+            sprite.source[2] = source_rect.size.x * texel_width;
+            sprite.source[3] = source_rect.size.y * texel_height;
+        } else {
+            sprite.source[0] = 0.0f;
+            sprite.source[1] = 0.0f;
+            sprite.source[2] = 1.0f;
+            sprite.source[3] = 1.0f;
+        }
 
-            verts[0].coord[0] = source_rect.top.x * texel_width;
-            verts[0].coord[1] = (source_rect.top.y + source_rect.size.y) * texel_height;
+        if (source_rect.size.x == 0) {
+            source_rect.size.x = bmp->tex->get_size().x;
+        }
 
-            // Top right
-            verts[1].top[0] = 1.0f;
-            verts[1].top[1] = 0.0f;
+        if (source_rect.size.y == 0) {
+            source_rect.size.y = bmp->tex->get_size().y;
+        }
 
-            verts[1].coord[0] = (source_rect.top.x + source_rect.size.x) * texel_width;
-            verts[1].coord[1] = source_rect.top.y * texel_height;
+        if (dest_rect.size.x == 0) {
+            dest_rect.size.x = source_rect.size.x;
+        }
 
-            // Top left
-            verts[2].top[0] = 0.0f;
-            verts[2].top[1] = 0.0f;
+        if (dest_rect.size.y == 0) {
+            dest_rect.size.y = source_rect.size.y;
+        }
 
-            verts[2].coord[0] = source_rect.top.x * texel_width;
-            verts[2].coord[1] = source_rect.top.y * texel_height;
+        sprite.dest[0] = static_cast<float>(dest_rect.top.x);
+        sprite.dest[1] = static_cast<float>(dest_rect.top.y);
+        sprite.dest[2] = static_cast<float>(dest_rect.size.x);
+        sprite.dest[3] = static_cast<float>(dest_rect.size.y);
 
-            // Bottom right
-            verts[3].top[0] = 1.0f;
-            verts[3].top[1] = 1.0f;
+        // Supply brush
+        if (flags & bitmap_draw_flag_use_brush) {
+            std::copy(brush_color.elements.begin(), brush_color.elements.end(), sprite.color);
+        } else {
+            std::fill(sprite.color, sprite.color + 4, 255.0f);
+        }
 
-            verts[3].coord[0] = (source_rect.top.x + source_rect.size.x) * texel_width;
-            verts[3].coord[1] = (source_rect.top.y + source_rect.size.y) * texel_height;
+        sprite.flip = (flags & bitmap_draw_flag_no_flip) ? 1.0f : -1.0f;
 
-            vert_pointer = verts;
+        if (!mask_bmp) {
+            queue_sprite(static_cast<GLuint>(bmp->tex->texture_handle()), sprite);
+            return;
         }
 
+        // Masked draws need a second texture, draw them on their own
+        flush_sprite_batch();
+
+        mask_program->use(this);
+
+        // The unit quad, with texcoords mapped to the source rectangle
+        const GLfloat verts[] = {
+            0.0f, 1.0f, sprite.source[0], sprite.source[1] + sprite.source[3],
+            1.0f, 0.0f, sprite.source[0] + sprite.source[2], sprite.source[1],
+            0.0f, 0.0f, sprite.source[0], sprite.source[1],
+            1.0f, 1.0f, sprite.source[0] + sprite.source[2], sprite.source[1] + sprite.source[3]
+        };
+
         glBindVertexArray(sprite_vao);
         glBindBuffer(GL_ARRAY_BUFFER, sprite_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), nullptr, GL_STATIC_DRAW);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), vert_pointer, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)(2 * sizeof(GLfloat)));
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
 
-        if (mask_bmp) {
-            glUniform1i(source_loc_mask, 0);
-            glUniform1i(mask_loc_mask, 1);
-        }
+        glUniform1i(source_loc_mask, 0);
+        glUniform1i(mask_loc_mask, 1);
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(bmp->tex->texture_handle()));
 
-        if (mask_bmp) {
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(mask_bmp->tex->texture_handle()));
-        }
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(mask_bmp->tex->texture_handle()));
 
         // For unknown reason my intel driver go out for an all out attack and garbage the filter...
         // so i have to set it here...
@@ -315,50 +368,19 @@ namespace eka2l1::drivers {
         // Build model matrix
         glm::mat4 model_matrix = glm::identity<glm::mat4>();
         model_matrix = glm::translate(model_matrix, { dest_rect.top.x, dest_rect.top.y, 0.0f });
-
-        if (source_rect.size.x == 0) {
-            source_rect.size.x = bmp->tex->get_size().x;
-        }
-
-        if (source_rect.size.y == 0) {
-            source_rect.size.y = bmp->tex->get_size().y;
-        }
-
-        if (dest_rect.size.x == 0) {
-            dest_rect.size.x = source_rect.size.x;
-        }
-
-        if (dest_rect.size.y == 0) {
-            dest_rect.size.y = source_rect.size.y;
-        }
-
         model_matrix = glm::scale(model_matrix, glm::vec3(dest_rect.size.x, dest_rect.size.y, 0.0f));
 
-        glUniformMatrix4fv((mask_bmp ? model_loc_mask : model_loc), 1, false, glm::value_ptr(model_matrix));
-        glUniformMatrix4fv((mask_bmp ? proj_loc_mask : proj_loc), 1, false, glm::value_ptr(projection_matrix));
-
-        // Supply brush
-        std::uint32_t flags = 0;
-        helper.pop(flags);
-
-        const GLfloat color[] = { 255.0f, 255.0f, 255.0f, 255.0f };
-
-        if (flags & bitmap_draw_flag_use_brush) {
-            glUniform4fv((mask_bmp ? color_loc_mask : color_loc), 1, brush_color.elements.data());
-        } else {
-            glUniform4fv((mask_bmp ? color_loc_mask : color_loc), 1, color);
-        }
-
-        glUniform1f((mask_bmp ? flip_loc_mask : flip_loc), (flags & bitmap_draw_flag_no_flip) ? 1.0f : -1.0f);
-
-        if (mask_bmp) {
-            glUniform1f(invert_loc_mask, (flags & bitmap_draw_flag_invert_mask) ? 1.0f : 0.0f);
-        }
+        glUniformMatrix4fv(model_loc_mask, 1, false, glm::value_ptr(model_matrix));
+        glUniformMatrix4fv(proj_loc_mask, 1, false, glm::value_ptr(projection_matrix));
+        glUniform4fv(color_loc_mask, 1, sprite.color);
+        glUniform1f(flip_loc_mask, sprite.flip);
+        glUniform1f(invert_loc_mask, (flags & bitmap_draw_flag_invert_mask) ? 1.0f : 0.0f);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ibo);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
 
         glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
     }
 
     void ogl_graphics_driver::set_clipping(command_helper &helper) {
@@ -750,15 +772,23 @@ namespace eka2l1::drivers {
     }
 
     std::unique_ptr<graphics_command_list> ogl_graphics_driver::new_command_list() {
-        return std::make_unique<server_graphics_command_list>();
+        std::unique_ptr<server_graphics_command_list> list = std::make_unique<server_graphics_command_list>();
+        list->list_ = list_pool.acquire();
+
+        return list;
     }
 
     std::unique_ptr<graphics_command_list_builder> ogl_graphics_driver::new_command_builder(graphics_command_list *list) {
         return std::make_unique<server_graphics_command_list_builder>(list);
     }
 
-    void ogl_graphics_driver::submit_command_list(graphics_command_list &command_list) {
-        list_queue.push(static_cast<server_graphics_command_list &>(command_list));
+    std::uint64_t ogl_graphics_driver::submit_command_list(graphics_command_list &command_list) {
+        // Fences must be handed out in the same order lists are queued
+        const std::lock_guard<std::mutex> guard(submit_lock_);
+        const std::uint64_t fence = next_fence();
+
+        list_queue.push(std::move(static_cast<server_graphics_command_list &>(command_list)));
+        return fence;
     }
 
     void ogl_graphics_driver::display(command_helper &helper) {
@@ -769,6 +799,18 @@ namespace eka2l1::drivers {
     void ogl_graphics_driver::dispatch(command *cmd) {
         command_helper helper(cmd);
 
+        // Sprite draws can be merged, anything else may observe or change the state they depend on
+        switch (cmd->opcode_) {
+        case graphics_driver_draw_bitmap:
+        case graphics_driver_draw_rectangle:
+        case graphics_driver_set_brush_color:
+            break;
+
+        default:
+            flush_sprite_batch();
+            break;
+        }
+
         switch (cmd->opcode_) {
         case graphics_driver_draw_bitmap: {
             draw_bitmap(helper);
@@ -871,23 +913,24 @@ namespace eka2l1::drivers {
                 break;
             }
 
-            command *cmd = list->list_.first_;
-            command *next = nullptr;
+            for (command &cmd : list->list_) {
+                dispatch(&cmd);
+            }
 
-            while (cmd) {
-                dispatch(cmd);
-                next = cmd->next_;
+            flush_sprite_batch();
 
-                // TODO: If any command list requires not rebuilding the buffer, dont delete the command.
-                // For now, not likely
-                delete cmd;
-                cmd = next;
-            }
+            // Give the storage back, so the next list built does not allocate
+            list_pool.release(std::move(list->list_));
+            signal_next_fence();
         }
+
+        // Nothing will be executed anymore, do not let anyone wait on it
+        signal_all_fences();
     }
 
     void ogl_graphics_driver::abort() {
         list_queue.abort();
         should_stop = true;
+        signal_all_fences();
     }
 }
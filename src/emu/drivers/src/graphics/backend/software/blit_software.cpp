@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/platform.h>
+#include <drivers/graphics/backend/software/blit_software.h>
+
+#include <algorithm>
+
+#if EKA2L1_ARCH(X64) || defined(__SSE2__)
+#define EKA2L1_SOFTWARE_BLIT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace eka2l1::drivers::software {
+    static inline std::uint32_t div_255(const std::uint32_t value) {
+        // Exact rounded division for value in range of 0 to 255 * 255
+        const std::uint32_t temp = value + 128;
+        return (temp + (temp >> 8)) >> 8;
+    }
+
+    static inline std::uint32_t multiply_pixel(const std::uint32_t lhs, const std::uint32_t rhs) {
+        std::uint32_t result = 0;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            result |= div_255(((lhs >> shift) & 0xFF) * ((rhs >> shift) & 0xFF)) << shift;
+        }
+
+        return result;
+    }
+
+    static inline std::uint32_t blend_factor_value(const blend_factor factor, const std::uint32_t source_alpha,
+        const std::uint32_t dest_alpha) {
+        switch (factor) {
+        case blend_factor::one:
+            return 255;
+
+        case blend_factor::frag_out_alpha:
+            return source_alpha;
+
+        case blend_factor::one_minus_frag_out_alpha:
+            return 255 - source_alpha;
+
+        case blend_factor::current_alpha:
+            return dest_alpha;
+
+        case blend_factor::one_minus_current_alpha:
+            return 255 - dest_alpha;
+
+        default:
+            break;
+        }
+
+        return 0;
+    }
+
+    static inline std::uint32_t blend_channel(const blend_equation equation, const std::uint32_t source, const std::uint32_t dest,
+        const std::uint32_t source_factor, const std::uint32_t dest_factor) {
+        const int source_term = static_cast<int>(div_255(source * source_factor));
+        const int dest_term = static_cast<int>(div_255(dest * dest_factor));
+
+        switch (equation) {
+        case blend_equation::sub:
+            return static_cast<std::uint32_t>(std::max(source_term - dest_term, 0));
+
+        case blend_equation::isub:
+            return static_cast<std::uint32_t>(std::max(dest_term - source_term, 0));
+
+        default:
+            break;
+        }
+
+        return static_cast<std::uint32_t>(std::min(source_term + dest_term, 255));
+    }
+
+    static inline std::uint32_t blend_pixel(const std::uint32_t dest, const std::uint32_t source, const blend_state &state) {
+        const std::uint32_t source_alpha = source >> 24;
+        const std::uint32_t dest_alpha = dest >> 24;
+
+        const std::uint32_t rgb_source_factor = blend_factor_value(state.rgb_frag_out_factor, source_alpha, dest_alpha);
+        const std::uint32_t rgb_dest_factor = blend_factor_value(state.rgb_current_factor, source_alpha, dest_alpha);
+
+        std::uint32_t result = 0;
+
+        for (int shift = 0; shift < 24; shift += 8) {
+            result |= blend_channel(state.rgb_equation, (source >> shift) & 0xFF, (dest >> shift) & 0xFF,
+                          rgb_source_factor, rgb_dest_factor)
+                << shift;
+        }
+
+        result |= blend_channel(state.a_equation, source_alpha, dest_alpha,
+                      blend_factor_value(state.a_frag_out_factor, source_alpha, dest_alpha),
+                      blend_factor_value(state.a_current_factor, source_alpha, dest_alpha))
+            << 24;
+
+        return result;
+    }
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+    static inline __m128i div_255_epi16(__m128i value) {
+        value = _mm_add_epi16(value, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+
+    static inline __m128i multiply_epu8(const __m128i lhs, const __m128i rhs) {
+        const __m128i zero = _mm_setzero_si128();
+
+        const __m128i lo = div_255_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(lhs, zero), _mm_unpacklo_epi8(rhs, zero)));
+        const __m128i hi = div_255_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(lhs, zero), _mm_unpackhi_epi8(rhs, zero)));
+
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    /**
+     * \brief Blend factors of two unpacked pixels, as masks selecting which alpha is added or subtracted.
+     *
+     * A factor is computed as: base + source alpha * (plus_sa - minus_sa) + dest alpha * (plus_da - minus_da).
+     */
+    struct factor_lanes {
+        __m128i base;
+        __m128i plus_sa;
+        __m128i minus_sa;
+        __m128i plus_da;
+        __m128i minus_da;
+    };
+
+    static factor_lanes make_factor_lanes(const blend_factor rgb_factor, const blend_factor a_factor) {
+        std::uint16_t base[8] = {};
+        std::uint16_t plus_sa[8] = {};
+        std::uint16_t minus_sa[8] = {};
+        std::uint16_t plus_da[8] = {};
+        std::uint16_t minus_da[8] = {};
+
+        for (int i = 0; i < 8; i++) {
+            switch (((i & 3) == 3) ? a_factor : rgb_factor) {
+            case blend_factor::one:
+                base[i] = 255;
+                break;
+
+            case blend_factor::frag_out_alpha:
+                plus_sa[i] = 0xFFFF;
+                break;
+
+            case blend_factor::one_minus_frag_out_alpha:
+                base[i] = 255;
+                minus_sa[i] = 0xFFFF;
+                break;
+
+            case blend_factor::current_alpha:
+                plus_da[i] = 0xFFFF;
+                break;
+
+            case blend_factor::one_minus_current_alpha:
+                base[i] = 255;
+                minus_da[i] = 0xFFFF;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        factor_lanes lanes;
+        lanes.base = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base));
+        lanes.plus_sa = _mm_loadu_si128(reinterpret_cast<const __m128i *>(plus_sa));
+        lanes.minus_sa = _mm_loadu_si128(reinterpret_cast<const __m128i *>(minus_sa));
+        lanes.plus_da = _mm_loadu_si128(reinterpret_cast<const __m128i *>(plus_da));
+        lanes.minus_da = _mm_loadu_si128(reinterpret_cast<const __m128i *>(minus_da));
+
+        return lanes;
+    }
+
+    static inline __m128i evaluate_factor(const factor_lanes &lanes, const __m128i source_alpha, const __m128i dest_alpha) {
+        __m128i result = _mm_add_epi16(lanes.base, _mm_and_si128(source_alpha, lanes.plus_sa));
+        result = _mm_sub_epi16(result, _mm_and_si128(source_alpha, lanes.minus_sa));
+        result = _mm_add_epi16(result, _mm_and_si128(dest_alpha, lanes.plus_da));
+
+        return _mm_sub_epi16(result, _mm_and_si128(dest_alpha, lanes.minus_da));
+    }
+
+    static inline __m128i broadcast_alpha_epi16(const __m128i unpacked) {
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(unpacked, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    static inline __m128i blend_add_epi16(const __m128i source, const __m128i dest, const factor_lanes &source_lanes,
+        const factor_lanes &dest_lanes) {
+        const __m128i source_alpha = broadcast_alpha_epi16(source);
+        const __m128i dest_alpha = broadcast_alpha_epi16(dest);
+
+        const __m128i source_term = div_255_epi16(_mm_mullo_epi16(source, evaluate_factor(source_lanes, source_alpha, dest_alpha)));
+        const __m128i dest_term = div_255_epi16(_mm_mullo_epi16(dest, evaluate_factor(dest_lanes, source_alpha, dest_alpha)));
+
+        return _mm_adds_epu16(source_term, dest_term);
+    }
+#endif
+
+    void fill_span(std::uint32_t *dest, const std::uint32_t color, const std::size_t count) {
+        std::fill(dest, dest + count, color);
+    }
+
+    void multiply_span(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count) {
+        std::size_t i = 0;
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+            const __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), multiply_epu8(lhs, rhs));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = multiply_pixel(dest[i], source[i]);
+        }
+    }
+
+    void multiply_color_span(std::uint32_t *dest, const std::uint32_t color, const std::size_t count) {
+        if (color == 0xFFFFFFFF) {
+            return;
+        }
+
+        std::size_t i = 0;
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+        const __m128i rhs = _mm_set1_epi32(static_cast<int>(color));
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), multiply_epu8(lhs, rhs));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = multiply_pixel(dest[i], color);
+        }
+    }
+
+    void invert_span(std::uint32_t *dest, const std::size_t count) {
+        std::size_t i = 0;
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+        const __m128i all_set = _mm_set1_epi32(-1);
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_xor_si128(value, all_set));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = ~dest[i];
+        }
+    }
+
+    static int channel_shift(const channel_swizzle channel) {
+        switch (channel) {
+        case channel_swizzle::red:
+            return 16;
+
+        case channel_swizzle::green:
+            return 8;
+
+        case channel_swizzle::blue:
+            return 0;
+
+        case channel_swizzle::alpha:
+            return 24;
+
+        default:
+            break;
+        }
+
+        return -1;
+    }
+
+    void swizzle_span(std::uint32_t *dest, const std::size_t count, const channel_swizzle *swizzle) {
+        static constexpr channel_swizzle OUTPUT_CHANNELS[4] = { channel_swizzle::red, channel_swizzle::green,
+            channel_swizzle::blue, channel_swizzle::alpha };
+
+        // Channels staying in place are masked, constant ones are or'ed in, the rest are moved one by one
+        std::uint32_t keep_mask = 0;
+        std::uint32_t fixed = 0;
+
+        int move_from[4] = { -1, -1, -1, -1 };
+        bool has_move = false;
+
+        for (int i = 0; i < 4; i++) {
+            const int output_shift = channel_shift(OUTPUT_CHANNELS[i]);
+            const int source_shift = channel_shift(swizzle[i]);
+
+            if (source_shift == output_shift) {
+                keep_mask |= 0xFFU << output_shift;
+            } else if (source_shift >= 0) {
+                move_from[i] = source_shift;
+                has_move = true;
+            } else if (swizzle[i] == channel_swizzle::one) {
+                fixed |= 0xFFU << output_shift;
+            }
+        }
+
+        std::size_t i = 0;
+
+        if (has_move) {
+            for (; i < count; i++) {
+                std::uint32_t result = (dest[i] & keep_mask) | fixed;
+
+                for (int c = 0; c < 4; c++) {
+                    if (move_from[c] >= 0) {
+                        result |= ((dest[i] >> move_from[c]) & 0xFF) << channel_shift(OUTPUT_CHANNELS[c]);
+                    }
+                }
+
+                dest[i] = result;
+            }
+
+            return;
+        }
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+        const __m128i keep_lanes = _mm_set1_epi32(static_cast<int>(keep_mask));
+        const __m128i fixed_lanes = _mm_set1_epi32(static_cast<int>(fixed));
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_or_si128(_mm_and_si128(value, keep_lanes), fixed_lanes));
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = (dest[i] & keep_mask) | fixed;
+        }
+    }
+
+    void blend_span(std::uint32_t *dest, const std::uint32_t *source, const std::size_t count, const blend_state &state) {
+        if (!state.enabled) {
+            std::copy(source, source + count, dest);
+            return;
+        }
+
+        std::size_t i = 0;
+
+#ifdef EKA2L1_SOFTWARE_BLIT_SSE2
+        // Subtract equations are rare enough to be left to the generic path
+        if ((state.rgb_equation == blend_equation::add) && (state.a_equation == blend_equation::add)) {
+            const factor_lanes source_lanes = make_factor_lanes(state.rgb_frag_out_factor, state.a_frag_out_factor);
+            const factor_lanes dest_lanes = make_factor_lanes(state.rgb_current_factor, state.a_current_factor);
+            const __m128i zero = _mm_setzero_si128();
+
+            for (; i + 4 <= count; i += 4) {
+                const __m128i source_pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+                const __m128i dest_pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+
+                const __m128i lo = blend_add_epi16(_mm_unpacklo_epi8(source_pixels, zero), _mm_unpacklo_epi8(dest_pixels, zero),
+                    source_lanes, dest_lanes);
+                const __m128i hi = blend_add_epi16(_mm_unpackhi_epi8(source_pixels, zero), _mm_unpackhi_epi8(dest_pixels, zero),
+                    source_lanes, dest_lanes);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_packus_epi16(lo, hi));
+            }
+        }
+#endif
+
+        for (; i < count; i++) {
+            dest[i] = blend_pixel(dest[i], source[i], state);
+        }
+    }
+}
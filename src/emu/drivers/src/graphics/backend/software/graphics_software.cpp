@@ -0,0 +1,905 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/algorithm.h>
+#include <common/log.h>
+#include <common/path.h>
+#include <common/pixel.h>
+
+#include <drivers/graphics/backend/software/graphics_software.h>
+
+#include <miniz.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace eka2l1::drivers {
+    static int bytes_per_pixel(const int bpp) {
+        switch (bpp) {
+        case 8:
+            return 1;
+
+        case 12:
+        case 16:
+            return 2;
+
+        case 24:
+            return 3;
+
+        default:
+            break;
+        }
+
+        return 4;
+    }
+
+    static void convert_row_to_bgra(std::uint32_t *dest, const std::uint8_t *source, const int count, const int bpp) {
+        switch (bpp) {
+        case 8: {
+            // Same as the swizzle used on GPU: the value is spread to all channels
+            static const std::vector<std::uint32_t> spread_palette = []() {
+                std::vector<std::uint32_t> palette(256);
+
+                for (std::uint32_t i = 0; i < 256; i++) {
+                    palette[i] = i * 0x01010101;
+                }
+
+                return palette;
+            }();
+
+            common::convert_palette_row_to_bgra32(dest, source, count, 8, spread_palette.data());
+            break;
+        }
+
+        case 12:
+            common::convert_xrgb4444_row_to_bgra32(dest, reinterpret_cast<const std::uint16_t *>(source), count);
+            break;
+
+        case 16:
+            common::convert_rgb565_row_to_bgra32(dest, reinterpret_cast<const std::uint16_t *>(source), count);
+            break;
+
+        case 24:
+            common::convert_bgr24_row_to_bgra32(dest, source, count);
+            break;
+
+        case 32:
+            std::memcpy(dest, source, count * sizeof(std::uint32_t));
+            break;
+
+        default:
+            LOG_ERROR("Unsupported bitmap bit depth {} for software driver", bpp);
+            break;
+        }
+    }
+
+    static bool write_png(software_bitmap &bmp, const std::string &path, const bool flip) {
+        if ((bmp.size.x <= 0) || (bmp.size.y <= 0)) {
+            return false;
+        }
+
+        std::vector<std::uint8_t> rgb(bmp.pixels.size() * 3);
+
+        for (std::size_t i = 0; i < bmp.pixels.size(); i++) {
+            rgb[i * 3] = static_cast<std::uint8_t>(bmp.pixels[i] >> 16);
+            rgb[i * 3 + 1] = static_cast<std::uint8_t>(bmp.pixels[i] >> 8);
+            rgb[i * 3 + 2] = static_cast<std::uint8_t>(bmp.pixels[i]);
+        }
+
+        std::size_t png_size = 0;
+        void *png_data = tdefl_write_image_to_png_file_in_memory_ex(rgb.data(), bmp.size.x, bmp.size.y, 3, &png_size,
+            MZ_DEFAULT_LEVEL, flip);
+
+        if (!png_data) {
+            return false;
+        }
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(png_data), png_size);
+
+        mz_free(png_data);
+        return out.good();
+    }
+
+    /**
+     * \brief Get the pixels whose center is inside a span, limited to a range.
+     */
+    static bool covered_range(const float start, const float end, const int limit_start, const int limit_end,
+        int &first, int &last) {
+        first = std::max(limit_start, static_cast<int>(std::ceil(start - 0.5f)));
+        last = std::min(limit_end, static_cast<int>(std::ceil(end - 0.5f)));
+
+        return first < last;
+    }
+
+    software_bitmap::software_bitmap(const eka2l1::vec2 &size, const int bpp)
+        : size(size)
+        , bpp(bpp)
+        , pixels(static_cast<std::size_t>(std::max(size.x, 0)) * std::max(size.y, 0), 0)
+        , swizzle({ channel_swizzle::red, channel_swizzle::green, channel_swizzle::blue, channel_swizzle::alpha }) {
+    }
+
+    bool software_bitmap::swizzled() const {
+        return (swizzle[0] != channel_swizzle::red) || (swizzle[1] != channel_swizzle::green)
+            || (swizzle[2] != channel_swizzle::blue) || (swizzle[3] != channel_swizzle::alpha);
+    }
+
+    void software_bitmap::resize(const eka2l1::vec2 &new_size) {
+        std::vector<std::uint32_t> new_pixels(static_cast<std::size_t>(std::max(new_size.x, 0)) * std::max(new_size.y, 0), 0);
+
+        const int copy_width = common::min<int>(size.x, new_size.x);
+        const int copy_height = common::min<int>(size.y, new_size.y);
+
+        for (int y = 0; y < copy_height; y++) {
+            std::copy(row(y), row(y) + copy_width, new_pixels.data() + static_cast<std::size_t>(y) * new_size.x);
+        }
+
+        pixels = std::move(new_pixels);
+        size = new_size;
+    }
+
+    software_graphics_driver::software_graphics_driver()
+        : graphics_driver(graphic_api::software)
+        , should_stop(false)
+        , swapchain(eka2l1::vec2(0, 0), 32)
+        , binding(nullptr)
+        , brush_color(0xFFFFFFFF)
+        , frame_dump_count(0) {
+        list_queue.max_pending_count_ = 128;
+    }
+
+    software_bitmap *software_graphics_driver::get_bitmap(const drivers::handle h) {
+        const std::size_t index = static_cast<std::size_t>(h & ~HANDLE_BITMAP);
+
+        if (!(h & HANDLE_BITMAP) || (index == 0) || (index > bitmaps.size())) {
+            return nullptr;
+        }
+
+        return bitmaps[index - 1].get();
+    }
+
+    software_bitmap *software_graphics_driver::current_target() {
+        return binding ? binding : &swapchain;
+    }
+
+    bool software_graphics_driver::transform_rect(const eka2l1::rect &draw_rect, const bool no_flip, float &x0, float &x1,
+        float &y0, float &y1, bool &mirrored) {
+        if ((projection_size.x <= 0) || (projection_size.y <= 0)) {
+            return false;
+        }
+
+        // Same mapping as an orthographic projection followed by the viewport transform on GPU
+        const float scale_x = static_cast<float>(state.viewport.size.x) / projection_size.x;
+        const float scale_y = static_cast<float>(state.viewport.size.y) / projection_size.y;
+
+        x0 = state.viewport.top.x + draw_rect.top.x * scale_x;
+        x1 = state.viewport.top.x + (draw_rect.top.x + draw_rect.size.x) * scale_x;
+
+        if (no_flip) {
+            // Rows are counted from the bottom of the viewport, as the display shows them upside down
+            const float base = static_cast<float>(state.viewport.top.y + state.viewport.size.y);
+
+            y0 = base - (draw_rect.top.y + draw_rect.size.y) * scale_y;
+            y1 = base - draw_rect.top.y * scale_y;
+            mirrored = true;
+        } else {
+            y0 = state.viewport.top.y + draw_rect.top.y * scale_y;
+            y1 = state.viewport.top.y + (draw_rect.top.y + draw_rect.size.y) * scale_y;
+            mirrored = false;
+        }
+
+        if (x0 > x1) {
+            std::swap(x0, x1);
+        }
+
+        if (y0 > y1) {
+            std::swap(y0, y1);
+            mirrored = !mirrored;
+        }
+
+        return (x0 < x1) && (y0 < y1);
+    }
+
+    eka2l1::rect software_graphics_driver::drawable_area(software_bitmap *target) {
+        eka2l1::rect area(eka2l1::vec2(0, 0), target->size);
+
+        if (state.clipping) {
+            const int left = std::max(area.top.x, state.clip.top.x);
+            const int top = std::max(area.top.y, state.clip.top.y);
+            const int right = std::min(area.top.x + area.size.x, state.clip.top.x + state.clip.size.x);
+            const int bottom = std::min(area.top.y + area.size.y, state.clip.top.y + state.clip.size.y);
+
+            area.top = eka2l1::vec2(left, top);
+            area.size = eka2l1::vec2(std::max(right - left, 0), std::max(bottom - top, 0));
+        }
+
+        return area;
+    }
+
+    void software_graphics_driver::update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
+        const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line) {
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp || !data) {
+            return;
+        }
+
+        const std::size_t pixel_size = bytes_per_pixel(bmp->bpp);
+
+        // Rows are aligned to 4 bytes, like the default unpack alignment on GPU
+        const std::size_t stride = common::align((pixels_per_line ? pixels_per_line : dim.x) * pixel_size, 4);
+
+        const int first_column = std::max(offset.x, 0);
+        const int last_column = std::min(offset.x + dim.x, bmp->size.x);
+
+        if (first_column >= last_column) {
+            return;
+        }
+
+        const std::uint8_t *source = reinterpret_cast<const std::uint8_t *>(data);
+
+        for (int y = 0; y < dim.y; y++) {
+            const int dest_y = offset.y + y;
+
+            if ((dest_y < 0) || (dest_y >= bmp->size.y)) {
+                continue;
+            }
+
+            const std::size_t row_start = y * stride + (first_column - offset.x) * pixel_size;
+
+            if (size && (row_start + (last_column - first_column) * pixel_size > size)) {
+                break;
+            }
+
+            convert_row_to_bgra(bmp->row(dest_y) + first_column, source + row_start, last_column - first_column, bmp->bpp);
+        }
+    }
+
+    void software_graphics_driver::update_bitmap(command_helper &helper) {
+        drivers::handle handle = 0;
+        std::uint8_t *data = nullptr;
+        std::size_t size = 0;
+        eka2l1::vec2 offset;
+        eka2l1::vec2 dim;
+        std::size_t pixels_per_line = 0;
+
+        helper.pop(handle);
+        helper.pop(data);
+        helper.pop(size);
+        helper.pop(offset);
+        helper.pop(dim);
+        helper.pop(pixels_per_line);
+
+        update_bitmap(handle, size, offset, dim, data, pixels_per_line);
+    }
+
+    void software_graphics_driver::attach_descriptors(drivers::handle h, const int stride, const bool instance_move,
+        const attribute_descriptor *descriptors, const int descriptor_count) {
+        LOG_ERROR("Vertex descriptors are not supported by the software graphics driver");
+    }
+
+    void software_graphics_driver::create_bitmap(command_helper &helper) {
+        eka2l1::vec2 size;
+        std::uint32_t bpp = 0;
+        drivers::handle h = 0;
+
+        helper.pop(size);
+        helper.pop(bpp);
+        helper.pop(h);
+
+        // The handle is reserved by the client already
+        const std::size_t index = static_cast<std::size_t>(h & ~HANDLE_BITMAP);
+
+        if (!(h & HANDLE_BITMAP) || (index == 0)) {
+            LOG_ERROR("Invalid bitmap handle to create");
+            return;
+        }
+
+        if (bitmaps.size() < index) {
+            bitmaps.resize(index);
+        }
+
+        bitmaps[index - 1] = std::make_unique<software_bitmap>(size, static_cast<int>(bpp));
+    }
+
+    void software_graphics_driver::destroy_bitmap(command_helper &helper) {
+        drivers::handle h = 0;
+        helper.pop(h);
+
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp) {
+            LOG_ERROR("Invalid bitmap handle to destroy");
+            return;
+        }
+
+        if (binding == bmp) {
+            binding = nullptr;
+            projection_size = swapchain_size;
+        }
+
+        bitmaps[(h & ~HANDLE_BITMAP) - 1].reset();
+        release_bitmap_handle(h);
+    }
+
+    void software_graphics_driver::bind_bitmap(command_helper &helper) {
+        drivers::handle h = 0;
+        helper.pop(h);
+
+        if (h == 0) {
+            binding = nullptr;
+            projection_size = swapchain_size;
+
+            return;
+        }
+
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp) {
+            LOG_ERROR("Bitmap handle invalid to be binded");
+            return;
+        }
+
+        binding = bmp;
+        projection_size = bmp->size;
+
+        set_viewport(eka2l1::rect(eka2l1::vec2(0, 0), bmp->size));
+    }
+
+    void software_graphics_driver::resize_bitmap(command_helper &helper) {
+        drivers::handle h = 0;
+        helper.pop(h);
+
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp) {
+            LOG_ERROR("Bitmap handle invalid to be resized");
+            return;
+        }
+
+        vec2 new_size = { 0, 0 };
+        helper.pop(new_size);
+
+        bmp->resize(new_size);
+    }
+
+    void software_graphics_driver::set_brush_color(command_helper &helper) {
+        float r = 0.0f;
+        float g = 0.0f;
+        float b = 0.0f;
+        float a = 0.0f;
+
+        helper.pop(r);
+        helper.pop(g);
+        helper.pop(b);
+        helper.pop(a);
+
+        const auto to_channel = [](const float value) {
+            return static_cast<std::uint8_t>(common::clamp(0.0f, 255.0f, value));
+        };
+
+        brush_color = software::pack_pixel(to_channel(r), to_channel(g), to_channel(b), to_channel(a));
+    }
+
+    void software_graphics_driver::set_swapchain_size(command_helper &helper) {
+        eka2l1::vec2 size;
+        helper.pop(size);
+
+        swapchain_size = size;
+        swapchain.resize(size);
+
+        if (!binding) {
+            projection_size = swapchain_size;
+        }
+    }
+
+    void software_graphics_driver::set_viewport(const eka2l1::rect &viewport) {
+        // Store it with rows counted from the bottom, the same way GPU does
+        state.viewport = viewport;
+        state.viewport.top.y = current_target()->size.y - (viewport.top.y + viewport.size.y);
+    }
+
+    void software_graphics_driver::set_viewport(command_helper &helper) {
+        eka2l1::rect viewport;
+        helper.pop(viewport);
+
+        set_viewport(viewport);
+    }
+
+    void software_graphics_driver::set_clipping(command_helper &helper) {
+        helper.pop(state.clipping);
+    }
+
+    void software_graphics_driver::clip_rect(command_helper &helper) {
+        eka2l1::rect clip;
+        helper.pop(clip);
+
+        // Negative height means the rectangle is given with rows counted from the top
+        if (clip.size.y < 0) {
+            clip.top.y = current_target()->size.y - (clip.top.y - clip.size.y);
+            clip.size.y = -clip.size.y;
+        }
+
+        state.clip = clip;
+    }
+
+    void software_graphics_driver::set_swizzle(command_helper &helper) {
+        drivers::handle h = 0;
+        helper.pop(h);
+
+        software_bitmap *bmp = get_bitmap(h);
+
+        // There are no textures other than bitmaps here
+        if (!bmp) {
+            LOG_ERROR("Invalid bitmap handle to set swizzle");
+            return;
+        }
+
+        helper.pop(bmp->swizzle[0]);
+        helper.pop(bmp->swizzle[1]);
+        helper.pop(bmp->swizzle[2]);
+        helper.pop(bmp->swizzle[3]);
+    }
+
+    void software_graphics_driver::set_blend(command_helper &helper) {
+        helper.pop(state.blend.enabled);
+    }
+
+    void software_graphics_driver::blend_formula(command_helper &helper) {
+        helper.pop(state.blend.rgb_equation);
+        helper.pop(state.blend.a_equation);
+        helper.pop(state.blend.rgb_frag_out_factor);
+        helper.pop(state.blend.rgb_current_factor);
+        helper.pop(state.blend.a_frag_out_factor);
+        helper.pop(state.blend.a_current_factor);
+    }
+
+    void software_graphics_driver::clear(command_helper &helper) {
+        std::uint32_t color_to_clear = 0;
+        std::uint8_t clear_bits = 0;
+
+        helper.pop(color_to_clear);
+        helper.pop(clear_bits);
+
+        // There is no depth or stencil buffer to clear
+        if (!(clear_bits & draw_buffer_bit_color_buffer)) {
+            return;
+        }
+
+        const std::uint32_t color = software::pack_pixel(static_cast<std::uint8_t>(color_to_clear >> 24),
+            static_cast<std::uint8_t>(color_to_clear >> 16), static_cast<std::uint8_t>(color_to_clear >> 8),
+            static_cast<std::uint8_t>(color_to_clear));
+
+        software_bitmap *target = current_target();
+        const eka2l1::rect area = drawable_area(target);
+
+        for (int y = area.top.y; y < area.top.y + area.size.y; y++) {
+            software::fill_span(target->row(y) + area.top.x, color, area.size.x);
+        }
+    }
+
+    void software_graphics_driver::draw_rectangle(command_helper &helper) {
+        eka2l1::rect fill_rect;
+        helper.pop(fill_rect);
+
+        float x0 = 0.0f;
+        float x1 = 0.0f;
+        float y0 = 0.0f;
+        float y1 = 0.0f;
+        bool mirrored = false;
+
+        if (!transform_rect(fill_rect, false, x0, x1, y0, y1, mirrored)) {
+            return;
+        }
+
+        software_bitmap *target = current_target();
+        const eka2l1::rect area = drawable_area(target);
+
+        int first_column = 0;
+        int last_column = 0;
+        int first_row = 0;
+        int last_row = 0;
+
+        if (!covered_range(x0, x1, area.top.x, area.top.x + area.size.x, first_column, last_column)
+            || !covered_range(y0, y1, area.top.y, area.top.y + area.size.y, first_row, last_row)) {
+            return;
+        }
+
+        const std::size_t count = last_column - first_column;
+
+        if (!state.blend.enabled) {
+            for (int y = first_row; y < last_row; y++) {
+                software::fill_span(target->row(y) + first_column, brush_color, count);
+            }
+
+            return;
+        }
+
+        source_span.resize(count);
+        software::fill_span(source_span.data(), brush_color, count);
+
+        for (int y = first_row; y < last_row; y++) {
+            software::blend_span(target->row(y) + first_column, source_span.data(), count, state.blend);
+        }
+    }
+
+    void software_graphics_driver::draw_bitmap(command_helper &helper) {
+        // Get bitmap to draw
+        drivers::handle to_draw = 0;
+        helper.pop(to_draw);
+
+        software_bitmap *bmp = get_bitmap(to_draw);
+
+        if (!bmp) {
+            LOG_ERROR("Invalid bitmap handle to draw");
+            return;
+        }
+
+        drivers::handle mask_to_use = 0;
+        helper.pop(mask_to_use);
+
+        software_bitmap *mask_bmp = nullptr;
+
+        if (mask_to_use) {
+            mask_bmp = get_bitmap(mask_to_use);
+
+            if (!mask_bmp) {
+                LOG_ERROR("Mask handle was provided but invalid!");
+                return;
+            }
+        }
+
+        eka2l1::rect dest_rect;
+        helper.pop(dest_rect);
+
+        eka2l1::rect source_rect;
+        helper.pop(source_rect);
+
+        std::uint32_t flags = 0;
+        helper.pop(flags);
+
+        if ((bmp->size.x <= 0) || (bmp->size.y <= 0) || (mask_bmp && ((mask_bmp->size.x <= 0) || (mask_bmp->size.y <= 0)))) {
+            return;
+        }
+
+        if (source_rect.empty()) {
+            source_rect = eka2l1::rect(eka2l1::vec2(0, 0), bmp->size);
+        }
+
+        if (dest_rect.size.x == 0) {
+            dest_rect.size.x = source_rect.size.x;
+        }
+
+        if (dest_rect.size.y == 0) {
+            dest_rect.size.y = source_rect.size.y;
+        }
+
+        float x0 = 0.0f;
+        float x1 = 0.0f;
+        float y0 = 0.0f;
+        float y1 = 0.0f;
+        bool mirrored = false;
+
+        if (!transform_rect(dest_rect, flags & bitmap_draw_flag_no_flip, x0, x1, y0, y1, mirrored)) {
+            return;
+        }
+
+        software_bitmap *target = current_target();
+        const eka2l1::rect area = drawable_area(target);
+
+        int first_column = 0;
+        int last_column = 0;
+        int first_row = 0;
+        int last_row = 0;
+
+        if (!covered_range(x0, x1, area.top.x, area.top.x + area.size.x, first_column, last_column)
+            || !covered_range(y0, y1, area.top.y, area.top.y + area.size.y, first_row, last_row)) {
+            return;
+        }
+
+        const std::size_t count = last_column - first_column;
+
+        // Nearest sampling, at the center of each target pixel. The mask is sampled at the same
+        // normalized coordinates as the source.
+        source_columns.resize(count);
+
+        if (mask_bmp) {
+            mask_columns.resize(count);
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            const float u = (first_column + i + 0.5f - x0) / (x1 - x0);
+            const int column = common::clamp(0, bmp->size.x - 1,
+                source_rect.top.x + static_cast<int>(std::floor(u * source_rect.size.x)));
+
+            source_columns[i] = column;
+
+            if (mask_bmp) {
+                mask_columns[i] = common::clamp(0, mask_bmp->size.x - 1, (column * 2 + 1) * mask_bmp->size.x / (bmp->size.x * 2));
+            }
+        }
+
+        // Equal source and target sizes, the source row can be read as is
+        const bool contiguous = (source_columns.back() - source_columns.front()) == static_cast<int>(count - 1);
+        const std::uint32_t color = (flags & bitmap_draw_flag_use_brush) ? brush_color : 0xFFFFFFFF;
+        const bool modify_source = !contiguous || mask_bmp || (color != 0xFFFFFFFF) || bmp->swizzled();
+
+        source_span.resize(count);
+
+        if (mask_bmp) {
+            mask_span.resize(count);
+        }
+
+        for (int y = first_row; y < last_row; y++) {
+            float v = (y + 0.5f - y0) / (y1 - y0);
+
+            if (mirrored) {
+                v = 1.0f - v;
+            }
+
+            const int source_y = common::clamp(0, bmp->size.y - 1,
+                source_rect.top.y + static_cast<int>(std::floor(v * source_rect.size.y)));
+
+            const std::uint32_t *source_row = bmp->row(source_y);
+            const std::uint32_t *span = source_row + source_columns[0];
+
+            if (modify_source) {
+                if (contiguous) {
+                    std::copy(span, span + count, source_span.data());
+                } else {
+                    for (std::size_t i = 0; i < count; i++) {
+                        source_span[i] = source_row[source_columns[i]];
+                    }
+                }
+
+                if (bmp->swizzled()) {
+                    software::swizzle_span(source_span.data(), count, bmp->swizzle.data());
+                }
+
+                if (mask_bmp) {
+                    const int mask_y = common::clamp(0, mask_bmp->size.y - 1, (source_y * 2 + 1) * mask_bmp->size.y / (bmp->size.y * 2));
+                    const std::uint32_t *mask_row = mask_bmp->row(mask_y);
+
+                    for (std::size_t i = 0; i < count; i++) {
+                        mask_span[i] = mask_row[mask_columns[i]];
+                    }
+
+                    if (mask_bmp->swizzled()) {
+                        software::swizzle_span(mask_span.data(), count, mask_bmp->swizzle.data());
+                    }
+
+                    if (flags & bitmap_draw_flag_invert_mask) {
+                        software::invert_span(mask_span.data(), count);
+                    }
+
+                    software::multiply_span(source_span.data(), mask_span.data(), count);
+                }
+
+                software::multiply_color_span(source_span.data(), color, count);
+                span = source_span.data();
+            }
+
+            software::blend_span(target->row(y) + first_column, span, count, state.blend);
+        }
+    }
+
+    void software_graphics_driver::display(command_helper &helper) {
+        if (disp_hook_) {
+            disp_hook_();
+        }
+
+        dump_frame();
+        helper.finish(this, 0);
+    }
+
+    void software_graphics_driver::dump_frame() {
+        if (frame_dump_folder.empty()) {
+            return;
+        }
+
+        const std::string path = eka2l1::add_path(frame_dump_folder, fmt::format("frame_{}.png", frame_dump_count++));
+
+        // The swapchain is stored with rows from the bottom, like a GPU framebuffer
+        if (!write_png(swapchain, path, true)) {
+            LOG_ERROR("Failed to dump frame to {}", path);
+        }
+    }
+
+    void software_graphics_driver::set_frame_dump_folder(const std::string &folder) {
+        frame_dump_folder = folder;
+
+        if (!frame_dump_folder.empty()) {
+            eka2l1::create_directories(frame_dump_folder);
+        }
+    }
+
+    bool software_graphics_driver::save_bitmap(const drivers::handle h, const std::string &path) {
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp) {
+            return false;
+        }
+
+        return write_png(*bmp, path, false);
+    }
+
+    bool software_graphics_driver::read_bitmap(const drivers::handle h, std::vector<std::uint32_t> &pixels) {
+        software_bitmap *bmp = get_bitmap(h);
+
+        if (!bmp) {
+            return false;
+        }
+
+        pixels = bmp->pixels;
+        return true;
+    }
+
+    std::unique_ptr<graphics_command_list> software_graphics_driver::new_command_list() {
+        std::unique_ptr<server_graphics_command_list> list = std::make_unique<server_graphics_command_list>();
+        list->list_ = list_pool.acquire();
+
+        return list;
+    }
+
+    std::unique_ptr<graphics_command_list_builder> software_graphics_driver::new_command_builder(graphics_command_list *list) {
+        return std::make_unique<server_graphics_command_list_builder>(list);
+    }
+
+    std::uint64_t software_graphics_driver::submit_command_list(graphics_command_list &command_list) {
+        // Fences must be handed out in the same order lists are queued
+        const std::lock_guard<std::mutex> guard(submit_lock_);
+        const std::uint64_t fence = next_fence();
+
+        list_queue.push(std::move(static_cast<server_graphics_command_list &>(command_list)));
+        return fence;
+    }
+
+    void software_graphics_driver::dispatch(command *cmd) {
+        command_helper helper(cmd);
+
+        switch (cmd->opcode_) {
+        case graphics_driver_create_bitmap:
+            create_bitmap(helper);
+            break;
+
+        case graphics_driver_destroy_bitmap:
+            destroy_bitmap(helper);
+            break;
+
+        case graphics_driver_bind_bitmap:
+            bind_bitmap(helper);
+            break;
+
+        case graphics_driver_update_bitmap:
+            update_bitmap(helper);
+            break;
+
+        case graphics_driver_resize_bitmap:
+            resize_bitmap(helper);
+            break;
+
+        case graphics_driver_set_brush_color:
+            set_brush_color(helper);
+            break;
+
+        case graphics_driver_set_swapchain_size:
+            set_swapchain_size(helper);
+            break;
+
+        case graphics_driver_clear:
+            clear(helper);
+            break;
+
+        case graphics_driver_draw_bitmap:
+            draw_bitmap(helper);
+            break;
+
+        case graphics_driver_draw_rectangle:
+            draw_rectangle(helper);
+            break;
+
+        case graphics_driver_set_clipping:
+            set_clipping(helper);
+            break;
+
+        case graphics_driver_clip_rect:
+            clip_rect(helper);
+            break;
+
+        case graphics_driver_set_viewport:
+            set_viewport(helper);
+            break;
+
+        case graphics_driver_set_blend:
+            set_blend(helper);
+            break;
+
+        case graphics_driver_blend_formula:
+            blend_formula(helper);
+            break;
+
+        case graphics_driver_set_swizzle:
+            set_swizzle(helper);
+            break;
+
+        // Bitmaps are always sampled with nearest filtering
+        case graphics_driver_set_texture_filter:
+            break;
+
+        case graphics_driver_backup_state:
+            backup = state;
+            break;
+
+        case graphics_driver_restore_state:
+            state = backup;
+            break;
+
+        case graphics_driver_display:
+            display(helper);
+            break;
+
+        // No depth nor stencil buffer, nothing to do
+        case graphics_driver_set_depth:
+        case graphics_driver_set_stencil:
+        case graphics_driver_set_cull:
+        case graphics_driver_stencil_pass_condition:
+        case graphics_driver_stencil_set_action:
+        case graphics_driver_stencil_set_mask:
+        case graphics_driver_set_back_face_rule:
+            break;
+
+        case graphics_driver_native_dialog:
+            helper.finish(this, 0);
+            break;
+
+        default:
+            LOG_ERROR("Unimplemented opcode {} for software graphics driver", cmd->opcode_);
+            break;
+        }
+    }
+
+    void software_graphics_driver::run() {
+        while (!should_stop) {
+            std::optional<server_graphics_command_list> list = list_queue.pop();
+
+            if (!list) {
+                LOG_ERROR("Corrupted graphics command list! Emulation halt.");
+                break;
+            }
+
+            for (command &cmd : list->list_) {
+                dispatch(&cmd);
+            }
+
+            // Give the storage back, so the next list built does not allocate
+            list_pool.release(std::move(list->list_));
+            signal_next_fence();
+        }
+
+        // Nothing will be executed anymore, do not let anyone wait on it
+        signal_all_fences();
+    }
+
+    void software_graphics_driver::abort() {
+        list_queue.abort();
+        should_stop = true;
+        signal_all_fences();
+    }
+}
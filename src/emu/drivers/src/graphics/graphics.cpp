@@ -18,8 +18,10 @@
  */
 
 #include <drivers/graphics/backend/ogl/graphics_ogl.h>
+#include <drivers/graphics/backend/software/graphics_software.h>
 #include <drivers/graphics/graphics.h>
 
+#include <common/algorithm.h>
 #include <common/log.h>
 #include <common/platform.h>
 #include <glad/glad.h>
@@ -34,6 +36,15 @@ namespace eka2l1::drivers {
         }
     }
 
+    graphic_api string_to_graphic_api(const std::string &name) {
+        const std::string backend_lowered = common::lowercase_string(name);
+
+        if (backend_lowered == software_graphics_backend_name)
+            return graphic_api::software;
+
+        return graphic_api::opengl;
+    }
+
     bool init_graphics_library(graphic_api api) {
         switch (api) {
         case graphic_api::opengl: {
@@ -45,6 +56,9 @@ namespace eka2l1::drivers {
             return true;
         }
 
+        case graphic_api::software:
+            return true;
+
         default:
             break;
         }
@@ -52,12 +66,34 @@ namespace eka2l1::drivers {
         return false;
     }
 
+    drivers::handle graphics_driver::reserve_bitmap_handle() {
+        const std::lock_guard<std::mutex> guard(bitmap_handle_lock_);
+
+        if (!free_bitmap_handles_.empty()) {
+            const drivers::handle h = free_bitmap_handles_.back();
+            free_bitmap_handles_.pop_back();
+
+            return h;
+        }
+
+        return (++bitmap_handle_counter_) | HANDLE_BITMAP;
+    }
+
+    void graphics_driver::release_bitmap_handle(const drivers::handle h) {
+        const std::lock_guard<std::mutex> guard(bitmap_handle_lock_);
+        free_bitmap_handles_.push_back(h);
+    }
+
     graphics_driver_ptr create_graphics_driver(const graphic_api api) {
         switch (api) {
         case graphic_api::opengl: {
             return std::make_unique<ogl_graphics_driver>();
         }
 
+        case graphic_api::software: {
+            return std::make_unique<software_graphics_driver>();
+        }
+
         default:
             break;
         }
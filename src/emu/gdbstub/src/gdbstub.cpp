@@ -334,7 +334,7 @@ namespace eka2l1 {
                 
                 if (buff) {
                     std::memcpy(buff, &(bp->second.inst[0]), bp->second.len);
-                    kern->get_cpu()->clear_instruction_cache();
+                    kern->clear_instruction_cache();
                 }
             }
         }
@@ -1054,7 +1054,7 @@ namespace eka2l1 {
                     std::memcpy(buff, (bp.len <= 2) ? &btrap_thumb[0] : &(btrap[0]), bp.len);
 
                     bp.pending = false;
-                    kern->get_cpu()->clear_instruction_cache();
+                    kern->clear_instruction_cache();
                 }
             }
         }
@@ -39,9 +39,20 @@ namespace eka2l1 {
 }
 
 namespace eka2l1::hle {
+    enum epoc_import_func_flags {
+        epoc_import_func_flag_none = 0,
+
+        /**
+         * The function only touches state owned by the calling thread, or constant data.
+         * It can be called without holding the kernel lock.
+         */
+        epoc_import_func_flag_no_kernel_lock = 1 << 0
+    };
+
     struct epoc_import_func {
         std::function<void(kernel_system *, kernel::process *, arm::core *)> func;
         std::string name;
+        std::uint32_t flags = epoc_import_func_flag_none;
     };
 
     using func_map = std::map<uint32_t, eka2l1::hle::epoc_import_func>;
@@ -33,6 +33,8 @@
 #include <kernel/process.h>
 #include <kernel/scheduler.h>
 #include <kernel/sema.h>
+#include <kernel/smp/balancer.h>
+#include <kernel/smp/core.h>
 #include <kernel/timer.h>
 
 #include <kernel/property.h>
@@ -42,6 +44,7 @@
 #include <common/types.h>
 #include <common/container.h>
 #include <common/hash.h>
+#include <common/profiler.h>
 #include <common/wildcard.h>
 
 #include <kernel/ipc.h>
@@ -49,6 +52,7 @@
 
 #include <cpu/arm_analyser.h>
 
+#include <array>
 #include <atomic>
 #include <exception>
 #include <functional>
@@ -247,9 +251,17 @@ namespace eka2l1 {
         std::vector<kernel_obj_unq_ptr> timers_;
         std::vector<kernel_obj_unq_ptr> message_queues_;
 
+        /**
+         * Name index for each object type, keyed by the object's own name rather than its full name.
+         * The full name also changes when an owner gets renamed, the own name only on rename().
+         */
+        std::array<std::unordered_multimap<std::string, kernel_obj_ptr>, static_cast<std::size_t>(kernel::object_type::unk)> name_indexes_;
+
         std::unique_ptr<kernel::btrace> btrace_inst_;
         std::unique_ptr<hle::lib_manager> lib_mngr_;
-        std::unique_ptr<kernel::thread_scheduler> thr_sch_;
+        std::vector<std::unique_ptr<kernel::smp::core>> cores_;
+        std::unique_ptr<kernel::smp::load_balancer> balancer_;
+        std::unique_ptr<common::call_profiler> profiler_;
 
         ntimer *timing_;
         memory_system *mem_;
@@ -259,7 +271,6 @@ namespace eka2l1 {
         config::app_settings *app_settings_;
         disasm *disassembler_;
 
-        arm::core *cpu_;
         loader::rom *rom_info_;
 
         //! Handles for some globally shared processes
@@ -308,10 +319,68 @@ namespace eka2l1 {
 
         void reset();
 
-        kernel::thread_scheduler *get_thread_scheduler() {
-            return thr_sch_.get();
+        /**
+         * @brief Get the scheduler of the core the caller is running on.
+         */
+        kernel::thread_scheduler *get_thread_scheduler();
+
+        /**
+         * @brief Get the scheduler a new thread of a process should be bound to.
+         * 
+         * All threads of a process run on the same core. The first thread of a process picks the least
+         * loaded core.
+         * 
+         * @param owner The process owning the new thread. Nullptr for the current core.
+         */
+        kernel::thread_scheduler *pick_thread_scheduler(kernel::process *owner);
+
+        /**
+         * @brief Add another core to run guest threads on.
+         * 
+         * Cores must be added before the EPOC version is set, and their CPU must already share the MMU.
+         * They are driven by their own host thread once started.
+         * 
+         * @param cpu The CPU executor of the new core.
+         * @see   start_secondary_cores
+         */
+        void add_core(arm::core *cpu);
+
+        /**
+         * @brief Get the core the caller is running on.
+         * 
+         * Host threads not driving a core are considered to run on the first one.
+         */
+        kernel::smp::core *current_core();
+
+        /**
+         * @brief Get the core running on a CPU executor.
+         * 
+         * @returns Nullptr if no core runs on it.
+         */
+        kernel::smp::core *get_core_of_cpu(arm::core *cpu);
+
+        std::size_t get_core_count() const {
+            return cores_.size();
         }
 
+        void start_secondary_cores();
+        void stop_secondary_cores();
+        void pause_secondary_cores(const bool should_pause);
+
+        /**
+         * @brief Invalidate translated code of a guest range on all cores.
+         * 
+         * Each core does it from its own host thread, before running guest code again.
+         */
+        void imb_range(const address addr, const std::uint32_t size);
+
+        /**
+         * @brief Invalidate all translated code on all cores.
+         * 
+         * @see imb_range
+         */
+        void clear_instruction_cache();
+
         void cpu_exception_handler(arm::core *core, arm::exception_type exception_type, const std::uint32_t exception_data);
 
         void call_ipc_send_callbacks(const std::string &server_name, const int ord, const ipc_arg &args,
@@ -369,9 +438,36 @@ namespace eka2l1 {
                 return;
             }
 
+            add_to_name_index(reinterpret_cast<kernel_obj_ptr>(svr.get()));
             servers_.push_back(std::move(svr));
         }
 
+        /**
+         * @brief Add an object to the name index of its type.
+         * 
+         * Done on creation. Objects call this themselves with the new name after a rename.
+         */
+        void add_to_name_index(kernel_obj_ptr obj);
+
+        /**
+         * @brief Remove an object from the name index of its type.
+         * @returns True if the object was in the index.
+         */
+        bool remove_from_name_index(kernel_obj_ptr obj);
+
+        /**
+         * @brief Find the object of the given type with exactly this full name.
+         * 
+         * If several objects match, the one created first is returned.
+         * 
+         * @param name          The name to look for.
+         * @param type          Type of the object.
+         * @param use_full_name Compare to the full name of the objects. Else compare to their own name.
+         * @param min_uid       Ignore objects with an unique ID lower than this.
+         */
+        kernel_obj_ptr find_by_exact_name(const std::string &name, const kernel::object_type type,
+            const bool use_full_name = true, const kernel::uid min_uid = 0);
+
         bool destroy(kernel_obj_ptr obj);
         int close(kernel::handle handle);
         bool get_info(kernel_obj_ptr obj, kernel::handle_info &info);
@@ -454,6 +550,13 @@ namespace eka2l1 {
             return btrace_inst_.get();
         }
 
+        /**
+         * @brief Get the profiler recording latency of SVCs, HLE IPC opcodes and dispatch calls.
+         */
+        common::call_profiler *get_call_profiler() {
+            return profiler_.get();
+        }
+
         loader::rom *get_rom_info() {
             return rom_info_;
         }
@@ -500,41 +603,7 @@ namespace eka2l1 {
 
         template <typename T>
         T *get_by_name_and_type(const std::string &name, const kernel::object_type obj_type) {
-            switch (obj_type) {
-#define OBJECT_SEARCH(obj_type, obj_map)                                               \
-    case kernel::object_type::obj_type: {                                              \
-        auto res = std::find_if(obj_map.begin(), obj_map.end(), [&](const auto &rhs) { \
-            std::string the_full_name;                                                 \
-            rhs->full_name(the_full_name);                                             \
-            return the_full_name == name;                                              \
-        });                                                                            \
-        if (res == obj_map.end())                                                      \
-            return nullptr;                                                            \
-        return reinterpret_cast<T *>(res->get());                                      \
-    }
-
-                OBJECT_SEARCH(mutex, mutexes_)
-                OBJECT_SEARCH(sema, semas_)
-                OBJECT_SEARCH(chunk, chunks_)
-                OBJECT_SEARCH(thread, threads_)
-                OBJECT_SEARCH(process, processes_)
-                OBJECT_SEARCH(change_notifier, change_notifiers_)
-                OBJECT_SEARCH(library, libraries_)
-                OBJECT_SEARCH(codeseg, codesegs_)
-                OBJECT_SEARCH(server, servers_)
-                OBJECT_SEARCH(prop, props_)
-                OBJECT_SEARCH(prop_ref, prop_refs_)
-                OBJECT_SEARCH(session, sessions_)
-                OBJECT_SEARCH(timer, timers_)
-                OBJECT_SEARCH(msg_queue, message_queues_)
-
-#undef OBJECT_SEARCH
-
-            default:
-                break;
-            }
-
-            return nullptr;
+            return reinterpret_cast<T *>(find_by_exact_name(name, obj_type));
         }
 
         /*! \brief Get kernel object by name
@@ -601,6 +670,7 @@ namespace eka2l1 {
 #define ADD_OBJECT_TO_CONTAINER(type, container, additional_setup) \
     case type:                                                     \
         additional_setup;                                          \
+        add_to_name_index(obj.get());                              \
         container.push_back(std::move(obj));                       \
         return reinterpret_cast<T *>(container.back().get());
 
@@ -26,11 +26,14 @@
 #include <kernel/common.h>
 #include <mem/ptr.h>
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace YAML {
@@ -64,6 +67,7 @@ namespace eka2l1 {
     namespace loader {
         struct e32img;
         struct romimg;
+        class e32img_cache;
 
         using e32img_ptr = std::shared_ptr<e32img>;
         using romimg_ptr = std::shared_ptr<romimg>;
@@ -73,6 +77,21 @@ namespace eka2l1 {
         using export_table = std::vector<std::uint32_t>;
         using symbols = std::vector<std::string>;
 
+        enum lib_image_kind {
+            lib_image_none = 0,
+            lib_image_e32 = 1,
+            lib_image_rom = 2
+        };
+
+        /**
+         * \brief Where a library name was found last time it was searched for.
+         */
+        struct lib_resolve_result {
+            std::u16string path_; ///< Full path of the image. Empty if it exists nowhere.
+            lib_image_kind kind_ = lib_image_none;
+            address rom_entry_point_ = 0; ///< Used to find the codeseg of a ROM image that is already loaded.
+        };
+
         /**
          * \brief Manage libraries and HLE functions.
 		 * 
@@ -91,6 +110,45 @@ namespace eka2l1 {
             kernel::chunk *bootstrap_chunk_;
             bool log_svc{ false };
 
+            /**
+             * Flat SVC dispatch table, built from svc_funcs_ once the EPOC version is known.
+             *
+             * The first level is indexed by bits 16-23 of the ordinal (the SVC class: slow, fast
+             * or HLE), the second level by the low 16 bits. Ordinals are dense inside each class,
+             * so a lookup is two array indexing operations instead of a tree walk.
+             */
+            std::array<std::vector<const epoc_import_func *>, 0x100> svc_table_;
+
+            void build_svc_table();
+            const epoc_import_func *lookup_svc(const sid svcnum) const;
+
+            /**
+             * Library resolution cache, keyed by lowercased name plus the search paths in effect.
+             *
+             * Every directory probed while resolving is watched (or its closest existing parent, so
+             * that creating it is noticed too). Any change there, an entry created, renamed or deleted
+             * through the IO system, or a drive being mounted/unmounted, marks the whole cache stale.
+             * Results are only cached when all probed directories are watched or on ROM, which does
+             * not change.
+             */
+            std::unordered_map<std::u16string, lib_resolve_result> resolve_cache_;
+            std::map<std::u16string, bool> resolve_dir_watched_;
+            std::vector<std::int64_t> resolve_watches_;
+            std::size_t resolve_drive_notify_;
+            std::size_t resolve_entry_notify_;
+            std::atomic<bool> resolve_cache_stale_;
+
+            std::unique_ptr<loader::e32img_cache> e32img_cache_;
+
+            std::u16string resolve_cache_key(const std::u16string &name) const;
+            std::optional<lib_resolve_result> find_resolved(const std::u16string &key);
+            bool watch_resolve_directory(const std::u16string &lib_path);
+            void invalidate_resolve_cache();
+
+            codeseg_ptr load_image(const drive_number drv, const std::u16string &lib_path, lib_resolve_result &result);
+            codeseg_ptr load_resolved(const lib_resolve_result &resolved);
+            codeseg_ptr search_and_load(const std::u16string &name, const std::u16string &cache_key);
+
         protected:
             const std::uint8_t *entry_points_call_routine_;
             const std::uint8_t *thread_entry_routine_;
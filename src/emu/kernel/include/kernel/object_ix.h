@@ -1,9 +1,9 @@
 #pragma once
 
+#include <common/container.h>
 #include <common/types.h>
 #include <kernel/kernel_obj.h>
 
-#include <array>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -40,9 +40,13 @@ namespace eka2l1 {
         };
 
         struct object_ix_record {
-            kernel_obj_ptr object;
-            uint32_t associated_handle;
-            bool free = true;
+            kernel_obj_ptr object = nullptr;
+            uint32_t associated_handle = 0;
+
+            // Links in the list of handles not yet taken by last_handle, in creation order
+            std::size_t prev_unclaimed = common::INVALID_SLAB_SLOT;
+            std::size_t next_unclaimed = common::INVALID_SLAB_SLOT;
+            bool unclaimed = false;
         };
 
         /*! \brief The ultimate object handles holder. */
@@ -51,18 +55,23 @@ namespace eka2l1 {
 
             size_t next_instance;
 
-            std::array<object_ix_record, 0x100> objects;
-            std::vector<std::uint32_t> handles;
+            common::slab_container<object_ix_record> objects;
+
+            std::size_t unclaimed_head;
+            std::size_t unclaimed_tail;
 
             handle_array_owner owner;
             size_t totals;
 
             uint32_t make_handle(size_t index);
 
+            void link_unclaimed(size_t index);
+            void unlink_unclaimed(size_t index);
+
             kernel_system *kern;
 
         public:
-            explicit object_ix() {}
+            explicit object_ix();
             explicit object_ix(kernel_system *kern, handle_array_owner owner);
 
             void do_state(common::chunkyseri &seri);
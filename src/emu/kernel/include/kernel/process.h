@@ -31,6 +31,7 @@
 #include <utils/reqsts.h>
 #include <utils/sec.h>
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <memory>
@@ -56,6 +57,10 @@ namespace eka2l1 {
 namespace eka2l1::kernel {
     class thread_scheduler;
 
+    namespace smp {
+        class load_balancer;
+    }
+
     struct process_info {
         ptr<void> code_where;
         std::uint64_t size;
@@ -104,6 +109,7 @@ namespace eka2l1::kernel {
     class process : public kernel_obj {
         friend class eka2l1::kernel_system;
         friend class thread_scheduler;
+        friend class smp::load_balancer;
 
         mem::mem_model_process_impl mm_impl_;
 
@@ -145,6 +151,11 @@ namespace eka2l1::kernel {
         std::uint32_t time_delay_;
         bool setting_inheritence_;
 
+        std::uint32_t core_index_; ///< Index of the core running threads of this process.
+        bool core_assigned_;
+        std::uint32_t load_; ///< Load unit calculated at the last rebalance.
+        std::atomic<std::uint64_t> run_ticks_; ///< Ticks ran by threads of this process since the last rebalance.
+
         // Это оскорбления, первое слово оскорбляет человека, а второе говорят для
         // увеличения эмоций.
         common::identity_container<process_uid_type_change_callback_elem> uid_change_callbacks;
@@ -305,6 +316,21 @@ namespace eka2l1::kernel {
             exit_type = t;
         }
 
+        /**
+         * @brief Account ticks ran by a thread of this process, for load balancing.
+         */
+        void add_run_ticks(const std::uint32_t ticks) {
+            run_ticks_ += ticks;
+        }
+
+        std::uint32_t get_core_index() const {
+            return core_index_;
+        }
+
+        std::uint32_t get_load() const {
+            return load_;
+        }
+
         std::uint32_t get_time_delay() const;
         void set_time_delay(const std::uint32_t delay);
         
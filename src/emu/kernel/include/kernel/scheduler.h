@@ -95,6 +95,20 @@ namespace eka2l1 {
             void unschedule(kernel::thread *thr);
             bool stop(kernel::thread *thr);
 
+            /**
+             * \brief Stop the core this scheduler runs on, so that it reschedules soon.
+             */
+            void prepare_reschedule();
+
+            /**
+             * \brief Move a thread of this scheduler to another one.
+             * 
+             * The thread must not be the current thread. If it's ready, it's queued to the target right away.
+             * 
+             * \returns False if the thread can't be moved now.
+             */
+            bool migrate(kernel::thread *thr, thread_scheduler *target);
+
             bool should_terminate() {
                 return false;
             }
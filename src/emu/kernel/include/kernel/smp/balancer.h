@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/smp/avail.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace eka2l1 {
+    class kernel_system;
+    class ntimer;
+
+    namespace kernel {
+        class process;
+    }
+}
+
+namespace eka2l1::kernel::smp {
+    class core;
+
+    /**
+     * \brief Distribute guest processes between cores.
+     * 
+     * The scheduable unit here is a whole process: all threads of a process stay on the same core, so
+     * a core never runs two threads sharing an address space at the same time. This keeps guest code
+     * of one process from racing itself on the host, while independent processes run in parallel.
+     * 
+     * Every rebalance period, the load of each process is calculated from the ticks its threads ran,
+     * and processes are placed again on the least loaded cores, heavy ones last. See README.txt.
+     */
+    class load_balancer {
+        kernel_system *kern_;
+        ntimer *timing_;
+        std::vector<core *> cores_;
+
+        int rebalance_evt_;
+        std::uint64_t last_rebalance_ticks_;
+
+        cpu_availability current_availability(const kernel::process *exclude);
+        bool move_process(kernel::process *pr, const std::uint32_t target);
+
+    public:
+        explicit load_balancer(kernel_system *kern, ntimer *timing);
+        ~load_balancer();
+
+        void add_core(core *new_core);
+
+        /**
+         * \brief Pick the core that threads of a process should be scheduled on.
+         * 
+         * If the process already has a core, it's returned. Else, the process is assigned to the least
+         * loaded core.
+         * 
+         * \returns Index of the core.
+         */
+        std::uint32_t pick_core(kernel::process *pr);
+
+        /**
+         * \brief Recalculate loads, and move processes between cores to even them.
+         * 
+         * The kernel must be locked. Processes with a thread running, or just stopped but not yet
+         * switched out, are left where they are.
+         */
+        void rebalance();
+
+        /**
+         * \brief Calculate the load unit of something that ran for a part of a time period.
+         * 
+         * \param run_ticks   Ticks ran during the period.
+         * \param total_ticks Total ticks of the period.
+         * 
+         * \returns Load unit, from 0 to cpu_availability::idle_unit.
+         */
+        static std::uint32_t calculate_load(std::uint64_t run_ticks, std::uint64_t total_ticks);
+    };
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/smp/scheduler.h>
+#include <cpu/arm_interface.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eka2l1 {
+    class kernel_system;
+    class ntimer;
+}
+
+namespace eka2l1::kernel::smp {
+    /**
+     * \brief A core of the emulated system.
+     * 
+     * Each core has its own CPU executor and subscheduler. The first core is driven by the emulator
+     * loop. Other cores are driven by their own host thread once started, so guest threads on
+     * different cores run in parallel. The kernel lock is only taken to reschedule, account the
+     * time a thread ran and serve kernel calls, never while running guest code.
+     * 
+     * The CPU executor of a core must only be touched by the host thread driving it. Other host
+     * threads queue their work with run_on_cpu, which the driving thread does before getting back
+     * to guest code.
+     */
+    class core {
+        kernel_system *kern_;
+        arm::core *cpu_;
+        std::unique_ptr<subscheduler> sched_;
+        std::uint32_t index_;
+
+        std::unique_ptr<std::thread> host_thread_;
+        std::atomic<bool> should_stop_;
+
+        bool paused_;
+        std::mutex pause_lock_;
+        std::condition_variable pause_cond_;
+
+        std::mutex work_lock_;
+        std::condition_variable work_cond_;
+        std::vector<arm::core_work_func> pending_work_;
+        std::thread::id driver_id_; ///< Host thread driving the core.
+        bool in_guest_; ///< The driving thread is running guest code, and has not called into the kernel.
+        std::uint64_t work_queued_;
+        std::uint64_t work_done_;
+
+        void host_loop();
+        void do_pending_work();
+
+    public:
+        explicit core(kernel_system *kern, ntimer *timing, arm::core *cpu, const std::uint32_t index);
+        ~core();
+
+        /**
+         * \brief Run the current thread of this core until its timeslice ends, then reschedule.
+         */
+        void run_slice();
+
+        /**
+         * \brief Run the current thread of this core, without rescheduling.
+         * 
+         * \param single_step Execute only one instruction.
+         * 
+         * \returns False if the core has no current thread.
+         */
+        bool run_current_thread(const bool single_step = false);
+
+        /**
+         * \brief Mark the calling host thread as the one driving this core, running guest code from now on.
+         * 
+         * Work queued for the CPU is done before returning.
+         */
+        void enter_guest();
+
+        /**
+         * \brief Mark that the thread driving this core stopped running guest code, for example to serve
+         *        a kernel call.
+         * 
+         * Work queued for the CPU is done before returning.
+         */
+        void leave_guest();
+
+        /**
+         * \brief Do work on the CPU of this core from the host thread driving it.
+         * 
+         * If the caller drives the core, the work is done right away. Otherwise, it's queued and the CPU
+         * is halted, so the driving thread gets to it soon.
+         * 
+         * \param work The work to do.
+         * \param wait Wait until the CPU can no longer run guest code without seeing the work done.
+         *             This must be set when changing memory mappings.
+         */
+        void run_on_cpu(arm::core_work_func work, const bool wait);
+
+        /**
+         * \brief Start driving this core from its own host thread.
+         */
+        void start();
+
+        /**
+         * \brief Stop the host thread driving this core, and wait for it to exit.
+         */
+        void stop();
+
+        void set_paused(const bool should_pause);
+
+        arm::core *get_cpu() {
+            return cpu_;
+        }
+
+        subscheduler *get_scheduler() {
+            return sched_.get();
+        }
+
+        const std::uint32_t index() const {
+            return index_;
+        }
+
+        /**
+         * \brief Get the core driven by the calling host thread.
+         * 
+         * \returns Nullptr if the caller does not drive a core with its own host thread.
+         */
+        static core *current();
+    };
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/scheduler.h>
+
+namespace eka2l1::kernel::smp {
+    /**
+     * \brief Scheduler of a single core.
+     * 
+     * Each core owns one, with its own ready queues and current thread. A thread is bound to the
+     * subscheduler of the core it runs on, and only the load balancer moves it to another one.
+     * 
+     * \sa core, load_balancer
+     */
+    using subscheduler = kernel::thread_scheduler;
+}
@@ -48,6 +48,12 @@
         func_sid, eka2l1::hle::epoc_import_func { eka2l1::hle::bridge(&func), #func } \
     }
 
+#define BRIDGE_REGISTER_NO_LOCK(func_sid, func)                                                    \
+    {                                                                                              \
+        func_sid, eka2l1::hle::epoc_import_func { eka2l1::hle::bridge(&func), #func,               \
+                      eka2l1::hle::epoc_import_func_flag_no_kernel_lock }                          \
+    }
+
 #define BRIDGE_FUNC(ret, name, ...) ret name(kernel_system *kern, ##__VA_ARGS__)
 
 namespace eka2l1::kernel {
@@ -71,6 +71,10 @@ namespace eka2l1 {
 
         class thread_scheduler;
 
+        namespace smp {
+            class load_balancer;
+        }
+
         enum class thread_state {
             create,
             run,
@@ -135,6 +139,7 @@ namespace eka2l1 {
             friend class eka2l1::gdbstub;
 
             friend class thread_scheduler;
+            friend class smp::load_balancer;
             friend class mutex;
             friend class semaphore;
             friend class process;
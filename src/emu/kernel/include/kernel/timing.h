@@ -27,6 +27,7 @@
 #include <functional>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1 {
@@ -55,6 +56,66 @@ namespace eka2l1 {
         uint64_t event_user_data;
     };
 
+    /**
+     * @brief Queue of timed events, ordered by time then by scheduling order.
+     * 
+     * Events are kept in a binary heap of slots. Each slot remembers its position in the heap, and slots
+     * are indexed by (event type, user data), so an event can be found in constant time and removed
+     * in logarithmic time, without sorting or scanning the queue.
+     */
+    class event_queue {
+        struct slot {
+            event evt_;
+            std::uint64_t sequence_;
+            std::size_t heap_index_;
+        };
+
+        std::vector<slot> slots_;
+        std::vector<std::uint32_t> free_slots_;
+        std::vector<std::uint32_t> heap_; ///< Slot indices, earliest event at the front.
+
+        std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> handles_; ///< Slots of each (type, user data) handle.
+        std::uint64_t sequence_;
+
+        static std::uint64_t make_handle_key(const int event_type, const std::uint64_t userdata);
+
+        bool earlier(const std::uint32_t lhs, const std::uint32_t rhs) const;
+        void swap_heap(const std::size_t lhs, const std::size_t rhs);
+        void sift_up(std::size_t idx);
+        void sift_down(std::size_t idx);
+
+        void remove_slot(const std::uint32_t slot_idx);
+
+    public:
+        explicit event_queue();
+
+        void push(const event &evt);
+
+        /**
+         * @brief   Remove the most recently scheduled event with the given handle.
+         * @returns True if such event was found.
+         */
+        bool remove(const int event_type, const std::uint64_t userdata);
+
+        /**
+         * @brief   Get the earliest event. The queue must not be empty.
+         */
+        const event &top() const;
+
+        /**
+         * @brief   Remove the earliest event. The queue must not be empty.
+         */
+        event pop();
+
+        bool empty() const {
+            return heap_.empty();
+        }
+
+        std::size_t size() const {
+            return heap_.size();
+        }
+    };
+
     namespace common {
         class chunkyseri;
     }
@@ -66,7 +127,7 @@ namespace eka2l1 {
      */
     class ntimer {
     private:
-        std::vector<event> events_;
+        event_queue events_;
         std::mutex lock_;
 
         common::event new_event_evt_;
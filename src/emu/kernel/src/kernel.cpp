@@ -64,14 +64,12 @@ namespace eka2l1 {
         config::state *old_conf, config::app_settings *settings, loader::rom *rom_info, arm::core *cpu, disasm *disassembler)
         : btrace_inst_(nullptr)
         , lib_mngr_(nullptr)
-        , thr_sch_(nullptr)
         , timing_(timing)
         , io_(io_sys)
         , sys_(esys)
         , conf_(old_conf)
         , app_settings_(settings)
         , disassembler_(disassembler)
-        , cpu_(cpu)
         , rom_info_(rom_info)
         , kernel_handles_(this, kernel::handle_array_owner::kernel)
         , realtime_ipc_signal_evt_(0)
@@ -83,7 +81,10 @@ namespace eka2l1 {
         , dll_global_data_chunk_(nullptr)
         , dll_global_data_last_offset_(0)
         , inactivity_starts_(0) {
-        thr_sch_ = std::make_unique<kernel::thread_scheduler>(this, timing_, cpu_);
+        balancer_ = std::make_unique<kernel::smp::load_balancer>(this, timing_);
+        add_core(cpu);
+
+        profiler_ = std::make_unique<common::call_profiler>(conf_->profile_calls);
 
         // Instantiate btrace
         btrace_inst_ = std::make_unique<kernel::btrace>(this, io_);
@@ -108,33 +109,37 @@ namespace eka2l1 {
     }
 
     void kernel_system::reset() {
+        // Nothing must run guest code while objects are being destroyed
+        stop_secondary_cores();
+
         if (rom_map_) {
             common::unmap_file(rom_map_);
         }
 
         rom_map_ = nullptr;
 
-#define OBJECT_CONTAINER_CLEANUP(container)             \
-    for (auto &obj: container) {                        \
-        obj->destroy();                                 \
-    }                                                   \
+#define OBJECT_CONTAINER_CLEANUP(obj_type, container)                    \
+    for (auto &obj: container) {                                          \
+        obj->destroy();                                                   \
+    }                                                                     \
+    name_indexes_[static_cast<std::size_t>(kernel::object_type::obj_type)].clear(); \
     container.clear();
 
         // Delete one by one in order. Do not change the order
-        OBJECT_CONTAINER_CLEANUP(sessions_);
-        OBJECT_CONTAINER_CLEANUP(servers_);
-        OBJECT_CONTAINER_CLEANUP(timers_);
-        OBJECT_CONTAINER_CLEANUP(mutexes_);
-        OBJECT_CONTAINER_CLEANUP(semas_);
-        OBJECT_CONTAINER_CLEANUP(change_notifiers_);
-        OBJECT_CONTAINER_CLEANUP(props_);
-        OBJECT_CONTAINER_CLEANUP(prop_refs_);
-        OBJECT_CONTAINER_CLEANUP(chunks_);
-        OBJECT_CONTAINER_CLEANUP(threads_);
-        OBJECT_CONTAINER_CLEANUP(processes_);
-        OBJECT_CONTAINER_CLEANUP(libraries_);
-        OBJECT_CONTAINER_CLEANUP(codesegs_);
-        OBJECT_CONTAINER_CLEANUP(message_queues_);
+        OBJECT_CONTAINER_CLEANUP(session, sessions_);
+        OBJECT_CONTAINER_CLEANUP(server, servers_);
+        OBJECT_CONTAINER_CLEANUP(timer, timers_);
+        OBJECT_CONTAINER_CLEANUP(mutex, mutexes_);
+        OBJECT_CONTAINER_CLEANUP(sema, semas_);
+        OBJECT_CONTAINER_CLEANUP(change_notifier, change_notifiers_);
+        OBJECT_CONTAINER_CLEANUP(prop, props_);
+        OBJECT_CONTAINER_CLEANUP(prop_ref, prop_refs_);
+        OBJECT_CONTAINER_CLEANUP(chunk, chunks_);
+        OBJECT_CONTAINER_CLEANUP(thread, threads_);
+        OBJECT_CONTAINER_CLEANUP(process, processes_);
+        OBJECT_CONTAINER_CLEANUP(library, libraries_);
+        OBJECT_CONTAINER_CLEANUP(codeseg, codesegs_);
+        OBJECT_CONTAINER_CLEANUP(msg_queue, message_queues_);
 
         btrace_inst_->close_trace_session();
     }
@@ -272,6 +277,27 @@ namespace eka2l1 {
 
     void kernel_system::install_memory(memory_system *new_mem) {
         mem_ = new_mem;
+
+        // Page tables of a core are only changed from its host thread, or while it's out of guest code
+        mem_->get_mmu()->set_cpu_work_dispatcher([this](arm::core *cpu, arm::core_work_func work) {
+            kernel::smp::core *owner = get_core_of_cpu(cpu);
+
+            if (!owner) {
+                work(cpu);
+                return;
+            }
+
+            owner->run_on_cpu(std::move(work), true);
+        });
+
+        if (cores_.size() > 1) {
+            // Each core runs its own process, so memory looked up in the current address space must be
+            // looked up in the one of the core serving the call
+            mem_->get_mmu()->set_addr_space_resolver([this]() -> mem::asid {
+                kernel::process *pr = current_core()->get_scheduler()->current_process();
+                return pr ? pr->get_mem_model()->address_space_id() : -1;
+            });
+        }
     }
     
     // For user-provided EPOC version
@@ -279,23 +305,96 @@ namespace eka2l1 {
         kern_ver_ = ver;
         lib_mngr_ = std::make_unique<hle::lib_manager>(this, io_, mem_);
 
-        // Set CPU SVC handler
-        cpu_->system_call_handler = [this](const std::uint32_t ordinal) {
-            get_lib_manager()->call_svc(ordinal);
+        for (auto &core: cores_) {
+            kernel::smp::core *owner = core.get();
+            arm::core *cpu = core->get_cpu();
+
+            // Set CPU SVC handler
+            cpu->system_call_handler = [this, owner, cpu](const std::uint32_t ordinal) {
+                owner->leave_guest();
+                get_lib_manager()->call_svc(ordinal);
+
+                // EKA1 does not use BX LR to jump back, they let kernel do it
+                if (is_eka1()) {
+                    const std::uint32_t jump_back = cpu->get_lr();
 
-            // EKA1 does not use BX LR to jump back, they let kernel do it
-            if (is_eka1()) {
-                const std::uint32_t jump_back = cpu_->get_lr();
+                    // Set pc and ARM/thumb flag
+                    cpu->set_pc(jump_back & ~0b1);
+                    cpu->set_cpsr(cpu->get_cpsr() | ((jump_back & 0b1) ? 0x20 : 0));
+                }
+
+                owner->enter_guest();
+            };
+
+            cpu->exception_handler = [this, owner, cpu](arm::exception_type exception_type, const std::uint32_t data) {
+                owner->leave_guest();
+                cpu_exception_handler(cpu, exception_type, data);
+                owner->enter_guest();
+            };
+        }
+    }
+
+    void kernel_system::add_core(arm::core *cpu) {
+        cores_.push_back(std::make_unique<kernel::smp::core>(this, timing_, cpu, static_cast<std::uint32_t>(cores_.size())));
+        balancer_->add_core(cores_.back().get());
+    }
+
+    kernel::smp::core *kernel_system::current_core() {
+        kernel::smp::core *driving = kernel::smp::core::current();
+        return driving ? driving : cores_[0].get();
+    }
 
-                // Set pc and ARM/thumb flag
-                cpu_->set_pc(jump_back & ~0b1);
-                cpu_->set_cpsr(cpu_->get_cpsr() | ((jump_back & 0b1) ? 0x20 : 0));
+    kernel::smp::core *kernel_system::get_core_of_cpu(arm::core *cpu) {
+        for (auto &core: cores_) {
+            if (core->get_cpu() == cpu) {
+                return core.get();
             }
-        };
+        }
 
-        cpu_->exception_handler = [this](arm::exception_type exception_type, const std::uint32_t data) {
-            cpu_exception_handler(cpu_, exception_type, data);
-        };
+        return nullptr;
+    }
+
+    kernel::thread_scheduler *kernel_system::get_thread_scheduler() {
+        return current_core()->get_scheduler();
+    }
+
+    kernel::thread_scheduler *kernel_system::pick_thread_scheduler(kernel::process *owner) {
+        if (!owner) {
+            return get_thread_scheduler();
+        }
+
+        return cores_[balancer_->pick_core(owner)]->get_scheduler();
+    }
+
+    void kernel_system::start_secondary_cores() {
+        for (std::size_t i = 1; i < cores_.size(); i++) {
+            cores_[i]->start();
+        }
+    }
+
+    void kernel_system::stop_secondary_cores() {
+        for (std::size_t i = 1; i < cores_.size(); i++) {
+            cores_[i]->stop();
+        }
+    }
+
+    void kernel_system::pause_secondary_cores(const bool should_pause) {
+        for (std::size_t i = 1; i < cores_.size(); i++) {
+            cores_[i]->set_paused(should_pause);
+        }
+    }
+
+    void kernel_system::imb_range(const address addr, const std::uint32_t size) {
+        // JIT caches can only be touched from the thread running them
+        for (auto &core: cores_) {
+            core->run_on_cpu([addr, size](arm::core *cpu) { cpu->imb_range(addr, size); }, false);
+        }
+    }
+
+    void kernel_system::clear_instruction_cache() {
+        for (auto &core: cores_) {
+            core->run_on_cpu([](arm::core *cpu) { cpu->clear_instruction_cache(); }, false);
+        }
     }
 
     eka2l1::ptr<kernel_global_data> kernel_system::get_global_user_data_pointer() {
@@ -316,25 +415,25 @@ namespace eka2l1 {
     }
     
     kernel::thread *kernel_system::crr_thread() {
-        return thr_sch_->current_thread();
+        return get_thread_scheduler()->current_thread();
     }
 
     kernel::process *kernel_system::crr_process() {
-        return thr_sch_->current_process();
+        return get_thread_scheduler()->current_process();
     }
 
     arm::core *kernel_system::get_cpu() {
-        return cpu_;
+        return current_core()->get_cpu();
     }
 
     void kernel_system::reschedule() {
         lock();
-        thr_sch_->reschedule();
+        get_thread_scheduler()->reschedule();
         unlock();
     }
 
     void kernel_system::unschedule_wakeup() {
-        thr_sch_->unschedule_wakeup();
+        get_thread_scheduler()->unschedule_wakeup();
     }
     
     void kernel_system::prepare_reschedule() {
@@ -472,6 +571,7 @@ namespace eka2l1 {
         if (res == obj_map.end())                                                                                \
             return false;                                                                                        \
         (*res)->destroy();                                                                                       \
+        remove_from_name_index(res->get());                                                                      \
         obj_map.erase(res);                                                                                      \
         return true;                                                                                             \
     }
@@ -701,6 +801,7 @@ namespace eka2l1 {
         }
 
         property_ptr prop_ptr = reinterpret_cast<property_ptr>(prop_res->get());
+        remove_from_name_index(prop_ptr);
         props_.erase(prop_res);
 
         return prop_ptr;
@@ -837,8 +938,128 @@ namespace eka2l1 {
         return reinterpret_cast<codeseg_ptr>(res->get());
     }
 
+    void kernel_system::add_to_name_index(kernel_obj_ptr obj) {
+        name_indexes_[static_cast<std::size_t>(obj->get_object_type())].emplace(obj->name(), obj);
+    }
+
+    bool kernel_system::remove_from_name_index(kernel_obj_ptr obj) {
+        const std::size_t type_index = static_cast<std::size_t>(obj->get_object_type());
+
+        if (type_index >= name_indexes_.size()) {
+            return false;
+        }
+
+        auto &index = name_indexes_[type_index];
+        auto range = index.equal_range(obj->name());
+
+        for (auto ite = range.first; ite != range.second; ite++) {
+            if (ite->second == obj) {
+                index.erase(ite);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    kernel_obj_ptr kernel_system::find_by_exact_name(const std::string &name, const kernel::object_type type,
+        const bool use_full_name, const kernel::uid min_uid) {
+        const std::size_t type_index = static_cast<std::size_t>(type);
+
+        if (type_index >= name_indexes_.size()) {
+            return nullptr;
+        }
+
+        auto &index = name_indexes_[type_index];
+        kernel_obj_ptr result = nullptr;
+
+        auto look_for = [&](const std::string &own_name) {
+            auto range = index.equal_range(own_name);
+
+            for (auto ite = range.first; ite != range.second; ite++) {
+                kernel_obj_ptr candidate = ite->second;
+
+                if ((candidate->unique_id() < min_uid) || (result && (result->unique_id() < candidate->unique_id()))) {
+                    continue;
+                }
+
+                if (use_full_name) {
+                    std::string the_full_name;
+                    candidate->full_name(the_full_name);
+
+                    if (the_full_name != name) {
+                        continue;
+                    }
+                }
+
+                result = candidate;
+            }
+        };
+
+        look_for(name);
+
+        if (use_full_name) {
+            // A full name ends with the own name, after the last "::" added by the owners. The own name
+            // may contain "::" itself, so try every one of them.
+            for (std::size_t pos = name.find("::"); pos != std::string::npos; pos = name.find("::", pos + 1)) {
+                look_for(name.substr(pos + 2));
+            }
+        }
+
+        return result;
+    }
+
+    // Characters that have a meaning in the regex built from a find pattern
+    static bool is_find_pattern_literal(const std::string &name) {
+        return name.find_first_of("*?[]()+^$|{}\\") == std::string::npos;
+    }
+
     std::optional<find_handle> kernel_system::find_object(const std::string &name, int start, kernel::object_type type, const bool use_full_name) {
         find_handle handle_find_info;
+
+        if (is_find_pattern_literal(name)) {
+            // No wildcard, the name index can answer
+            switch (type) {
+#define OBJECT_LOOKUP(obj_type, obj_map)                                                                           \
+    case kernel::object_type::obj_type: {                                                                          \
+        if ((start < 1) || (start > static_cast<int>(obj_map.size())))                                            \
+            return std::nullopt;                                                                                   \
+        kernel_obj_ptr obj = find_by_exact_name(name, type, use_full_name, obj_map[start - 1]->unique_id());       \
+        if (!obj)                                                                                                  \
+            return std::nullopt;                                                                                   \
+        auto res = std::lower_bound(obj_map.begin(), obj_map.end(), obj, [&](const auto &lhs, const auto &rhs) { \
+            return lhs->unique_id() < rhs->unique_id();                                                            \
+        });                                                                                                        \
+        handle_find_info.index = static_cast<int>(std::distance(obj_map.begin(), res)) + 1;                       \
+        handle_find_info.object_id = obj->unique_id();                                                             \
+        handle_find_info.obj = obj;                                                                                \
+        return handle_find_info;                                                                                   \
+    }
+
+                OBJECT_LOOKUP(mutex, mutexes_)
+                OBJECT_LOOKUP(sema, semas_)
+                OBJECT_LOOKUP(chunk, chunks_)
+                OBJECT_LOOKUP(thread, threads_)
+                OBJECT_LOOKUP(process, processes_)
+                OBJECT_LOOKUP(change_notifier, change_notifiers_)
+                OBJECT_LOOKUP(library, libraries_)
+                OBJECT_LOOKUP(codeseg, codesegs_)
+                OBJECT_LOOKUP(server, servers_)
+                OBJECT_LOOKUP(prop, props_)
+                OBJECT_LOOKUP(prop_ref, prop_refs_)
+                OBJECT_LOOKUP(session, sessions_)
+                OBJECT_LOOKUP(timer, timers_)
+                OBJECT_LOOKUP(msg_queue, message_queues_)
+
+#undef OBJECT_LOOKUP
+
+            default:
+                break;
+            }
+
+            return std::nullopt;
+        }
+
         std::regex filter(common::wildcard_to_regex_string(name));
 
         // NOTE: See about the starting index of find handle info in the struct's document!
@@ -887,7 +1108,7 @@ namespace eka2l1 {
     }
 
     bool kernel_system::should_terminate() {
-        return thr_sch_->should_terminate();
+        return get_thread_scheduler()->should_terminate();
     }
 
     bool kernel_system::map_rom(const mem::vm_address addr, const std::string &path) {
@@ -917,12 +1138,15 @@ namespace eka2l1 {
 
     void kernel_system::stop_cores_idling() {
         if (should_core_idle_when_inactive()) {
-            thr_sch_->stop_idling();
+            for (auto &core: cores_) {
+                core->get_scheduler()->stop_idling();
+            }
         }
     }
 
     bool kernel_system::should_core_idle_when_inactive() {
-        return conf_->cpu_load_save;
+        // A secondary core has nothing else to do while idle, it must not spin on the kernel lock
+        return conf_->cpu_load_save || (cores_.size() > 1);
     }
 
     void kernel_system::set_current_language(const language new_lang) {
@@ -45,11 +45,28 @@ namespace eka2l1 {
                 return;
             }
 
+            // The kernel indexes objects by name, keep it in sync
+            const bool reindex = (seri.get_seri_mode() == common::SERI_MODE_READ) && kern->remove_from_name_index(this);
+
             seri.absorb(obj_name);
             seri.absorb(uid);
             seri.absorb(obj_type);
             seri.absorb(access);
             seri.absorb(access_count);
+
+            if (reindex) {
+                kern->add_to_name_index(this);
+            }
+        }
+
+        void kernel_obj::rename(const std::string &new_name) {
+            // Objects not created through the kernel are not indexed, and should stay so
+            const bool indexed = kern->remove_from_name_index(this);
+            obj_name = new_name;
+
+            if (indexed) {
+                kern->add_to_name_index(this);
+            }
         }
 
         void kernel_obj::full_name(std::string &name_will_full) {
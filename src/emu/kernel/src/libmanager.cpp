@@ -24,6 +24,7 @@
 #include <common/ini.h>
 #include <common/log.h>
 #include <common/path.h>
+#include <common/profiler.h>
 #include <common/random.h>
 
 #include <kernel/common.h>
@@ -394,7 +395,7 @@ namespace eka2l1::hle {
                 eka2l1::ro_file_stream image_data_stream(e32imgfile.get());
 
                 // Try to load them to ROM section
-                auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream));
+                auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream), true, e32img_cache_.get());
 
                 if (!e32img) {
                     // Ignore.
@@ -628,6 +629,100 @@ namespace eka2l1::hle {
         return cs;
     }
 
+    std::u16string lib_manager::resolve_cache_key(const std::u16string &name) const {
+        std::u16string key = common::lowercase_ucs2_string(name);
+
+        if (!eka2l1::has_root_dir(name)) {
+            // The same name may resolve elsewhere with other search paths
+            for (const std::u16string &search_path : search_paths) {
+                key += u'|';
+                key += common::lowercase_ucs2_string(search_path);
+            }
+        }
+
+        return key;
+    }
+
+    void lib_manager::invalidate_resolve_cache() {
+        resolve_cache_.clear();
+        resolve_dir_watched_.clear();
+
+        // Directories may have been created or removed, so watch again from scratch
+        for (const std::int64_t handle : resolve_watches_) {
+            io_->unwatch_directory(handle);
+        }
+
+        resolve_watches_.clear();
+    }
+
+    std::optional<lib_resolve_result> lib_manager::find_resolved(const std::u16string &key) {
+        if (resolve_cache_stale_.exchange(false)) {
+            invalidate_resolve_cache();
+        }
+
+        auto ite = resolve_cache_.find(key);
+
+        if (ite == resolve_cache_.end()) {
+            return std::nullopt;
+        }
+
+        return ite->second;
+    }
+
+    bool lib_manager::watch_resolve_directory(const std::u16string &lib_path) {
+        if (!eka2l1::has_root_name(lib_path, true)) {
+            return false;
+        }
+
+        std::u16string dir = eka2l1::file_directory(lib_path, true);
+        std::u16string dir_key = common::lowercase_ucs2_string(dir);
+
+        auto ite = resolve_dir_watched_.find(dir_key);
+
+        if (ite != resolve_dir_watched_.end()) {
+            return ite->second;
+        }
+
+        bool covered = false;
+
+        // Nothing changes in ROM while we are running
+        const std::optional<drive> entry = io_->get_drive_entry(char16_to_drive(lib_path[0]));
+
+        if (entry && (entry->media_type == drive_media::rom)) {
+            covered = true;
+        } else {
+            // Watch the closest directory that exists. If the one we want gets created later on,
+            // its parent reports that.
+            while (!dir.empty()) {
+                if (io_->is_directory(dir)) {
+                    const std::int64_t handle = io_->watch_directory(
+                        dir, [this](void *userdata, common::directory_changes &changes) {
+                            resolve_cache_stale_ = true;
+                        },
+                        nullptr, common::directory_change_move | common::directory_change_last_write);
+
+                    if (handle != -1) {
+                        resolve_watches_.push_back(handle);
+                        covered = true;
+                    }
+
+                    break;
+                }
+
+                // Reached the drive root (X:\)
+                if (dir.length() <= 3) {
+                    break;
+                }
+
+                dir.pop_back();
+                dir = eka2l1::file_directory(dir, true);
+            }
+        }
+
+        resolve_dir_watched_.emplace(std::move(dir_key), covered);
+        return covered;
+    }
+
     std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>> lib_manager::try_search_and_parse(const std::u16string &path, std::u16string *full_path) {
         std::u16string lib_path = path;
 
@@ -644,7 +739,7 @@ namespace eka2l1::hle {
 
                 eka2l1::ro_file_stream image_data_stream(f.get());
 
-                auto parse_result = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream));
+                auto parse_result = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream), true, e32img_cache_.get());
                 if (parse_result != std::nullopt) {
                     f->close();
                     result.first = std::move(parse_result);
@@ -667,6 +762,53 @@ namespace eka2l1::hle {
             return std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>>{};
         };
 
+        const std::u16string cache_key = resolve_cache_key(path);
+
+        if (std::optional<lib_resolve_result> resolved = find_resolved(cache_key)) {
+            if (resolved->path_.empty()) {
+                return std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>>{};
+            }
+
+            lib_path = resolved->path_;
+            auto result = open_and_get(lib_path);
+
+            if (result.first != std::nullopt || result.second != std::nullopt) {
+                if (full_path)
+                    *full_path = lib_path;
+
+                return result;
+            }
+
+            // Gone since, search again
+            resolve_cache_.erase(cache_key);
+            lib_path = path;
+        }
+
+        bool cacheable = true;
+        bool found_any = false;
+
+        auto remember = [&](const std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>> &result) {
+            if (!cacheable) {
+                return;
+            }
+
+            lib_resolve_result resolved;
+
+            if (result.first != std::nullopt) {
+                resolved.path_ = lib_path;
+                resolved.kind_ = lib_image_e32;
+            } else if (result.second != std::nullopt) {
+                resolved.path_ = lib_path;
+                resolved.kind_ = lib_image_rom;
+                resolved.rom_entry_point_ = result.second->header.entry_point;
+            } else if (found_any) {
+                // Exists but can't be parsed, don't remember it as missing
+                return;
+            }
+
+            resolve_cache_[cache_key] = std::move(resolved);
+        };
+
         if (!eka2l1::has_root_dir(lib_path)) {
             // Nope ? We need to cycle through all possibilities
             for (std::size_t i = 0; i < search_paths.size(); i++) {
@@ -676,18 +818,29 @@ namespace eka2l1::hle {
                     const char16_t drvc = drive_to_char16(drv);
 
                     if (!only_once) {
+                        if (!io_->get_drive_entry(drv)) {
+                            // Not mounted, nothing to find there. Mounting it drops the cache.
+                            continue;
+                        }
+
                         lib_path = drvc;
                         lib_path += u':';
+                    } else {
+                        lib_path.clear();
                     }
 
                     lib_path += search_paths[i];
                     lib_path += path;
 
+                    cacheable = watch_resolve_directory(lib_path) && cacheable;
+                    found_any = found_any || io_->exist(lib_path);
+
                     auto result = open_and_get(lib_path);
                     if (result.first != std::nullopt || result.second != std::nullopt) {
                         if (full_path)
                             *full_path = lib_path;
 
+                        remember(result);
                         return result;
                     }
 
@@ -697,6 +850,7 @@ namespace eka2l1::hle {
                 }
             }
 
+            remember(std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>>{});
             return std::pair<std::optional<loader::e32img>, std::optional<loader::romimg>>{};
         }
 
@@ -704,40 +858,78 @@ namespace eka2l1::hle {
             *full_path = lib_path;
         }
 
-        return open_and_get(lib_path);
-    }
+        cacheable = watch_resolve_directory(lib_path);
+        found_any = io_->exist(lib_path);
 
-    codeseg_ptr lib_manager::load(const std::u16string &name) {
-        auto load_depend_on_drive = [&](drive_number drv, const std::u16string &lib_path) -> codeseg_ptr {
-            auto entry = io_->get_drive_entry(drv);
+        auto result = open_and_get(lib_path);
+        remember(result);
 
-            if (entry) {
-                symfile f = io_->open_file(lib_path, READ_MODE | BIN_MODE);
-                if (!f) {
-                    return nullptr;
-                }
+        return result;
+    }
 
-                eka2l1::ro_file_stream image_data_stream(f.get());
+    codeseg_ptr lib_manager::load_image(const drive_number drv, const std::u16string &lib_path, lib_resolve_result &result) {
+        auto entry = io_->get_drive_entry(drv);
 
-                if (entry->media_type == drive_media::rom && io_->is_entry_in_rom(lib_path)) {
-                    auto romimg = loader::parse_romimg(reinterpret_cast<common::ro_stream *>(&image_data_stream), mem_, kern_->get_epoc_version());
-                    if (!romimg) {
-                        return nullptr;
-                    }
+        if (!entry) {
+            return nullptr;
+        }
 
-                    return load_as_romimg(*romimg, lib_path);
-                } else {
-                    auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream));
-                    if (!e32img) {
-                        return nullptr;
-                    }
+        symfile f = io_->open_file(lib_path, READ_MODE | BIN_MODE);
+        if (!f) {
+            return nullptr;
+        }
 
-                    return load_as_e32img(*e32img, lib_path);
-                }
+        eka2l1::ro_file_stream image_data_stream(f.get());
+
+        if (entry->media_type == drive_media::rom && io_->is_entry_in_rom(lib_path)) {
+            auto romimg = loader::parse_romimg(reinterpret_cast<common::ro_stream *>(&image_data_stream), mem_, kern_->get_epoc_version());
+            if (!romimg) {
+                return nullptr;
             }
 
+            result.kind_ = lib_image_rom;
+            result.rom_entry_point_ = romimg->header.entry_point;
+
+            return load_as_romimg(*romimg, lib_path);
+        }
+
+        auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream), true, e32img_cache_.get());
+        if (!e32img) {
             return nullptr;
-        };
+        }
+
+        result.kind_ = lib_image_e32;
+        return load_as_e32img(*e32img, lib_path);
+    }
+
+    codeseg_ptr lib_manager::load_resolved(const lib_resolve_result &resolved) {
+        // Already loaded? Then there is no need to touch the file at all
+        codeseg_ptr cs = nullptr;
+
+        if (resolved.kind_ == lib_image_rom) {
+            cs = kern_->pull_codeseg_by_ep(resolved.rom_entry_point_);
+        } else {
+            cs = kern_->get_by_name<kernel::codeseg>(get_e32_codeseg_name_from_path(resolved.path_));
+        }
+
+        if (!cs && io_->exist(resolved.path_)) {
+            lib_resolve_result refreshed;
+            cs = load_image(char16_to_drive(resolved.path_[0]), resolved.path_, refreshed);
+        }
+
+        if (cs) {
+            cs->set_full_path(resolved.path_);
+        }
+
+        return cs;
+    }
+
+    codeseg_ptr lib_manager::search_and_load(const std::u16string &name, const std::u16string &cache_key) {
+        lib_resolve_result result;
+        codeseg_ptr cs = nullptr;
+
+        bool cacheable = true;
+        bool found_any = false;
 
         std::u16string lib_path = name;
 
@@ -745,14 +937,19 @@ namespace eka2l1::hle {
         // Absolute yet ?
         if (!eka2l1::has_root_dir(lib_path)) {
             // Nope ? We need to cycle through all possibilities
-            for (std::size_t i = 0; i < search_paths.size(); i++) {
+            for (std::size_t i = 0; (i < search_paths.size()) && !cs; i++) {
                 lib_path.clear();
                 bool only_once = eka2l1::has_root_name(search_paths[i]);
-               
+
                 for (drive_number drv = drive_z; drv >= drive_a; drv = static_cast<drive_number>(static_cast<int>(drv) - 1)) {
                     const char16_t drvc = drive_to_char16(drv);
 
                     if (!only_once) {
+                        if (!io_->get_drive_entry(drv)) {
+                            // Not mounted, nothing to find there. Mounting it drops the cache.
+                            continue;
+                        }
+
                         lib_path = drvc;
                         lib_path += u':';
                     }
@@ -760,11 +957,14 @@ namespace eka2l1::hle {
                     lib_path += search_paths[i];
                     lib_path += name;
 
+                    cacheable = watch_resolve_directory(lib_path) && cacheable;
+
                     if (io_->exist(lib_path)) {
-                        auto result = load_depend_on_drive(drv, lib_path);
-                        if (result != nullptr) {
-                            result->set_full_path(lib_path);
-                            return result;
+                        found_any = true;
+                        cs = load_image(drv, lib_path, result);
+
+                        if (cs) {
+                            break;
                         }
                     }
 
@@ -772,49 +972,124 @@ namespace eka2l1::hle {
                         break;
                 }
             }
+        } else {
+            cacheable = watch_resolve_directory(lib_path);
 
-            return nullptr;
+            if (io_->exist(lib_path)) {
+                found_any = true;
+                cs = load_image(char16_to_drive(lib_path[0]), lib_path, result);
+            }
         }
 
-        drive_number drv = char16_to_drive(lib_path[0]);
-        if (!io_->exist(lib_path)) {
-            return nullptr;
+        if (cs) {
+            cs->set_full_path(lib_path);
+            result.path_ = lib_path;
         }
 
-        // Add the codeseg that trying to be loaded path to search path, for dependencies search.
-        search_paths.push_back(eka2l1::file_directory(lib_path, true));
+        // A file that exists but fails to load is not remembered, it may be fine next time
+        if (cacheable && (cs || !found_any)) {
+            resolve_cache_[cache_key] = std::move(result);
+        }
 
-        if (auto cs = load_depend_on_drive(drv, lib_path)) {
-            cs->set_full_path(lib_path);
+        return cs;
+    }
+
+    codeseg_ptr lib_manager::load(const std::u16string &name) {
+        const std::u16string cache_key = resolve_cache_key(name);
+        const bool absolute = eka2l1::has_root_dir(name);
+
+        if (absolute) {
+            // Add the codeseg that trying to be loaded path to search path, for dependencies search.
+            search_paths.push_back(eka2l1::file_directory(name, true));
+        }
+
+        codeseg_ptr cs = nullptr;
+
+        if (std::optional<lib_resolve_result> resolved = find_resolved(cache_key)) {
+            if (!resolved->path_.empty()) {
+                cs = load_resolved(resolved.value());
+
+                if (!cs) {
+                    // Changed under our feet, do it the long way
+                    resolve_cache_.erase(cache_key);
+                    cs = search_and_load(name, cache_key);
+                }
+            }
+        } else {
+            cs = search_and_load(name, cache_key);
+        }
+
+        if (absolute) {
             search_paths.pop_back();
-            return cs;
         }
 
-        search_paths.pop_back();
-        return nullptr;
+        return cs;
+    }
+
+    void lib_manager::build_svc_table() {
+        for (auto &bank : svc_table_) {
+            bank.clear();
+        }
+
+        for (const auto &[svcnum, func] : svc_funcs_) {
+            if (svcnum > 0xFFFFFF) {
+                LOG_ERROR("System call ordinal 0x{:X} is out of dispatch table range!", svcnum);
+                continue;
+            }
+
+            auto &bank = svc_table_[(svcnum >> 16) & 0xFF];
+            const std::uint16_t index = static_cast<std::uint16_t>(svcnum & 0xFFFF);
+
+            if (bank.size() <= index) {
+                bank.resize(index + 1, nullptr);
+            }
+
+            bank[index] = &func;
+        }
+    }
+
+    const epoc_import_func *lib_manager::lookup_svc(const sid svcnum) const {
+        if (svcnum > 0xFFFFFF) {
+            return nullptr;
+        }
+
+        const auto &bank = svc_table_[(svcnum >> 16) & 0xFF];
+        const std::uint16_t index = static_cast<std::uint16_t>(svcnum & 0xFFFF);
+
+        if (index >= bank.size()) {
+            return nullptr;
+        }
+
+        return bank[index];
     }
 
     bool lib_manager::call_svc(sid svcnum) {
-        // Lock the kernel so SVC call can operate in safety
-        kern_->lock();
-        auto res = svc_funcs_.find(svcnum);
+        const epoc_import_func *func = lookup_svc(svcnum);
 
-        if (res == svc_funcs_.end()) {
+        if (!func) {
             LOG_ERROR("Unimplement system call: 0x{:X}!", svcnum);
-
-            kern_->unlock();
             return false;
         }
 
-        epoc_import_func func = res->second;
-
         if (kern_->get_config()->log_svc) {
-            LOG_TRACE("Calling SVC 0x{:x} {}", svcnum, func.name);
+            LOG_TRACE("Calling SVC 0x{:x} {}", svcnum, func->name);
         }
 
-        func.func(kern_, kern_->crr_process(), kern_->get_cpu());
+        static const std::string NO_GROUP;
+        common::call_profile_scope profile_scope(kern_->get_call_profiler(), common::call_profile_category_svc, 0, svcnum,
+            NO_GROUP, func->name);
+
+        if (func->flags & epoc_import_func_flag_no_kernel_lock) {
+            // Only touches the calling thread's own state, no need to serialize with other cores
+            func->func(kern_, kern_->crr_process(), kern_->get_cpu());
+            return true;
+        }
 
+        // Lock the kernel so SVC call can operate in safety
+        kern_->lock();
+        func->func(kern_, kern_->crr_process(), kern_->get_cpu());
         kern_->unlock();
+
         return true;
     }
 
@@ -956,7 +1231,10 @@ namespace eka2l1::hle {
         , bootstrap_chunk_(nullptr)
         , entry_points_call_routine_(nullptr)
         , thread_entry_routine_(nullptr)
-        , rom_drv_(drive_invalid) { 
+        , rom_drv_(drive_invalid)
+        , resolve_drive_notify_(0)
+        , resolve_entry_notify_(0)
+        , resolve_cache_stale_(false) { 
         hle::symbols sb;
         std::string lib_name;
 
@@ -998,6 +1276,8 @@ namespace eka2l1::hle {
             break;
         }
 
+        build_svc_table();
+
         if (kern_->is_eka1()) {
             search_paths.push_back(u"\\System\\Libs\\");
             search_paths.push_back(u"\\System\\Programs\\");
@@ -1005,9 +1285,34 @@ namespace eka2l1::hle {
         } else {
             search_paths.push_back(u"\\Sys\\Bin\\");
         }
+
+        if (config::state *conf = kern_->get_config()) {
+            e32img_cache_ = std::make_unique<loader::e32img_cache>(eka2l1::add_path(conf->storage, "cache/e32img/"));
+        }
+
+        resolve_drive_notify_ = io_->register_drive_change_notify([this](void *userdata, drive_number drv, drive_action act) {
+            resolve_cache_stale_ = true;
+        }, nullptr);
+
+        // Host watches report changes some time later, so a library created through the IO system and
+        // loaded right away would still be remembered as missing
+        resolve_entry_notify_ = io_->register_entry_change_notify([this](void *userdata, const std::u16string &path) {
+            resolve_cache_stale_ = true;
+        }, nullptr);
     }
     
     lib_manager::~lib_manager() {
+        io_->unregister_drive_change_notify(resolve_drive_notify_);
+        io_->unregister_entry_change_notify(resolve_entry_notify_);
+
+        for (const std::int64_t handle : resolve_watches_) {
+            io_->unwatch_directory(handle);
+        }
+
+        for (auto &bank : svc_table_) {
+            bank.clear();
+        }
+
         svc_funcs_.clear();
     }
 
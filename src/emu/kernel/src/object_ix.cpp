@@ -77,39 +77,78 @@ namespace eka2l1::kernel {
             handle |= (1 << 29);
         }
 
-        handles.push_back(handle);
         return handle;
     }
 
-    std::uint32_t object_ix::add_object(kernel_obj_ptr obj) {
-        auto slot = std::find_if(objects.begin(), objects.end(), [](const object_ix_record &record) {
-            return record.free;
-        });
+    void object_ix::link_unclaimed(size_t index) {
+        object_ix_record *record = objects.get(index);
+
+        record->prev_unclaimed = unclaimed_tail;
+        record->next_unclaimed = common::INVALID_SLAB_SLOT;
+        record->unclaimed = true;
+
+        if (unclaimed_tail != common::INVALID_SLAB_SLOT) {
+            objects.get(unclaimed_tail)->next_unclaimed = index;
+        } else {
+            unclaimed_head = index;
+        }
+
+        unclaimed_tail = index;
+    }
 
-        if (slot != objects.end()) {
-            next_instance = (next_instance + 1) & HANDLE_NEXT_INSTANCE_MASK;
-            std::uint32_t ret_handle = make_handle(slot - objects.begin());
+    void object_ix::unlink_unclaimed(size_t index) {
+        object_ix_record *record = objects.get(index);
 
-            slot->associated_handle = ret_handle;
-            slot->free = false;
-            slot->object = obj;
+        if (!record || !record->unclaimed) {
+            return;
+        }
 
-            obj->increase_access_count();
+        if (record->prev_unclaimed != common::INVALID_SLAB_SLOT) {
+            objects.get(record->prev_unclaimed)->next_unclaimed = record->next_unclaimed;
+        } else {
+            unclaimed_head = record->next_unclaimed;
+        }
 
-            totals++;
-            return ret_handle;
+        if (record->next_unclaimed != common::INVALID_SLAB_SLOT) {
+            objects.get(record->next_unclaimed)->prev_unclaimed = record->prev_unclaimed;
+        } else {
+            unclaimed_tail = record->prev_unclaimed;
         }
 
-        return INVALID_HANDLE;
+        record->prev_unclaimed = common::INVALID_SLAB_SLOT;
+        record->next_unclaimed = common::INVALID_SLAB_SLOT;
+        record->unclaimed = false;
+    }
+
+    std::uint32_t object_ix::add_object(kernel_obj_ptr obj) {
+        object_ix_record new_record;
+        new_record.object = obj;
+
+        const std::size_t slot = objects.add(new_record);
+
+        if (slot == common::INVALID_SLAB_SLOT) {
+            return INVALID_HANDLE;
+        }
+
+        next_instance = (next_instance + 1) & HANDLE_NEXT_INSTANCE_MASK;
+        std::uint32_t ret_handle = make_handle(slot);
+
+        objects.get(slot)->associated_handle = ret_handle;
+        link_unclaimed(slot);
+
+        obj->increase_access_count();
+
+        totals++;
+        return ret_handle;
     }
 
     std::uint32_t object_ix::last_handle() {
-        if (!handles.size()) {
+        if (unclaimed_tail == common::INVALID_SLAB_SLOT) {
             return 0;
         }
 
-        std::uint32_t last = handles.back();
-        handles.pop_back();
+        std::uint32_t last = objects.get(unclaimed_tail)->associated_handle;
+        unlink_unclaimed(unclaimed_tail);
 
         return last;
     }
@@ -133,12 +172,14 @@ namespace eka2l1::kernel {
     kernel_obj_ptr object_ix::get_object(std::uint32_t handle) {
         handle_inspect_info info = inspect_handle(handle);
 
-        if (info.object_ix_index < objects.size()) {
-            if (objects[info.object_ix_index].free) {
+        if (info.object_ix_index < objects.capacity()) {
+            object_ix_record *record = objects.get(info.object_ix_index);
+
+            if (!record) {
                 return nullptr;
             }
 
-            return objects[info.object_ix_index].object;
+            return record->object;
         }
 
         LOG_WARN("Can't find object with handle: 0x{:x}", handle);
@@ -150,80 +191,87 @@ namespace eka2l1::kernel {
         handle_inspect_info info = inspect_handle(handle);
         int ret_value = 0;
 
-        if (info.object_ix_index < objects.size()) {
-            kernel_obj_ptr obj = objects[info.object_ix_index].object;
-
-            if (!obj) {
-                LOG_TRACE("WASDDS");
-                return -1;
-            }
-
-            obj->decrease_access_count();
-            totals--;
+        object_ix_record *record = objects.get(info.object_ix_index);
 
-            if (obj->get_access_count() <= 0 && obj->get_object_type() != object_type::process && obj->get_object_type() != object_type::thread) {
-                if (obj->get_object_type() == object_type::chunk) {
-                    chunk_ptr c = reinterpret_cast<kernel::chunk *>(obj);
+        if (!record || !record->object) {
+            LOG_TRACE("WASDDS");
+            return -1;
+        }
 
-                    // This is a force hack signaling the closing one is chunk heap, which means the
-                    // thread is in destruction, and detach needed
-                    if (c->is_chunk_heap()) {
-                        ret_value = 1;
-                    }
-                }
+        kernel_obj_ptr obj = record->object;
 
-                kern->destroy(obj);
-            }
+        obj->decrease_access_count();
+        totals--;
 
-            objects[info.object_ix_index].free = true;
-            objects[info.object_ix_index].object = nullptr;
+        if (obj->get_access_count() <= 0 && obj->get_object_type() != object_type::process && obj->get_object_type() != object_type::thread) {
+            if (obj->get_object_type() == object_type::chunk) {
+                chunk_ptr c = reinterpret_cast<kernel::chunk *>(obj);
 
-            // Find the handle in unclosed handle list
-            auto iterator = std::find(handles.begin(), handles.end(), handle);
-            if (iterator != handles.end()) {
-                handles.erase(iterator);
+                // This is a force hack signaling the closing one is chunk heap, which means the
+                // thread is in destruction, and detach needed
+                if (c->is_chunk_heap()) {
+                    ret_value = 1;
+                }
             }
 
-            return ret_value;
+            kern->destroy(obj);
         }
 
-        LOG_TRACE("WASDDS");
-        return -1;
+        // Destroying may have touched the table, so go through the index again
+        unlink_unclaimed(info.object_ix_index);
+        objects.remove(info.object_ix_index);
+
+        return ret_value;
     }
 
     void object_ix::reset() {
-        for (auto &index: objects) {
-            if (index.free == false) {
-                index.object->decrease_access_count();
-                index.free = true;
-            }
-        }
+        objects.for_each([](const std::size_t index, object_ix_record &record) {
+            record.object->decrease_access_count();
+        });
+
+        objects.clear();
+
+        unclaimed_head = common::INVALID_SLAB_SLOT;
+        unclaimed_tail = common::INVALID_SLAB_SLOT;
     }
     
     bool object_ix::has(kernel_obj_ptr obj) {
-        for (const auto &index: objects) {
-            if ((index.object == obj) && (index.free == false)) {
-                return true;
-            }
-        }
+        bool found = false;
+
+        objects.for_each([&](const std::size_t index, object_ix_record &record) {
+            found = found || (record.object == obj);
+        });
 
-        return false;
+        return found;
     }
 
     std::uint32_t object_ix::count(kernel_obj_ptr obj) {
         std::uint32_t so_far = 0;
 
-        for (const auto &index: objects) {
-            if ((index.free == false) && (index.object == obj)) {
+        objects.for_each([&](const std::size_t index, object_ix_record &record) {
+            if (record.object == obj) {
                 so_far++;
             }
-        }
+        });
 
         return so_far;
     }
 
+    object_ix::object_ix()
+        : objects(HANDLE_INDEX_MASK + 1)
+        , unclaimed_head(common::INVALID_SLAB_SLOT)
+        , unclaimed_tail(common::INVALID_SLAB_SLOT)
+        , kern(nullptr)
+        , owner(handle_array_owner::process)
+        , next_instance(0)
+        , uid(0)
+        , totals(0) {}
+
     object_ix::object_ix(kernel_system *kern, handle_array_owner owner)
-        : kern(kern)
+        : objects(HANDLE_INDEX_MASK + 1)
+        , unclaimed_head(common::INVALID_SLAB_SLOT)
+        , unclaimed_tail(common::INVALID_SLAB_SLOT)
+        , kern(kern)
         , owner(owner)
         , next_instance(0)
         , uid(kern->next_uid())
@@ -244,12 +292,12 @@ namespace eka2l1::kernel {
         std::uint32_t slot_count = 0;
 
         if (seri.get_seri_mode() == common::SERI_MODE_WRITE) {
-            for (std::size_t i = 0; i < objects.size(); i++) {
-                if (!objects[i].free) {
-                    slot_count++;
-                    slot_used.push(static_cast<std::uint16_t>(i));
-                }
-            }
+            objects.for_each([&](const std::size_t index, object_ix_record &record) {
+                slot_count++;
+                slot_used.push(static_cast<std::uint16_t>(index));
+            });
+        } else {
+            objects.clear();
         }
 
         seri.absorb(slot_count);
@@ -258,26 +306,50 @@ namespace eka2l1::kernel {
 
         for (std::uint32_t i = 0; i < slot_count; i++) {
             std::uint64_t obj_id = 0;
+            object_ix_record record;
 
             if (seri.get_seri_mode() == common::SERI_MODE_WRITE) {
                 next_slot_use = slot_used.top();
                 slot_used.pop();
 
-                obj_id = objects[next_slot_use].object->unique_id();
+                record = *objects.get(next_slot_use);
+                obj_id = record.object->unique_id();
             }
 
             seri.absorb(next_slot_use);
             seri.absorb(obj_id);
-            seri.absorb(objects[next_slot_use].associated_handle);
+            seri.absorb(record.associated_handle);
 
             if (seri.get_seri_mode() == common::SERI_MODE_READ) {
                 // TODO
-                //objects[next_slot_use].object = kern->get_kernel_obj_raw(obj_id);
-                objects[next_slot_use].free = false;
+                //record.object = kern->get_kernel_obj_raw(obj_id);
+                objects.add_at(next_slot_use, record);
             }
         }
 
         // Hey, we need to save last thread handle too
+        std::vector<std::uint32_t> handles;
+
+        if (seri.get_seri_mode() == common::SERI_MODE_WRITE) {
+            for (std::size_t index = unclaimed_head; index != common::INVALID_SLAB_SLOT; index = objects.get(index)->next_unclaimed) {
+                handles.push_back(objects.get(index)->associated_handle);
+            }
+        }
+
         seri.absorb_container(handles);
+
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            unclaimed_head = common::INVALID_SLAB_SLOT;
+            unclaimed_tail = common::INVALID_SLAB_SLOT;
+
+            for (const std::uint32_t handle: handles) {
+                const std::size_t index = handle & HANDLE_INDEX_MASK;
+                object_ix_record *record = objects.get(index);
+
+                if (record && !record->unclaimed && (record->associated_handle == handle)) {
+                    link_unclaimed(index);
+                }
+            }
+        }
     }
 }
\ No newline at end of file
@@ -136,6 +136,10 @@ namespace eka2l1::kernel {
         , parent_process_(nullptr)
         , time_delay_(0) 
         , setting_inheritence_(true)
+        , core_index_(0)
+        , core_assigned_(false)
+        , load_(0)
+        , run_ticks_(0)
         , uid_change_callbacks(is_process_uid_type_change_callback_elem_free, make_process_uid_type_change_callback_elem_free) {
         obj_type = kernel::object_type::process;
 
@@ -209,7 +213,7 @@ namespace eka2l1::kernel {
     }
 
     bool process::run() {
-        return kern->get_thread_scheduler()->schedule(&(*primary_thread));
+        return primary_thread->get_scheduler()->schedule(&(*primary_thread));
     }
 
     std::uint32_t process::get_entry_point_address() {
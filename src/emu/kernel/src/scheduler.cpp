@@ -94,10 +94,15 @@ namespace eka2l1::kernel {
                 kern->call_process_switch_callbacks(run_core, crr_process, newt->owning_process());
                 crr_process = newt->owning_process();
 
+                const mem::asid new_addr_space = crr_process->get_mem_model()->address_space_id();
+
                 memory_system *mem = kern->get_memory_system();
-                mem->get_mmu()->set_current_addr_space(crr_process->get_mem_model()->address_space_id());
+                mem->get_mmu()->set_current_addr_space(new_addr_space);
 
-                crr_process->get_mem_model()->remap_to_cpu();
+                // If the core keeps a page table per address space, our memory is already there
+                if (!run_core->set_address_space(new_addr_space)) {
+                    crr_process->get_mem_model()->remap_to_cpu();
+                }
             }
 
             run_core->load_context(crr_thread->ctx);
@@ -146,6 +151,11 @@ namespace eka2l1::kernel {
 #pragma optimize("", on)
 #endif
 
+    void thread_scheduler::prepare_reschedule() {
+        // The thread may belong to another core, only stop the one we schedule for
+        run_core->stop();
+    }
+
     void thread_scheduler::reschedule() {
         kernel::thread *crr_thread = current_thread();
         kernel::thread *next_thread = next_ready_thread();
@@ -286,7 +296,7 @@ namespace eka2l1::kernel {
         }
 
         dequeue_thread_from_ready(thr);
-        kern->prepare_reschedule();
+        prepare_reschedule();
 
         return true;
     }
@@ -311,7 +321,7 @@ namespace eka2l1::kernel {
         
         queue_thread_ready(thr);
         
-        kern->prepare_reschedule();
+        prepare_reschedule();
 
         return true;
     }
@@ -348,7 +358,29 @@ namespace eka2l1::kernel {
         }
 
         if (crr_thread == thr) {
-            kern->prepare_reschedule();
+            prepare_reschedule();
+        }
+
+        return true;
+    }
+
+    bool thread_scheduler::migrate(kernel::thread *thr, thread_scheduler *target) {
+        if ((thr->scheduler != this) || (thr == crr_thread) || (thr->state == thread_state::run)) {
+            // The core may still save context to it, wait for it to be switched out
+            return false;
+        }
+
+        const bool queued = (thr->scheduler_link.next != nullptr);
+
+        if (queued) {
+            dequeue_thread_from_ready(thr);
+        }
+
+        thr->scheduler = target;
+
+        if (queued) {
+            target->queue_thread_ready(thr);
+            target->prepare_reschedule();
         }
 
         return true;
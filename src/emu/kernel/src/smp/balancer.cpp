@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/kernel.h>
+#include <kernel/process.h>
+#include <kernel/smp/balancer.h>
+#include <kernel/smp/core.h>
+#include <kernel/thread.h>
+#include <kernel/timing.h>
+
+#include <common/linked.h>
+
+#include <algorithm>
+
+namespace eka2l1::kernel::smp {
+    // Period between two rebalances, in microseconds.
+    static constexpr std::int64_t REBALANCE_PERIOD_US = 20000;
+
+    // A process running more than 90% of the time is heavy, and gets a core for itself if possible.
+    static constexpr std::uint32_t HEAVY_LOAD_UNIT = (cpu_availability::idle_unit * 9) / 10;
+
+    load_balancer::load_balancer(kernel_system *kern, ntimer *timing)
+        : kern_(kern)
+        , timing_(timing)
+        , rebalance_evt_(-1)
+        , last_rebalance_ticks_(0) {
+        rebalance_evt_ = timing_->register_event("SMPLoadRebalance", [this](std::uint64_t userdata, int cycles_late) {
+            kern_->lock();
+            rebalance();
+            kern_->unlock();
+
+            timing_->schedule_event(REBALANCE_PERIOD_US, rebalance_evt_, 0);
+        });
+    }
+
+    load_balancer::~load_balancer() {
+        timing_->unschedule_event(rebalance_evt_, 0);
+    }
+
+    void load_balancer::add_core(core *new_core) {
+        cores_.push_back(new_core);
+
+        if (cores_.size() == 2) {
+            // Only now there is something to balance
+            last_rebalance_ticks_ = timing_->ticks();
+            timing_->schedule_event(REBALANCE_PERIOD_US, rebalance_evt_, 0);
+        }
+    }
+
+    std::uint32_t load_balancer::calculate_load(std::uint64_t run_ticks, std::uint64_t total_ticks) {
+        if (total_ticks == 0) {
+            return 0;
+        }
+
+        run_ticks = std::min(run_ticks, total_ticks);
+
+        // Clamp both down to 2^20, so the multiplication below can't overflow
+        while (total_ticks >= (1ULL << 20)) {
+            total_ticks >>= 1;
+            run_ticks >>= 1;
+        }
+
+        // Round to nearest, a process that barely ran should not be seen as idle
+        return static_cast<std::uint32_t>((run_ticks * cpu_availability::idle_unit + (total_ticks >> 1)) / total_ticks);
+    }
+
+    cpu_availability load_balancer::current_availability(const kernel::process *exclude) {
+        cpu_availability avail(static_cast<std::uint32_t>(cores_.size()));
+
+        for (auto &obj: kern_->get_process_list()) {
+            kernel::process *pr = reinterpret_cast<kernel::process *>(obj.get());
+
+            if ((pr == exclude) || !pr->core_assigned_ || (pr->thread_count == 0)) {
+                continue;
+            }
+
+            // Count idle processes as a bit of load, so new processes are spread even before loads are known
+            avail.add_load(pr->core_index_, std::max<std::uint32_t>(pr->load_, 1));
+        }
+
+        return avail;
+    }
+
+    std::uint32_t load_balancer::pick_core(kernel::process *pr) {
+        if (pr->core_assigned_) {
+            return pr->core_index_;
+        }
+
+        pr->core_index_ = (cores_.size() <= 1) ? 0 : current_availability(pr).find_lowest_load();
+        pr->core_assigned_ = true;
+
+        return pr->core_index_;
+    }
+
+    static bool is_heavy(const kernel::process *pr) {
+        return pr->get_load() >= HEAVY_LOAD_UNIT;
+    }
+
+    bool load_balancer::move_process(kernel::process *pr, const std::uint32_t target) {
+        if (pr->core_index_ == target) {
+            return true;
+        }
+
+        common::roundabout &threads = pr->get_thread_list();
+
+        // A process never spans two cores, so either all threads move or none does
+        for (common::double_linked_queue_element *elem = threads.first(); elem && (elem != threads.end()); elem = elem->next) {
+            kernel::thread *thr = E_LOFF(elem, kernel::thread, process_thread_link);
+
+            if (thr == thr->scheduler->current_thread()) {
+                return false;
+            }
+        }
+
+        subscheduler *target_sched = cores_[target]->get_scheduler();
+
+        for (common::double_linked_queue_element *elem = threads.first(); elem && (elem != threads.end()); elem = elem->next) {
+            kernel::thread *thr = E_LOFF(elem, kernel::thread, process_thread_link);
+            thr->scheduler->migrate(thr, target_sched);
+        }
+
+        pr->core_index_ = target;
+        return true;
+    }
+
+    void load_balancer::rebalance() {
+        const std::uint64_t now = timing_->ticks();
+        const std::uint64_t delta = now - last_rebalance_ticks_;
+
+        last_rebalance_ticks_ = now;
+
+        std::vector<kernel::process *> actives;
+
+        for (auto &obj: kern_->get_process_list()) {
+            kernel::process *pr = reinterpret_cast<kernel::process *>(obj.get());
+            pr->load_ = calculate_load(pr->run_ticks_.exchange(0), delta);
+
+            if (pr->core_assigned_ && (pr->thread_count != 0)) {
+                actives.push_back(pr);
+            }
+        }
+
+        if (cores_.size() <= 1) {
+            return;
+        }
+
+        // Non-heavy processes go first, from the largest load to the smallest. Heavy ones are placed last,
+        // once the load of everything else is known.
+        std::stable_sort(actives.begin(), actives.end(), [](const kernel::process *lhs, const kernel::process *rhs) {
+            if (is_heavy(lhs) != is_heavy(rhs)) {
+                return !is_heavy(lhs);
+            }
+
+            return lhs->get_load() > rhs->get_load();
+        });
+
+        std::size_t heavy_left = std::count_if(actives.begin(), actives.end(), is_heavy);
+        cpu_availability avail(static_cast<std::uint32_t>(cores_.size()));
+
+        for (kernel::process *pr: actives) {
+            if (pr->load_ == 0) {
+                // It has not run since the last balance, moving it is not worth it
+                continue;
+            }
+
+            std::uint32_t target = avail.find_lowest_load();
+
+            // Avoid moving back and forth between cores equally loaded
+            if (avail.remains[pr->core_index_] >= avail.remains[target]) {
+                target = pr->core_index_;
+            }
+
+            if (!move_process(pr, target)) {
+                target = pr->core_index_;
+            }
+
+            if (is_heavy(pr)) {
+                // If there are no more heavy processes than cores, give each of them a core. Else they have to share.
+                if (heavy_left <= cores_.size()) {
+                    avail.set_load_max(target);
+                } else {
+                    avail.add_load(target, pr->load_);
+                }
+
+                heavy_left--;
+            } else {
+                avail.add_load(target, pr->load_);
+            }
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/kernel.h>
+#include <kernel/smp/core.h>
+#include <kernel/thread.h>
+
+#include <common/thread.h>
+#include <cpu/arm_interface.h>
+
+#include <chrono>
+#include <string>
+
+namespace eka2l1::kernel::smp {
+    static thread_local core *host_thread_core = nullptr;
+
+    core::core(kernel_system *kern, ntimer *timing, arm::core *cpu, const std::uint32_t index)
+        : kern_(kern)
+        , cpu_(cpu)
+        , index_(index)
+        , should_stop_(false)
+        , paused_(false)
+        , in_guest_(false)
+        , work_queued_(0)
+        , work_done_(0) {
+        sched_ = std::make_unique<subscheduler>(kern, timing, cpu);
+    }
+
+    core::~core() {
+        stop();
+    }
+
+    core *core::current() {
+        return host_thread_core;
+    }
+
+    bool core::run_current_thread(const bool single_step) {
+        kern_->lock();
+
+        kernel::thread *thr = sched_->current_thread();
+        const std::uint32_t ticks = thr ? thr->get_remaining_screenticks() : 0;
+
+        kern_->unlock();
+
+        if (!thr) {
+            return false;
+        }
+
+        enter_guest();
+
+        if (single_step) {
+            cpu_->step();
+        } else {
+            cpu_->run(ticks);
+        }
+
+        leave_guest();
+
+        const std::uint32_t executed = single_step ? 1 : cpu_->get_num_instruction_executed();
+
+        // Another core may have killed the thread while it was running. Thread objects are only freed
+        // with the kernel, but their state must be checked under the lock.
+        kern_->lock();
+
+        if ((sched_->current_thread() == thr) && (thr->current_state() != kernel::thread_state::stop)) {
+            thr->add_ticks(executed);
+        }
+
+        kern_->unlock();
+        return true;
+    }
+
+    void core::run_slice() {
+        run_current_thread();
+        kern_->reschedule();
+    }
+
+    void core::do_pending_work() {
+        for (arm::core_work_func &work: pending_work_) {
+            work(cpu_);
+        }
+
+        pending_work_.clear();
+        work_done_ = work_queued_;
+
+        work_cond_.notify_all();
+    }
+
+    void core::enter_guest() {
+        const std::lock_guard<std::mutex> guard(work_lock_);
+
+        driver_id_ = std::this_thread::get_id();
+        do_pending_work();
+
+        in_guest_ = true;
+    }
+
+    void core::leave_guest() {
+        const std::lock_guard<std::mutex> guard(work_lock_);
+
+        in_guest_ = false;
+        do_pending_work();
+    }
+
+    void core::run_on_cpu(arm::core_work_func work, const bool wait) {
+        std::unique_lock<std::mutex> guard(work_lock_);
+
+        if (std::this_thread::get_id() == driver_id_) {
+            work(cpu_);
+            return;
+        }
+
+        if (wait && !in_guest_) {
+            // The driving thread is outside guest code, and can't get back to it without the lock
+            work(cpu_);
+            return;
+        }
+
+        pending_work_.push_back(std::move(work));
+        const std::uint64_t ticket = ++work_queued_;
+
+        if (!wait) {
+            // Get the driving thread out of guest code soon, so the work is done without much delay
+            if (in_guest_) {
+                cpu_->stop();
+            }
+
+            return;
+        }
+
+        // The CPU may have not started running yet when halted, so keep halting it until it's out
+        do {
+            cpu_->stop();
+        } while (!work_cond_.wait_for(guard, std::chrono::milliseconds(1), [&]() { return work_done_ >= ticket; }));
+    }
+
+    void core::host_loop() {
+        host_thread_core = this;
+
+        const std::string thread_name = "Core " + std::to_string(index_);
+        common::set_thread_name(thread_name.c_str());
+
+        while (!should_stop_) {
+            {
+                std::unique_lock<std::mutex> guard(pause_lock_);
+                pause_cond_.wait(guard, [this]() { return !paused_ || should_stop_; });
+            }
+
+            if (should_stop_) {
+                break;
+            }
+
+            run_slice();
+        }
+
+        host_thread_core = nullptr;
+    }
+
+    void core::start() {
+        if (host_thread_) {
+            return;
+        }
+
+        should_stop_ = false;
+        host_thread_ = std::make_unique<std::thread>([this]() { host_loop(); });
+    }
+
+    void core::stop() {
+        if (!host_thread_) {
+            return;
+        }
+
+        should_stop_ = true;
+
+        // Wake it up from wherever it's waiting
+        cpu_->stop();
+        sched_->stop_idling();
+
+        {
+            const std::lock_guard<std::mutex> guard(pause_lock_);
+            pause_cond_.notify_all();
+        }
+
+        host_thread_->join();
+        host_thread_.reset();
+    }
+
+    void core::set_paused(const bool should_pause) {
+        const std::lock_guard<std::mutex> guard(pause_lock_);
+        paused_ = should_pause;
+
+        if (should_pause) {
+            // Return to the loop as soon as possible
+            cpu_->stop();
+        } else {
+            pause_cond_.notify_all();
+        }
+    }
+}
@@ -1205,7 +1205,7 @@ namespace eka2l1::epoc {
             }
         }
 
-        kern->get_cpu()->imb_range(addr.ptr_address(), size);
+        kern->imb_range(addr.ptr_address(), size);
     }
 
     /********************/
@@ -1841,7 +1841,7 @@ namespace eka2l1::epoc {
 
         switch (thr->current_state()) {
         case kernel::thread_state::create: {
-            kern->get_thread_scheduler()->schedule(&(*thr));
+            thr->get_scheduler()->schedule(&(*thr));
             break;
         }
 
@@ -3828,18 +3828,18 @@ namespace eka2l1::epoc {
     const eka2l1::hle::func_map svc_register_funcs_v10 = {
         /* FAST EXECUTIVE CALL */
         BRIDGE_REGISTER(0x00800000, wait_for_any_request),
-        BRIDGE_REGISTER(0x00800001, heap),
-        BRIDGE_REGISTER(0x00800002, heap_switch),
-        BRIDGE_REGISTER(0x00800005, active_scheduler),
-        BRIDGE_REGISTER(0x00800006, set_active_scheduler),
-        BRIDGE_REGISTER(0x00800008, trap_handler),
-        BRIDGE_REGISTER(0x00800009, set_trap_handler),
-        BRIDGE_REGISTER(0x0080000A, debug_mask),
-        BRIDGE_REGISTER(0x0080000B, debug_mask_index),
-        BRIDGE_REGISTER(0x00800011, user_svr_rom_header_address),
-        BRIDGE_REGISTER(0x00800012, user_svr_rom_root_dir_address),
-        BRIDGE_REGISTER(0x00800015, utc_offset),
-        BRIDGE_REGISTER(0x00800016, get_global_userdata),
+        BRIDGE_REGISTER_NO_LOCK(0x00800001, heap),
+        BRIDGE_REGISTER_NO_LOCK(0x00800002, heap_switch),
+        BRIDGE_REGISTER_NO_LOCK(0x00800005, active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800006, set_active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800008, trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800009, set_trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000A, debug_mask),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000B, debug_mask_index),
+        BRIDGE_REGISTER_NO_LOCK(0x00800011, user_svr_rom_header_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800012, user_svr_rom_root_dir_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800015, utc_offset),
+        BRIDGE_REGISTER_NO_LOCK(0x00800016, get_global_userdata),
         BRIDGE_REGISTER(0x00C10000, hle_dispatch),
         /* SLOW EXECUTIVE CALL */
         BRIDGE_REGISTER(0x01, chunk_base),
@@ -3919,22 +3919,22 @@ namespace eka2l1::epoc {
     const eka2l1::hle::func_map svc_register_funcs_v94 = {
         /* FAST EXECUTIVE CALL */
         BRIDGE_REGISTER(0x00800000, wait_for_any_request),
-        BRIDGE_REGISTER(0x00800001, heap),
-        BRIDGE_REGISTER(0x00800002, heap_switch),
-        BRIDGE_REGISTER(0x00800005, active_scheduler),
-        BRIDGE_REGISTER(0x00800006, set_active_scheduler),
-        BRIDGE_REGISTER(0x00800008, trap_handler),
-        BRIDGE_REGISTER(0x00800009, set_trap_handler),
-        BRIDGE_REGISTER(0x0080000C, debug_mask),
-        BRIDGE_REGISTER(0x0080000D, debug_mask_index),
-        BRIDGE_REGISTER(0x0080000E, set_debug_mask),
+        BRIDGE_REGISTER_NO_LOCK(0x00800001, heap),
+        BRIDGE_REGISTER_NO_LOCK(0x00800002, heap_switch),
+        BRIDGE_REGISTER_NO_LOCK(0x00800005, active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800006, set_active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800008, trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800009, set_trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000C, debug_mask),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000D, debug_mask_index),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000E, set_debug_mask),
         BRIDGE_REGISTER(0x00800010, ntick_count),
-        BRIDGE_REGISTER(0x00800013, user_svr_rom_header_address),
-        BRIDGE_REGISTER(0x00800014, user_svr_rom_root_dir_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800013, user_svr_rom_header_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800014, user_svr_rom_root_dir_address),
         BRIDGE_REGISTER(0x00800015, safe_inc_32),
         BRIDGE_REGISTER(0x00800016, safe_dec_32),
-        BRIDGE_REGISTER(0x00800019, utc_offset),
-        BRIDGE_REGISTER(0x0080001A, get_global_userdata),
+        BRIDGE_REGISTER_NO_LOCK(0x00800019, utc_offset),
+        BRIDGE_REGISTER_NO_LOCK(0x0080001A, get_global_userdata),
         BRIDGE_REGISTER(0x00C10000, hle_dispatch),
 
         /* SLOW EXECUTIVE CALL */
@@ -4071,20 +4071,20 @@ namespace eka2l1::epoc {
     const eka2l1::hle::func_map svc_register_funcs_v93 = {
         /* FAST EXECUTIVE CALL */
         BRIDGE_REGISTER(0x00800000, wait_for_any_request),
-        BRIDGE_REGISTER(0x00800001, heap),
-        BRIDGE_REGISTER(0x00800002, heap_switch),
-        BRIDGE_REGISTER(0x00800005, active_scheduler),
-        BRIDGE_REGISTER(0x00800006, set_active_scheduler),
-        BRIDGE_REGISTER(0x00800008, trap_handler),
-        BRIDGE_REGISTER(0x00800009, set_trap_handler),
-        BRIDGE_REGISTER(0x0080000D, debug_mask),
+        BRIDGE_REGISTER_NO_LOCK(0x00800001, heap),
+        BRIDGE_REGISTER_NO_LOCK(0x00800002, heap_switch),
+        BRIDGE_REGISTER_NO_LOCK(0x00800005, active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800006, set_active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800008, trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x00800009, set_trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x0080000D, debug_mask),
         BRIDGE_REGISTER(0x00800010, ntick_count),
-        BRIDGE_REGISTER(0x00800013, user_svr_rom_header_address),
-        BRIDGE_REGISTER(0x00800014, user_svr_rom_root_dir_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800013, user_svr_rom_header_address),
+        BRIDGE_REGISTER_NO_LOCK(0x00800014, user_svr_rom_root_dir_address),
         BRIDGE_REGISTER(0x00800015, safe_inc_32),
         BRIDGE_REGISTER(0x00800016, safe_dec_32),
-        BRIDGE_REGISTER(0x00800019, utc_offset),
-        BRIDGE_REGISTER(0x0080001A, get_global_userdata),
+        BRIDGE_REGISTER_NO_LOCK(0x00800019, utc_offset),
+        BRIDGE_REGISTER_NO_LOCK(0x0080001A, get_global_userdata),
         BRIDGE_REGISTER(0x00C10000, hle_dispatch),
 
         /* SLOW EXECUTIVE CALL */
@@ -4227,18 +4227,18 @@ namespace eka2l1::epoc {
         BRIDGE_REGISTER(0x51, uchar_lowercase),
         BRIDGE_REGISTER(0x52, uchar_uppercase),
         BRIDGE_REGISTER(0x53, uchar_get_category),
-        BRIDGE_REGISTER(0x6C, heap),
+        BRIDGE_REGISTER_NO_LOCK(0x6C, heap),
         BRIDGE_REGISTER(0x70, tick_count),
         BRIDGE_REGISTER(0x72, push_trap_frame),
         BRIDGE_REGISTER(0x73, pop_trap_frame),
-        BRIDGE_REGISTER(0x74, active_scheduler),
-        BRIDGE_REGISTER(0x75, set_active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x74, active_scheduler),
+        BRIDGE_REGISTER_NO_LOCK(0x75, set_active_scheduler),
         BRIDGE_REGISTER(0x80, dll_tls),
-        BRIDGE_REGISTER(0x81, trap_handler),
-        BRIDGE_REGISTER(0x82, set_trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x81, trap_handler),
+        BRIDGE_REGISTER_NO_LOCK(0x82, set_trap_handler),
         BRIDGE_REGISTER(0x8D, locked_inc_32),
         BRIDGE_REGISTER(0x8E, locked_dec_32),
-        BRIDGE_REGISTER(0xBC, user_svr_rom_header_address),
+        BRIDGE_REGISTER_NO_LOCK(0xBC, user_svr_rom_header_address),
         BRIDGE_REGISTER(0xBE, math_rand),
         BRIDGE_REGISTER(0xFE, static_call_list),
         
@@ -4293,7 +4293,7 @@ namespace eka2l1::epoc {
         BRIDGE_REGISTER(0xC0004E, request_signal),
         BRIDGE_REGISTER(0xC0005E, after),
         BRIDGE_REGISTER(0xC0006B, message_complete_eka1),
-        BRIDGE_REGISTER(0xC0006D, heap_switch),
+        BRIDGE_REGISTER_NO_LOCK(0xC0006D, heap_switch),
         BRIDGE_REGISTER(0xC00076, the_executor_eka1),
         BRIDGE_REGISTER(0xC0007B, add_event),
         BRIDGE_REGISTER(0xC00097, debug_command_execute),
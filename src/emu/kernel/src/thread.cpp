@@ -321,7 +321,7 @@ namespace eka2l1 {
             }
 
             reset_thread_ctx(epa, stack_top, local_data_chunk->base(owner).ptr_address(), initial);
-            scheduler = kern->get_thread_scheduler();
+            scheduler = kern->pick_thread_scheduler(owner);
 
             // Add thread to process's thread list
             owner->get_thread_list().push(&process_thread_link);
@@ -683,6 +683,7 @@ namespace eka2l1 {
 
         void thread::add_ticks(const int num) {
             time = common::max(0, time - num);
+            owning_process()->add_run_ticks(static_cast<std::uint32_t>(num));
         }
     
         address thread::push_trap_frame(const address new_trap) {
@@ -32,6 +32,163 @@
 #include <vector>
 
 namespace eka2l1 {
+    event_queue::event_queue()
+        : sequence_(0) {
+    }
+
+    std::uint64_t event_queue::make_handle_key(const int event_type, const std::uint64_t userdata) {
+        // User data are mostly object IDs and pointers. Mix the event type into the upper bits,
+        // collisions only cost a few more comparisons.
+        return userdata ^ (static_cast<std::uint64_t>(event_type) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    bool event_queue::earlier(const std::uint32_t lhs, const std::uint32_t rhs) const {
+        const slot &lslot = slots_[lhs];
+        const slot &rslot = slots_[rhs];
+
+        if (lslot.evt_.event_time != rslot.evt_.event_time) {
+            return lslot.evt_.event_time < rslot.evt_.event_time;
+        }
+
+        return lslot.sequence_ < rslot.sequence_;
+    }
+
+    void event_queue::swap_heap(const std::size_t lhs, const std::size_t rhs) {
+        std::swap(heap_[lhs], heap_[rhs]);
+
+        slots_[heap_[lhs]].heap_index_ = lhs;
+        slots_[heap_[rhs]].heap_index_ = rhs;
+    }
+
+    void event_queue::sift_up(std::size_t idx) {
+        while (idx > 0) {
+            const std::size_t parent = (idx - 1) / 2;
+
+            if (!earlier(heap_[idx], heap_[parent])) {
+                break;
+            }
+
+            swap_heap(idx, parent);
+            idx = parent;
+        }
+    }
+
+    void event_queue::sift_down(std::size_t idx) {
+        while (true) {
+            const std::size_t left = idx * 2 + 1;
+            const std::size_t right = left + 1;
+            std::size_t smallest = idx;
+
+            if ((left < heap_.size()) && earlier(heap_[left], heap_[smallest])) {
+                smallest = left;
+            }
+
+            if ((right < heap_.size()) && earlier(heap_[right], heap_[smallest])) {
+                smallest = right;
+            }
+
+            if (smallest == idx) {
+                break;
+            }
+
+            swap_heap(idx, smallest);
+            idx = smallest;
+        }
+    }
+
+    void event_queue::push(const event &evt) {
+        std::uint32_t slot_idx = 0;
+
+        if (!free_slots_.empty()) {
+            slot_idx = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot_idx = static_cast<std::uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        slot &target = slots_[slot_idx];
+        target.evt_ = evt;
+        target.sequence_ = sequence_++;
+        target.heap_index_ = heap_.size();
+
+        heap_.push_back(slot_idx);
+        sift_up(heap_.size() - 1);
+
+        handles_[make_handle_key(evt.event_type, evt.event_user_data)].push_back(slot_idx);
+    }
+
+    void event_queue::remove_slot(const std::uint32_t slot_idx) {
+        const std::size_t heap_idx = slots_[slot_idx].heap_index_;
+        const std::size_t last_idx = heap_.size() - 1;
+
+        if (heap_idx != last_idx) {
+            swap_heap(heap_idx, last_idx);
+        }
+
+        heap_.pop_back();
+
+        if (heap_idx < heap_.size()) {
+            // The slot moved into the hole may belong either up or down
+            sift_up(heap_idx);
+            sift_down(heap_idx);
+        }
+
+        free_slots_.push_back(slot_idx);
+    }
+
+    bool event_queue::remove(const int event_type, const std::uint64_t userdata) {
+        auto handle_ite = handles_.find(make_handle_key(event_type, userdata));
+
+        if (handle_ite == handles_.end()) {
+            return false;
+        }
+
+        std::vector<std::uint32_t> &handle_slots = handle_ite->second;
+
+        // Slots are appended in scheduling order, search from the latest
+        for (auto slot_ite = handle_slots.rbegin(); slot_ite != handle_slots.rend(); slot_ite++) {
+            const event &evt = slots_[*slot_ite].evt_;
+
+            if ((evt.event_type == event_type) && (evt.event_user_data == userdata)) {
+                const std::uint32_t slot_idx = *slot_ite;
+                handle_slots.erase(std::next(slot_ite).base());
+
+                if (handle_slots.empty()) {
+                    handles_.erase(handle_ite);
+                }
+
+                remove_slot(slot_idx);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const event &event_queue::top() const {
+        return slots_[heap_.front()].evt_;
+    }
+
+    event event_queue::pop() {
+        const std::uint32_t slot_idx = heap_.front();
+        const event evt = slots_[slot_idx].evt_;
+
+        auto handle_ite = handles_.find(make_handle_key(evt.event_type, evt.event_user_data));
+
+        if (handle_ite != handles_.end()) {
+            std::vector<std::uint32_t> &handle_slots = handle_ite->second;
+            handle_slots.erase(std::find(handle_slots.begin(), handle_slots.end(), slot_idx));
+
+            if (handle_slots.empty()) {
+                handles_.erase(handle_ite);
+            }
+        }
+
+        remove_slot(slot_idx);
+        return evt;
+    }
+
     ntimer::ntimer(const std::uint32_t cpu_hz) {
         CPU_HZ_ = cpu_hz;
         should_stop_ = false;
@@ -125,13 +282,8 @@ namespace eka2l1 {
         std::unique_lock<std::mutex> unq(lock_);
         std::uint64_t global_timer = teletimer_->microseconds();
 
-        while (!events_.empty() && events_.back().event_time <= global_timer) {
-            event evt = std::move(events_.back());
-            events_.pop_back();
-
-            std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-                return lhs.event_time > rhs.event_time;
-            });
+        while (!events_.empty() && events_.top().event_time <= global_timer) {
+            const event evt = events_.pop();
 
             unq.unlock();
             event_types_[evt.event_type]
@@ -140,7 +292,7 @@ namespace eka2l1 {
         }
 
         if (!events_.empty()) {
-            return static_cast<std::uint64_t>(events_.back().event_time - global_timer);
+            return static_cast<std::uint64_t>(events_.top().event_time - global_timer);
         }
 
         return std::nullopt;
@@ -155,12 +307,8 @@ namespace eka2l1 {
         evt.event_type = event_type;
         evt.event_user_data = userdata;
 
-        bool should_nof = (events_.empty()) ||  (events_.back().event_time > evt.event_time);
-        events_.push_back(evt);
-
-        std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-            return lhs.event_time > rhs.event_time;
-        });
+        bool should_nof = (events_.empty()) || (events_.top().event_time > evt.event_time);
+        events_.push(evt);
 
         if (should_nof) {
             new_event_evt_.set();
@@ -169,21 +317,7 @@ namespace eka2l1 {
 
     bool ntimer::unschedule_event(int event_type, uint64_t userdata) {
         const std::lock_guard<std::mutex> guard(lock_);
-
-        auto res = std::find_if(events_.begin(), events_.end(),
-            [&](auto evt) { return (evt.event_type == event_type) && (evt.event_user_data == userdata); });
-
-        if (res != events_.end()) {
-            events_.erase(res);
-
-            std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-                return lhs.event_time > rhs.event_time;
-            });
-
-            return true;
-        }
-
-        return false;
+        return events_.remove(event_type, userdata);
     }
 
     bool ntimer::set_clock_frequency_mhz(const std::uint32_t cpu_mhz) {
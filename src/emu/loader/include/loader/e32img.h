@@ -25,8 +25,10 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1 {
@@ -194,15 +196,86 @@ namespace eka2l1 {
             std::vector<std::string> dll_names;
         };
 
+        /**
+         * @brief Identify the content of an image file: its size and two checksums.
+         */
+        struct e32img_cache_key {
+            std::uint32_t source_size{ 0 };
+            std::uint32_t source_crc{ 0 }; ///< CRC-32 of the content, 0 is the initial value.
+            std::uint32_t source_adler{ 1 }; ///< Adler-32 of the content, 1 is the initial value.
+
+            /**
+             * @brief Add the next part of the file content to the key.
+             */
+            void add(const char *data, const std::size_t size);
+        };
+
+        /**
+         * @brief Disk cache of decompressed E32 images.
+         * 
+         * Entries are named after the content of the image file, so the same image hits no matter
+         * where it is loaded from, and a modified file never matches an old entry.
+         * 
+         * An entry is a fixed size header followed by the decompressed image, exactly as it lays in
+         * memory after the E32 header. The import and relocation tables are part of that, and are read
+         * back from there.
+         * 
+         * The total size of the entries is capped. When storing would go over, the least recently used
+         * entries are removed first. Entries of an older run are ordered by their modification time.
+         */
+        class e32img_cache {
+            struct entry_info {
+                std::uint64_t size;
+                std::uint64_t last_use;
+            };
+
+            std::string folder_;
+            std::uint64_t max_size_;
+            std::uint64_t total_size_;
+            std::uint64_t use_counter_;
+
+            std::unordered_map<std::string, entry_info> entries_;
+            std::mutex lock_;
+
+            std::string entry_name(const e32img_cache_key &key) const;
+
+            void scan();
+            void remove_entry(const std::string &name);
+            void evict(const std::uint64_t incoming_size);
+
+        public:
+            static constexpr std::uint64_t DEFAULT_MAX_SIZE = 256 * 1024 * 1024;
+
+            explicit e32img_cache(const std::string &folder, const std::uint64_t max_size = DEFAULT_MAX_SIZE);
+
+            /**
+             * @brief Fill the buffer with the decompressed content of the image.
+             * @returns True if an entry with the exact size exists and was read whole.
+             */
+            bool load(const e32img_cache_key &key, char *dest, const std::uint32_t size);
+
+            /**
+             * @brief Store the decompressed content of the image. Failures are ignored.
+             */
+            void store(const e32img_cache_key &key, const char *data, const std::uint32_t size);
+
+            /**
+             * @brief Get the total size of the entries on disk, headers included.
+             */
+            std::uint64_t total_size();
+        };
+
         /**
          * @brief Parse an E32 Image from stream.
          * 
          * @param stream     The stream to parse from.
          * @param read_reloc If this is true, relocation section will be parsed.
+         * @param cache      Optional cache to look up and store the decompressed image in.
          * 
          * @returns An optional contains E32 Image. Nullopt if invalid.
          */
-        std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc = true);
+        std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc = true,
+            e32img_cache *cache = nullptr);
 
         /**
          * @brief Check if the stream content is E32 Image.
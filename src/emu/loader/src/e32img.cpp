@@ -26,10 +26,15 @@
 #include <common/buffer.h>
 #include <common/bytepair.h>
 #include <common/bytes.h>
+#include <common/fileutils.h>
 #include <common/flate.h>
 #include <common/log.h>
+#include <common/path.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <miniz.h>
 #include <sstream>
 
@@ -116,10 +121,7 @@ namespace eka2l1::loader {
             assert((reloc_entry.size) % 2 == 0);
 
             reloc_entry.rels_info.resize(((reloc_entry.size - 8) / 2));
-
-            for (auto &rel_info : reloc_entry.rels_info) {
-                stream->read(reinterpret_cast<void *>(&rel_info), 2);
-            }
+            stream->read(reloc_entry.rels_info.data(), reloc_entry.rels_info.size() * 2);
 
             i += static_cast<int>(reloc_entry.rels_info.size()) - 1;
 
@@ -150,6 +152,222 @@ namespace eka2l1::loader {
 
     static constexpr std::uint32_t E32IMG_SIGNATURE = 0x434F5045;
 
+    static constexpr std::uint32_t E32IMG_CACHE_MAGIC = 0x43323345; // E32C
+    static constexpr std::uint32_t E32IMG_CACHE_VERSION = 1;
+
+    struct e32img_cache_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        e32img_cache_key key;
+        std::uint32_t data_size;
+        std::uint32_t reserved[2]; // Keep the data 32 bytes aligned in the file
+    };
+
+    static_assert(sizeof(e32img_cache_header) == 32);
+
+    static constexpr const char *E32IMG_CACHE_EXTENSION = ".e32c";
+    static constexpr const char *E32IMG_CACHE_TEMP_EXTENSION = ".tmp";
+
+    void e32img_cache_key::add(const char *data, const std::size_t size) {
+        source_size += static_cast<std::uint32_t>(size);
+        source_crc = static_cast<std::uint32_t>(mz_crc32(source_crc, reinterpret_cast<const std::uint8_t *>(data), size));
+        source_adler = static_cast<std::uint32_t>(mz_adler32(source_adler, reinterpret_cast<const std::uint8_t *>(data), size));
+    }
+
+    e32img_cache::e32img_cache(const std::string &folder, const std::uint64_t max_size)
+        : folder_(folder)
+        , max_size_(max_size)
+        , total_size_(0)
+        , use_counter_(0) {
+        scan();
+    }
+
+    std::string e32img_cache::entry_name(const e32img_cache_key &key) const {
+        return fmt::format("{:08X}{:08X}{:08X}{}", key.source_size, key.source_crc, key.source_adler,
+            E32IMG_CACHE_EXTENSION);
+    }
+
+    void e32img_cache::scan() {
+        common::dir_iterator iterator(folder_);
+        iterator.detail = true;
+
+        common::dir_entry entry;
+        std::vector<std::pair<std::uint64_t, std::string>> found;
+
+        while (iterator.next_entry(entry) == 0) {
+            if (entry.type != common::FILE_REGULAR) {
+                continue;
+            }
+
+            const std::string path = eka2l1::add_path(folder_, entry.name);
+            const std::string extension = eka2l1::path_extension(entry.name);
+
+            if (extension == E32IMG_CACHE_TEMP_EXTENSION) {
+                // Left by a store that did not finish
+                common::remove(path);
+            } else if (extension == E32IMG_CACHE_EXTENSION) {
+                entries_[entry.name] = { entry.size, 0 };
+                total_size_ += entry.size;
+
+                found.emplace_back(common::get_last_modifiy_since_ad(common::utf8_to_ucs2(path)), entry.name);
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+
+        for (const auto &[modify_time, name] : found) {
+            entries_[name].last_use = ++use_counter_;
+        }
+
+        evict(0);
+    }
+
+    void e32img_cache::remove_entry(const std::string &name) {
+        auto ite = entries_.find(name);
+
+        if (ite != entries_.end()) {
+            total_size_ -= ite->second.size;
+            entries_.erase(ite);
+        }
+
+        common::remove(eka2l1::add_path(folder_, name));
+    }
+
+    void e32img_cache::evict(const std::uint64_t incoming_size) {
+        if (total_size_ + incoming_size <= max_size_) {
+            return;
+        }
+
+        std::vector<std::pair<std::uint64_t, std::string>> by_use;
+        by_use.reserve(entries_.size());
+
+        for (const auto &[name, info] : entries_) {
+            by_use.emplace_back(info.last_use, name);
+        }
+
+        std::sort(by_use.begin(), by_use.end());
+
+        for (const auto &[last_use, name] : by_use) {
+            if (total_size_ + incoming_size <= max_size_) {
+                break;
+            }
+
+            remove_entry(name);
+        }
+    }
+
+    std::uint64_t e32img_cache::total_size() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return total_size_;
+    }
+
+    bool e32img_cache::load(const e32img_cache_key &key, char *dest, const std::uint32_t size) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        const std::string name = entry_name(key);
+        auto ite = entries_.find(name);
+
+        if (ite == entries_.end()) {
+            return false;
+        }
+
+        std::ifstream entry(eka2l1::add_path(folder_, name), std::ios::binary);
+
+        if (!entry) {
+            // Deleted behind our back
+            total_size_ -= ite->second.size;
+            entries_.erase(ite);
+
+            return false;
+        }
+
+        e32img_cache_header header;
+
+        const bool valid = entry.read(reinterpret_cast<char *>(&header), sizeof(e32img_cache_header))
+            && (header.magic == E32IMG_CACHE_MAGIC) && (header.version == E32IMG_CACHE_VERSION)
+            && (std::memcmp(&header.key, &key, sizeof(e32img_cache_key)) == 0);
+
+        if (valid && (header.data_size != size)) {
+            return false;
+        }
+
+        if (!valid || !entry.read(dest, size)) {
+            // Truncated, or written by another version. It will never be of use
+            entry.close();
+            remove_entry(name);
+
+            return false;
+        }
+
+        ite->second.last_use = ++use_counter_;
+        return true;
+    }
+
+    void e32img_cache::store(const e32img_cache_key &key, const char *data, const std::uint32_t size) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        const std::uint64_t entry_size = sizeof(e32img_cache_header) + size;
+
+        if (entry_size > max_size_) {
+            return;
+        }
+
+        const std::string name = entry_name(key);
+
+        // An entry with the same name is replaced, it must not count twice
+        if (entries_.find(name) != entries_.end()) {
+            remove_entry(name);
+        }
+
+        evict(entry_size);
+
+        if (!eka2l1::exists(folder_)) {
+            eka2l1::create_directories(folder_);
+        }
+
+        e32img_cache_header header;
+        std::memset(&header, 0, sizeof(e32img_cache_header));
+
+        header.magic = E32IMG_CACHE_MAGIC;
+        header.version = E32IMG_CACHE_VERSION;
+        header.key = key;
+        header.data_size = size;
+
+        const std::string path = eka2l1::add_path(folder_, name);
+        const std::string temp_path = path + E32IMG_CACHE_TEMP_EXTENSION;
+
+        {
+            std::ofstream entry(temp_path, std::ios::binary | std::ios::trunc);
+            entry.write(reinterpret_cast<const char *>(&header), sizeof(e32img_cache_header));
+            entry.write(data, size);
+
+            if (!entry) {
+                entry.close();
+                std::remove(temp_path.c_str());
+
+                return;
+            }
+        }
+
+        // Only show up under the real name once complete, so an interrupted write is never loaded
+        std::remove(path.c_str());
+
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            return;
+        }
+
+        entries_[name] = { entry_size, ++use_counter_ };
+        total_size_ += entry_size;
+    }
+
+    static e32img_cache_key make_cache_key(const char *header, const std::size_t header_size, const std::vector<char> &rest) {
+        e32img_cache_key key;
+        key.add(header, header_size);
+        key.add(rest.data(), rest.size());
+
+        return key;
+    }
+
     bool is_e32img(common::ro_stream *stream, std::uint32_t *uid_array) {
         std::uint32_t temp_arr[3];
         if (!uid_array) {
@@ -171,7 +389,7 @@ namespace eka2l1::loader {
         return result;
     }
 
-    std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc) {
+    std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc, e32img_cache *cache) {
         if (!stream) {
             return std::nullopt;
         }
@@ -311,27 +529,40 @@ namespace eka2l1::loader {
                 LOG_ERROR("File reading improperly");
             }
 
-            if (ctype == compress_type::deflate_c) {
+            e32img_cache_key cache_key;
+            bool from_cache = false;
+
+            if (cache) {
+                // Decompressing is most of the loading time for big images, see if it was done before
+                cache_key = make_cache_key(img.data.data(), img.header.code_offset, temp_buf);
+                from_cache = cache->load(cache_key, &img.data[img.header.code_offset], img.uncompressed_size);
+            }
+
+            std::size_t decompressed_size = 0;
+
+            if (!from_cache && (ctype == compress_type::deflate_c)) {
                 flate::bit_input input(reinterpret_cast<uint8_t *>(temp_buf.data()),
                     static_cast<int>(temp_buf.size() * 8));
 
                 flate::inflater inflate_machine(input);
 
                 inflate_machine.init();
-                auto read = inflate_machine.read(reinterpret_cast<uint8_t *>(&img.data[img.header.code_offset]),
+                const int read = inflate_machine.read(reinterpret_cast<uint8_t *>(&img.data[img.header.code_offset]),
                     img.uncompressed_size);
-            } else if (ctype == compress_type::byte_pair_c) {
-                auto crr_pos = stream->tell();
-
-                std::vector<char> temp(stream->size() - img.header.code_offset);
-                stream->seek(img.header.code_offset, common::seek_where::beg);
-                stream->read(temp.data(), static_cast<uint32_t>(temp.size()));
 
-                common::ro_buf_stream raw_bp_stream(reinterpret_cast<std::uint8_t *>(&temp[0]), temp.size());
+                decompressed_size = (read > 0) ? static_cast<std::size_t>(read) : 0;
+            } else if (!from_cache && (ctype == compress_type::byte_pair_c)) {
+                common::ro_buf_stream raw_bp_stream(reinterpret_cast<std::uint8_t *>(&temp_buf[0]), temp_buf.size());
                 common::ibytepair_stream bpstream(reinterpret_cast<common::ro_stream *>(&raw_bp_stream));
 
                 auto codesize = bpstream.read_pages(&img.data[img.header.code_offset], img.header.code_size);
                 auto restsize = bpstream.read_pages(&img.data[img.header.code_offset + img.header.code_size], img.uncompressed_size);
+
+                decompressed_size = codesize + restsize;
+            }
+
+            if (cache && !from_cache && (decompressed_size == img.uncompressed_size)) {
+                cache->store(cache_key, &img.data[img.header.code_offset], img.uncompressed_size);
             }
         } else {
             img.uncompressed_size = static_cast<uint32_t>(file_size);
@@ -26,6 +26,8 @@
 
 #include <loader/mbm.h>
 
+#include <vector>
+
 namespace eka2l1::loader {
     bool sbm_header::internalize(common::ro_stream &stream) {
         std::uint64_t total_read = 0;
@@ -135,10 +137,18 @@ namespace eka2l1::loader {
 
         bool success = true;
 
+        // The bitmap size includes the header, don't run into the next bitmap or the trailer
         std::size_t compressed_size = common::min<std::size_t>(static_cast<std::size_t>(stream->left()),
-            static_cast<std::size_t>(single_bm_header.bitmap_size));
+            static_cast<std::size_t>(single_bm_header.bitmap_size - single_bm_header.header_len));
+
+        const std::size_t dest_size = dest_max ? dest_max : 0xFFFFFFFF;
+        std::vector<std::uint8_t> compressed;
 
-        common::wo_buf_stream dest_stream(dest, dest_max ? dest_max : 0xFFFFFFFF);
+        if (single_bm_header.compression != 0) {
+            // Decode from memory rather than through the stream
+            compressed.resize(compressed_size);
+            compressed.resize(static_cast<std::size_t>(stream->read(compressed.data(), compressed_size)));
+        }
 
         switch (single_bm_header.compression) {
         case 0: {
@@ -152,23 +162,17 @@ namespace eka2l1::loader {
         }
 
         case 1: {
-            eka2l1::decompress_rle<8>(stream, reinterpret_cast<common::wo_stream *>(&dest_stream));
-            dest_max = dest_stream.tell();
-
+            dest_max = eka2l1::decompress_rle<8>(compressed.data(), compressed.size(), dest, dest_size);
             break;
         }
 
         case 3: {
-            eka2l1::decompress_rle<16>(stream, reinterpret_cast<common::wo_stream *>(&dest_stream));
-            dest_max = dest_stream.tell();
-
+            dest_max = eka2l1::decompress_rle<16>(compressed.data(), compressed.size(), dest, dest_size);
             break;
         }
 
         case 4: {
-            eka2l1::decompress_rle<24>(stream, reinterpret_cast<common::wo_stream *>(&dest_stream));
-            dest_max = dest_stream.tell();
-
+            dest_max = eka2l1::decompress_rle<24>(compressed.data(), compressed.size(), dest, dest_size);
             break;
         }
 
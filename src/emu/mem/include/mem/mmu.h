@@ -19,11 +19,17 @@
 
 #pragma once
 
+#include <common/virtualmem.h>
 #include <mem/page.h>
+
+#include <functional>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace eka2l1::arm {
     class core;
+    using core_work_func = std::function<void(core *)>;
 }
 
 namespace eka2l1::config {
@@ -39,6 +45,20 @@ namespace eka2l1::mem {
         MMU_ASSIGN_GLOBAL = 1 << 1
     };
 
+    /**
+     * \brief Do work on a CPU core, from the host thread driving it.
+     * 
+     * The work must be done, or be guaranteed to be done before the core runs guest code again, when this returns.
+     */
+    using cpu_work_dispatcher = std::function<void(arm::core *, arm::core_work_func)>;
+
+    /**
+     * \brief Get the address space of the core driven by the calling host thread.
+     * 
+     * Returns -1 if it is not known, in which case the MMU's current address space is used.
+     */
+    using addr_space_resolver = std::function<asid()>;
+
     /**
      * \brief The base of memory management unit.
      */
@@ -46,15 +66,48 @@ namespace eka2l1::mem {
     protected:
         page_table_allocator *alloc_; ///< Page table allocator.
 
-        bool read_8bit_data(const vm_address addr, std::uint8_t *data);
-        bool read_16bit_data(const vm_address addr, std::uint16_t *data);
-        bool read_32bit_data(const vm_address addr, std::uint32_t *data);
-        bool read_64bit_data(const vm_address addr, std::uint64_t *data);
+        struct host_backing {
+            common::shared_memory_handle handle_;
+            std::size_t size_;
+        };
+
+        std::map<std::uint8_t *, host_backing> host_backings_; ///< Shared memory backing host regions, keyed by region base.
+
+        /**
+         * \brief Read a value from guest memory in an address space.
+         * 
+         * \param id The address space to read from. Use -1 for the MMU's current one.
+         * 
+         * Accesses contained in a single page take one page lookup. Accesses that straddle a page boundary
+         * are assembled from the two pages they touch, and fail if either page is not mapped.
+         */
+        template <typename T>
+        bool read_data(const asid id, const vm_address addr, T *data);
+
+        /**
+         * \brief Write a value to guest memory in an address space.
+         * 
+         * See read_data for how page-straddling accesses are handled. Nothing is written if either page
+         * is not mapped.
+         */
+        template <typename T>
+        bool write_data(const asid id, const vm_address addr, T *data);
+
+        cpu_work_dispatcher cpu_dispatcher_; ///< Routes changes to page tables of each core. Empty to do them directly.
+        addr_space_resolver addr_space_resolver_; ///< Address space of the calling core. Empty if there is only one.
 
-        bool write_8bit_data(const vm_address addr, std::uint8_t *data);
-        bool write_16bit_data(const vm_address addr, std::uint16_t *data);
-        bool write_32bit_data(const vm_address addr, std::uint32_t *data);
-        bool write_64bit_data(const vm_address addr, std::uint64_t *data);
+        void install_cpu_callbacks(arm::core *cpu);
+        void run_on_cpu(arm::core *cpu, arm::core_work_func work);
+
+        bool read_8bit_data(const asid id, const vm_address addr, std::uint8_t *data);
+        bool read_16bit_data(const asid id, const vm_address addr, std::uint16_t *data);
+        bool read_32bit_data(const asid id, const vm_address addr, std::uint32_t *data);
+        bool read_64bit_data(const asid id, const vm_address addr, std::uint64_t *data);
+
+        bool write_8bit_data(const asid id, const vm_address addr, std::uint8_t *data);
+        bool write_16bit_data(const asid id, const vm_address addr, std::uint16_t *data);
+        bool write_32bit_data(const asid id, const vm_address addr, std::uint32_t *data);
+        bool write_64bit_data(const asid id, const vm_address addr, std::uint64_t *data);
 
     public:
         std::size_t page_size_bits_; ///< The number of bits of page size.
@@ -68,7 +121,8 @@ namespace eka2l1::mem {
         std::uint32_t page_per_tab_shift_;
 
         bool mem_map_old_; ///< Should we use EKA1 mem map model?
-        arm::core *cpu_;
+        arm::core *cpu_; ///< The first CPU core.
+        std::vector<arm::core *> cpus_; ///< All CPU cores sharing this MMU, including the first one.
         config::state *conf_;
 
     public:
@@ -78,8 +132,81 @@ namespace eka2l1::mem {
 
         virtual const mem_model_type model_type() const = 0;
 
-        void map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm);
-        void unmap_from_cpu(const vm_address addr, const std::size_t size);
+        /**
+         * \brief Map host memory to the CPU.
+         * 
+         * \param id The address space to map the memory to. Use -1 for the current one, 0 for all of them.
+         *           If the CPU does not keep a page table per address space, this is ignored and the memory is
+         *           mapped to the current page table.
+         */
+        void map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm, const asid id = -1);
+        void unmap_from_cpu(const vm_address addr, const std::size_t size, const asid id = -1);
+
+        /**
+         * \brief Make another CPU core share this MMU.
+         * 
+         * Its memory accesses are routed to the MMU, and memory mapped to the CPU from now on is also
+         * mapped to it. Sharing the MMU between cores requires each core to keep a page table per
+         * address space, since each of them may run a different address space.
+         * 
+         * \returns False if the core does not keep a page table per address space.
+         */
+        bool attach_cpu(arm::core *cpu);
+
+        /**
+         * \brief Set how changes to page tables of each core are routed.
+         * 
+         * A core's page tables may be in use by the host thread driving it, so other threads must
+         * not change them directly while cores run in parallel.
+         */
+        void set_cpu_work_dispatcher(cpu_work_dispatcher dispatcher) {
+            cpu_dispatcher_ = std::move(dispatcher);
+        }
+
+        /**
+         * \brief Set how the address space of the calling core is found.
+         * 
+         * With multiple cores, each of them runs its own address space, so the current address space
+         * set with set_current_addr_space is only the one of the last core that switched. Lookups done
+         * with -1 as the address space ask the resolver instead.
+         */
+        void set_addr_space_resolver(addr_space_resolver resolver) {
+            addr_space_resolver_ = std::move(resolver);
+        }
+
+        /**
+         * \brief Turn -1 into the address space of the calling core. Other IDs are returned as is.
+         */
+        asid resolve_addr_space(const asid id) const;
+
+        /**
+         * \brief Release the page table of an address space on all CPU cores.
+         */
+        void free_cpu_address_space(const asid id);
+
+        /**
+         * \brief Check if the CPU keeps a page table for each address space.
+         * 
+         * In that case, memory should be mapped to its address space right away, and there is no
+         * need to remap anything on address space switch.
+         */
+        bool cpu_has_address_space_tables() const;
+
+        /**
+         * \brief Reserve host memory to back guest memory.
+         * 
+         * If the CPU has a fastmem region, the memory is backed by a shared memory object, so that
+         * the parts mapped to the CPU can be mirrored into that region.
+         * 
+         * \param size Size of memory to reserve. The memory must then be committed before being used.
+         * \returns Nullptr on failure.
+         */
+        void *map_host_memory(const std::size_t size);
+
+        /**
+         * \brief Release host memory reserved with map_host_memory.
+         */
+        void unmap_host_memory(void *ptr, const std::size_t size);
 
         /**
          * \brief Get number of bytes a page occupy
@@ -50,6 +50,14 @@ namespace eka2l1::mem {
 
         void do_selection_cpu_memory_manipulation(const bool unmap);
 
+        /**
+         * \brief Get the CPU address space this chunk's memory should be mapped to.
+         * 
+         * \param target The address space ID to pass to the MMU.
+         * \returns False if the memory should not be mapped to the CPU right now.
+         */
+        bool get_cpu_map_target(asid &target);
+
     public:
         bool is_local{ false };
         bool is_code { false };
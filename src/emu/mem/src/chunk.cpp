@@ -19,6 +19,7 @@
 
 #include <mem/chunk.h>
 #include <mem/mmu.h>
+#include <mem/process.h>
 #include <mem/model/flexible/chunk.h>
 #include <mem/model/multiple/chunk.h>
 
@@ -76,6 +77,7 @@ namespace eka2l1::mem {
         const bool map) {
         // Get the base address for this process
         const vm_address base_addr = base(process);
+        const asid target_id = process ? process->address_space_id() : -1;
         
         if (!base_addr) {
             LOG_ERROR("Unable to get base address of this chunk!");
@@ -85,9 +87,9 @@ namespace eka2l1::mem {
         auto do_the_map = [&](const std::uint32_t start_index, const std::uint32_t page_count) {
             if (map) {
                 mmu_->map_to_cpu(base_addr + (start_index << mmu_->page_size_bits_), page_count << mmu_->page_size_bits_,
-                    reinterpret_cast<std::uint8_t *>(host_base()) + (start_index << mmu_->page_size_bits_), permission_);
+                    reinterpret_cast<std::uint8_t *>(host_base()) + (start_index << mmu_->page_size_bits_), permission_, target_id);
             } else {
-                mmu_->unmap_from_cpu(base_addr + (start_index << mmu_->page_size_bits_), page_count << mmu_->page_size_bits_);
+                mmu_->unmap_from_cpu(base_addr + (start_index << mmu_->page_size_bits_), page_count << mmu_->page_size_bits_, target_id);
             }
         };
 
@@ -25,6 +25,8 @@
 #include <mem/model/flexible/mmu.h>
 #include <mem/model/multiple/mmu.h>
 
+#include <cstring>
+
 namespace eka2l1::mem {
     mmu_base::mmu_base(page_table_allocator *alloc, arm::core *cpu, config::state *conf, const std::size_t psize_bits, const bool mem_map_old)
         : alloc_(alloc)
@@ -53,27 +55,147 @@ namespace eka2l1::mem {
         }
 
         // Set CPU read/write functions
-        cpu->read_8bit = [this](const vm_address addr, std::uint8_t* data) { return read_8bit_data(addr, data); };
-        cpu->read_16bit = [this](const vm_address addr, std::uint16_t* data) { return read_16bit_data(addr, data); };
-        cpu->read_32bit = [this](const vm_address addr, std::uint32_t* data) { return read_32bit_data(addr, data); };
-        cpu->read_64bit = [this](const vm_address addr, std::uint64_t* data) { return read_64bit_data(addr, data); };
+        cpus_.push_back(cpu);
+        install_cpu_callbacks(cpu);
+    }
+
+    void mmu_base::install_cpu_callbacks(arm::core *cpu) {
+        // Each core may run a different address space, so accesses are done in the one of the core doing them
+        cpu->read_8bit = [this, cpu](const vm_address addr, std::uint8_t* data) { return read_8bit_data(cpu->current_address_space(), addr, data); };
+        cpu->read_16bit = [this, cpu](const vm_address addr, std::uint16_t* data) { return read_16bit_data(cpu->current_address_space(), addr, data); };
+        cpu->read_32bit = [this, cpu](const vm_address addr, std::uint32_t* data) { return read_32bit_data(cpu->current_address_space(), addr, data); };
+        cpu->read_64bit = [this, cpu](const vm_address addr, std::uint64_t* data) { return read_64bit_data(cpu->current_address_space(), addr, data); };
+
+        cpu->write_8bit = [this, cpu](const vm_address addr, std::uint8_t* data) { return write_8bit_data(cpu->current_address_space(), addr, data); };
+        cpu->write_16bit = [this, cpu](const vm_address addr, std::uint16_t* data) { return write_16bit_data(cpu->current_address_space(), addr, data); };
+        cpu->write_32bit = [this, cpu](const vm_address addr, std::uint32_t* data) { return write_32bit_data(cpu->current_address_space(), addr, data); };
+        cpu->write_64bit = [this, cpu](const vm_address addr, std::uint64_t* data) { return write_64bit_data(cpu->current_address_space(), addr, data); };
+
+        // Traced accesses must be logged, so they can't bypass the callbacks above
+        cpu->trace_read = &conf_->log_read;
+        cpu->trace_write = &conf_->log_write;
+    }
+
+    bool mmu_base::attach_cpu(arm::core *cpu) {
+        if (!cpu->has_address_space_tables() || !cpu_->has_address_space_tables()) {
+            return false;
+        }
+
+        install_cpu_callbacks(cpu);
+        cpus_.push_back(cpu);
 
-        cpu->write_8bit = [this](const vm_address addr, std::uint8_t* data) { return write_8bit_data(addr, data); };
-        cpu->write_16bit = [this](const vm_address addr, std::uint16_t* data) { return write_16bit_data(addr, data); };
-        cpu->write_32bit = [this](const vm_address addr, std::uint32_t* data) { return write_32bit_data(addr, data); };
-        cpu->write_64bit = [this](const vm_address addr, std::uint64_t* data) { return write_64bit_data(addr, data); };
+        return true;
+    }
+
+    void mmu_base::run_on_cpu(arm::core *cpu, arm::core_work_func work) {
+        if (!cpu_dispatcher_) {
+            work(cpu);
+            return;
+        }
+
+        cpu_dispatcher_(cpu, std::move(work));
+    }
+
+    asid mmu_base::resolve_addr_space(const asid id) const {
+        if ((id != -1) || !addr_space_resolver_) {
+            return id;
+        }
+
+        const asid calling_id = addr_space_resolver_();
+        return (calling_id == -1) ? current_addr_space() : calling_id;
+    }
+
+    void mmu_base::free_cpu_address_space(const asid id) {
+        for (arm::core *cpu: cpus_) {
+            run_on_cpu(cpu, [id](arm::core *target) { target->free_address_space(id); });
+        }
     }
 
     page_table *mmu_base::create_new_page_table() {
         return alloc_->create_new(page_size_bits_);
     }
 
-    void mmu_base::map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm) {
-        cpu_->map_backing_mem(addr, size, reinterpret_cast<std::uint8_t *>(ptr), perm);
+    bool mmu_base::cpu_has_address_space_tables() const {
+        return cpu_->has_address_space_tables();
+    }
+
+    void mmu_base::map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm, const asid id) {
+        std::uint8_t *host_ptr = reinterpret_cast<std::uint8_t *>(ptr);
+
+        for (arm::core *cpu: cpus_) {
+            run_on_cpu(cpu, [=](arm::core *target) { target->map_backing_mem(addr, size, host_ptr, perm, id); });
+        }
+
+        if (!cpu_->has_fastmem() || host_backings_.empty()) {
+            return;
+        }
+
+        // The arena mirrors global memory and the address space being run. Memory of other address
+        // spaces is mapped when switching to them, and unmapped when switching away.
+        if ((id != -1) && (id != 0) && (id != current_addr_space())) {
+            return;
+        }
+
+        // Find the region containing the pointer. External host memory has no backing, and will be accessed
+        // through the page table instead.
+        auto backing_ite = host_backings_.upper_bound(host_ptr);
+
+        if (backing_ite == host_backings_.begin()) {
+            return;
+        }
+
+        backing_ite--;
+
+        const std::size_t offset = static_cast<std::size_t>(host_ptr - backing_ite->first);
+
+        if (offset + size <= backing_ite->second.size_) {
+            cpu_->map_fastmem(addr, size, backing_ite->second.handle_, offset);
+        }
     }
 
-    void mmu_base::unmap_from_cpu(const vm_address addr, const std::size_t size) {
-        cpu_->unmap_memory(addr, size);
+    void mmu_base::unmap_from_cpu(const vm_address addr, const std::size_t size, const asid id) {
+        for (arm::core *cpu: cpus_) {
+            run_on_cpu(cpu, [=](arm::core *target) { target->unmap_memory(addr, size, id); });
+        }
+    }
+
+    void *mmu_base::map_host_memory(const std::size_t size) {
+        if (!cpu_->has_fastmem()) {
+            return common::map_memory(size);
+        }
+
+        common::shared_memory_handle handle = common::create_shared_memory(size);
+
+        if (handle == common::INVALID_SHARED_MEMORY_HANDLE) {
+            LOG_WARN("Unable to create shared memory for guest memory, fastmem won't be used for it");
+            return common::map_memory(size);
+        }
+
+        // Reserve the view inaccessible, commit will later change its protection
+        std::uint8_t *ptr = reinterpret_cast<std::uint8_t *>(common::map_shared_memory(handle, 0, size, nullptr,
+            prot::none));
+
+        if (!ptr) {
+            common::destroy_shared_memory(handle);
+            return nullptr;
+        }
+
+        host_backings_.emplace(ptr, host_backing{ handle, size });
+        return ptr;
+    }
+
+    void mmu_base::unmap_host_memory(void *ptr, const std::size_t size) {
+        auto backing_ite = host_backings_.find(reinterpret_cast<std::uint8_t *>(ptr));
+
+        if (backing_ite == host_backings_.end()) {
+            common::unmap_memory(ptr, size);
+            return;
+        }
+
+        common::unmap_shared_memory(ptr, size, false);
+        common::destroy_shared_memory(backing_ite->second.handle_);
+
+        host_backings_.erase(backing_ite);
     }
 
     mmu_impl make_new_mmu(page_table_allocator *alloc, arm::core *cpu, config::state *conf, const std::size_t psize_bits, const bool mem_map_old,
@@ -96,13 +218,67 @@ namespace eka2l1::mem {
     
     /// ================== MISCS ====================
 
-    bool mmu_base::read_8bit_data(const vm_address addr, std::uint8_t *data) {
-        std::uint8_t *ptr = reinterpret_cast<std::uint8_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    template <typename T>
+    bool mmu_base::read_data(const asid id, const vm_address addr, T *data) {
+        const std::uint32_t offset = addr & offset_mask_;
+
+        if (offset <= offset_mask_ + 1 - sizeof(T)) {
+            const std::uint8_t *ptr = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr));
+            if (!ptr) {
+                return false;
+            }
+
+            std::memcpy(data, ptr, sizeof(T));
+            return true;
+        }
+
+        // The access straddles two pages, each of them may be backed by a different host chunk
+        const std::uint32_t first_part = offset_mask_ + 1 - offset;
+        const std::uint8_t *first = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr));
+        const std::uint8_t *second = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr + first_part));
+
+        if (!first || !second) {
             return false;
         }
 
-        *data = *ptr;
+        std::memcpy(data, first, first_part);
+        std::memcpy(reinterpret_cast<std::uint8_t *>(data) + first_part, second, sizeof(T) - first_part);
+
+        return true;
+    }
+
+    template <typename T>
+    bool mmu_base::write_data(const asid id, const vm_address addr, T *data) {
+        const std::uint32_t offset = addr & offset_mask_;
+
+        if (offset <= offset_mask_ + 1 - sizeof(T)) {
+            std::uint8_t *ptr = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr));
+            if (!ptr) {
+                return false;
+            }
+
+            std::memcpy(ptr, data, sizeof(T));
+            return true;
+        }
+
+        const std::uint32_t first_part = offset_mask_ + 1 - offset;
+        std::uint8_t *first = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr));
+        std::uint8_t *second = reinterpret_cast<std::uint8_t *>(get_host_pointer(id, addr + first_part));
+
+        if (!first || !second) {
+            return false;
+        }
+
+        std::memcpy(first, data, first_part);
+        std::memcpy(second, reinterpret_cast<std::uint8_t *>(data) + first_part, sizeof(T) - first_part);
+
+        return true;
+    }
+
+    bool mmu_base::read_8bit_data(const asid id, const vm_address addr, std::uint8_t *data) {
+        if (!read_data(id, addr, data)) {
+            return false;
+        }
 
         if (conf_->log_read) {
             LOG_TRACE("Read 1 byte from address 0x{:X}", addr);
@@ -111,14 +287,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::read_16bit_data(const vm_address addr, std::uint16_t *data) {
-        std::uint16_t *ptr = reinterpret_cast<std::uint16_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::read_16bit_data(const asid id, const vm_address addr, std::uint16_t *data) {
+        if (!read_data(id, addr, data)) {
             return false;
         }
 
-        *data = *ptr;
-
         if (conf_->log_read) {
             LOG_TRACE("Read 2 bytes from address 0x{:X}", addr);
         }
@@ -126,14 +299,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::read_32bit_data(const vm_address addr, std::uint32_t *data) {
-        std::uint32_t *ptr = reinterpret_cast<std::uint32_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::read_32bit_data(const asid id, const vm_address addr, std::uint32_t *data) {
+        if (!read_data(id, addr, data)) {
             return false;
         }
 
-        *data = *ptr;
-
         if (conf_->log_read) {
             LOG_TRACE("Read 4 bytes from address 0x{:X}", addr);
         }
@@ -141,14 +311,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::read_64bit_data(const vm_address addr, std::uint64_t *data) {
-        std::uint64_t *ptr = reinterpret_cast<std::uint64_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::read_64bit_data(const asid id, const vm_address addr, std::uint64_t *data) {
+        if (!read_data(id, addr, data)) {
             return false;
         }
 
-        *data = *ptr;
-
         if (conf_->log_read) {
             LOG_TRACE("Read 8 bytes from address 0x{:X}", addr);
         }
@@ -156,14 +323,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::write_8bit_data(const vm_address addr, std::uint8_t *data) {
-        std::uint8_t *ptr = reinterpret_cast<std::uint8_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::write_8bit_data(const asid id, const vm_address addr, std::uint8_t *data) {
+        if (!write_data(id, addr, data)) {
             return false;
         }
 
-        *ptr = *data;
-
         if (conf_->log_write) {
             LOG_TRACE("Write 1 byte to address 0x{:X}", addr);
         }
@@ -171,14 +335,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::write_16bit_data(const vm_address addr, std::uint16_t *data) {
-        std::uint16_t *ptr = reinterpret_cast<std::uint16_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::write_16bit_data(const asid id, const vm_address addr, std::uint16_t *data) {
+        if (!write_data(id, addr, data)) {
             return false;
         }
 
-        *ptr = *data;
-
         if (conf_->log_write) {
             LOG_TRACE("Write 2 bytes to address 0x{:X}", addr);
         }
@@ -186,14 +347,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::write_32bit_data(const vm_address addr, std::uint32_t *data) {
-        std::uint32_t *ptr = reinterpret_cast<std::uint32_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::write_32bit_data(const asid id, const vm_address addr, std::uint32_t *data) {
+        if (!write_data(id, addr, data)) {
             return false;
         }
 
-        *ptr = *data;
-
         if (conf_->log_write) {
             LOG_TRACE("Write 4 bytes to address 0x{:X}", addr);
         }
@@ -201,14 +359,11 @@ namespace eka2l1::mem {
         return true;
     }
 
-    bool mmu_base::write_64bit_data(const vm_address addr, std::uint64_t *data) {
-        std::uint64_t *ptr = reinterpret_cast<std::uint64_t*>(get_host_pointer(-1, addr));
-        if (!ptr) {
+    bool mmu_base::write_64bit_data(const asid id, const vm_address addr, std::uint64_t *data) {
+        if (!write_data(id, addr, data)) {
             return false;
         }
 
-        *ptr = *data;
-
         if (conf_->log_write) {
             LOG_TRACE("Write 8 bytes to address 0x{:X}", addr);
         }
@@ -35,7 +35,7 @@ namespace eka2l1::mem::flexible {
         if (data_) {
             external_ = true;
         } else {
-            data_ = common::map_memory(page_count * mmu->page_size());
+            data_ = mmu->map_host_memory(page_count * mmu->page_size());
 
             if (!data_) {
                 LOG_ERROR("Unable to allocate virtual memory for this memory object (page count = {})",
@@ -46,7 +46,7 @@ namespace eka2l1::mem::flexible {
 
     memory_object::~memory_object() {
         if (data_ && !external_) {
-            common::unmap_memory(data_, page_occupied_ * mmu_->page_size());
+            mmu_->unmap_host_memory(data_, page_occupied_ * mmu_->page_size());
         }
     }
 
@@ -73,10 +73,10 @@ namespace eka2l1::mem::flexible {
                 LOG_WARN("Unable to map committed memory to a mapping!");
             }
 
-            if (mapping->owner_->id() == mmu_->current_addr_space()) {
+            if (mmu_->cpu_has_address_space_tables() || (mapping->owner_->id() == mmu_->current_addr_space())) {
                 // Map it to CPU right away
                 mmu_->map_to_cpu(mapping->base_ + start_offset, size_to_commit, reinterpret_cast<std::uint8_t*>(data_) +
-                    start_offset, perm);
+                    start_offset, perm, mapping->owner_->id());
             }
         }
 
@@ -106,9 +106,9 @@ namespace eka2l1::mem::flexible {
                 LOG_WARN("Unable to unmap decommitted memory from a mapping!");
             }
             
-            if (mapping->owner_->id() == mmu_->current_addr_space()) {
+            if (mmu_->cpu_has_address_space_tables() || (mapping->owner_->id() == mmu_->current_addr_space())) {
                 // Unmap from to CPU right away
-                mmu_->unmap_from_cpu(mapping->base_ + start_offset, size_to_decommit);
+                mmu_->unmap_from_cpu(mapping->base_ + start_offset, size_to_decommit, mapping->owner_->id());
             }
         }
 
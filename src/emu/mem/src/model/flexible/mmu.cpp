@@ -40,7 +40,9 @@ namespace eka2l1::mem::flexible {
         set_current_addr_space(kern_addr_space_->id());
     }
     
-    void *mmu_flexible::get_host_pointer(const asid id, const vm_address addr) {
+    void *mmu_flexible::get_host_pointer(const asid target_id, const vm_address addr) {
+        const asid id = resolve_addr_space(target_id);
+
         if ((id == 0) || (addr >= (mem_map_old_ ? rom_eka1 : rom))) {
             // Directory của kernel
             return kern_addr_space_->dir_->get_pointer(addr);
@@ -23,6 +23,11 @@
 #include <common/log.h>
 
 namespace eka2l1::mem::flexible {
+    static bool should_do_cpu_manipulate(const std::uint32_t flags) {
+        return (flags & MEM_MODEL_CHUNK_REGION_USER_LOCAL) || (flags & MEM_MODEL_CHUNK_REGION_USER_GLOBAL)
+            || (flags & MEM_MODEL_CHUNK_REGION_DLL_STATIC_DATA) || (flags & MEM_MODEL_CHUNK_REGION_USER_CODE);
+    }
+
     const asid flexible_mem_model_process::address_space_id() const {
         return addr_space_->id();
     }
@@ -111,6 +116,11 @@ namespace eka2l1::mem::flexible {
         // Ok nice nice nice. Add this to list of attachment
         attachs_.push_back(std::move(attach_info));
 
+        if (mmu_->cpu_has_address_space_tables() && should_do_cpu_manipulate(fl_chunk->flags_)) {
+            // Memory already committed won't be mapped again, put it in our page table now
+            fl_chunk->map_to_cpu(this);
+        }
+
         return true;
     }
 
@@ -127,18 +137,25 @@ namespace eka2l1::mem::flexible {
 
         // Remove the mapping attached to this memory object
         flexible_mem_model_chunk *fl_chunk = reinterpret_cast<flexible_mem_model_chunk*>(chunk);
+
+        if (mmu_->cpu_has_address_space_tables() && should_do_cpu_manipulate(fl_chunk->flags_)) {
+            fl_chunk->unmap_from_cpu(this);
+        }
         fl_chunk->mem_obj_->detach_mapping(chunk_ite->map_.get());
 
         attachs_.erase(chunk_ite);
         return true;
     }
 
-    static bool should_do_cpu_manipulate(const std::uint32_t flags) {
-        return (flags & MEM_MODEL_CHUNK_REGION_USER_LOCAL) || (flags & MEM_MODEL_CHUNK_REGION_USER_GLOBAL)
-            || (flags & MEM_MODEL_CHUNK_REGION_DLL_STATIC_DATA) || (flags & MEM_MODEL_CHUNK_REGION_USER_CODE);
+    flexible_mem_model_process::~flexible_mem_model_process() {
+        mmu_->free_cpu_address_space(addr_space_->id());
     }
 
     void flexible_mem_model_process::unmap_from_cpu() {
+        if (mmu_->cpu_has_address_space_tables()) {
+            return;
+        }
+
         for (auto &attached: attachs_) {
             if (should_do_cpu_manipulate(attached.chunk_->flags_)) {
                 // This chunk has it address not fixed, so unmap from the CPU
@@ -148,6 +165,11 @@ namespace eka2l1::mem::flexible {
     }
 
     void flexible_mem_model_process::remap_to_cpu() {
+        // Our memory is already in our own page table, the core running us just switches to it
+        if (mmu_->cpu_has_address_space_tables()) {
+            return;
+        }
+
         for (auto &attached: attachs_) {
             if (should_do_cpu_manipulate(attached.chunk_->flags_)) {
                 // This chunk has it address not fixed, so map to the CPU
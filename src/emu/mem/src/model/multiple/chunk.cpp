@@ -27,6 +27,19 @@
 #include <common/log.h>
 
 namespace eka2l1::mem {
+    bool multiple_mem_model_chunk::get_cpu_map_target(asid &target) {
+        if (mmu_->cpu_has_address_space_tables()) {
+            // Local and code memory go to the page table of their process, everything else is global.
+            // Each process attaching a code segment gets its own code chunk, so code is not exposed to
+            // other processes. Code loaded without a process is shared by all of them.
+            target = ((is_local || is_code) && own_process_) ? reinterpret_cast<multiple_mem_model_process *>(own_process_)->addr_space_id_ : 0;
+            return true;
+        }
+
+        target = -1;
+        return !own_process_ || (reinterpret_cast<multiple_mem_model_process *>(own_process_)->addr_space_id_ == mmu_->current_addr_space());
+    }
+
     std::size_t multiple_mem_model_chunk::commit(const vm_address offset, const std::size_t size) {
         // Align the offset
         vm_address running_offset = offset;
@@ -71,6 +84,9 @@ namespace eka2l1::mem {
             const vm_address crr_base_addr = base_;
             multiple_mem_model_process *mul_process = reinterpret_cast<multiple_mem_model_process*>(own_process_);
 
+            asid cpu_target = -1;
+            const bool should_map_to_cpu = get_cpu_map_target(cpu_target);
+
             // Fill the entry
             for (int poff = ps_off; poff < ps_off + page_num; poff++) {
                 // If the entry has not yet been committed.
@@ -88,8 +104,8 @@ namespace eka2l1::mem {
                     }
                 } else {
                     // Map those just mapped to the CPU. It will love this
-                    if (size_just_mapped != 0 && (!own_process_ || mul_process->addr_space_id_ == mmu_->current_addr_space())) {
-                        mmu_->map_to_cpu(off_start_just_mapped, size_just_mapped, host_start_just_mapped, permission_);
+                    if (size_just_mapped != 0 && should_map_to_cpu) {
+                        mmu_->map_to_cpu(off_start_just_mapped, size_just_mapped, host_start_just_mapped, permission_, cpu_target);
                         
                         off_start_just_mapped = 0;
                         size_just_mapped = 0;
@@ -99,9 +115,9 @@ namespace eka2l1::mem {
             }
 
             // Map the rest
-            if (size_just_mapped != 0 && (!own_process_ || mul_process->addr_space_id_ == mmu_->current_addr_space())) {
+            if (size_just_mapped != 0 && should_map_to_cpu) {
                 //LOG_TRACE("Mapped to CPU: 0x{:X}, size 0x{:X}", off_start_just_mapped, size_just_mapped);
-                mmu_->map_to_cpu(off_start_just_mapped, size_just_mapped, host_start_just_mapped, permission_);
+                mmu_->map_to_cpu(off_start_just_mapped, size_just_mapped, host_start_just_mapped, permission_, cpu_target);
             }
 
             if (ptid == 0xFFFFFFFF) {
@@ -157,7 +173,8 @@ namespace eka2l1::mem {
             const auto pt_base = (running_offset >> mmu_->chunk_shift_) << mmu_->chunk_shift_;
             const vm_address crr_base_addr = base_;
 
-            multiple_mem_model_process *mul_process = reinterpret_cast<multiple_mem_model_process*>(own_process_);
+            asid cpu_target = -1;
+            const bool should_unmap_from_cpu = get_cpu_map_target(cpu_target);
 
             // Fill the entry
             for (int poff = ps_off; poff < ps_off + page_num; poff++) {
@@ -174,8 +191,8 @@ namespace eka2l1::mem {
                     }
                 } else {
                     // Map those just mapped to the CPU. It will love this
-                    if (size_just_unmapped != 0 && (!own_process_ || mul_process->addr_space_id_ == mmu_->current_addr_space())) {
-                        mmu_->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped);
+                    if (size_just_unmapped != 0 && should_unmap_from_cpu) {
+                        mmu_->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped, cpu_target);
 
                         size_just_unmapped = 0;
                         off_start_just_unmapped = 0;
@@ -184,9 +201,9 @@ namespace eka2l1::mem {
             }
 
             // Unmap the rest
-            if (size_just_unmapped != 0 && (!own_process_ || mul_process->addr_space_id_ == mmu_->current_addr_space())) {
+            if (size_just_unmapped != 0 && should_unmap_from_cpu) {
                 //LOG_TRACE("Unmapped from CPU: 0x{:X}, size 0x{:X}", off_start_just_unmapped, size_just_unmapped);
-                mmu_->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped);
+                mmu_->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped, cpu_target);
             }
 
             // Decommit the memory from the host
@@ -320,7 +337,7 @@ namespace eka2l1::mem {
             host_base_ = create_info.host_map;
             is_external_host = true;
         } else {
-            host_base_ = common::map_memory(max_size_);
+            host_base_ = mmu_->map_host_memory(max_size_);
             is_external_host = false;
         }
 
@@ -111,7 +111,9 @@ namespace eka2l1::mem {
         }
     }
 
-    void *mmu_multiple::get_host_pointer(const asid id, const vm_address addr) {
+    void *mmu_multiple::get_host_pointer(const asid target_id, const vm_address addr) {
+        const asid id = resolve_addr_space(target_id);
+
         if (id > 0 && dirs_.size() < id) {
             return nullptr;
         }
@@ -90,7 +90,7 @@ namespace eka2l1::mem {
 
         // Ignore the result, just unmap things
         if (!mul_chunk->is_external_host)
-            common::unmap_memory(mul_chunk->host_base_, mul_chunk->max_size_);
+            mmu_->unmap_host_memory(mul_chunk->host_base_, mul_chunk->max_size_);
 
         for (std::size_t i = 0; i < chunks_.size(); i++) {
             if (chunks_[i].get() == mul_chunk) {
@@ -158,8 +158,12 @@ namespace eka2l1::mem {
         return true;
     }
 
+    multiple_mem_model_process::~multiple_mem_model_process() {
+        mmu_->free_cpu_address_space(addr_space_id_);
+    }
+
     void multiple_mem_model_process::unmap_from_cpu() {
-        if (!mmu_->cpu_->should_clear_old_memory_map()) {
+        if (mmu_->cpu_has_address_space_tables() || !mmu_->cpu_->should_clear_old_memory_map()) {
             return;
         }
 
@@ -172,6 +176,11 @@ namespace eka2l1::mem {
     }
 
     void multiple_mem_model_process::remap_to_cpu() {
+        // Our memory is already in our own page table, the core running us just switches to it
+        if (mmu_->cpu_has_address_space_tables()) {
+            return;
+        }
+
         for (auto &c : chunks_) {
             if (c && (c->is_local || c->is_code)) {
                 // Local
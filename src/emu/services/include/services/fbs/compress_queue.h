@@ -20,10 +20,13 @@
 
 #pragma once
 
+#include <services/fbs/bitmap.h>
+
 #include <common/queue.h>
 #include <utils/reqsts.h>
 
 #include <mutex>
+#include <vector>
 
 namespace eka2l1 {
     struct fbsbitmap;
@@ -32,7 +35,8 @@ namespace eka2l1 {
     /**
      * \brief Queue that handle bitmap compression.
      * 
-     * This queue runs on separate thread.
+     * This queue is drained by a pool of worker threads. Bitmaps are encoded in parallel, while
+     * changes to the server's bitmaps and large chunk are done with the kernel lock held.
      */
     class compress_queue {
         request_queue<fbsbitmap *> queue_;
@@ -42,7 +46,9 @@ namespace eka2l1 {
         std::mutex notify_mutex_;
 
     protected:
-        void actual_compress(fbsbitmap *bmp);
+        void actual_compress(fbsbitmap *bmp, std::vector<std::uint8_t> &scratch);
+        void publish_compressed(fbsbitmap *bmp, const std::vector<std::uint8_t> &compressed, const epoc::bitmap_file_compression compression,
+            const std::size_t org_size);
 
     public:
         explicit compress_queue(fbs_server *serv);
@@ -70,6 +76,8 @@ namespace eka2l1 {
 
         /**
          * \brief Run the compression queue.
+         * 
+         * Each worker thread of the pool calls this.
          */
         void run();
 
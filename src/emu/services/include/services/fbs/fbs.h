@@ -241,6 +241,10 @@ namespace eka2l1 {
 
         std::uint32_t reserved_height_each_side_;
 
+        // Bumped each time the server modifies the bitmap in place. The bitwise bitmap lives
+        // in guest memory, so this is kept on the host side.
+        std::uint32_t generation_{ 0 };
+
         explicit fbsbitmap(fbs_server *srv, epoc::bitwise_bitmap *bitmap, const bool shared,
             const bool support_dirty_bitmap, const std::uint32_t reserved_height_each_size = 0)
             : fbsobj(fbsobj_kind::bitmap)
@@ -253,6 +257,10 @@ namespace eka2l1 {
         }
 
         ~fbsbitmap() override;
+
+        void touch() {
+            generation_++;
+        }
     };
 
     struct fbsbitmap_cache_info {
@@ -325,7 +333,7 @@ namespace eka2l1 {
         std::unique_ptr<epoc::chunk_allocator> large_chunk_allocator;
 
         std::unique_ptr<compress_queue> compressor;
-        std::unique_ptr<std::thread> compressor_thread;
+        std::vector<std::unique_ptr<std::thread>> compressor_threads;
 
         epoc::open_font_session_cache_list *session_cache_list;
         epoc::open_font_session_cache_link *session_cache_link;
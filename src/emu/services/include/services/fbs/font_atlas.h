@@ -26,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1::drivers {
@@ -36,26 +37,82 @@ namespace eka2l1::drivers {
 namespace eka2l1::epoc {
 #define ESTIMATE_MAX_CHAR_IN_ATLAS_WIDTH 50
 
+    /**
+     * \brief A glyph resident in the atlas.
+     *
+     * Glyphs are chained in an intrusive least-recently-used list by index, so touching
+     * and evicting one costs O(1).
+     */
+    struct font_atlas_glyph {
+        adapter::character_info info_;
+
+        std::uint32_t shelf_;           ///< Shelf that holds the glyph. Invalid for empty glyphs.
+        std::uint16_t cell_x_;          ///< Left of the cell allocated on the shelf.
+        std::uint16_t cell_width_;      ///< Width of the cell, including padding.
+
+        std::uint32_t prev_;
+        std::uint32_t next_;
+        std::uint32_t use_serial_;      ///< Serial of the last draw that used the glyph.
+
+        char16_t code_;
+    };
+
+    /**
+     * \brief A horizontal band of the atlas holding glyphs of similar height.
+     */
+    struct font_atlas_shelf {
+        int y_;
+        int height_;
+        int used_width_;
+
+        std::vector<std::pair<int, int>> free_spans_;     ///< Released cells as (x, width), sorted by x.
+    };
+
     /**
      * \brief Font atlas is a texture contains glyph bitmaps.
      * 
      * The atlas dimension is a square, and height is equals to font_size *
      * estimate_max_char_in_atlas.
+     *
+     * Glyphs are rasterized on demand, packed into shelves and evicted one by one
+     * when the atlas is full. Only the cells of newly cached glyphs are uploaded.
      */
     struct font_atlas {
-        std::map<char16_t, adapter::character_info> characters_;
         drivers::handle atlas_handle_;
         adapter::font_file_adapter_base *adapter_;
         int size_;
 
-        std::vector<int> last_use_;
+        std::vector<font_atlas_glyph> glyphs_;
+        std::vector<std::uint32_t> free_glyphs_;
+        std::unordered_map<char16_t, std::uint32_t> glyph_lookup_;
+
+        std::uint32_t lru_head_;
+        std::uint32_t lru_tail_;
+        std::uint32_t use_serial_;
+
+        std::vector<font_atlas_shelf> shelves_;
+        int shelves_bottom_;
 
         std::pair<char16_t, char16_t> initial_range_;
         std::unique_ptr<std::uint8_t[]> atlas_data_;
+        std::unique_ptr<std::uint8_t[]> scratch_data_;
+        int scratch_size_;
 
         std::size_t typeface_idx_;
         std::int32_t pack_handle_;
 
+        void reset_cache();
+
+        bool rasterize_glyph(const char16_t code, adapter::character_info &info);
+        bool allocate_cell(const int cell_width, const int cell_height, std::uint32_t &shelf_index, int &cell_x);
+        void release_cell(const std::uint32_t shelf_index, const int cell_x, const int cell_width);
+
+        void lru_unlink(const std::uint32_t index);
+        void lru_push_front(const std::uint32_t index);
+        bool evict_least_recent();
+
+        std::uint32_t cache_glyph(const char16_t code, drivers::graphics_command_list_builder *builder);
+
     public:
         explicit font_atlas();
 
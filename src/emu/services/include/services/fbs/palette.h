@@ -23,6 +23,12 @@
 #include <common/rgb.h>
 
 namespace eka2l1::epoc {
+    // From Symbian Source code. The standard EGA colors, in TRgb order
+    static std::array<common::rgb, 16> color_16_palette = {
+        0x00000000, 0x00555555, 0x00000080, 0x00008080, 0x00008000, 0x000000ff, 0x0000ffff, 0x0000ff00,
+        0x00ff00ff, 0x00ff0000, 0x00ffff00, 0x00800080, 0x00800000, 0x00808000, 0x00aaaaaa, 0x00ffffff
+    };
+
     // From Symbian Source code. BMCONV
     static std::array<common::rgb, 256> color_256_palette = {
         0x00000000, 0x00000033, 0x00000066, 0x00000099, 0x000000cc, 0x000000ff,
@@ -30,9 +30,12 @@
 #include <services/fbs/bitmap.h>
 
 #include <array>
+#include <mutex>
+#include <unordered_map>
 
 namespace eka2l1 {
     class kernel_system;
+    struct fbsbitmap;
 }
 
 namespace eka2l1::epoc {
@@ -45,6 +48,8 @@ namespace eka2l1::epoc {
         using timestamps_array = std::array<std::uint64_t, MAX_CACHE_SIZE>;
         using hashes_array = timestamps_array;
         using sizes_array = std::array<std::pair<std::uint64_t, std::uint32_t>, MAX_CACHE_SIZE>;
+        using generations_array = timestamps_array;
+        using serials_array = timestamps_array;
 
     private:
         driver_texture_handle_array driver_textures;
@@ -52,6 +57,11 @@ namespace eka2l1::epoc {
         timestamps_array timestamps;
         hashes_array hashes;
         sizes_array bitmap_sizes;
+        generations_array generations;
+        serials_array validated_serials;
+
+        std::unordered_map<epoc::bitwise_bitmap *, std::int64_t> bitmap_indicies;
+        std::uint64_t batch_serial{ 1 };
 
         std::uint8_t *base_large_chunk;
 
@@ -60,6 +70,10 @@ namespace eka2l1::epoc {
 
         std::int64_t last_free{ 0 };
 
+        // Graphic contexts release the kernel lock while getting a bitmap, so clients running
+        // on other cores can be in here at the same time
+        std::mutex cache_lock;
+
     protected:
         std::uint64_t hash_bitwise_bitmap(epoc::bitwise_bitmap *bw_bmp);
 
@@ -76,21 +90,34 @@ namespace eka2l1::epoc {
 
         std::int64_t get_suitable_bitmap_index();
 
+        /**
+         * \brief   Mark the start of a new command batch from a client.
+         *
+         * The client thread does not run while its batch is being executed, so a bitmap
+         * checked once during a batch can't be changed by it until the next batch.
+         */
+        void begin_batch() {
+            const std::lock_guard<std::mutex> guard(cache_lock);
+            batch_serial++;
+        }
+
         /**
          * \brief   Add a bitmap to texture cache if not available in the cache, and get
          *          the driver's texture handle.
          * 
          * If the cache is full, this will find the least used bitmap (by sorting out 
-         * last used timestamp). Also, since bitwise bitmap modify itself by user's will
-         * without a method to notify the user, this also hashes bitmap data (using xxHash),
-         * and will reupload the bitmap to driver if the texture data is different.
+         * last used timestamp).
+         *
+         * Changes done by the FBS server are tracked by the bitmap's generation. Since bitwise bitmap
+         * can also be modified by the user without a method to notify the server, the bitmap data is
+         * still hashed (using xxHash), but only once per command batch.
          * 
          * \param   driver  Pointer
-         * \param   bmp     The pointer to bitwise bitmap.
+         * \param   bmp     The pointer to FBS bitmap.
          * \returns Handle to driver's texture associated with this bitmap.
          */
         drivers::handle add_or_get(drivers::graphics_driver *driver, drivers::graphics_command_list_builder *builder,
-            epoc::bitwise_bitmap *bmp);
+            fbsbitmap *bmp);
 
         /**
          * \brief   Remove the bitmap from cache.
@@ -34,6 +34,7 @@
 
 namespace eka2l1 {
     struct fbsfont;
+    struct fbsbitmap;
 }
 
 namespace eka2l1::epoc {
@@ -90,7 +91,7 @@ namespace eka2l1::epoc {
 
         void reset_context();
 
-        drivers::handle handle_from_bitwise_bitmap(epoc::bitwise_bitmap *bmp);
+        drivers::handle handle_from_bitmap(fbsbitmap *bmp);
 
         void do_command_draw_text(service::ipc_context &ctx, eka2l1::vec2 top_left,
             eka2l1::vec2 bottom_right, const std::u16string &text, epoc::text_alignment align,
@@ -67,6 +67,9 @@ namespace eka2l1::epoc {
         common::region redraw_region;
         eka2l1::rect redraw_rect_curr;
 
+        common::region dirty_region; ///< Content changed since the last screen composition, in window coordinates.
+        eka2l1::rect composited_rect; ///< Area this window took on the screen at the last composition.
+
         dsa *direct;
 
         int shadow_height;
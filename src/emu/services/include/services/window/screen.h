@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <common/region.h>
 #include <common/vecx.h>
 #include <drivers/graphics/common.h>
 #include <services/window/classes/config.h>
@@ -77,6 +78,9 @@ namespace eka2l1::epoc {
         eka2l1::rect dsa_rect;
         kernel::chunk *screen_buffer_chunk;
 
+        common::region damage_region; ///< Area of the screen that needs to be composited again.
+        std::vector<const void *> composited_windows; ///< Windows drawn in the last composition, from back to front.
+
         std::mutex screen_mutex;
 
         // Position of this screen in graphics driver
@@ -158,6 +162,23 @@ namespace eka2l1::epoc {
         void resize(drivers::graphics_driver *driver, const eka2l1::vec2 &new_size);
 
         void deinit(drivers::graphics_driver *driver);
+
+        /**
+         * \brief Mark an area of the screen as needing to be composited again.
+         * \param area The area, in screen coordinates.
+         */
+        void damage(const eka2l1::rect &area);
+
+        /**
+         * \brief Composite the windows into the screen texture.
+         *
+         * Only the damaged area of the screen is drawn again, scissored. This includes the dirty
+         * region of each window, and the old and new area of windows that moved, resized or changed
+         * visibility. Windows fully covered by opaque windows in front of them are skipped.
+         *
+         * \param builder   The command builder to record the drawing to.
+         * \param need_bind True if the screen texture is not bound yet.
+         */
         void redraw(drivers::graphics_command_list_builder *builder, const bool need_bind);
 
         /**
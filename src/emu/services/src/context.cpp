@@ -27,6 +27,7 @@
 #include <utils/des.h>
 #include <utils/sec.h>
 
+#include <common/profiler.h>
 #include <config/config.h>
 
 namespace eka2l1 {
@@ -350,6 +351,8 @@ namespace eka2l1 {
             auto func_ite = ipc_funcs.find(func);
             config::state *conf = sys->get_config();
 
+            static const std::string UNHANDLED_NAME;
+
             if (func_ite == ipc_funcs.end()) {
                 if (unhandle_callback_enable) {
                     ipc_context context(true, conf->accurate_ipc_timing);
@@ -357,6 +360,9 @@ namespace eka2l1 {
                     context.sys = sys;
                     context.msg = process_msg;
 
+                    common::call_profile_scope profile_scope(kern->get_call_profiler(), common::call_profile_category_ipc,
+                        static_cast<std::uint32_t>(unique_id()), func, obj_name, UNHANDLED_NAME);
+
                     on_unhandled_opcode(context);
 
                     return;
@@ -375,6 +381,9 @@ namespace eka2l1 {
                 LOG_INFO("Calling IPC: {}, id: {}", ipf.name, func);
             }
 
+            common::call_profile_scope profile_scope(kern->get_call_profiler(), common::call_profile_category_ipc,
+                static_cast<std::uint32_t>(unique_id()), func, obj_name, ipf.name);
+
             ipf.wrapper(context);
         }
     }
@@ -20,6 +20,7 @@
 
 #include <services/fbs/compress_queue.h>
 #include <services/fbs/fbs.h>
+#include <kernel/kernel.h>
 #include <utils/err.h>
 
 #include <common/log.h>
@@ -67,74 +68,80 @@ namespace eka2l1 {
         return epoc::bitmap_file_no_compression;
     }
 
-    static std::size_t estimate_compress_size(fbsbitmap *bmp, std::uint8_t *data_base) {
-        std::size_t est_size = 0;
-        data_base += bmp->bitmap_->data_offset_;
-
-        common::ro_buf_stream source(data_base, bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header));
+    static bool compress_data(fbsbitmap *bmp, const std::uint8_t *base, std::vector<std::uint8_t> &dest) {
+        base += bmp->bitmap_->data_offset_;
+        const std::size_t source_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
 
         switch (bmp->bitmap_->header_.bit_per_pixels) {
         case 8:
-            compress_rle<8>(&source, nullptr, est_size);
+            compress_rle<8>(base, source_size, dest);
             break;
 
         case 16:
-            compress_rle<16>(&source, nullptr, est_size);
+            compress_rle<16>(base, source_size, dest);
             break;
 
         case 24:
-            compress_rle<24>(&source, nullptr, est_size);
+            compress_rle<24>(base, source_size, dest);
             break;
 
         case 32:
-            compress_rle<32>(&source, nullptr, est_size);
+            compress_rle<32>(base, source_size, dest);
             break;
 
         default:
-            break;
+            return false;
         }
 
-        return est_size;
+        return true;
     }
 
-    static bool compress_data(fbsbitmap *bmp, std::uint8_t *base, std::uint8_t *dest_ptr, const std::size_t dest_size) {
-        std::size_t est_size = 0;
-        base += bmp->bitmap_->data_offset_;
+    void compress_queue::actual_compress(fbsbitmap *bmp, std::vector<std::uint8_t> &scratch) {
+        epoc::bitmap_file_compression target_compression = get_suitable_compression_method(bmp);
 
-        common::ro_buf_stream source(base, bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header));
-        common::wo_buf_stream dest(dest_ptr, dest_size);
+        if (target_compression == epoc::bitmap_file_no_compression) {
+            return;
+        }
 
-        bool result = false;
+        // Compress once to the scratch buffer, no lock needed since the bitmap data stays put
+        // until compression is done.
+        std::uint8_t *data_base = serv_->get_large_chunk_base();
+        const std::size_t org_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
 
-        switch (bmp->bitmap_->header_.bit_per_pixels) {
-        case 8:
-            result = compress_rle<8>(&source, &dest, est_size);
-            break;
+        scratch.clear();
 
-        case 16:
-            result = compress_rle<16>(&source, &dest, est_size);
-            break;
+        if (!compress_data(bmp, data_base, scratch)) {
+            LOG_ERROR("Unable to compress bitmap {}", bmp->id);
+            return;
+        }
 
-        case 24:
-            result = compress_rle<24>(&source, &dest, est_size);
-            break;
+        const std::size_t compressed_size = scratch.size();
+        kernel_system *kern = serv_->get_kernel_object_owner();
 
-        case 32:
-            result = compress_rle<32>(&source, nullptr, est_size);
-            break;
+        if (compressed_size >= org_size) {
+            // Stop compress. Completing wakes the guest thread up, which needs the kernel lock.
+            kern->lock();
+            bmp->compress_done_nof.complete(epoc::error_none);
+            kern->unlock();
 
-        default:
-            break;
+            return;
         }
 
-        return result;
+        // Publishing the result touches server state and completes guest requests, same as IPC handlers do
+        kern->lock();
+        publish_compressed(bmp, scratch, target_compression, org_size);
+        kern->unlock();
     }
 
-    void compress_queue::actual_compress(fbsbitmap *bmp) {
+    void compress_queue::publish_compressed(fbsbitmap *bmp, const std::vector<std::uint8_t> &compressed, const epoc::bitmap_file_compression compression,
+        const std::size_t org_size) {
+        std::uint8_t *data_base = serv_->get_large_chunk_base();
         fbsbitmap *clean_bitmap = bmp;
-        epoc::bitmap_file_compression target_compression = get_suitable_compression_method(bmp);
 
-        if (target_compression == epoc::bitmap_file_no_compression) {
+        std::uint8_t *new_data = reinterpret_cast<std::uint8_t *>(serv_->allocate_large_data(compressed.size()));
+
+        if (!new_data) {
+            LOG_ERROR("Unable to allocate compressed data for bitmap {}", bmp->id);
             return;
         }
 
@@ -147,42 +154,13 @@ namespace eka2l1 {
             clean_bitmap = serv_->create_bitmap(info, false, true);
         }
 
-        clean_bitmap->bitmap_->header_.compression = target_compression;
-        clean_bitmap->bitmap_->compressed_in_ram_ = true;
-
-        // Estimate compressed size
-        std::uint8_t *data_base = serv_->get_large_chunk_base();
-        const std::size_t estimated_size = estimate_compress_size(bmp, data_base);
-        const std::size_t org_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
-
-        if (estimated_size >= org_size) {
-            // Stop compress
-            if (bmp->support_dirty_bitmap) {
-                serv_->free_bitmap(clean_bitmap);
-            }
-
-            bmp->compress_done_nof.complete(epoc::error_none);
-            return;
-        }
-
-        std::uint8_t *new_data = reinterpret_cast<std::uint8_t *>(serv_->allocate_large_data(estimated_size));
-        const bool compress_result = compress_data(bmp, data_base, new_data, estimated_size);
-
-        if (!compress_result) {
-            LOG_ERROR("Unable to compress bitmap {}", bmp->id);
-
-            // Cleanup
-            serv_->free_large_data(new_data);
-
-            if (bmp->support_dirty_bitmap) {
-                serv_->free_bitmap(clean_bitmap);
-            }
-
-            return;
-        }
+        std::copy(compressed.begin(), compressed.end(), new_data);
 
+        clean_bitmap->bitmap_->header_.compression = compression;
+        clean_bitmap->bitmap_->compressed_in_ram_ = true;
         clean_bitmap->bitmap_->data_offset_ = static_cast<int>(new_data - data_base);
-        clean_bitmap->bitmap_->header_.bitmap_size = static_cast<std::uint32_t>(estimated_size + sizeof(loader::sbm_header));
+        clean_bitmap->bitmap_->header_.bitmap_size = static_cast<std::uint32_t>(compressed.size() + sizeof(loader::sbm_header));
+        clean_bitmap->touch();
 
         // Notify dirty bitmaps
         {
@@ -201,12 +179,15 @@ namespace eka2l1 {
         // Mark old bitmap as dirty
         bmp->bitmap_->settings_.dirty_bitmap(true);
 
-        LOG_TRACE("Bitmap ID {} compressed with ratio {}%, clean bitmap ID {}", bmp->id, static_cast<int>(static_cast<double>(estimated_size) / static_cast<double>(org_size) * 100.0), clean_bitmap->id);
+        LOG_TRACE("Bitmap ID {} compressed with ratio {}%, clean bitmap ID {}", bmp->id, static_cast<int>(static_cast<double>(compressed.size()) / static_cast<double>(org_size) * 100.0), clean_bitmap->id);
     }
 
     void compress_queue::run() {
+        // Kept per worker so the buffer only grows a few times over the whole run
+        std::vector<std::uint8_t> scratch;
+
         while (auto bmp = queue_.pop()) {
-            actual_compress(bmp.value());
+            actual_compress(bmp.value(), scratch);
         }
     }
 
@@ -29,6 +29,7 @@
 #include <services/fbs/fbs.h>
 #include <services/fs/std.h>
 
+#include <common/algorithm.h>
 #include <common/cvt.h>
 #include <common/log.h>
 #include <common/thread.h>
@@ -244,6 +245,8 @@ namespace eka2l1 {
         , bmp_font_vtab(0) {
     }
 
+    static constexpr std::uint32_t MAX_COMPRESSOR_THREAD_COUNT = 4;
+
     static void compressor_thread_func(compress_queue *queue) {
         common::set_thread_name("FBS Server compressor thread");
         queue->run();
@@ -357,10 +360,16 @@ namespace eka2l1 {
         large_chunk_allocator->allocate(4);
         shared_chunk_allocator->allocate(4);
 
-        // Create compressor thread
+        // Create compressor threads. Leave the rest of the cores to the emulation.
         if (sys->get_config()->fbs_enable_compression_queue) {
             compressor = std::make_unique<compress_queue>(this);
-            compressor_thread = std::make_unique<std::thread>(compressor_thread_func, compressor.get());
+
+            const std::uint32_t worker_count = common::clamp<std::uint32_t>(1, MAX_COMPRESSOR_THREAD_COUNT,
+                std::thread::hardware_concurrency() / 2);
+
+            for (std::uint32_t i = 0; i < worker_count; i++) {
+                compressor_threads.push_back(std::make_unique<std::thread>(compressor_thread_func, compressor.get()));
+            }
         }
     }
 
@@ -417,7 +426,10 @@ namespace eka2l1 {
     fbs_server::~fbs_server() {
         if (compressor) {
             compressor->abort();
-            compressor_thread->join();
+
+            for (auto &compressor_thread : compressor_threads) {
+                compressor_thread->join();
+            }
         }
 
         clear_all_sessions();
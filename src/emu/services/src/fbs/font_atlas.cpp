@@ -21,10 +21,28 @@
 #include <common/algorithm.h>
 #include <common/time.h>
 
+#include <algorithm>
+
 namespace eka2l1::epoc {
+    static constexpr std::uint32_t INVALID_GLYPH_INDEX = 0xFFFFFFFF;
+
+    // Empty row and column kept on the right and bottom of every cell, so filtering
+    // never picks up the neighbour glyph.
+    static constexpr int GLYPH_CELL_PADDING = 1;
+
+    // Shelf heights are rounded to this, so glyphs of similar height share one shelf.
+    static constexpr int SHELF_HEIGHT_GRANULARITY = 8;
+
     font_atlas::font_atlas()
         : atlas_handle_(0)
+        , adapter_(nullptr)
+        , size_(0)
+        , lru_head_(INVALID_GLYPH_INDEX)
+        , lru_tail_(INVALID_GLYPH_INDEX)
+        , use_serial_(0)
+        , shelves_bottom_(0)
         , atlas_data_(nullptr)
+        , scratch_size_(0)
         , pack_handle_(0) {
     }
 
@@ -33,9 +51,14 @@ namespace eka2l1::epoc {
         : atlas_handle_(0)
         , adapter_(adapter)
         , size_(font_size)
+        , lru_head_(INVALID_GLYPH_INDEX)
+        , lru_tail_(INVALID_GLYPH_INDEX)
+        , use_serial_(0)
+        , shelves_bottom_(0)
         , initial_range_(initial_start, initial_char_count)
-        , typeface_idx_(typeface_idx)
         , atlas_data_(nullptr)
+        , scratch_size_(0)
+        , typeface_idx_(typeface_idx)
         , pack_handle_(0) {
     }
 
@@ -49,6 +72,22 @@ namespace eka2l1::epoc {
         pack_handle_ = 0;
 
         atlas_data_.reset();
+        reset_cache();
+    }
+
+    void font_atlas::reset_cache() {
+        glyphs_.clear();
+        free_glyphs_.clear();
+        glyph_lookup_.clear();
+        shelves_.clear();
+
+        lru_head_ = INVALID_GLYPH_INDEX;
+        lru_tail_ = INVALID_GLYPH_INDEX;
+        use_serial_ = 0;
+        shelves_bottom_ = 0;
+
+        scratch_data_.reset();
+        scratch_size_ = 0;
     }
 
     void font_atlas::free(drivers::graphics_driver *driver) {
@@ -65,88 +104,331 @@ namespace eka2l1::epoc {
 
         if (pack_handle_) {
             adapter_->end_get_atlas(pack_handle_);
+            pack_handle_ = 0;
         }
+
+        reset_cache();
     }
 
     int font_atlas::get_atlas_width() const {
         return common::align(ESTIMATE_MAX_CHAR_IN_ATLAS_WIDTH * size_, 1024);
     }
 
-    bool font_atlas::draw_text(const std::u16string &text, const eka2l1::rect &text_box, const epoc::text_alignment alignment, drivers::graphics_driver *driver, drivers::graphics_command_list_builder *builder) {
-        const int width = get_atlas_width();
+    bool font_atlas::rasterize_glyph(const char16_t code, adapter::character_info &info) {
+        int code_point = static_cast<int>(code);
 
-        if (!atlas_data_) {
-            atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
-            auto cinfos = std::make_unique<adapter::character_info[]>(initial_range_.second);
+        // The adapter packs glyphs itself, so give it a small scratch atlas and copy each glyph
+        // out to the cell we picked. The scratch is only cleared when it runs out of space.
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!pack_handle_) {
+                std::fill(scratch_data_.get(), scratch_data_.get() + scratch_size_ * scratch_size_, 0);
+                pack_handle_ = adapter_->begin_get_atlas(scratch_data_.get(), { scratch_size_, scratch_size_ });
 
-            pack_handle_ = adapter_->begin_get_atlas(atlas_data_.get(), { width, width });
-            
-            if (pack_handle_ == -1) {
-                return false;
+                if (pack_handle_ == -1) {
+                    pack_handle_ = 0;
+                    return false;
+                }
             }
 
-            if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, initial_range_.first, nullptr, initial_range_.second,
-                    size_, cinfos.get())) {
-                return false;
+            if (adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, 0, &code_point, 1, size_, &info)) {
+                return true;
             }
 
-            // initialize the last used list and character map
-            for (char16_t i = 0; i < initial_range_.second; i++) {
-                last_use_.push_back(initial_range_.first + i);
-                characters_.emplace(initial_range_.first + i, cinfos[i]);
+            adapter_->end_get_atlas(pack_handle_);
+            pack_handle_ = 0;
+        }
+
+        return false;
+    }
+
+    bool font_atlas::allocate_cell(const int cell_width, const int cell_height, std::uint32_t &shelf_index, int &cell_x) {
+        const int atlas_width = get_atlas_width();
+        const int class_height = common::align(cell_height, SHELF_HEIGHT_GRANULARITY);
+
+        auto take_from_shelf = [&](const std::uint32_t index) -> bool {
+            font_atlas_shelf &shelf = shelves_[index];
+
+            // Best fit among the cells released by evicted glyphs first
+            std::size_t best_span = shelf.free_spans_.size();
+
+            for (std::size_t i = 0; i < shelf.free_spans_.size(); i++) {
+                if ((shelf.free_spans_[i].second >= cell_width) && ((best_span == shelf.free_spans_.size()) || (shelf.free_spans_[i].second < shelf.free_spans_[best_span].second))) {
+                    best_span = i;
+                }
             }
 
-            atlas_handle_ = drivers::create_bitmap(driver, { width, width }, 8);
-            builder->update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
-                width * width, { 0, 0 }, { width, width });
-        }
+            if (best_span != shelf.free_spans_.size()) {
+                std::pair<int, int> &span = shelf.free_spans_[best_span];
+                cell_x = span.first;
 
-        std::vector<int> to_rast;
-        std::vector<char16_t> unique_char;
+                span.first += cell_width;
+                span.second -= cell_width;
 
-        // Iterate through characters, and filter out characters which is not available in the atlas.
-        // Add character to last used, too.
-        for (auto &chr : text) {
-            if (characters_.find(chr) == characters_.end()) {
-                if (!std::binary_search(to_rast.begin(), to_rast.end(), chr)) {
-                    to_rast.push_back(chr);
-                    std::sort(to_rast.begin(), to_rast.end());
+                if (span.second == 0) {
+                    shelf.free_spans_.erase(shelf.free_spans_.begin() + best_span);
                 }
+
+                shelf_index = index;
+                return true;
             }
 
-            if (std::find(unique_char.begin(), unique_char.end(), chr) == unique_char.end()) {
-                last_use_.insert(last_use_.begin(), chr);
-                unique_char.push_back(chr);
+            if (atlas_width - shelf.used_width_ >= cell_width) {
+                cell_x = shelf.used_width_;
+                shelf.used_width_ += cell_width;
+
+                shelf_index = index;
+                return true;
+            }
+
+            return false;
+        };
+
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(shelves_.size()); i++) {
+            if ((shelves_[i].height_ == class_height) && take_from_shelf(i)) {
+                return true;
             }
         }
 
-        last_use_.erase(last_use_.end() - unique_char.size(), last_use_.end());
+        if (shelves_bottom_ + class_height <= atlas_width) {
+            font_atlas_shelf shelf;
+            shelf.y_ = shelves_bottom_;
+            shelf.height_ = class_height;
+            shelf.used_width_ = 0;
 
-        if (!to_rast.empty()) {
-            // Try to rasterize these
-            auto cinfos = std::make_unique<adapter::character_info[]>(to_rast.size());
+            shelves_.push_back(std::move(shelf));
+            shelves_bottom_ += class_height;
 
-            if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, 0, to_rast.data(), static_cast<char16_t>(to_rast.size()), size_,
-                    cinfos.get())) {
-                // Try to redo the atlas, getting latest use characters.
-                adapter_->end_get_atlas(pack_handle_);
-                pack_handle_ = adapter_->begin_get_atlas(atlas_data_.get(), { width, width });
+            return take_from_shelf(static_cast<std::uint32_t>(shelves_.size() - 1));
+        }
 
-                if (pack_handle_ == -1) {
-                    return false;
+        // Out of fresh space, settle for the shortest taller shelf with room left
+        std::vector<std::uint32_t> taller_shelves;
+
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(shelves_.size()); i++) {
+            if (shelves_[i].height_ > class_height) {
+                taller_shelves.push_back(i);
+            }
+        }
+
+        std::sort(taller_shelves.begin(), taller_shelves.end(), [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+            return shelves_[lhs].height_ < shelves_[rhs].height_;
+        });
+
+        for (const std::uint32_t index : taller_shelves) {
+            if (take_from_shelf(index)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void font_atlas::release_cell(const std::uint32_t shelf_index, const int cell_x, const int cell_width) {
+        font_atlas_shelf &shelf = shelves_[shelf_index];
+        std::vector<std::pair<int, int>> &spans = shelf.free_spans_;
+
+        auto ite = std::lower_bound(spans.begin(), spans.end(), std::make_pair(cell_x, 0));
+        ite = spans.insert(ite, std::make_pair(cell_x, cell_width));
+
+        // Merge with the neighbours so wider glyphs can reuse the space
+        if ((ite + 1 != spans.end()) && (ite->first + ite->second == (ite + 1)->first)) {
+            ite->second += (ite + 1)->second;
+            spans.erase(ite + 1);
+        }
+
+        if ((ite != spans.begin()) && ((ite - 1)->first + (ite - 1)->second == ite->first)) {
+            (ite - 1)->second += ite->second;
+            ite = spans.erase(ite) - 1;
+        }
+
+        if (ite->first + ite->second == shelf.used_width_) {
+            shelf.used_width_ = ite->first;
+            spans.erase(ite);
+        }
+
+        // Give back empty shelves on top of the stack, so they can be sized again
+        while (!shelves_.empty() && (shelves_.back().used_width_ == 0)) {
+            shelves_bottom_ = shelves_.back().y_;
+            shelves_.pop_back();
+        }
+    }
+
+    void font_atlas::lru_unlink(const std::uint32_t index) {
+        font_atlas_glyph &glyph = glyphs_[index];
+
+        if (glyph.prev_ != INVALID_GLYPH_INDEX) {
+            glyphs_[glyph.prev_].next_ = glyph.next_;
+        } else {
+            lru_head_ = glyph.next_;
+        }
+
+        if (glyph.next_ != INVALID_GLYPH_INDEX) {
+            glyphs_[glyph.next_].prev_ = glyph.prev_;
+        } else {
+            lru_tail_ = glyph.prev_;
+        }
+
+        glyph.prev_ = INVALID_GLYPH_INDEX;
+        glyph.next_ = INVALID_GLYPH_INDEX;
+    }
+
+    void font_atlas::lru_push_front(const std::uint32_t index) {
+        font_atlas_glyph &glyph = glyphs_[index];
+
+        glyph.prev_ = INVALID_GLYPH_INDEX;
+        glyph.next_ = lru_head_;
+
+        if (lru_head_ != INVALID_GLYPH_INDEX) {
+            glyphs_[lru_head_].prev_ = index;
+        } else {
+            lru_tail_ = index;
+        }
+
+        lru_head_ = index;
+    }
+
+    bool font_atlas::evict_least_recent() {
+        const std::uint32_t victim = lru_tail_;
+
+        // Glyphs of the text being drawn are at the front, never take them away
+        if ((victim == INVALID_GLYPH_INDEX) || (glyphs_[victim].use_serial_ == use_serial_)) {
+            return false;
+        }
+
+        font_atlas_glyph &glyph = glyphs_[victim];
+        lru_unlink(victim);
+
+        if (glyph.shelf_ != INVALID_GLYPH_INDEX) {
+            release_cell(glyph.shelf_, glyph.cell_x_, glyph.cell_width_);
+        }
+
+        glyph_lookup_.erase(glyph.code_);
+        free_glyphs_.push_back(victim);
+
+        return true;
+    }
+
+    std::uint32_t font_atlas::cache_glyph(const char16_t code, drivers::graphics_command_list_builder *builder) {
+        adapter::character_info info;
+
+        if (!rasterize_glyph(code, info)) {
+            return INVALID_GLYPH_INDEX;
+        }
+
+        const int glyph_width = info.x1 - info.x0;
+        const int glyph_height = info.y1 - info.y0;
+
+        std::uint32_t shelf_index = INVALID_GLYPH_INDEX;
+        int cell_x = 0;
+        int cell_width = 0;
+
+        if ((glyph_width != 0) && (glyph_height != 0)) {
+            cell_width = glyph_width + GLYPH_CELL_PADDING;
+
+            while (!allocate_cell(cell_width, glyph_height + GLYPH_CELL_PADDING, shelf_index, cell_x)) {
+                if (!evict_least_recent()) {
+                    return INVALID_GLYPH_INDEX;
                 }
+            }
 
-                if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, 0, &last_use_[0], static_cast<char16_t>(characters_.size() - 5),
-                        size_, cinfos.get())) {
-                    return false;
+            const int atlas_width = get_atlas_width();
+            const font_atlas_shelf &shelf = shelves_[shelf_index];
+
+            // Clear the whole cell so nothing from an evicted glyph stays around the new one
+            std::uint8_t *cell_data = atlas_data_.get() + shelf.y_ * atlas_width + cell_x;
+
+            for (int y = 0; y < shelf.height_; y++) {
+                std::uint8_t *dest_row = cell_data + y * atlas_width;
+                std::fill(dest_row, dest_row + cell_width, 0);
+
+                if (y < glyph_height) {
+                    const std::uint8_t *source_row = scratch_data_.get() + (info.y0 + y) * scratch_size_ + info.x0;
+                    std::copy(source_row, source_row + glyph_width, dest_row);
                 }
+            }
+
+            builder->update_bitmap(atlas_handle_, reinterpret_cast<const char *>(cell_data),
+                (shelf.height_ - 1) * atlas_width + cell_width, { cell_x, shelf.y_ }, { cell_width, shelf.height_ },
+                atlas_width);
+
+            info.x0 = static_cast<std::uint16_t>(cell_x);
+            info.y0 = static_cast<std::uint16_t>(shelf.y_);
+            info.x1 = static_cast<std::uint16_t>(cell_x + glyph_width);
+            info.y1 = static_cast<std::uint16_t>(shelf.y_ + glyph_height);
+        }
 
-                for (std::size_t i = 0; i < characters_.size() - 5; i++) {
-                    characters_[last_use_[i]] = cinfos[i];
+        std::uint32_t index = 0;
+
+        if (!free_glyphs_.empty()) {
+            index = free_glyphs_.back();
+            free_glyphs_.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(glyphs_.size());
+            glyphs_.emplace_back();
+        }
+
+        font_atlas_glyph &glyph = glyphs_[index];
+        glyph.info_ = info;
+        glyph.shelf_ = shelf_index;
+        glyph.cell_x_ = static_cast<std::uint16_t>(cell_x);
+        glyph.cell_width_ = static_cast<std::uint16_t>(cell_width);
+        glyph.use_serial_ = use_serial_;
+        glyph.code_ = code;
+
+        lru_push_front(index);
+        glyph_lookup_.emplace(code, index);
+
+        return index;
+    }
+
+    bool font_atlas::draw_text(const std::u16string &text, const eka2l1::rect &text_box, const epoc::text_alignment alignment, drivers::graphics_driver *driver, drivers::graphics_command_list_builder *builder) {
+        const int width = get_atlas_width();
+
+        if (!atlas_data_) {
+            atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
+            std::fill(atlas_data_.get(), atlas_data_.get() + width * width, 0);
+
+            scratch_size_ = std::min(width, common::align(size_ * 8, 256));
+            scratch_data_ = std::make_unique<std::uint8_t[]>(scratch_size_ * scratch_size_);
+
+            atlas_handle_ = drivers::create_bitmap(driver, { width, width }, 8);
+            builder->update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
+                width * width, { 0, 0 }, { width, width });
+
+            use_serial_++;
+
+            for (char16_t i = 0; i < initial_range_.second; i++) {
+                if (cache_glyph(initial_range_.first + i, builder) == INVALID_GLYPH_INDEX) {
+                    break;
                 }
             }
         }
 
+        // Glyphs stamped with this serial are pinned until the next draw
+        use_serial_++;
+
+        std::vector<std::uint32_t> text_glyphs(text.size(), INVALID_GLYPH_INDEX);
+
+        for (std::size_t i = 0; i < text.size(); i++) {
+            const char16_t chr = text[i];
+            auto glyph_ite = glyph_lookup_.find(chr);
+
+            if (glyph_ite == glyph_lookup_.end()) {
+                text_glyphs[i] = cache_glyph(chr, builder);
+                continue;
+            }
+
+            const std::uint32_t index = glyph_ite->second;
+            text_glyphs[i] = index;
+
+            if (glyphs_[index].use_serial_ != use_serial_) {
+                glyphs_[index].use_serial_ = use_serial_;
+
+                lru_unlink(index);
+                lru_push_front(index);
+            }
+        }
+
         eka2l1::vec2 cur_pos = text_box.top;
 
         // Calculate size of the text to know where to put them
@@ -154,8 +436,10 @@ namespace eka2l1::epoc {
         if (alignment != epoc::text_alignment::left) {
             float size_length = 0;
 
-            for (auto &chr : text) {
-                size_length += characters_[chr].xoff2 - characters_[chr].xoff;
+            for (const std::uint32_t index : text_glyphs) {
+                if (index != INVALID_GLYPH_INDEX) {
+                    size_length += glyphs_[index].info_.xoff2 - glyphs_[index].info_.xoff;
+                }
             }
 
             if (alignment == epoc::text_alignment::right) {
@@ -171,9 +455,13 @@ namespace eka2l1::epoc {
             drivers::blend_factor::zero, drivers::blend_factor::one);
 
         // Start to render these texts.
-        for (auto &chr : text) {
+        for (const std::uint32_t index : text_glyphs) {
+            if (index == INVALID_GLYPH_INDEX) {
+                continue;
+            }
+
             eka2l1::rect source_rect;
-            adapter::character_info &info = characters_[chr];
+            const adapter::character_info &info = glyphs_[index].info_;
 
             source_rect.top = { info.x0, info.y0 };
             source_rect.size = eka2l1::object_size(info.x1 - info.x0, info.y1 - info.y0);
@@ -18,6 +18,8 @@
  */
 
 #include <common/log.h>
+#include <common/profiler.h>
+#include <kernel/kernel.h>
 #include <system/epoc.h>
 
 #include <services/framework.h>
@@ -80,6 +82,9 @@ namespace eka2l1::service {
         auto func = ipc_funcs.find(process_msg->function);
 
         if (func != ipc_funcs.end()) {
+            common::call_profile_scope profile_scope(kern->get_call_profiler(), common::call_profile_category_ipc,
+                static_cast<std::uint32_t>(unique_id()), process_msg->function, obj_name, func->second.name);
+
             func->second.wrapper(context);
             return;
         }
@@ -93,6 +98,12 @@ namespace eka2l1::service {
             return;
         }
 
+        // Session-side opcodes are not named, only the ordinal is recorded
+        static const std::string SESSION_FETCH_NAME;
+
+        common::call_profile_scope profile_scope(kern->get_call_profiler(), common::call_profile_category_ipc,
+            static_cast<std::uint32_t>(unique_id()), process_msg->function, obj_name, SESSION_FETCH_NAME);
+
         ss_ite->second->fetch(&context);
     }
 }
@@ -21,6 +21,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <services/fbs/fbs.h>
 #include <services/fbs/palette.h>
 #include <services/window/bitmap_cache.h>
 
@@ -32,6 +33,7 @@
 
 #include <common/buffer.h>
 #include <common/log.h>
+#include <common/pixel.h>
 #include <common/runlen.h>
 #include <common/time.h>
 
@@ -43,7 +45,10 @@ namespace eka2l1::epoc {
         : base_large_chunk(nullptr)
         , kern(kern_) {
         std::fill(driver_textures.begin(), driver_textures.end(), 0);
+        std::fill(bitmaps.begin(), bitmaps.end(), nullptr);
         std::fill(hashes.begin(), hashes.end(), 0);
+        std::fill(generations.begin(), generations.end(), 0);
+        std::fill(validated_serials.begin(), validated_serials.end(), 0);
     }
 
     bool is_palette_bitmap(epoc::bitwise_bitmap *bw_bmp) {
@@ -51,63 +56,99 @@ namespace eka2l1::epoc {
         return (dsp == epoc::display_mode::color16) || (dsp == epoc::display_mode::color256);
     }
 
-    static char *converted_one_bpp_to_twenty_four_bpp_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint32_t *original_ptr, std::vector<char> &converted_pool) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        converted_pool.resize(byte_width_converted * bw_bmp->header_.size_pixels.y);
+    /**
+     * \brief Palettes of bitmaps the GPU can't read, with colors already in the uploaded pixel format.
+     */
+    struct converted_palettes {
+        std::array<std::uint32_t, 256> color256;
+        std::array<std::uint32_t, 16> color16;
+        std::array<std::uint32_t, 16> gray16;
+        std::array<std::uint32_t, 4> gray4;
+        std::array<std::uint32_t, 2> gray2;
+
+        explicit converted_palettes() {
+            // The palette colors are stored the same way as the pixels, only the alpha is missing
+            for (std::size_t i = 0; i < color256.size(); i++) {
+                color256[i] = 0xFF000000 | epoc::color_256_palette[i];
+            }
 
-        char *return_ptr = &converted_pool[0];
+            for (std::size_t i = 0; i < color16.size(); i++) {
+                color16[i] = 0xFF000000 | epoc::color_16_palette[i];
+            }
 
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x; x++) {
-                std::uint32_t word_per_line = (bw_bmp->header_.size_pixels.x + 31) / 32;
-                std::uint32_t color = original_ptr[y * word_per_line + x / 32];
-                std::uint32_t converted_color =  0;
-                if (color & (1 << (x & 0x1F))) {
-                    converted_color = 0xFFFFFF;
-                }
+            for (std::uint32_t i = 0; i < gray16.size(); i++) {
+                gray16[i] = 0xFF000000 | (i * 0x111111);
+            }
 
-                std::memcpy(return_ptr + byte_width_converted * y + x * 3, reinterpret_cast<const char *>(&converted_color), 3);
+            for (std::uint32_t i = 0; i < gray4.size(); i++) {
+                gray4[i] = 0xFF000000 | (i * 0x555555);
             }
+
+            gray2[0] = 0xFF000000;
+            gray2[1] = 0xFFFFFFFF;
         }
-        return return_ptr;
+    };
+
+    static bool should_convert_bitmap(epoc::bitwise_bitmap *bw_bmp) {
+        return is_palette_bitmap(bw_bmp) || (bw_bmp->header_.bit_per_pixels < 8);
     }
 
-    static char *converted_palette_bitmap_to_twenty_four_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint8_t *original_ptr, std::vector<char> &converted_pool) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        converted_pool.resize(byte_width_converted * bw_bmp->header_.size_pixels.y);
+    static const std::uint32_t *get_conversion_palette(epoc::bitwise_bitmap *bw_bmp) {
+        static const converted_palettes palettes;
 
-        char *return_ptr = &converted_pool[0];
+        switch (bw_bmp->settings_.current_display_mode()) {
+        case epoc::display_mode::color256:
+            return palettes.color256.data();
 
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x; x++) {
-                switch (bw_bmp->settings_.current_display_mode()) {
-                case epoc::display_mode::color256: {
-                    const std::uint8_t palette_index = original_ptr[y * bw_bmp->byte_width_ + x];
-                    const std::uint32_t palette_color = epoc::color_256_palette[palette_index];
-                    const std::size_t location = byte_width_converted * y + x * 3;
+        case epoc::display_mode::color16:
+            return palettes.color16.data();
 
-                    return_ptr[location] = palette_color & 0xFF;
-                    return_ptr[location + 1] = (palette_color >> 8) & 0xFF;
-                    return_ptr[location + 2] = (palette_color >> 16) & 0xFF;
+        default:
+            break;
+        }
 
-                    break;
-                }
+        switch (bw_bmp->header_.bit_per_pixels) {
+        case 1:
+            return palettes.gray2.data();
 
-                default:
-                    LOG_ERROR("Unhandled display mode to convert {}", static_cast<int>(bw_bmp->settings_.current_display_mode()));
-                    break;
-                }
-            }
+        case 2:
+            return palettes.gray4.data();
+
+        case 4:
+            return palettes.gray16.data();
+
+        default:
+            break;
+        }
+
+        return nullptr;
+    }
+
+    static char *converted_palette_bitmap_to_thirty_two_bitmap(epoc::bitwise_bitmap *bw_bmp,
+        const std::uint8_t *original_ptr, std::vector<char> &converted_pool) {
+        const std::uint32_t *palette = get_conversion_palette(bw_bmp);
+
+        if (!palette) {
+            LOG_ERROR("Unhandled display mode to convert {}", static_cast<int>(bw_bmp->settings_.current_display_mode()));
+            return nullptr;
+        }
+
+        const std::size_t width = bw_bmp->header_.size_pixels.x;
+        converted_pool.resize(width * bw_bmp->header_.size_pixels.y * sizeof(std::uint32_t));
+
+        std::uint32_t *return_ptr = reinterpret_cast<std::uint32_t *>(&converted_pool[0]);
+
+        for (int y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
+            common::convert_palette_row_to_bgra32(return_ptr + y * width, original_ptr + y * bw_bmp->byte_width_, width,
+                bw_bmp->header_.bit_per_pixels, palette);
         }
 
-        return return_ptr;
+        return reinterpret_cast<char *>(return_ptr);
     }
 
     static std::uint32_t get_suitable_bpp_for_bitmap(epoc::bitwise_bitmap *bmp) {
-        if (is_palette_bitmap(bmp) || (bmp->header_.bit_per_pixels == 1)) {
-            return 24;
+        if (should_convert_bitmap(bmp)) {
+            return 32;
         }
 
         return bmp->header_.bit_per_pixels;
@@ -116,24 +157,21 @@ namespace eka2l1::epoc {
     std::uint64_t bitmap_cache::hash_bitwise_bitmap(epoc::bitwise_bitmap *bw_bmp) {
         std::uint64_t hash = 0xB1711A3F;
 
-        // Hash using XXHASH
-        XXH64_state_t *const state = XXH64_createState();
-        XXH64_reset(state, hash);
+        // Hash using XXHASH. The state is inlined, so no need to allocate it.
+        XXH64_state_t state;
+        XXH64_reset(&state, hash);
 
         // First, hash the single bitmap header
-        XXH64_update(state, reinterpret_cast<const void *>(&bw_bmp->header_), sizeof(loader::sbm_header));
+        XXH64_update(&state, reinterpret_cast<const void *>(&bw_bmp->header_), sizeof(loader::sbm_header));
 
         // Now, hash the byte width and UID, if it changes, we need to update
-        XXH64_update(state, reinterpret_cast<const void *>(&bw_bmp->byte_width_), sizeof(bw_bmp->byte_width_));
-        XXH64_update(state, reinterpret_cast<const void *>(&bw_bmp->uid_), sizeof(bw_bmp->uid_));
+        XXH64_update(&state, reinterpret_cast<const void *>(&bw_bmp->byte_width_), sizeof(bw_bmp->byte_width_));
+        XXH64_update(&state, reinterpret_cast<const void *>(&bw_bmp->uid_), sizeof(bw_bmp->uid_));
 
         // Lastly, we needs to hash the data, to see if anything changed
-        XXH64_update(state, bw_bmp->data_pointer(base_large_chunk), bw_bmp->header_.bitmap_size - sizeof(bw_bmp->header_));
-
-        hash = XXH64_digest(state);
-        XXH64_freeState(state);
+        XXH64_update(&state, bw_bmp->data_pointer(base_large_chunk), bw_bmp->header_.bitmap_size - sizeof(bw_bmp->header_));
 
-        return hash;
+        return XXH64_digest(&state);
     }
 
     std::int64_t bitmap_cache::get_suitable_bitmap_index() {
@@ -157,7 +195,9 @@ namespace eka2l1::epoc {
     }
 
     drivers::handle bitmap_cache::add_or_get(drivers::graphics_driver *driver, drivers::graphics_command_list_builder *builder,
-        epoc::bitwise_bitmap *bmp) {
+        fbsbitmap *fbs_bmp) {
+        const std::lock_guard<std::mutex> guard(cache_lock);
+
         if (!base_large_chunk) {
             chunk_ptr ch = kern->get_by_name<kernel::chunk>("FbsLargeChunk");
             base_large_chunk = reinterpret_cast<std::uint8_t*>(ch->host_base());
@@ -171,10 +211,15 @@ namespace eka2l1::epoc {
         bool should_upload = true;
         bool should_recreate = true;
 
+        epoc::bitwise_bitmap *bmp = fbs_bmp->bitmap_;
+
+        // The bitwise bitmap memory may be reused by another FBS bitmap, so the ID is also part of this
+        const std::uint64_t generation = (static_cast<std::uint64_t>(fbs_bmp->id) << 32) | fbs_bmp->generation_;
+
         const std::uint32_t suit_bpp = get_suitable_bpp_for_bitmap(bmp);
-        auto bitmap_ite = std::find(bitmaps.begin(), bitmaps.end(), bmp);
+        auto bitmap_ite = bitmap_indicies.find(bmp);
 
-        if (bitmap_ite == bitmaps.end()) {
+        if (bitmap_ite == bitmap_indicies.end()) {
             // If the bitmap is not in the bitmap array
             if (last_free < MAX_CACHE_SIZE) {
                 // Use last free
@@ -183,21 +228,41 @@ namespace eka2l1::epoc {
                 idx = get_suitable_bitmap_index();
             }
 
+            // Evict the old bitmap
+            if (bitmaps[idx]) {
+                bitmap_indicies.erase(bitmaps[idx]);
+            }
+
+            if (driver_textures[idx]) {
+                builder->destroy_bitmap(driver_textures[idx]);
+            }
+
             bitmaps[idx] = bmp;
+            bitmap_indicies.emplace(bmp, idx);
+
             driver_textures[idx] = 0;
-            hash = (hashes[idx] == 0) ? hash_bitwise_bitmap(bmp) : hashes[idx];
+            hash = hash_bitwise_bitmap(bmp);
         } else {
             // Else, get the index
-            idx = std::distance(bitmaps.begin(), bitmap_ite);
-
-            // Check if we should upload or not, by calculating the hash
-            hash = hash_bitwise_bitmap(bmp);
-            should_upload = hash != (hashes[idx]);
+            idx = bitmap_ite->second;
+
+            if (generations[idx] != generation) {
+                // Server changed the bitmap, no need to compare
+                hash = hash_bitwise_bitmap(bmp);
+            } else if (validated_serials[idx] == batch_serial) {
+                // Already checked in this batch, and the user could not touch it since
+                hash = hashes[idx];
+                should_upload = false;
+            } else {
+                // Check if we should upload or not, by calculating the hash
+                hash = hash_bitwise_bitmap(bmp);
+                should_upload = hash != (hashes[idx]);
+            }
 
             const std::uint32_t bitmap_bpp = static_cast<std::uint32_t>(bitmap_sizes[idx].first >> 32);
             eka2l1::object_size bitmap_stored_size(static_cast<int>(bitmap_sizes[idx].first), static_cast<int>(bitmap_sizes[idx].second));
 
-            should_recreate = (bmp->header_.size_pixels != bitmap_stored_size) && (bitmap_bpp == suit_bpp);
+            should_recreate = (bmp->header_.size_pixels != bitmap_stored_size) || (bitmap_bpp != suit_bpp);
         }
 
         if (should_recreate) {
@@ -205,6 +270,9 @@ namespace eka2l1::epoc {
                 builder->destroy_bitmap(driver_textures[idx]);
 
             driver_textures[idx] = drivers::create_bitmap(driver, bmp->header_.size_pixels, suit_bpp);
+
+            // New texture has nothing in it
+            should_upload = true;
         }
 
         if (should_upload) {
@@ -221,24 +289,23 @@ namespace eka2l1::epoc {
 
                 const std::uint32_t compressed_size = bmp->header_.bitmap_size - bmp->header_.header_len;
 
-                common::wo_buf_stream dest_stream(&decompressed[0], raw_size);
-                common::ro_buf_stream source_stream(reinterpret_cast<std::uint8_t *>(data_pointer), compressed_size);
+                const std::uint8_t *source = reinterpret_cast<const std::uint8_t *>(data_pointer);
 
                 switch (comp) {
                 case bitmap_file_byte_rle_compression:
-                    eka2l1::decompress_rle<8>(&source_stream, &dest_stream);
+                    eka2l1::decompress_rle<8>(source, compressed_size, decompressed.data(), raw_size);
                     break;
 
                 case bitmap_file_twelve_bit_rle_compression:
-                    eka2l1::decompress_rle<12>(&source_stream, &dest_stream);
+                    eka2l1::decompress_rle<12>(source, compressed_size, decompressed.data(), raw_size);
                     break;
 
                 case bitmap_file_sixteen_bit_rle_compression:
-                    eka2l1::decompress_rle<16>(&source_stream, &dest_stream);
+                    eka2l1::decompress_rle<16>(source, compressed_size, decompressed.data(), raw_size);
                     break;
 
                 case bitmap_file_twenty_four_bit_rle_compression:
-                    eka2l1::decompress_rle<24>(&source_stream, &dest_stream);
+                    eka2l1::decompress_rle<24>(source, compressed_size, decompressed.data(), raw_size);
                     break;
 
                 default:
@@ -252,7 +319,6 @@ namespace eka2l1::epoc {
             }
 
             std::vector<char> converted;
-            std::uint32_t bpp = bmp->header_.bit_per_pixels;
             std::size_t pixels_per_line = 0;
 
             if ((bmp->header_.bit_per_pixels % 8) == 0) {
@@ -260,31 +326,20 @@ namespace eka2l1::epoc {
             }
 
             // GPU don't support them. Convert them on CPU
-            if (is_palette_bitmap(bmp)) {
-                data_pointer = converted_palette_bitmap_to_twenty_four_bitmap(bmp, reinterpret_cast<const std::uint8_t *>(data_pointer),
+            if (should_convert_bitmap(bmp)) {
+                data_pointer = converted_palette_bitmap_to_thirty_two_bitmap(bmp, reinterpret_cast<const std::uint8_t *>(data_pointer),
                     converted);
-                bpp = 24;
+
                 raw_size = static_cast<std::uint32_t>(converted.size());
 
                 // Use default
                 pixels_per_line = 0;
             }
 
-            switch (bpp) {
-            case 1:
-                data_pointer = converted_one_bpp_to_twenty_four_bpp_bitmap(bmp, reinterpret_cast<const std::uint32_t *>(data_pointer),
-                    converted);
-                bpp = 24;
-                raw_size = static_cast<std::uint32_t>(converted.size());
-                pixels_per_line = 0;
-
-                break;
-
-            default:
-                break;
+            if (data_pointer) {
+                builder->update_bitmap(driver_textures[idx], data_pointer, raw_size, { 0, 0 }, bmp->header_.size_pixels, pixels_per_line);
             }
 
-            builder->update_bitmap(driver_textures[idx], data_pointer, raw_size, { 0, 0 }, bmp->header_.size_pixels, pixels_per_line);
             hashes[idx] = hash;
 
             if (bmp->settings_.current_display_mode() == epoc::display_mode::color16mu) {
@@ -294,6 +349,8 @@ namespace eka2l1::epoc {
         }
 
         timestamps[idx] = crr_timestamp;
+        generations[idx] = generation;
+        validated_serials[idx] = batch_serial;
 
         bitmap_sizes[idx].first = static_cast<std::uint64_t>(bmp->header_.size_pixels.x) | (static_cast<std::uint64_t>(suit_bpp) << 32);
         bitmap_sizes[idx].second = static_cast<std::uint32_t>(bmp->header_.size_pixels.y);
@@ -319,6 +319,7 @@ namespace eka2l1::epoc {
                 flush_queue_to_driver();
 
                 // Content of the window changed, so call the handler
+                attached_window->dirty_region.add_rect(attached_window->bounding_rect());
                 attached_window->take_action_on_change(context.msg->own_thr);
             }
         }
@@ -329,7 +330,7 @@ namespace eka2l1::epoc {
         context.complete(epoc::error_none);
     }
 
-    drivers::handle graphic_context::handle_from_bitwise_bitmap(epoc::bitwise_bitmap *bmp) {
+    drivers::handle graphic_context::handle_from_bitmap(fbsbitmap *bmp) {
         drivers::graphics_driver *driver = client->get_ws().get_graphics_driver();
         epoc::bitmap_cache *cacher = client->get_ws().get_bitmap_cache();
 
@@ -346,28 +347,31 @@ namespace eka2l1::epoc {
 
     void graphic_context::draw_bitmap(service::ipc_context &context, ws_cmd &cmd) {
         ws_cmd_draw_bitmap *bitmap_cmd = reinterpret_cast<ws_cmd_draw_bitmap *>(cmd.data_ptr);
-        epoc::bitwise_bitmap *bw_bmp = client->get_ws().get_bitmap(bitmap_cmd->handle);
+        fbsbitmap *bmp = client->get_ws().get_bitmap(bitmap_cmd->handle);
 
-        if (!bw_bmp) {
+        if (!bmp) {
             context.complete(epoc::error_argument);
             return;
         }
 
-        drivers::handle bmp_driver_handle = handle_from_bitwise_bitmap(bw_bmp);
+        epoc::bitwise_bitmap *bw_bmp = bmp->bitmap_;
+        drivers::handle bmp_driver_handle = handle_from_bitmap(bmp);
         do_command_draw_bitmap(context, bmp_driver_handle, rect({ 0, 0 }, bw_bmp->header_.size_pixels),
             rect(bitmap_cmd->pos, { 0, 0 }));
     }
 
     void graphic_context::gdi_blt_masked(service::ipc_context &context, ws_cmd &cmd) {
         ws_cmd_gdi_blt_masked *blt_cmd = reinterpret_cast<ws_cmd_gdi_blt_masked *>(cmd.data_ptr);
-        epoc::bitwise_bitmap *bmp = client->get_ws().get_bitmap(blt_cmd->source_handle);
-        epoc::bitwise_bitmap *masked = client->get_ws().get_bitmap(blt_cmd->mask_handle);
+        fbsbitmap *bmp = client->get_ws().get_bitmap(blt_cmd->source_handle);
+        fbsbitmap *mask_bmp = client->get_ws().get_bitmap(blt_cmd->mask_handle);
 
-        if (!bmp || !masked) {
+        if (!bmp || !mask_bmp) {
             context.complete(epoc::error_bad_handle);
             return;
         }
 
+        epoc::bitwise_bitmap *masked = mask_bmp->bitmap_;
+
         eka2l1::rect source_rect = blt_cmd->source_rect;
         source_rect.transform_from_symbian_rectangle();
 
@@ -375,8 +379,8 @@ namespace eka2l1::epoc {
         dest_rect.size = source_rect.size;
         dest_rect.top = blt_cmd->pos;
 
-        drivers::handle bmp_driver_handle = handle_from_bitwise_bitmap(bmp);
-        drivers::handle bmp_mask_driver_handle = handle_from_bitwise_bitmap(masked);
+        drivers::handle bmp_driver_handle = handle_from_bitmap(bmp);
+        drivers::handle bmp_mask_driver_handle = handle_from_bitmap(mask_bmp);
 
         std::uint32_t flags = 0;
         const bool alpha_blending = (masked->settings_.current_display_mode() == epoc::display_mode::gray256)
@@ -416,13 +420,15 @@ namespace eka2l1::epoc {
         ws_cmd_gdi_blt3 *blt_cmd = reinterpret_cast<ws_cmd_gdi_blt3 *>(cmd.data_ptr);
 
         // Try to get the bitmap
-        epoc::bitwise_bitmap *bmp = client->get_ws().get_bitmap(blt_cmd->handle);
+        fbsbitmap *fbs_bmp = client->get_ws().get_bitmap(blt_cmd->handle);
 
-        if (!bmp) {
+        if (!fbs_bmp) {
             context.complete(epoc::error_bad_handle);
             return;
         }
 
+        epoc::bitwise_bitmap *bmp = fbs_bmp->bitmap_;
+
         eka2l1::rect source_rect;
 
         if (ver == 2) {
@@ -453,7 +459,7 @@ namespace eka2l1::epoc {
             dest_rect.size.y = source_rect.size.y;
         }
 
-        drivers::handle bmp_driver_handle = handle_from_bitwise_bitmap(bmp);
+        drivers::handle bmp_driver_handle = handle_from_bitmap(fbs_bmp);
         do_command_draw_bitmap(context, bmp_driver_handle, source_rect, dest_rect);
     }
 
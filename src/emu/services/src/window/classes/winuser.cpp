@@ -98,6 +98,9 @@ namespace eka2l1::epoc {
 
     window_user::~window_user() {
         client->remove_redraws(this);
+
+        // What's left of this window on the screen needs to be covered
+        scr->damage(composited_rect);
     }
 
     eka2l1::vec2 window_user::get_origin() {
@@ -255,6 +258,9 @@ namespace eka2l1::epoc {
 
     void window_user::end_redraw(service::ipc_context &ctx, ws_cmd &cmd) {
         drivers::graphics_driver *drv = client->get_ws().get_graphics_driver();
+
+        // Outside of a redraw, drawing is not restricted to any rectangle
+        const eka2l1::rect changed_rect = (flags & flags_in_redraw) ? redraw_rect_curr : bounding_rect();
         redraw_rect_curr.make_empty();
 
         if (resize_needed) {
@@ -302,6 +308,7 @@ namespace eka2l1::epoc {
         } while (ite != end);
 
         if (any_flush_performed) {
+            dirty_region.add_rect(changed_rect);
             take_action_on_change(ctx.msg->own_thr);
         }
 
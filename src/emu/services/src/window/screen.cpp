@@ -23,6 +23,7 @@
 #include <services/window/screen.h>
 #include <services/window/window.h>
 
+#include <common/region.h>
 #include <common/time.h>
 #include <drivers/itc.h>
 
@@ -31,13 +32,15 @@
 #include <thread>
 
 namespace eka2l1::epoc {
-    struct window_drawer_walker : public window_tree_walker {
-        drivers::graphics_command_list_builder *builder_;
-        std::uint32_t total_redrawed_;
+    // Above this number of damaged rectangles, just recomposite their bounding rectangle
+    static constexpr std::size_t MAX_DAMAGE_RECTS = 16;
 
-        explicit window_drawer_walker(drivers::graphics_command_list_builder *builder)
-            : builder_(builder)
-            , total_redrawed_(0) {
+    struct window_damage_collector : public window_tree_walker {
+        common::region &damage_;
+        std::vector<window_user *> windows_; ///< Windows that can be seen, ordered from back to front.
+
+        explicit window_damage_collector(common::region &damage)
+            : damage_(damage) {
         }
 
         bool do_it(window *win) {
@@ -47,23 +50,29 @@ namespace eka2l1::epoc {
 
             window_user *winuser = reinterpret_cast<window_user *>(win);
 
-            if (!winuser || !winuser->driver_win_id || !winuser->is_visible()) {
-                // No need to redraw this window yet. It doesn't even have any content ready.
-                return false;
-            }
+            // No need to draw the window if it doesn't have any content ready, or no one can see it
+            const bool can_show = winuser->driver_win_id && winuser->is_visible() && (winuser->size.x != 0)
+                && (winuser->size.y != 0);
 
-            // Check if extent is just invalid
-            if (winuser->size.x == 0 || winuser->size.y == 0) {
-                // No one can see this. Leave it for now.
-                return false;
+            const eka2l1::rect current_rect = can_show ? eka2l1::rect(winuser->pos, winuser->size) : eka2l1::rect();
+
+            if ((current_rect.top != winuser->composited_rect.top) || (current_rect.size != winuser->composited_rect.size)) {
+                // Moved, resized, shown or hidden. Both the old and new area need recompositing
+                damage_.add_rect(winuser->composited_rect);
+                damage_.add_rect(current_rect);
+
+                winuser->composited_rect = current_rect;
             }
 
-            // Draw it onto current binding buffer
-            builder_->draw_bitmap(winuser->driver_win_id, 0, eka2l1::rect(winuser->pos, { 0, 0 }),
-                eka2l1::rect({ 0, 0 }, winuser->size), 0);
+            if (can_show) {
+                for (const eka2l1::rect &dirty : winuser->dirty_region.rects_) {
+                    damage_.add_rect(eka2l1::rect(dirty.top + winuser->pos, dirty.size));
+                }
 
-            total_redrawed_++;
+                windows_.push_back(winuser);
+            }
 
+            winuser->dirty_region.make_empty();
             return false;
         }
     };
@@ -94,16 +103,83 @@ namespace eka2l1::epoc {
         }
     }
 
+    void screen::damage(const eka2l1::rect &area) {
+        damage_region.add_rect(area);
+    }
+
     void screen::redraw(drivers::graphics_command_list_builder *cmd_builder, const bool need_bind) {
+        // Walk through the window tree in recursive order, and collect what changed since last time
+        window_damage_collector collector(damage_region);
+        root->walk_tree_back_to_front(&collector);
+
+        // Windows changing their order also changes what's on top. The pointers of the last composition
+        // are only compared, never accessed.
+        for (std::size_t i = 0; i < collector.windows_.size(); i++) {
+            if ((i >= composited_windows.size()) || (composited_windows[i] != collector.windows_[i])) {
+                damage(collector.windows_[i]->composited_rect);
+            }
+        }
+
+        composited_windows.assign(collector.windows_.begin(), collector.windows_.end());
+
+        common::region screen_region;
+        screen_region.add_rect(eka2l1::rect({ 0, 0 }, current_mode().size));
+
+        common::region damage = damage_region.intersect(screen_region);
+        damage_region.make_empty();
+
+        if (damage.empty()) {
+            // Nothing changed on the screen. Leave the current content as is.
+            if (!need_bind) {
+                cmd_builder->bind_bitmap(0);
+            }
+
+            return;
+        }
+
+        if (damage.rects_.size() > MAX_DAMAGE_RECTS) {
+            const eka2l1::rect bound = damage.bounding_rect();
+
+            damage.make_empty();
+            damage.add_rect(bound);
+        }
+
+        // Find the part of each window that can be seen in the damaged area. Go from front to back,
+        // so windows fully covered by opaque windows in front of them are skipped.
+        std::vector<common::region> visible_parts(collector.windows_.size());
+        common::region covered;
+
+        for (std::size_t i = collector.windows_.size(); i > 0; i--) {
+            window_user *winuser = collector.windows_[i - 1];
+
+            common::region &part = visible_parts[i - 1];
+            part.add_rect(winuser->composited_rect);
+            part = part.intersect(damage);
+            part.eliminate(covered);
+
+            if (!(winuser->flags & window::flags_enable_alpha)) {
+                covered.add_rect(winuser->composited_rect);
+            }
+        }
+
         if (need_bind) {
             cmd_builder->bind_bitmap(screen_texture);
         }
 
-        // Walk through the window tree in recursive order, and do draw
-        // We dont care about visible regions. Nowadays, detect visible region to reduce pixel plotting is
-        // just not really worth the time, since GPU draws so fast. Symbian code still has it though.
-        window_drawer_walker adrawwalker(cmd_builder);
-        root->walk_tree_back_to_front(&adrawwalker);
+        cmd_builder->set_clipping(true);
+
+        // Draw onto current binding buffer, only in the visible parts
+        for (std::size_t i = 0; i < collector.windows_.size(); i++) {
+            window_user *winuser = collector.windows_[i];
+
+            for (eka2l1::rect clip : visible_parts[i].rects_) {
+                cmd_builder->clip_rect(clip);
+                cmd_builder->draw_bitmap(winuser->driver_win_id, 0, eka2l1::rect(winuser->pos, { 0, 0 }),
+                    eka2l1::rect({ 0, 0 }, winuser->size), 0);
+            }
+        }
+
+        cmd_builder->set_clipping(false);
 
         // Done! Unbind and submit this to the driver
         cmd_builder->bind_bitmap(0);
@@ -149,6 +225,9 @@ namespace eka2l1::epoc {
 
         bool need_bind = true;
 
+        // All pixels are lost, everything needs to be composited again
+        damage(eka2l1::rect({ 0, 0 }, new_size));
+
         if (!screen_texture) {
             // Create new one!
             screen_texture = drivers::create_bitmap(driver, new_size, 32);
@@ -137,6 +137,8 @@ namespace eka2l1::epoc {
     }
 
     void window_server_client::execute_commands(service::ipc_context &ctx, std::vector<ws_cmd> cmds) {
+        get_ws().get_bitmap_cache()->begin_batch();
+
         for (auto &cmd : cmds) {
             if (cmd.obj_handle == guest_session->unique_id()) {
                 execute_command(ctx, cmd);
@@ -1925,13 +1927,8 @@ namespace eka2l1 {
         return ws_code_chunk->base(nullptr).ptr_address() + sync_thread_code_offset;
     }
 
-    epoc::bitwise_bitmap *window_server::get_bitmap(const std::uint32_t h) {
-        fbsbitmap *bmp = get_fbs_server()->get<fbsbitmap>(h);
-        if (bmp) {
-            return bmp->bitmap_;
-        }
-
-        return nullptr;
+    fbsbitmap *window_server::get_bitmap(const std::uint32_t h) {
+        return get_fbs_server()->get<fbsbitmap>(h);
     }
 
     void window_server::set_keyboard_repeat_rate(const std::uint64_t initial_time, const std::uint64_t next_time) {
@@ -29,6 +29,7 @@
 #include <common/log.h>
 #include <common/path.h>
 #include <common/platform.h>
+#include <common/profiler.h>
 #include <common/random.h>
 
 #include <disasm/disasm.h>
@@ -82,7 +83,9 @@ namespace eka2l1 {
     class system_impl {
         std::mutex mut;
 
+        arm::exclusive_monitor_instance cpu_monitor; ///< Exclusive monitor shared by all cores. Must outlive them.
         arm::core_instance cpu;
+        std::vector<arm::core_instance> secondary_cpus; ///< CPUs of the cores other than the first one.
         arm_emulator_type cpu_type;
 
         drivers::graphics_driver *gdriver;
@@ -129,8 +132,10 @@ namespace eka2l1 {
         ~system_impl() {
             // We need to clear kernel content first, since some object do references to it,
             // and if we let it go in destructor it would be messy! :D
-            if (kern_)
+            if (kern_) {
+                dump_call_profile();
                 kern_->reset();
+            }
 
 #if ENABLE_SCRIPTING
             scripting_.reset();
@@ -157,6 +162,13 @@ namespace eka2l1 {
             mem_ = std::make_unique<memory_system>(cpu.get(), conf_, (kern_->get_epoc_version() >= epocver::epoc95) ? mem::mem_model_type::flexible
                 : mem::mem_model_type::multiple, is_epocver_eka1(ever) ? true : false);
 
+            // Other cores share the MMU of the first one
+            for (auto &secondary_cpu: secondary_cpus) {
+                if (!mem_->get_mmu()->attach_cpu(secondary_cpu.get())) {
+                    LOG_ERROR("Unable to share memory with a secondary CPU core!");
+                }
+            }
+
             // Install memory to the kernel, then set epoc version
             kern_->install_memory(mem_.get());
             kern_->set_epoc_version(ever);
@@ -257,7 +269,7 @@ namespace eka2l1 {
         }
 
         void prepare_reschedule() {
-            cpu->prepare_rescheduling();
+            kern_->get_cpu()->prepare_rescheduling();
             reschedule_pending = true;
         }
 
@@ -327,6 +339,7 @@ namespace eka2l1 {
 
         void load_scripts();
         void do_state(common::chunkyseri &seri);
+        void dump_call_profile();
 
         bool install_package(std::u16string path, drive_number drv);
         bool load_rom(const std::string &path);
@@ -364,6 +377,24 @@ namespace eka2l1 {
     void system_impl::do_state(common::chunkyseri &seri) {
     }
 
+    void system_impl::dump_call_profile() {
+        common::call_profiler *profiler = kern_->get_call_profiler();
+
+        if (!profiler || profiler->empty() || conf_->profile_dump_path.empty()) {
+            return;
+        }
+
+        const std::string json_path = conf_->profile_dump_path + ".json";
+        const std::string csv_path = conf_->profile_dump_path + ".csv";
+
+        if (!profiler->dump_json(json_path) || !profiler->dump_csv(csv_path)) {
+            LOG_ERROR("Failed to dump call profile to {}", conf_->profile_dump_path);
+            return;
+        }
+
+        LOG_INFO("Call profile dumped to {} and {}", json_path, csv_path);
+    }
+
     static constexpr std::uint32_t DEFAULT_CPU_HZ = 484000000;
 
     void system_impl::startup() {
@@ -379,11 +410,37 @@ namespace eka2l1 {
         file_system_inst rom_fs = create_rom_filesystem(nullptr, mem_.get(), epocver::epoc94, "");
         rom_fs_id_ = io_->add_filesystem(rom_fs);
 
-        cpu = arm::create_core(cpu_type);
+        // Cores running in parallel must see exclusive accesses of each other
+        arm::exclusive_monitor_instance new_monitor;
+
+        if (conf_->cpu_core_count > 1) {
+            new_monitor = arm::create_exclusive_monitor(cpu_type, conf_->cpu_core_count);
+        }
+
+        cpu = arm::create_core(cpu_type, conf_->cpu_fastmem, new_monitor.get(), 0);
         
         kern_ = std::make_unique<kernel_system>(parent_, timing_.get(), io_.get(), conf_, app_settings_, &romf_, cpu.get(),
             disassembler_.get());
 
+        secondary_cpus.clear();
+        cpu_monitor = std::move(new_monitor);
+
+        if (conf_->cpu_core_count > 1) {
+            // Cores may run different address spaces at the same time, so each needs its own page tables
+            if (!cpu->has_address_space_tables()) {
+                LOG_WARN("The CPU backend can't run multiple cores (is fastmem enabled?), only one core will be used");
+            } else if (!cpu_monitor) {
+                LOG_WARN("The CPU backend has no exclusive monitor to share between cores, only one core will be used");
+            } else {
+                for (int i = 1; i < conf_->cpu_core_count; i++) {
+                    secondary_cpus.push_back(arm::create_core(cpu_type, false, cpu_monitor.get(), i));
+                    kern_->add_core(secondary_cpus.back().get());
+                }
+
+                LOG_INFO("Running guest threads on {} cores", conf_->cpu_core_count);
+            }
+        }
+
         epoc::init_panic_descriptions();
         
 #if ENABLE_SCRIPTING == 1
@@ -434,6 +491,9 @@ namespace eka2l1 {
     bool system_impl::pause() {
         paused = true;
 
+        if (kern_)
+            kern_->pause_secondary_cores(true);
+
         if (timing_)
             timing_->set_paused(true);
 
@@ -443,6 +503,9 @@ namespace eka2l1 {
     bool system_impl::unpause() {
         paused = false;
 
+        if (kern_)
+            kern_->pause_secondary_cores(false);
+
         if (timing_)
             timing_->set_paused(false);
 
@@ -454,6 +517,9 @@ namespace eka2l1 {
             return 1;
         }
 
+        // The first core is driven by us, others run on their own
+        kern_->start_secondary_cores();
+
         bool should_step = false;
         bool script_hits_the_feels = false;
 
@@ -487,24 +553,16 @@ namespace eka2l1 {
         if (kern_->crr_thread() == nullptr) {
             prepare_reschedule();
         } else {
-            kernel::thread *thr = kern_->crr_thread();
-
-            if (!should_step) {
-                cpu->run(thr->get_remaining_screenticks());
-                thr->add_ticks(cpu->get_num_instruction_executed());
-            } else {
-                cpu->step();
+            // We drive the first core
+            kern_->current_core()->run_current_thread(should_step);
 
 #ifdef ENABLE_SCRIPTING
-                if (script_hits_the_feels) {
-                    should_step = true;
-                    script_hits_the_feels = true;
-                    scripter->reset_breakpoint_hit(cpu.get(), kern_->crr_thread());
-                }
-#endif
-
-                thr->add_ticks(1);
+            if (should_step && script_hits_the_feels) {
+                should_step = true;
+                script_hits_the_feels = true;
+                scripter->reset_breakpoint_hit(cpu.get(), kern_->crr_thread());
             }
+#endif
         }
 
         if (!kern_->should_terminate()) {
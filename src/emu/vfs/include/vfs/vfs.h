@@ -243,6 +243,14 @@ namespace eka2l1 {
 
     using drive_change_notify_callback = std::function<void(void*, drive_number, drive_action)>;
 
+    /**
+     * \brief Called when an entry is created, renamed or deleted through the IO system.
+     * 
+     * Unlike directory watches, this is called right away by the thread doing the change, but knows
+     * nothing about changes made on the host.
+     */
+    using entry_change_notify_callback = std::function<void(void*, const std::u16string &)>;
+
     /* \brief An abstract filesystem
     */
     class abstract_file_system {
@@ -313,6 +321,7 @@ namespace eka2l1 {
     using filesystem_id = std::size_t;
 
     using drive_change_callback_and_data = std::pair<drive_change_notify_callback, void*>;
+    using entry_change_callback_and_data = std::pair<entry_change_notify_callback, void*>;
     
     class io_system {
     private:
@@ -321,9 +330,11 @@ namespace eka2l1 {
 
         std::atomic<filesystem_id> id_counter;
         common::identity_container<drive_change_callback_and_data> drive_change_callbacks;
+        common::identity_container<entry_change_callback_and_data> entry_change_callbacks;
 
     protected:
         void invoke_drive_change_callbacks(drive_number drv, drive_action act);
+        void invoke_entry_change_callbacks(const std::u16string &path);
 
     public:
         explicit io_system();
@@ -335,6 +346,10 @@ namespace eka2l1 {
         void validate_for_host();
 
         std::size_t register_drive_change_notify(drive_change_notify_callback callback, void *userdata);
+        bool unregister_drive_change_notify(const std::size_t handle);
+
+        std::size_t register_entry_change_notify(entry_change_notify_callback callback, void *userdata);
+        bool unregister_entry_change_notify(const std::size_t handle);
         
         std::optional<std::u16string> get_raw_path(const std::u16string &path);
 
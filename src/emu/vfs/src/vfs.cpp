@@ -34,11 +34,13 @@
 #include <array>
 #include <cwctype>
 #include <iostream>
+#include <list>
 #include <map>
 #include <mutex>
 #include <regex>
 #include <thread>
 #include <stack>
+#include <unordered_map>
 
 #include <string.h>
 
@@ -516,8 +518,37 @@ namespace eka2l1 {
         }
     };
 
+    // How many virtual paths keep their resolved host path around
+    static constexpr std::size_t RESOLVED_PATH_CACHE_SIZE = 512;
+
+    // How many host directories keep a case-folded listing around. Each one holds a directory watch.
+    static constexpr std::size_t FOLDED_INDEX_CACHE_SIZE = 64;
+
     class physical_file_system : public abstract_file_system {
         std::mutex fs_mutex;
+
+        /**
+         * \brief Lowercased name to real name of entries in a host directory.
+         *
+         * Only used on case-sensitive hosts, so that entries not lowercased by validate_for_host
+         * can still be found. The directory is watched, and the index is rebuilt after it changes.
+         */
+        struct folded_name_index {
+            std::unordered_map<std::u16string, std::u16string> names_;
+            std::int32_t watch_handle_ = 0;
+            bool stale_ = true;
+            std::list<std::u16string>::iterator lru_position_;
+        };
+
+        using resolved_path_pair = std::pair<std::u16string, std::u16string>;
+
+        // Declared before the watcher, so they are still alive while its thread winds down
+        std::mutex resolve_lock_;
+        std::list<resolved_path_pair> resolved_lru_;
+        std::unordered_map<std::u16string, std::list<resolved_path_pair>::iterator> resolved_paths_;
+        std::list<std::u16string> folded_index_lru_;
+        std::unordered_map<std::u16string, folded_name_index> folded_indexes_;
+
         std::unique_ptr<common::directory_watcher> watcher_;
 
     protected:
@@ -558,11 +589,12 @@ namespace eka2l1 {
 
             // Mark as mapped
             mappings[static_cast<int>(drv)].second = true;
+            clear_resolve_cache(false);
 
             return true;
         }
 
-        std::optional<std::u16string> get_real_physical_path(const std::u16string &vert_path) {
+        std::optional<std::u16string> resolve_physical_path(const std::u16string &vert_path) {
             std::string path_ucs8 = common::ucs2_to_utf8(vert_path);
             const std::string root = eka2l1::root_name(path_ucs8);
             std::u16string vert_path_copy = vert_path;
@@ -597,11 +629,219 @@ namespace eka2l1 {
 
             std::u16string vert_path_no_root = vert_path_copy.substr(root.size());
 
-            if (!common::is_system_case_insensitive()) {
-                vert_path_no_root = common::lowercase_ucs2_string(vert_path_no_root);
+            if (common::is_system_case_insensitive()) {
+                return eka2l1::add_path(map_path, vert_path_no_root);
+            }
+
+            vert_path_no_root = common::lowercase_ucs2_string(vert_path_no_root);
+            std::u16string result = eka2l1::add_path(map_path, vert_path_no_root);
+
+            // Swap each lowercased component with the real name on the host, if it is there under another case
+            std::size_t component_start = eka2l1::add_path(map_path, std::u16string{}).size();
+
+            while (component_start < result.size()) {
+                std::size_t component_end = component_start;
+
+                while ((component_end < result.size()) && !eka2l1::is_separator(result[component_end])) {
+                    component_end++;
+                }
+
+                if (component_end != component_start) {
+                    folded_name_index *index = get_folded_index(result.substr(0, component_start));
+
+                    if (!index) {
+                        // Directory does not exist, nothing deeper does either
+                        break;
+                    }
+
+                    auto real_name = index->names_.find(result.substr(component_start, component_end - component_start));
+
+                    if (real_name != index->names_.end()) {
+                        result.replace(component_start, component_end - component_start, real_name->second);
+                    }
+                }
+
+                component_start = component_end + 1;
+            }
+
+            return result;
+        }
+
+        void clear_resolved_paths() {
+            resolved_lru_.clear();
+            resolved_paths_.clear();
+        }
+
+        void clear_resolve_cache(const bool drop_folded_indexes) {
+            const std::lock_guard<std::mutex> guard(resolve_lock_);
+            clear_resolved_paths();
+
+            if (!drop_folded_indexes) {
+                return;
+            }
+
+            while (!folded_indexes_.empty()) {
+                drop_folded_index(folded_indexes_.begin());
+            }
+        }
+
+        // Must be called with the resolve lock held
+        void invalidate_folded_index(const std::u16string &dir) {
+            auto ite = folded_indexes_.find(dir);
+
+            if (ite != folded_indexes_.end()) {
+                ite->second.stale_ = true;
+            }
+
+            // Paths resolved through this directory may be wrong now
+            clear_resolved_paths();
+        }
+
+        void invalidate_parent_folded_index(const std::u16string &real_path) {
+            if (common::is_system_case_insensitive()) {
+                return;
+            }
+
+            const std::lock_guard<std::mutex> guard(resolve_lock_);
+
+            std::u16string entry_path = real_path;
+
+            while (!entry_path.empty() && eka2l1::is_separator(entry_path.back())) {
+                entry_path.pop_back();
+            }
+
+            invalidate_folded_index(eka2l1::file_directory(entry_path));
+        }
+
+        bool list_folded_names(const std::u16string &dir, std::unordered_map<std::u16string, std::u16string> &names) {
+            common::dir_iterator iterator(common::ucs2_to_utf8(dir));
+
+            if (!iterator.is_valid()) {
+                return false;
+            }
+
+            common::dir_entry entry;
+            names.clear();
+
+            while (iterator.next_entry(entry) == 0) {
+                const std::u16string name = common::utf8_to_ucs2(entry.name);
+                const std::u16string folded = common::lowercase_ucs2_string(name);
+
+                if ((name == u".") || (name == u"..")) {
+                    continue;
+                }
+
+                // An entry that is already lowercase wins, that is the one the emulator creates
+                if (folded == name) {
+                    names[folded] = name;
+                } else {
+                    names.emplace(folded, name);
+                }
+            }
+
+            return true;
+        }
+
+        // Must be called with the resolve lock held. Returns 0 on failure.
+        std::int32_t watch_folded_dir(const std::u16string &dir) {
+            if (!watcher_) {
+                watcher_ = std::make_unique<common::directory_watcher>();
+            }
+
+            const std::int32_t watch_handle = watcher_->watch(common::ucs2_to_utf8(dir), [this, dir](void *userdata, common::directory_changes &changes) {
+                // Only names matter here, file content being written is not interesting. Anything else,
+                // like the directory itself going away, is.
+                const bool names_changed = std::any_of(changes.begin(), changes.end(), [](const common::directory_change &change) {
+                    return change.change_ != common::directory_change_action_modified;
+                });
+
+                if (!names_changed) {
+                    return;
+                }
+
+                const std::lock_guard<std::mutex> guard(resolve_lock_);
+                invalidate_folded_index(dir);
+            },
+                nullptr, common::directory_change_move);
+
+            return (watch_handle <= 0) ? 0 : watch_handle;
+        }
+
+        // Must be called with the resolve lock held
+        void drop_folded_index(std::unordered_map<std::u16string, folded_name_index>::iterator ite) {
+            if (watcher_ && ite->second.watch_handle_) {
+                watcher_->unwatch(ite->second.watch_handle_);
+            }
+
+            folded_index_lru_.erase(ite->second.lru_position_);
+            folded_indexes_.erase(ite);
+        }
+
+        // Must be called with the resolve lock held. Returns nullptr if the directory can't be listed.
+        folded_name_index *get_folded_index(const std::u16string &dir) {
+            auto ite = folded_indexes_.find(dir);
+
+            if (ite == folded_indexes_.end()) {
+                if (folded_indexes_.size() >= FOLDED_INDEX_CACHE_SIZE) {
+                    drop_folded_index(folded_indexes_.find(folded_index_lru_.back()));
+                }
+
+                folded_index_lru_.push_front(dir);
+
+                ite = folded_indexes_.emplace(dir, folded_name_index{}).first;
+                ite->second.lru_position_ = folded_index_lru_.begin();
+            } else {
+                folded_index_lru_.splice(folded_index_lru_.begin(), folded_index_lru_, ite->second.lru_position_);
+            }
+
+            folded_name_index &index = ite->second;
+
+            if (index.stale_) {
+                // Watch again before listing, so nothing done in between is missed. The old watch may
+                // be dead if the directory was deleted and made again.
+                if (watcher_ && index.watch_handle_) {
+                    watcher_->unwatch(index.watch_handle_);
+                }
+
+                index.watch_handle_ = watch_folded_dir(dir);
+
+                if (!index.watch_handle_ || !list_folded_names(dir, index.names_)) {
+                    // Either gone, or can't tell when it goes stale
+                    drop_folded_index(ite);
+                    return nullptr;
+                }
+
+                index.stale_ = false;
             }
 
-            return eka2l1::add_path(map_path, vert_path_no_root);
+            return &index;
+        }
+
+        std::optional<std::u16string> get_real_physical_path(const std::u16string &vert_path) {
+            const std::lock_guard<std::mutex> guard(resolve_lock_);
+
+            auto cached = resolved_paths_.find(vert_path);
+
+            if (cached != resolved_paths_.end()) {
+                resolved_lru_.splice(resolved_lru_.begin(), resolved_lru_, cached->second);
+                return cached->second->second;
+            }
+
+            std::optional<std::u16string> result = resolve_physical_path(vert_path);
+
+            if (!result || result->empty()) {
+                return result;
+            }
+
+            if (resolved_paths_.size() >= RESOLVED_PATH_CACHE_SIZE) {
+                resolved_paths_.erase(resolved_lru_.back().first);
+                resolved_lru_.pop_back();
+            }
+
+            resolved_lru_.emplace_front(vert_path, result.value());
+            resolved_paths_.emplace(vert_path, resolved_lru_.begin());
+
+            return result;
         }
 
     public:
@@ -616,6 +856,7 @@ namespace eka2l1 {
 
         void set_epoc_ver(const epocver ever) override {
             ver = ever;
+            clear_resolve_cache(false);
         }
 
         std::optional<std::u16string> get_raw_path(const std::u16string &path) override {
@@ -629,11 +870,15 @@ namespace eka2l1 {
                 return false;
             }
 
-            return common::remove(common::ucs2_to_utf8(*path_real));
+            const bool result = common::remove(common::ucs2_to_utf8(*path_real));
+            invalidate_parent_folded_index(*path_real);
+
+            return result;
         }
 
         void set_product_code(const std::string &pc) override {
             firmcode = pc;
+            clear_resolve_cache(false);
         }
 
         bool exists(const std::u16string &path) override {
@@ -649,8 +894,13 @@ namespace eka2l1 {
                 return false;
             }
 
-            return common::move_file(common::ucs2_to_utf8(*old_path_real),
+            const bool result = common::move_file(common::ucs2_to_utf8(*old_path_real),
                 common::ucs2_to_utf8(*new_path_real));
+
+            invalidate_parent_folded_index(*old_path_real);
+            invalidate_parent_folded_index(*new_path_real);
+
+            return result;
         }
 
         bool create_directories(const std::u16string &path) override {
@@ -688,6 +938,7 @@ namespace eka2l1 {
         bool unmount(const drive_number drv) override {
             if (mappings[static_cast<int>(drv)].second) {
                 mappings[static_cast<int>(drv)].second = false;
+                clear_resolve_cache(false);
 
                 for (auto &watch_handle: watches[drv]) {
                     if (watcher_) {
@@ -824,8 +1075,9 @@ namespace eka2l1 {
             }
 
             const std::int64_t handle = watcher_->watch(common::ucs2_to_utf8(real_path.value()), callback, callback_userdata, filters);
-            if (handle < 0) {
-                return handle;
+            if (handle <= 0) {
+                // Watchers report failure as a non-positive handle
+                return -1;
             }
 
             watches[drv].push_back(handle);
@@ -863,6 +1115,9 @@ namespace eka2l1 {
                     common::copy_folder(mapping.first.real_path, mapping.first.real_path, common::FOLDER_COPY_FLAG_LOWERCASE_NAME,
                         nullptr);
                 }
+
+                // Every name on the host changed
+                clear_resolve_cache(true);
             }
         }
     };
@@ -1067,8 +1322,17 @@ namespace eka2l1 {
         elem.first = nullptr;
     }
 
+    bool io_entry_callback_free_check_func(entry_change_callback_and_data &elem) {
+        return !elem.first;
+    }
+
+    void io_entry_callback_free_func(entry_change_callback_and_data &elem) {
+        elem.first = nullptr;
+    }
+
     io_system::io_system()
-        : drive_change_callbacks(io_drive_callback_free_check_func, io_drive_callback_free_func) {
+        : drive_change_callbacks(io_drive_callback_free_check_func, io_drive_callback_free_func)
+        , entry_change_callbacks(io_entry_callback_free_check_func, io_entry_callback_free_func) {
     }
 
     io_system::~io_system() {
@@ -1138,9 +1402,16 @@ namespace eka2l1 {
 
     std::unique_ptr<file> io_system::open_file(utf16_str vir_path, int mode) {
         const std::lock_guard<std::mutex> guard(access_lock);
+        const bool may_create = (mode & (WRITE_MODE | APPEND_MODE));
 
         for (auto &[id, fs] : filesystems) {
+            const bool created = may_create && !fs->exists(vir_path);
+
             if (auto f = fs->open_file(vir_path, mode)) {
+                if (created) {
+                    invoke_entry_change_callbacks(vir_path);
+                }
+
                 return f;
             }
         }
@@ -1177,6 +1448,9 @@ namespace eka2l1 {
 
         for (auto &[id, fs] : filesystems) {
             if (fs->replace(old_path, new_path)) {
+                invoke_entry_change_callbacks(old_path);
+                invoke_entry_change_callbacks(new_path);
+
                 return true;
             }
         }
@@ -1189,6 +1463,7 @@ namespace eka2l1 {
 
         for (auto &[id, fs] : filesystems) {
             if (fs->delete_entry(path)) {
+                invoke_entry_change_callbacks(path);
                 return true;
             }
         }
@@ -1213,6 +1488,7 @@ namespace eka2l1 {
 
         for (auto &[id, fs] : filesystems) {
             if (fs->create_directories(path)) {
+                invoke_entry_change_callbacks(path);
                 return true;
             }
         }
@@ -1225,6 +1501,7 @@ namespace eka2l1 {
 
         for (auto &[id, fs] : filesystems) {
             if (fs->create_directory(path)) {
+                invoke_entry_change_callbacks(path);
                 return true;
             }
         }
@@ -1336,6 +1613,11 @@ namespace eka2l1 {
         auto pdat = std::make_pair(callback, userdata);
         return drive_change_callbacks.add(pdat);
     }
+
+    bool io_system::unregister_drive_change_notify(const std::size_t handle) {
+        const std::lock_guard<std::mutex> guard(access_lock);
+        return drive_change_callbacks.remove(handle);
+    }
     
     void io_system::invoke_drive_change_callbacks(drive_number drv, drive_action act) {
         for (auto &callback: drive_change_callbacks) {
@@ -1345,6 +1627,26 @@ namespace eka2l1 {
         }
     }
 
+    std::size_t io_system::register_entry_change_notify(entry_change_notify_callback callback, void *userdata) {
+        const std::lock_guard<std::mutex> guard(access_lock);
+
+        auto pdat = std::make_pair(callback, userdata);
+        return entry_change_callbacks.add(pdat);
+    }
+
+    bool io_system::unregister_entry_change_notify(const std::size_t handle) {
+        const std::lock_guard<std::mutex> guard(access_lock);
+        return entry_change_callbacks.remove(handle);
+    }
+
+    void io_system::invoke_entry_change_callbacks(const std::u16string &path) {
+        for (auto &callback: entry_change_callbacks) {
+            access_lock.unlock();
+            callback.first(callback.second, path);
+            access_lock.lock();
+        }
+    }
+
     symfile physical_file_proxy(const std::string &path, int mode) {
         return std::make_unique<physical_file>(common::utf8_to_ucs2(path), common::utf8_to_ucs2(path), mode);
     }
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/container.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+TEST_CASE("slab_container_reuse", "slab_container") {
+    common::slab_container<std::uint32_t> slab;
+
+    REQUIRE(slab.add(10) == 0);
+    REQUIRE(slab.add(11) == 1);
+    REQUIRE(slab.add(12) == 2);
+    REQUIRE(slab.size() == 3);
+
+    REQUIRE(slab.remove(1));
+    REQUIRE_FALSE(slab.remove(1));
+    REQUIRE(slab.get(1) == nullptr);
+
+    // The freed slot is taken before anything new
+    REQUIRE(slab.add(13) == 1);
+    REQUIRE(*slab.get(1) == 13);
+    REQUIRE(*slab.get(2) == 12);
+    REQUIRE(slab.size() == 3);
+}
+
+TEST_CASE("slab_container_limit", "slab_container") {
+    common::slab_container<std::uint32_t> slab(40);
+
+    for (std::uint32_t i = 0; i < 40; i++) {
+        REQUIRE(slab.add(i) == i);
+    }
+
+    REQUIRE(slab.capacity() == 40);
+    REQUIRE(slab.add(40) == common::INVALID_SLAB_SLOT);
+
+    REQUIRE(slab.remove(7));
+    REQUIRE(slab.add(41) == 7);
+    REQUIRE(slab.add(42) == common::INVALID_SLAB_SLOT);
+}
+
+TEST_CASE("slab_container_add_at", "slab_container") {
+    common::slab_container<std::uint32_t> slab;
+
+    REQUIRE(slab.add_at(20, 1));
+    REQUIRE_FALSE(slab.add_at(20, 2));
+    REQUIRE(*slab.get(20) == 1);
+
+    // Every other slot is still free and handed out from the lowest
+    for (std::size_t i = 0; i < 20; i++) {
+        REQUIRE(slab.add(0) == i);
+    }
+
+    REQUIRE(slab.add(0) == 21);
+    REQUIRE(slab.size() == 22);
+}
+
+TEST_CASE("slab_container_stress", "slab_container") {
+    common::slab_container<std::uint32_t> slab;
+    std::vector<std::size_t> alive;
+    std::mt19937 rng(0x5678);
+
+    for (std::uint32_t i = 0; i < 20000; i++) {
+        if (!alive.empty() && (rng() % 3 == 0)) {
+            const std::size_t pick = rng() % alive.size();
+
+            REQUIRE(slab.remove(alive[pick]));
+            alive[pick] = alive.back();
+            alive.pop_back();
+        } else {
+            const std::size_t index = slab.add(i);
+            REQUIRE(index != common::INVALID_SLAB_SLOT);
+            REQUIRE(*slab.get(index) == i);
+
+            alive.push_back(index);
+        }
+    }
+
+    REQUIRE(slab.size() == alive.size());
+
+    // Freed slots were reused, so the array never grew much past what was alive at once
+    REQUIRE(slab.capacity() <= alive.size() * 4);
+}
+
+TEST_CASE("slab_container_benchmark", "[.benchmark]") {
+    static constexpr std::size_t BENCHMARK_HANDLE_COUNT = 0x7FFF;
+
+    BENCHMARK("Open then close 32767 handles") {
+        common::slab_container<std::uint32_t> slab(BENCHMARK_HANDLE_COUNT + 1);
+
+        for (std::uint32_t i = 0; i < BENCHMARK_HANDLE_COUNT; i++) {
+            slab.add(i);
+        }
+
+        for (std::size_t i = 0; i < BENCHMARK_HANDLE_COUNT; i++) {
+            slab.remove(i);
+        }
+
+        return slab.size();
+    };
+
+    common::slab_container<std::uint32_t> full(BENCHMARK_HANDLE_COUNT + 1);
+
+    for (std::uint32_t i = 0; i < BENCHMARK_HANDLE_COUNT; i++) {
+        full.add(i);
+    }
+
+    BENCHMARK("Churn one handle in a nearly full table") {
+        full.remove(BENCHMARK_HANDLE_COUNT / 2);
+        return full.add(0);
+    };
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/pixel.h>
+
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+// Odd counts so both the vectorized part and the tail are checked
+static constexpr std::size_t TEST_PIXEL_COUNT = 37;
+
+template <typename T>
+static std::vector<T> make_random_row(const std::size_t count) {
+    std::mt19937 rng(0x1234);
+    std::vector<T> row(count);
+
+    for (auto &value : row) {
+        value = static_cast<T>(rng());
+    }
+
+    return row;
+}
+
+TEST_CASE("palette_conversion", "pixel") {
+    std::vector<std::uint32_t> palette(256);
+
+    for (std::uint32_t i = 0; i < 256; i++) {
+        palette[i] = 0xFF000000 | (i * 0x10101);
+    }
+
+    const std::vector<std::uint8_t> indices = make_random_row<std::uint8_t>(TEST_PIXEL_COUNT);
+    std::vector<std::uint32_t> result(TEST_PIXEL_COUNT);
+
+    for (const int bits_per_pixel : { 1, 2, 4, 8 }) {
+        common::convert_palette_row_to_bgra32(result.data(), indices.data(), TEST_PIXEL_COUNT, bits_per_pixel, palette.data());
+
+        const int pixels_per_byte = 8 / bits_per_pixel;
+        const std::uint8_t index_mask = static_cast<std::uint8_t>((1 << bits_per_pixel) - 1);
+
+        for (std::size_t i = 0; i < TEST_PIXEL_COUNT; i++) {
+            const std::uint8_t index = (indices[i / pixels_per_byte] >> ((i % pixels_per_byte) * bits_per_pixel)) & index_mask;
+            REQUIRE(result[i] == palette[index]);
+        }
+    }
+}
+
+TEST_CASE("twelve_and_sixteen_bit_conversion", "pixel") {
+    const std::vector<std::uint16_t> words = make_random_row<std::uint16_t>(TEST_PIXEL_COUNT);
+    std::vector<std::uint32_t> result(TEST_PIXEL_COUNT);
+
+    common::convert_xrgb4444_row_to_bgra32(result.data(), words.data(), TEST_PIXEL_COUNT);
+
+    for (std::size_t i = 0; i < TEST_PIXEL_COUNT; i++) {
+        REQUIRE((result[i] >> 24) == 0xFF);
+        REQUIRE(((result[i] >> 16) & 0xFF) == ((words[i] >> 8) & 0xF) * 17);
+        REQUIRE(((result[i] >> 8) & 0xFF) == ((words[i] >> 4) & 0xF) * 17);
+        REQUIRE((result[i] & 0xFF) == (words[i] & 0xF) * 17);
+    }
+
+    common::convert_rgb565_row_to_bgra32(result.data(), words.data(), TEST_PIXEL_COUNT);
+
+    for (std::size_t i = 0; i < TEST_PIXEL_COUNT; i++) {
+        REQUIRE((result[i] >> 24) == 0xFF);
+
+        // Top bits are kept as they are
+        REQUIRE(((result[i] >> 19) & 0x1F) == (words[i] >> 11));
+        REQUIRE(((result[i] >> 10) & 0x3F) == ((words[i] >> 5) & 0x3F));
+        REQUIRE(((result[i] >> 3) & 0x1F) == (words[i] & 0x1F));
+    }
+
+    const std::uint16_t white = 0xFFFF;
+    common::convert_rgb565_row_to_bgra32(result.data(), &white, 1);
+
+    REQUIRE(result[0] == 0xFFFFFFFF);
+}
+
+TEST_CASE("true_color_conversion", "pixel") {
+    const std::vector<std::uint8_t> bytes = make_random_row<std::uint8_t>(TEST_PIXEL_COUNT * 3);
+    std::vector<std::uint32_t> result(TEST_PIXEL_COUNT);
+
+    common::convert_bgr24_row_to_bgra32(result.data(), bytes.data(), TEST_PIXEL_COUNT);
+
+    for (std::size_t i = 0; i < TEST_PIXEL_COUNT; i++) {
+        REQUIRE(result[i] == (0xFF000000 | (bytes[i * 3 + 2] << 16) | (bytes[i * 3 + 1] << 8) | bytes[i * 3]));
+    }
+
+    const std::vector<std::uint32_t> pixels = make_random_row<std::uint32_t>(TEST_PIXEL_COUNT);
+    common::convert_bgrx32_row_to_bgra32(result.data(), pixels.data(), TEST_PIXEL_COUNT);
+
+    for (std::size_t i = 0; i < TEST_PIXEL_COUNT; i++) {
+        REQUIRE(result[i] == (pixels[i] | 0xFF000000));
+    }
+}
+
+TEST_CASE("pixel_conversion_benchmark", "[.benchmark]") {
+    static constexpr std::size_t BENCHMARK_PIXEL_COUNT = 360 * 640;
+
+    std::vector<std::uint32_t> palette(256, 0xFF000000);
+    const std::vector<std::uint8_t> bytes = make_random_row<std::uint8_t>(BENCHMARK_PIXEL_COUNT * 3);
+    const std::vector<std::uint16_t> words = make_random_row<std::uint16_t>(BENCHMARK_PIXEL_COUNT);
+
+    std::vector<std::uint32_t> result(BENCHMARK_PIXEL_COUNT);
+
+    BENCHMARK("1bpp to 32bpp, 360x640") {
+        common::convert_palette_row_to_bgra32(result.data(), bytes.data(), BENCHMARK_PIXEL_COUNT, 1, palette.data());
+        return result[0];
+    };
+
+    BENCHMARK("8bpp palette to 32bpp, 360x640") {
+        common::convert_palette_row_to_bgra32(result.data(), bytes.data(), BENCHMARK_PIXEL_COUNT, 8, palette.data());
+        return result[0];
+    };
+
+    BENCHMARK("16bpp to 32bpp, 360x640") {
+        common::convert_rgb565_row_to_bgra32(result.data(), words.data(), BENCHMARK_PIXEL_COUNT);
+        return result[0];
+    };
+
+    BENCHMARK("24bpp to 32bpp, 360x640") {
+        common::convert_bgr24_row_to_bgra32(result.data(), bytes.data(), BENCHMARK_PIXEL_COUNT);
+        return result[0];
+    };
+}
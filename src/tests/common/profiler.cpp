@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/profiler.h>
+
+using namespace eka2l1;
+
+TEST_CASE("latency_histogram_buckets_and_percentile", "profiler") {
+    common::latency_histogram hist;
+
+    for (int i = 0; i < 99; i++) {
+        hist.record(100);
+    }
+
+    hist.record(5000);
+
+    REQUIRE(hist.count_ == 100);
+    REQUIRE(hist.min_ns_ == 100);
+    REQUIRE(hist.max_ns_ == 5000);
+    REQUIRE(hist.average() == (99 * 100 + 5000) / 100);
+
+    // 100 lands in [64, 128), 5000 lands in [4096, 8192)
+    REQUIRE(hist.buckets_[6] == 99);
+    REQUIRE(hist.buckets_[12] == 1);
+
+    REQUIRE(hist.percentile(0.5) == 127);
+    REQUIRE(hist.percentile(1.0) == 5000);
+}
+
+TEST_CASE("call_profiler_disabled_records_nothing", "profiler") {
+    common::call_profiler profiler(false);
+    const std::string name = "heap";
+
+    {
+        common::call_profile_scope scope(&profiler, common::call_profile_category_svc, 0, 0x00800001, "", name);
+    }
+
+    REQUIRE(profiler.snapshot().empty());
+}
+
+TEST_CASE("call_profiler_groups_by_owner_and_ordinal", "profiler") {
+    common::call_profiler profiler(true);
+    const std::string server_a = "!Windowserver";
+    const std::string server_b = "!Fontbitmapserver";
+    const std::string empty;
+
+    profiler.record(common::call_profile_category_ipc, 1, 5, server_a, empty, 10);
+    profiler.record(common::call_profile_category_ipc, 1, 5, server_a, empty, 30);
+    profiler.record(common::call_profile_category_ipc, 2, 5, server_b, empty, 100);
+    profiler.record(common::call_profile_category_svc, 0, 5, empty, empty, 1);
+
+    const auto entries = profiler.snapshot();
+
+    REQUIRE(entries.size() == 3);
+
+    // Sorted by total time
+    REQUIRE(entries[0].group_ == server_b);
+    REQUIRE(entries[1].group_ == server_a);
+    REQUIRE(entries[1].histogram_.count_ == 2);
+    REQUIRE(entries[1].histogram_.total_ns_ == 40);
+    REQUIRE(entries[2].category_ == common::call_profile_category_svc);
+
+    profiler.reset();
+    REQUIRE(profiler.snapshot().empty());
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/queue.h>
+
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+TEST_CASE("spsc_ring_wraparound", "spsc_ring") {
+    spsc_ring<std::int16_t> ring(6);
+    REQUIRE(ring.capacity() == 8);
+
+    std::array<std::int16_t, 8> input = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    std::array<std::int16_t, 8> output = {};
+
+    REQUIRE(ring.write(input.data(), 6) == 6);
+    REQUIRE(ring.read(output.data(), 4) == 4);
+    REQUIRE(output[3] == 4);
+
+    // This one crosses the end of the storage
+    REQUIRE(ring.write(input.data(), 8) == 6);
+    REQUIRE(ring.space() == 0);
+
+    REQUIRE(ring.read(output.data(), 8) == 8);
+
+    const std::array<std::int16_t, 8> expected = { 5, 6, 1, 2, 3, 4, 5, 6 };
+    REQUIRE(output == expected);
+    REQUIRE(ring.size() == 0);
+}
+
+TEST_CASE("spsc_ring_discard_until_mark", "spsc_ring") {
+    spsc_ring<std::int16_t> ring(8);
+
+    std::array<std::int16_t, 4> input = { 1, 2, 3, 4 };
+    std::array<std::int16_t, 4> output = {};
+
+    ring.write(input.data(), 3);
+    const std::size_t mark = ring.write_mark();
+    ring.write(input.data() + 3, 1);
+
+    ring.discard_until(mark);
+    REQUIRE(ring.size() == 1);
+    REQUIRE(ring.read(output.data(), 4) == 1);
+    REQUIRE(output[0] == 4);
+
+    // Marks already passed are ignored
+    ring.discard_until(mark);
+    ring.write(input.data(), 2);
+    REQUIRE(ring.size() == 2);
+}
+
+TEST_CASE("spsc_ring_two_threads", "spsc_ring") {
+    static constexpr std::uint32_t TOTAL_COUNT = 1 << 20;
+    spsc_ring<std::uint32_t> ring(1024);
+
+    std::thread producer([&]() {
+        std::vector<std::uint32_t> chunk(97);
+        std::uint32_t next = 0;
+
+        while (next < TOTAL_COUNT) {
+            const std::uint32_t count = std::min<std::uint32_t>(static_cast<std::uint32_t>(chunk.size()), TOTAL_COUNT - next);
+
+            for (std::uint32_t i = 0; i < count; i++) {
+                chunk[i] = next + i;
+            }
+
+            next += static_cast<std::uint32_t>(ring.write(chunk.data(), count));
+        }
+    });
+
+    std::vector<std::uint32_t> chunk(61);
+    std::uint32_t expected = 0;
+    bool in_order = true;
+
+    while (expected < TOTAL_COUNT) {
+        const std::size_t count = ring.read(chunk.data(), chunk.size());
+
+        for (std::size_t i = 0; i < count; i++) {
+            in_order = in_order && (chunk[i] == expected++);
+        }
+    }
+
+    producer.join();
+
+    REQUIRE(in_order);
+    REQUIRE(ring.size() == 0);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/region.h>
+
+using namespace eka2l1;
+
+static int region_area(const common::region &reg) {
+    int total = 0;
+
+    for (const eka2l1::rect &r : reg.rects_) {
+        total += r.size.x * r.size.y;
+    }
+
+    return total;
+}
+
+TEST_CASE("add_overlapping_rects", "region") {
+    common::region reg;
+    REQUIRE(reg.add_rect(eka2l1::rect({ 0, 0 }, { 10, 10 })));
+    REQUIRE(reg.add_rect(eka2l1::rect({ 5, 5 }, { 10, 10 })));
+
+    // Overlap is only counted once
+    REQUIRE(region_area(reg) == 175);
+    REQUIRE(reg.bounding_rect().top == eka2l1::vec2(0, 0));
+    REQUIRE(reg.bounding_rect().size == eka2l1::vec2(15, 15));
+
+    // Already covered, nothing changes
+    REQUIRE_FALSE(reg.add_rect(eka2l1::rect({ 2, 2 }, { 3, 3 })));
+    REQUIRE(region_area(reg) == 175);
+}
+
+TEST_CASE("add_rect_spanning_multiple_rects", "region") {
+    common::region reg;
+    reg.add_rect(eka2l1::rect({ 0, 0 }, { 4, 4 }));
+    reg.add_rect(eka2l1::rect({ 8, 0 }, { 4, 4 }));
+    reg.add_rect(eka2l1::rect({ 2, 2 }, { 8, 4 }));
+
+    REQUIRE(region_area(reg) == 16 + 16 + 32 - 4 - 4);
+}
+
+TEST_CASE("eliminate_rect_from_middle", "region") {
+    common::region reg;
+    reg.add_rect(eka2l1::rect({ 0, 0 }, { 10, 10 }));
+    reg.eliminate(eka2l1::rect({ 3, 3 }, { 4, 4 }));
+
+    REQUIRE(reg.rects_.size() == 4);
+    REQUIRE(region_area(reg) == 84);
+
+    // The hole must not be covered by any piece
+    for (const eka2l1::rect &r : reg.rects_) {
+        REQUIRE(r.intersect(eka2l1::rect({ 3, 3 }, { 4, 4 })).empty());
+    }
+}
+
+TEST_CASE("eliminate_whole_rects", "region") {
+    common::region reg;
+    reg.add_rect(eka2l1::rect({ 0, 0 }, { 10, 10 }));
+    reg.add_rect(eka2l1::rect({ 20, 0 }, { 10, 10 }));
+
+    common::region cover;
+    cover.add_rect(eka2l1::rect({ 0, 0 }, { 40, 10 }));
+    reg.eliminate(cover);
+
+    REQUIRE(reg.empty());
+}
+
+TEST_CASE("intersect_regions", "region") {
+    common::region a;
+    a.add_rect(eka2l1::rect({ 0, 0 }, { 10, 10 }));
+
+    common::region b;
+    b.add_rect(eka2l1::rect({ 5, 5 }, { 10, 10 }));
+    b.add_rect(eka2l1::rect({ 20, 20 }, { 5, 5 }));
+
+    common::region result = a.intersect(b);
+    REQUIRE(region_area(result) == 25);
+    REQUIRE(result.bounding_rect().top == eka2l1::vec2(5, 5));
+}
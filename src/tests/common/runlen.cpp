@@ -21,7 +21,12 @@
 #include <common/buffer.h>
 #include <common/runlen.h>
 
+#include <algorithm>
 #include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace eka2l1;
 
@@ -178,4 +183,234 @@ TEST_CASE("sixteen_bits_compression_small", "rle_compression") {
 
     REQUIRE(compressed_size == expected.size());
     REQUIRE(std::equal(expected.begin(), expected.end(), dest_buf.begin()));
-}
\ No newline at end of file
+}
+
+TEST_CASE("compression_keeps_last_unequal_pixel", "rle_compression") {
+    static std::array<std::uint8_t, 3> source = { 0x44, 0x44, 0x45 };
+    static std::array<std::int8_t, 4> expected = { 1, 0x44, -1, 0x45 };
+
+    std::vector<std::uint8_t> dest_buf;
+    compress_rle<8>(source.data(), source.size(), dest_buf);
+
+    REQUIRE(dest_buf.size() == expected.size());
+    REQUIRE(std::equal(expected.begin(), expected.end(), reinterpret_cast<std::int8_t *>(dest_buf.data())));
+}
+
+// Runs split across the 128 limit, unique sequences and short runs. The first pixel of a run
+// following a unique sequence is folded into that sequence.
+template <size_t BIT>
+static std::vector<std::uint8_t> make_reference_source() {
+    static constexpr std::size_t BYTE_COUNT = BIT / 8;
+    static const std::array<std::pair<std::uint8_t, std::size_t>, 9> pattern = { {
+        { 0x10, 130 }, { 0x20, 1 }, { 0x30, 1 }, { 0x40, 1 }, { 0x50, 1 },
+        { 0x60, 3 }, { 0x70, 1 }, { 0x80, 1 }, { 0x90, 5 }
+    } };
+
+    std::vector<std::uint8_t> source;
+
+    for (const auto &[value, repeat] : pattern) {
+        for (std::size_t i = 0; i < repeat; i++) {
+            for (std::size_t b = 0; b < BYTE_COUNT; b++) {
+                source.push_back(static_cast<std::uint8_t>(value + b));
+            }
+        }
+    }
+
+    return source;
+}
+
+template <size_t BIT, std::size_t N>
+static void check_compression_against_reference(const std::array<std::int8_t, N> &expected) {
+    std::vector<std::uint8_t> source = make_reference_source<BIT>();
+
+    std::vector<std::uint8_t> compressed;
+    compress_rle<BIT>(source.data(), source.size(), compressed);
+
+    REQUIRE(compressed.size() == expected.size());
+    REQUIRE(std::equal(expected.begin(), expected.end(), reinterpret_cast<std::int8_t *>(compressed.data())));
+
+    common::ro_buf_stream source_stream(source.data(), source.size());
+    std::vector<std::uint8_t> stream_compressed(expected.size());
+    common::wo_buf_stream stream_dest(stream_compressed.data(), stream_compressed.size());
+
+    std::size_t compressed_size = 0;
+    REQUIRE(compress_rle<BIT>(&source_stream, &stream_dest, compressed_size));
+    REQUIRE(compressed_size == expected.size());
+    REQUIRE(std::equal(expected.begin(), expected.end(), reinterpret_cast<std::int8_t *>(stream_compressed.data())));
+}
+
+// Expected outputs were produced by the stream-only encoder this one replaced
+TEST_CASE("sixteen_bits_compression_reference", "rle_compression") {
+    static const std::array<std::int8_t, 30> expected = {
+        127, 16, 17, 1, 16, 17,
+        -5, 32, 33, 48, 49, 64, 65, 80, 81, 96, 97,
+        1, 96, 97,
+        -3, 112, 113, -128, -127, -112, -111,
+        3, -112, -111
+    };
+
+    check_compression_against_reference<16>(expected);
+}
+
+TEST_CASE("twenty_four_bits_compression_reference", "rle_compression") {
+    static const std::array<std::int8_t, 42> expected = {
+        127, 16, 17, 18, 1, 16, 17, 18,
+        -5, 32, 33, 34, 48, 49, 50, 64, 65, 66, 80, 81, 82, 96, 97, 98,
+        1, 96, 97, 98,
+        -3, 112, 113, 114, -128, -127, -126, -112, -111, -110,
+        3, -112, -111, -110
+    };
+
+    check_compression_against_reference<24>(expected);
+}
+
+TEST_CASE("thirty_two_bits_compression_reference", "rle_compression") {
+    static const std::array<std::int8_t, 54> expected = {
+        127, 16, 17, 18, 19, 1, 16, 17, 18, 19,
+        -5, 32, 33, 34, 35, 48, 49, 50, 51, 64, 65, 66, 67, 80, 81, 82, 83, 96, 97, 98, 99,
+        1, 96, 97, 98, 99,
+        -3, 112, 113, 114, 115, -128, -127, -126, -125, -112, -111, -110, -109,
+        3, -112, -111, -110, -109
+    };
+
+    check_compression_against_reference<32>(expected);
+}
+
+template <size_t BIT>
+static void check_compression_round_trip(const std::uint32_t seed) {
+    static constexpr std::size_t BYTE_COUNT = BIT / 8;
+    static constexpr std::size_t PIXEL_COUNT = 4099;
+
+    // Mix runs of every length with unique sequences, so both paths and the chunk splits get hit
+    std::mt19937 rng(seed);
+    std::vector<std::uint8_t> source;
+
+    while (source.size() < PIXEL_COUNT * BYTE_COUNT) {
+        std::uint8_t pixel[BYTE_COUNT];
+
+        for (std::size_t i = 0; i < BYTE_COUNT; i++) {
+            pixel[i] = static_cast<std::uint8_t>(rng() % 4);
+        }
+
+        const std::size_t repeat = (rng() % 3 == 0) ? (rng() % 300) : 1;
+
+        for (std::size_t i = 0; i < repeat; i++) {
+            source.insert(source.end(), pixel, pixel + BYTE_COUNT);
+        }
+    }
+
+    source.resize(PIXEL_COUNT * BYTE_COUNT);
+
+    std::vector<std::uint8_t> compressed;
+    compress_rle<BIT>(source.data(), source.size(), compressed);
+
+    std::vector<std::uint8_t> decompressed(source.size());
+    common::ro_buf_stream compressed_stream(compressed.data(), compressed.size());
+    common::wo_buf_stream decompressed_stream(decompressed.data(), decompressed.size());
+
+    decompress_rle<BIT>(&compressed_stream, &decompressed_stream);
+
+    REQUIRE(decompressed == source);
+}
+
+TEST_CASE("compression_round_trip", "rle_compression") {
+    for (std::uint32_t seed = 0; seed < 8; seed++) {
+        check_compression_round_trip<8>(seed);
+        check_compression_round_trip<16>(seed);
+        check_compression_round_trip<24>(seed);
+        check_compression_round_trip<32>(seed);
+    }
+}
+
+TEST_CASE("decompression_from_memory", "rle_compression") {
+    static std::array<std::int8_t, 12> compressed = {
+        17, 0x00,
+        -9, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13
+    };
+
+    const std::uint8_t *source = reinterpret_cast<const std::uint8_t *>(compressed.data());
+
+    // Measure only
+    REQUIRE(decompress_rle<8>(source, compressed.size(), nullptr, 0xFFFFFFFF) == 27);
+
+    std::vector<std::uint8_t> dest(27, 0xFF);
+    REQUIRE(decompress_rle<8>(source, compressed.size(), dest.data(), dest.size()) == 27);
+    REQUIRE(std::count(dest.begin(), dest.begin() + 18, 0) == 18);
+    REQUIRE(dest[18] == 0x05);
+    REQUIRE(dest[26] == 0x13);
+
+    // Stops once the destination is full
+    std::vector<std::uint8_t> small_dest(20, 0xFF);
+    REQUIRE(decompress_rle<8>(source, compressed.size(), small_dest.data(), small_dest.size()) == 20);
+    REQUIRE(small_dest[17] == 0x00);
+    REQUIRE(small_dest[18] == 0x05);
+    REQUIRE(small_dest[19] == 0x06);
+}
+
+TEST_CASE("twelve_bit_decompression", "rle_compression") {
+    static std::array<std::uint16_t, 2> compressed = { 0x3ABC, 0x0123 };
+    static std::array<std::uint16_t, 5> expected = { 0xABC, 0xABC, 0xABC, 0xABC, 0x123 };
+
+    std::array<std::uint16_t, 5> dest{};
+
+    REQUIRE(decompress_rle<12>(reinterpret_cast<const std::uint8_t *>(compressed.data()), sizeof(compressed),
+                reinterpret_cast<std::uint8_t *>(dest.data()), sizeof(dest))
+        == sizeof(dest));
+    REQUIRE(dest == expected);
+}
+
+template <size_t BIT>
+static std::vector<std::uint8_t> make_skin_like_bitmap(const int width, const int height) {
+    static constexpr std::size_t BYTE_COUNT = BIT / 8;
+
+    // Flat areas with gradient bands and some detailed areas, roughly what skin and icon bitmaps look like
+    std::mt19937 rng(1234);
+    std::vector<std::uint8_t> result;
+    result.reserve(width * height * BYTE_COUNT);
+
+    for (int y = 0; y < height; y++) {
+        int x = 0;
+
+        while (x < width) {
+            const int span = (rng() % 4 == 0) ? 1 : static_cast<int>(rng() % 48 + 2);
+            const std::uint32_t color = (rng() % 4 == 0) ? rng() : static_cast<std::uint32_t>(y * 0x010101);
+
+            for (int i = 0; (i < span) && (x < width); i++, x++) {
+                for (std::size_t b = 0; b < BYTE_COUNT; b++) {
+                    result.push_back(static_cast<std::uint8_t>(color >> (b * 8)));
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+template <size_t BIT>
+static void benchmark_decompression(const char *name) {
+    const std::vector<std::uint8_t> raw = make_skin_like_bitmap<BIT>(360, 640);
+
+    std::vector<std::uint8_t> compressed;
+    compress_rle<BIT>(raw.data(), raw.size(), compressed);
+
+    std::vector<std::uint8_t> dest(raw.size());
+
+    BENCHMARK(std::string(name) + " through streams") {
+        common::ro_buf_stream source_stream(compressed.data(), compressed.size());
+        common::wo_buf_stream dest_stream(dest.data(), dest.size());
+
+        decompress_rle<BIT>(&source_stream, &dest_stream);
+        return dest[0];
+    };
+
+    BENCHMARK(std::string(name) + " from memory") {
+        return decompress_rle<BIT>(compressed.data(), compressed.size(), dest.data(), dest.size());
+    };
+}
+
+TEST_CASE("rle_decompression_benchmark", "[.benchmark]") {
+    benchmark_decompression<8>("8bpp 360x640");
+    benchmark_decompression<16>("16bpp 360x640");
+    benchmark_decompression<24>("24bpp 360x640");
+    benchmark_decompression<32>("32bpp 360x640");
+}
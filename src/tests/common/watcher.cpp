@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/fileutils.h>
+#include <common/path.h>
+#include <common/watcher.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace eka2l1;
+
+static bool wait_until_reported(const std::atomic<int> &counter, const int expected) {
+    for (int i = 0; i < 200; i++) {
+        if (counter >= expected) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+TEST_CASE("watch_same_directory_twice", "directory_watcher") {
+    eka2l1::create_directories("watcher_shared");
+    common::remove("watcher_shared/first.txt");
+    common::remove("watcher_shared/second.txt");
+
+    common::directory_watcher watcher;
+
+    std::atomic<int> first_count(0);
+    std::atomic<int> second_count(0);
+
+    auto count_changes = [](void *userdata, common::directory_changes &changes) {
+        *reinterpret_cast<std::atomic<int> *>(userdata) += static_cast<int>(changes.size());
+    };
+
+    const std::int32_t first_handle = watcher.watch("watcher_shared", count_changes, &first_count, common::directory_change_move);
+    const std::int32_t second_handle = watcher.watch("watcher_shared", count_changes, &second_count, common::directory_change_move);
+
+    REQUIRE(first_handle > 0);
+    REQUIRE(second_handle > 0);
+    REQUIRE(first_handle != second_handle);
+
+    // Both watches see the change
+    std::ofstream("watcher_shared/first.txt") << "1";
+
+    REQUIRE(wait_until_reported(first_count, 1));
+    REQUIRE(wait_until_reported(second_count, 1));
+
+    // Dropping one watch keeps the other alive
+    REQUIRE(watcher.unwatch(first_handle));
+    REQUIRE_FALSE(watcher.unwatch(first_handle));
+
+    const int second_before = second_count;
+    std::ofstream("watcher_shared/second.txt") << "2";
+
+    REQUIRE(wait_until_reported(second_count, second_before + 1));
+    REQUIRE(watcher.unwatch(second_handle));
+}
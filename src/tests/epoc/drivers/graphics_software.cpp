@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/graphics/backend/software/blit_software.h>
+#include <drivers/graphics/backend/software/graphics_software.h>
+#include <drivers/itc.h>
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    // Runs the driver on its own thread, like the emulator does, and stops it when done
+    struct software_driver_runner {
+        drivers::software_graphics_driver driver;
+        std::thread driver_thread;
+
+        explicit software_driver_runner()
+            : driver_thread([this]() { driver.run(); }) {
+        }
+
+        ~software_driver_runner() {
+            driver.abort();
+            driver_thread.join();
+        }
+
+        template <typename T>
+        void execute(T build_func) {
+            auto cmd_list = driver.new_command_list();
+            auto cmd_builder = driver.new_command_builder(cmd_list.get());
+
+            build_func(cmd_builder.get());
+            driver.wait_fence(driver.submit_command_list(*cmd_list));
+        }
+
+        std::vector<std::uint32_t> read(const drivers::handle h) {
+            std::vector<std::uint32_t> pixels;
+            REQUIRE(driver.read_bitmap(h, pixels));
+
+            return pixels;
+        }
+    };
+}
+
+static void use_window_server_blending(drivers::graphics_command_list_builder *builder) {
+    builder->set_blend_mode(true);
+    builder->blend_formula(drivers::blend_equation::add, drivers::blend_equation::add,
+        drivers::blend_factor::frag_out_alpha, drivers::blend_factor::one_minus_frag_out_alpha,
+        drivers::blend_factor::one, drivers::blend_factor::one_minus_frag_out_alpha);
+}
+
+TEST_CASE("software_swizzle_span", "software_rasterizer") {
+    // Odd count so both the vector loop and the remainder run
+    std::vector<std::uint32_t> pixels(7, drivers::software::pack_pixel(0x30, 0x20, 0x10, 0x00));
+
+    const std::array<drivers::channel_swizzle, 4> alpha_one = { drivers::channel_swizzle::red, drivers::channel_swizzle::green,
+        drivers::channel_swizzle::blue, drivers::channel_swizzle::one };
+
+    drivers::software::swizzle_span(pixels.data(), pixels.size(), alpha_one.data());
+
+    for (const std::uint32_t pixel : pixels) {
+        REQUIRE(pixel == drivers::software::pack_pixel(0x30, 0x20, 0x10, 0xFF));
+    }
+
+    const std::array<drivers::channel_swizzle, 4> moved = { drivers::channel_swizzle::blue, drivers::channel_swizzle::zero,
+        drivers::channel_swizzle::red, drivers::channel_swizzle::red };
+
+    drivers::software::swizzle_span(pixels.data(), pixels.size(), moved.data());
+
+    for (const std::uint32_t pixel : pixels) {
+        REQUIRE(pixel == drivers::software::pack_pixel(0x10, 0x00, 0x30, 0x30));
+    }
+}
+
+TEST_CASE("software_draw_bitmap_applies_swizzle", "software_rasterizer") {
+    software_driver_runner runner;
+
+    const eka2l1::vec2 size(4, 1);
+    const eka2l1::rect full_rect({ 0, 0 }, size);
+
+    const drivers::handle target = drivers::create_bitmap(&runner.driver, size, 32);
+    const drivers::handle source = drivers::create_bitmap(&runner.driver, size, 32);
+
+    // Color16MU pixels, the alpha byte is left unset
+    const std::array<std::uint32_t, 4> source_pixels = { 0x00302010, 0x00302010, 0x00302010, 0x00302010 };
+
+    runner.execute([&](drivers::graphics_command_list_builder *builder) {
+        builder->update_bitmap(source, reinterpret_cast<const char *>(source_pixels.data()), sizeof(source_pixels),
+            { 0, 0 }, size);
+
+        builder->bind_bitmap(target);
+        builder->clear({ 0, 0, 0, 0 }, drivers::draw_buffer_bit_color_buffer);
+
+        use_window_server_blending(builder);
+        builder->draw_bitmap(source, 0, full_rect, full_rect);
+    });
+
+    // Transparent, so nothing shows up
+    for (const std::uint32_t pixel : runner.read(target)) {
+        REQUIRE(pixel == 0);
+    }
+
+    runner.execute([&](drivers::graphics_command_list_builder *builder) {
+        builder->set_swizzle(source, drivers::channel_swizzle::red, drivers::channel_swizzle::green,
+            drivers::channel_swizzle::blue, drivers::channel_swizzle::one);
+
+        // Only nearest filtering is done, this must not stop the draw after it
+        builder->set_texture_filter(source, drivers::filter_option::linear, drivers::filter_option::linear);
+
+        builder->draw_bitmap(source, 0, full_rect, full_rect);
+    });
+
+    for (const std::uint32_t pixel : runner.read(target)) {
+        REQUIRE(pixel == 0xFF302010);
+    }
+
+    // Source data stays untouched, only sampling changes
+    for (const std::uint32_t pixel : runner.read(source)) {
+        REQUIRE(pixel == 0x00302010);
+    }
+}
+
+TEST_CASE("software_draw_bitmap_applies_mask_swizzle", "software_rasterizer") {
+    software_driver_runner runner;
+
+    const eka2l1::vec2 size(4, 1);
+    const eka2l1::rect full_rect({ 0, 0 }, size);
+
+    const drivers::handle target = drivers::create_bitmap(&runner.driver, size, 32);
+    const drivers::handle source = drivers::create_bitmap(&runner.driver, size, 32);
+    const drivers::handle mask = drivers::create_bitmap(&runner.driver, size, 32);
+
+    const std::array<std::uint32_t, 4> source_pixels = { 0xFF302010, 0xFF302010, 0xFF302010, 0xFF302010 };
+
+    // Mask without alpha: white on the left half, black on the right
+    const std::array<std::uint32_t, 4> mask_pixels = { 0x00FFFFFF, 0x00FFFFFF, 0x00000000, 0x00000000 };
+
+    runner.execute([&](drivers::graphics_command_list_builder *builder) {
+        builder->update_bitmap(source, reinterpret_cast<const char *>(source_pixels.data()), sizeof(source_pixels),
+            { 0, 0 }, size);
+        builder->update_bitmap(mask, reinterpret_cast<const char *>(mask_pixels.data()), sizeof(mask_pixels),
+            { 0, 0 }, size);
+
+        builder->bind_bitmap(target);
+        builder->clear({ 0, 0, 0, 0 }, drivers::draw_buffer_bit_color_buffer);
+
+        // Same as the window server does for masks in a display mode without alpha
+        builder->set_swizzle(mask, drivers::channel_swizzle::red, drivers::channel_swizzle::green,
+            drivers::channel_swizzle::blue, drivers::channel_swizzle::red);
+
+        use_window_server_blending(builder);
+        builder->draw_bitmap(source, mask, full_rect, full_rect);
+    });
+
+    const std::vector<std::uint32_t> result = runner.read(target);
+
+    REQUIRE(result[0] == 0xFF302010);
+    REQUIRE(result[1] == 0xFF302010);
+    REQUIRE(result[2] == 0);
+    REQUIRE(result[3] == 0);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <cpu/arm_factory.h>
+
+#include <kernel/kernel.h>
+#include <kernel/sema.h>
+#include <kernel/timing.h>
+#include <vfs/vfs.h>
+
+#include <memory>
+
+using namespace eka2l1;
+
+// A kernel with nothing running, enough to create and look up objects
+struct kernel_name_fixture {
+    config::state conf;
+    arm::core_instance cpu;
+
+    std::unique_ptr<ntimer> timing;
+    std::unique_ptr<io_system> io;
+    std::unique_ptr<kernel_system> kern;
+
+    explicit kernel_name_fixture() {
+        cpu = arm::create_core(arm_emulator_type::dynarmic);
+        timing = std::make_unique<ntimer>(484000000);
+        io = std::make_unique<io_system>();
+        kern = std::make_unique<kernel_system>(nullptr, timing.get(), io.get(), &conf, nullptr, nullptr, cpu.get(), nullptr);
+    }
+
+    kernel::semaphore *create_sema(const std::string &name) {
+        return kern->create<kernel::semaphore>(name, 0, kernel::access_type::global_access);
+    }
+
+    kernel_obj_ptr find_sema(const std::string &name) {
+        return kern->find_by_exact_name(name, kernel::object_type::sema);
+    }
+};
+
+TEST_CASE("kernel_find_by_exact_name", "kernel_name_index") {
+    kernel_name_fixture fixture;
+
+    kernel::semaphore *first = fixture.create_sema("FontStoreLock");
+    kernel::semaphore *second = fixture.create_sema("WsSema");
+
+    REQUIRE(fixture.find_sema("FontStoreLock") == first);
+    REQUIRE(fixture.find_sema("WsSema") == second);
+    REQUIRE(fixture.find_sema("FontStore") == nullptr);
+    REQUIRE(fixture.find_sema("") == nullptr);
+
+    // The index is per type
+    REQUIRE(fixture.kern->find_by_exact_name("WsSema", kernel::object_type::mutex) == nullptr);
+
+    // Same name, the first created wins, unless the search starts past it
+    kernel::semaphore *duplicate = fixture.create_sema("WsSema");
+
+    REQUIRE(fixture.find_sema("WsSema") == second);
+    REQUIRE(fixture.kern->find_by_exact_name("WsSema", kernel::object_type::sema, true, second->unique_id() + 1) == duplicate);
+
+    const std::optional<find_handle> found = fixture.kern->find_object("WsSema", 1, kernel::object_type::sema);
+
+    REQUIRE(found.has_value());
+    REQUIRE(found->obj == second);
+    REQUIRE(found->index == 2);
+}
+
+TEST_CASE("kernel_find_by_exact_name_case_differs", "kernel_name_index") {
+    kernel_name_fixture fixture;
+
+    // Names only differing in case are different names, as for the wildcard search
+    kernel::semaphore *upper = fixture.create_sema("AppArcLock");
+    kernel::semaphore *lower = fixture.create_sema("apparclock");
+
+    REQUIRE(fixture.find_sema("AppArcLock") == upper);
+    REQUIRE(fixture.find_sema("apparclock") == lower);
+    REQUIRE(fixture.find_sema("APPARCLOCK") == nullptr);
+
+    REQUIRE(fixture.kern->find_object("apparclock", 1, kernel::object_type::sema)->obj == lower);
+    REQUIRE(fixture.kern->find_object("AppArc*", 1, kernel::object_type::sema)->obj == upper);
+
+    // Removing one of them leaves the other found
+    REQUIRE(fixture.kern->destroy(upper));
+
+    REQUIRE(fixture.find_sema("AppArcLock") == nullptr);
+    REQUIRE(fixture.find_sema("apparclock") == lower);
+}
+
+TEST_CASE("kernel_find_by_exact_name_after_rename", "kernel_name_index") {
+    kernel_name_fixture fixture;
+
+    kernel::semaphore *sema = fixture.create_sema("OldName");
+    sema->rename("NewName");
+
+    REQUIRE(fixture.find_sema("OldName") == nullptr);
+    REQUIRE(fixture.find_sema("NewName") == sema);
+
+    // Only the case changes
+    sema->rename("newname");
+
+    REQUIRE(fixture.find_sema("NewName") == nullptr);
+    REQUIRE(fixture.find_sema("newname") == sema);
+
+    // Objects not created by the kernel stay out of the index
+    kernel::semaphore outside(fixture.kern.get(), "Outside", 0);
+    outside.rename("StillOutside");
+
+    REQUIRE(fixture.find_sema("Outside") == nullptr);
+    REQUIRE(fixture.find_sema("StillOutside") == nullptr);
+}
+
+TEST_CASE("kernel_find_by_exact_name_after_destroy", "kernel_name_index") {
+    kernel_name_fixture fixture;
+
+    kernel::semaphore *first = fixture.create_sema("Shared");
+    kernel::semaphore *second = fixture.create_sema("Shared");
+
+    REQUIRE(fixture.kern->destroy(first));
+    REQUIRE(fixture.find_sema("Shared") == second);
+
+    REQUIRE(fixture.kern->destroy(second));
+    REQUIRE(fixture.find_sema("Shared") == nullptr);
+    REQUIRE(!fixture.kern->find_object("Shared", 1, kernel::object_type::sema).has_value());
+
+    // A new object under the same name is found again
+    kernel::semaphore *third = fixture.create_sema("Shared");
+    REQUIRE(fixture.find_sema("Shared") == third);
+
+    fixture.kern->reset();
+    REQUIRE(fixture.find_sema("Shared") == nullptr);
+}
@@ -22,3 +22,156 @@
 #include <loader/e32img.h>
 
 #include <vfs/vfs.h>
+
+#include <common/fileutils.h>
+#include <common/path.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static const char *E32IMG_CACHE_TEST_FOLDER = "e32img_cache_test/";
+
+static void clear_e32img_cache_test_folder() {
+    common::dir_iterator iterator(E32IMG_CACHE_TEST_FOLDER);
+    common::dir_entry entry;
+
+    while (iterator.next_entry(entry) == 0) {
+        common::remove(eka2l1::add_path(E32IMG_CACHE_TEST_FOLDER, entry.name));
+    }
+}
+
+static loader::e32img_cache_key make_test_key(const std::string &source) {
+    loader::e32img_cache_key key;
+    key.add(source.data(), source.size());
+
+    return key;
+}
+
+TEST_CASE("e32img_cache_miss_when_empty", "e32img_cache") {
+    clear_e32img_cache_test_folder();
+
+    loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER);
+    std::vector<char> dest(64);
+
+    REQUIRE(!cache.load(make_test_key("compressed image"), dest.data(), static_cast<std::uint32_t>(dest.size())));
+    REQUIRE(cache.total_size() == 0);
+}
+
+TEST_CASE("e32img_cache_hit_after_store", "e32img_cache") {
+    clear_e32img_cache_test_folder();
+
+    const loader::e32img_cache_key key = make_test_key("compressed image");
+    const std::vector<char> decompressed(300, 'D');
+
+    {
+        loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER);
+        cache.store(key, decompressed.data(), static_cast<std::uint32_t>(decompressed.size()));
+
+        std::vector<char> dest(decompressed.size());
+
+        REQUIRE(cache.load(key, dest.data(), static_cast<std::uint32_t>(dest.size())));
+        REQUIRE(dest == decompressed);
+
+        // Asking for another size is a miss
+        REQUIRE(!cache.load(key, dest.data(), static_cast<std::uint32_t>(dest.size() - 1)));
+    }
+
+    // Entries outlive the cache object
+    loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER);
+    std::vector<char> dest(decompressed.size());
+
+    REQUIRE(cache.load(key, dest.data(), static_cast<std::uint32_t>(dest.size())));
+    REQUIRE(dest == decompressed);
+}
+
+TEST_CASE("e32img_cache_miss_when_source_changes", "e32img_cache") {
+    clear_e32img_cache_test_folder();
+
+    loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER);
+    const std::vector<char> decompressed(300, 'D');
+
+    cache.store(make_test_key("compressed image v1"), decompressed.data(), static_cast<std::uint32_t>(decompressed.size()));
+
+    // Same size, one byte changed
+    std::vector<char> dest(decompressed.size());
+    REQUIRE(!cache.load(make_test_key("compressed image v2"), dest.data(), static_cast<std::uint32_t>(dest.size())));
+
+    // The key covers the content given in parts the same as given whole
+    loader::e32img_cache_key split_key;
+    split_key.add("compressed ", 11);
+    split_key.add("image v1", 8);
+
+    REQUIRE(cache.load(split_key, dest.data(), static_cast<std::uint32_t>(dest.size())));
+}
+
+TEST_CASE("e32img_cache_evicts_least_recently_used", "e32img_cache") {
+    clear_e32img_cache_test_folder();
+
+    const std::vector<char> decompressed(1000, 'D');
+    std::vector<char> dest(decompressed.size());
+
+    const std::uint32_t size = static_cast<std::uint32_t>(decompressed.size());
+
+    // Room for two entries, not three
+    loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER, 2500);
+
+    cache.store(make_test_key("a"), decompressed.data(), size);
+    cache.store(make_test_key("b"), decompressed.data(), size);
+
+    REQUIRE(cache.load(make_test_key("a"), dest.data(), size));
+
+    cache.store(make_test_key("c"), decompressed.data(), size);
+
+    REQUIRE(cache.total_size() <= 2500);
+    REQUIRE(cache.load(make_test_key("a"), dest.data(), size));
+    REQUIRE(!cache.load(make_test_key("b"), dest.data(), size));
+    REQUIRE(cache.load(make_test_key("c"), dest.data(), size));
+
+    // Too big to ever fit, nothing gets evicted for it
+    const std::vector<char> huge(4000, 'H');
+    cache.store(make_test_key("d"), huge.data(), static_cast<std::uint32_t>(huge.size()));
+
+    REQUIRE(cache.load(make_test_key("a"), dest.data(), size));
+    REQUIRE(cache.load(make_test_key("c"), dest.data(), size));
+
+    // A smaller cap next run trims the folder right away
+    loader::e32img_cache smaller_cache(E32IMG_CACHE_TEST_FOLDER, 1500);
+    REQUIRE(smaller_cache.total_size() <= 1500);
+}
+
+TEST_CASE("e32img_cache_removes_unfinished_entries", "e32img_cache") {
+    clear_e32img_cache_test_folder();
+    eka2l1::create_directories(E32IMG_CACHE_TEST_FOLDER);
+
+    const std::string unfinished_path = eka2l1::add_path(E32IMG_CACHE_TEST_FOLDER, "unfinished.e32c.tmp");
+    const std::string corrupted_path = eka2l1::add_path(E32IMG_CACHE_TEST_FOLDER, "000000020000000000000001.e32c");
+
+    {
+        std::ofstream unfinished(unfinished_path, std::ios::binary);
+        unfinished << "half written";
+
+        std::ofstream corrupted(corrupted_path, std::ios::binary);
+        corrupted << "not an entry";
+    }
+
+    loader::e32img_cache cache(E32IMG_CACHE_TEST_FOLDER);
+
+    REQUIRE(!eka2l1::exists(unfinished_path));
+    REQUIRE(cache.total_size() == 12);
+
+    // Found broken on first use, and dropped
+    loader::e32img_cache_key key;
+    key.source_size = 2;
+
+    std::vector<char> dest(4);
+
+    REQUIRE(!cache.load(key, dest.data(), static_cast<std::uint32_t>(dest.size())));
+    REQUIRE(!eka2l1::exists(corrupted_path));
+    REQUIRE(cache.total_size() == 0);
+}
@@ -25,6 +25,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <string>
 #include <vector>
 
 using namespace eka2l1;
@@ -57,3 +58,72 @@ TEST_CASE("mbm_header_trailer_and_single_headers", "mbm_file") {
     REQUIRE(mbmf.sbm_headers[0].bitmap_size == 3545);
     REQUIRE(mbmf.sbm_headers[0].bit_per_pixels == 24);
 }
+
+static std::vector<std::uint8_t> read_face_mbm() {
+    std::ifstream fi("loaderassets/face.mbm", std::ios::binary);
+    REQUIRE(!fi.bad());
+    REQUIRE(!fi.fail());
+
+    std::vector<std::uint8_t> data;
+
+    fi.seekg(0, std::ios::end);
+    data.resize(static_cast<std::size_t>(fi.tellg()));
+    fi.seekg(0, std::ios::beg);
+
+    fi.read(reinterpret_cast<char *>(&data[0]), data.size());
+    return data;
+}
+
+static std::uint32_t fnv1a_hash(const std::uint8_t *data, const std::size_t size) {
+    std::uint32_t hash = 2166136261U;
+
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/**
+ * Decode the 24-bit RLE bitmap in the MBM. The expected hash was taken from the
+ * stream decoder the in-memory one replaced.
+ */
+TEST_CASE("mbm_read_single_bitmap_rle", "mbm_file") {
+    std::vector<std::uint8_t> data = read_face_mbm();
+
+    common::ro_buf_stream stream(&data[0], data.size());
+    loader::mbm_file mbmf(reinterpret_cast<common::ro_stream *>(&stream));
+
+    REQUIRE(mbmf.do_read_headers());
+    REQUIRE(mbmf.sbm_headers[0].compression == 4);
+
+    std::size_t uncompressed_size = 0;
+    REQUIRE(mbmf.read_single_bitmap(0, nullptr, uncompressed_size));
+    REQUIRE(uncompressed_size == 200 * 48 * 3);
+
+    std::vector<std::uint8_t> pixels(uncompressed_size);
+    REQUIRE(mbmf.read_single_bitmap(0, pixels.data(), uncompressed_size));
+    REQUIRE(uncompressed_size == pixels.size());
+    REQUIRE(fnv1a_hash(pixels.data(), pixels.size()) == 0x6A984BD6);
+}
+
+TEST_CASE("mbm_read_single_bitmap_benchmark", "[.benchmark]") {
+    std::vector<std::uint8_t> data = read_face_mbm();
+
+    common::ro_buf_stream stream(&data[0], data.size());
+    loader::mbm_file mbmf(reinterpret_cast<common::ro_stream *>(&stream));
+
+    REQUIRE(mbmf.do_read_headers());
+
+    std::size_t uncompressed_size = 0;
+    REQUIRE(mbmf.read_single_bitmap(0, nullptr, uncompressed_size));
+
+    std::vector<std::uint8_t> pixels(uncompressed_size);
+
+    BENCHMARK(std::string("face.mbm 24bpp 200x48")) {
+        std::size_t size = pixels.size();
+        mbmf.read_single_bitmap(0, pixels.data(), size);
+        return size;
+    };
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <cpu/arm_factory.h>
+
+#include <mem/mem.h>
+#include <mem/mmu.h>
+#include <mem/page.h>
+
+#include <array>
+#include <cstring>
+
+using namespace eka2l1;
+
+// Two guest pages, each backed by a separate host buffer so that a straddling access can't accidentally
+// succeed by reading past the first buffer.
+struct mmu_access_fixture {
+    config::state conf;
+    arm::core_instance cpu;
+    std::unique_ptr<memory_system> mem;
+
+    std::array<std::uint8_t, mem::page_size> first_page;
+    std::array<std::uint8_t, mem::page_size> second_page;
+
+    static constexpr mem::vm_address BASE = mem::shared_data;
+
+    explicit mmu_access_fixture() {
+        cpu = arm::create_core(arm_emulator_type::dynarmic);
+        mem = std::make_unique<memory_system>(cpu.get(), &conf, mem::mem_model_type::multiple, false);
+
+        for (std::size_t i = 0; i < mem::page_size; i++) {
+            first_page[i] = static_cast<std::uint8_t>(i);
+            second_page[i] = static_cast<std::uint8_t>(0xFF - i);
+        }
+
+        mem::mmu_base *mmu = mem->get_mmu();
+        mem::page_table *tab = mmu->create_new_page_table();
+
+        tab->get_page_info(0)->host_addr = first_page.data();
+        tab->get_page_info(1)->host_addr = second_page.data();
+
+        mmu->assign_page_table(tab, BASE, mem::MMU_ASSIGN_GLOBAL);
+    }
+};
+
+TEST_CASE("mmu_read_aligned_and_unaligned", "mmu_access") {
+    mmu_access_fixture fixture;
+
+    std::uint32_t value = 0;
+    REQUIRE(fixture.cpu->read_32bit(mmu_access_fixture::BASE + 4, &value));
+    REQUIRE(value == 0x07060504);
+
+    REQUIRE(fixture.cpu->read_32bit(mmu_access_fixture::BASE + 5, &value));
+    REQUIRE(value == 0x08070605);
+}
+
+TEST_CASE("mmu_read_straddling_pages", "mmu_access") {
+    mmu_access_fixture fixture;
+
+    std::uint32_t value = 0;
+    REQUIRE(fixture.cpu->read_32bit(mmu_access_fixture::BASE + mem::page_size - 2, &value));
+    REQUIRE(value == 0xFEFFFFFE);
+
+    std::uint64_t value64 = 0;
+    REQUIRE(fixture.cpu->read_64bit(mmu_access_fixture::BASE + mem::page_size - 1, &value64));
+    REQUIRE(value64 == 0xF9FAFBFCFDFEFFFF);
+
+    // The page after the second one is not mapped
+    REQUIRE_FALSE(fixture.cpu->read_32bit(mmu_access_fixture::BASE + mem::page_size * 2 - 2, &value));
+}
+
+TEST_CASE("mmu_write_straddling_pages", "mmu_access") {
+    mmu_access_fixture fixture;
+
+    std::uint32_t value = 0xAABBCCDD;
+    REQUIRE(fixture.cpu->write_32bit(mmu_access_fixture::BASE + mem::page_size - 1, &value));
+
+    REQUIRE(fixture.first_page[mem::page_size - 1] == 0xDD);
+    REQUIRE(fixture.second_page[0] == 0xCC);
+    REQUIRE(fixture.second_page[1] == 0xBB);
+    REQUIRE(fixture.second_page[2] == 0xAA);
+
+    // Failed straddling writes must not touch the mapped page either
+    value = 0x11223344;
+    REQUIRE_FALSE(fixture.cpu->write_32bit(mmu_access_fixture::BASE + mem::page_size * 2 - 2, &value));
+    REQUIRE(fixture.second_page[mem::page_size - 2] == 0x01);
+}
+
+TEST_CASE("mmu_resolve_addr_space_of_calling_core", "mmu_access") {
+    config::state conf;
+    arm::core_instance cpu = arm::create_core(arm_emulator_type::dynarmic);
+    memory_system mem(cpu.get(), &conf, mem::mem_model_type::multiple, false);
+
+    mem::mmu_base *mmu = mem.get_mmu();
+
+    const mem::asid first_space = mmu->rollover_fresh_addr_space();
+    const mem::asid second_space = mmu->rollover_fresh_addr_space();
+
+    std::array<std::uint8_t, mem::page_size> page{};
+    mem::page_table *tab = mmu->create_new_page_table();
+    tab->get_page_info(0)->host_addr = page.data();
+
+    // Local memory of the second address space only
+    mem::asid owner = second_space;
+    mmu->assign_page_table(tab, mem::local_data, 0, &owner, 1);
+
+    // The last core that switched runs the first address space
+    REQUIRE(mmu->set_current_addr_space(first_space));
+    REQUIRE(mem.get_real_pointer(mem::local_data) == nullptr);
+
+    // The calling core runs the second one
+    mmu->set_addr_space_resolver([&]() { return second_space; });
+    REQUIRE(mem.get_real_pointer(mem::local_data) == page.data());
+
+    // Explicit address spaces are used as they are
+    REQUIRE(mem.get_real_pointer(mem::local_data, first_space) == nullptr);
+
+    // Unknown to the resolver, so the MMU's current address space is used
+    mmu->set_addr_space_resolver([]() { return -1; });
+    REQUIRE(mem.get_real_pointer(mem::local_data) == nullptr);
+}
+
+TEST_CASE("mmu_read_benchmark", "[.benchmark]") {
+    mmu_access_fixture fixture;
+
+    BENCHMARK("Aligned 32-bit loads") {
+        std::uint32_t sum = 0;
+        std::uint32_t value = 0;
+
+        for (mem::vm_address off = 0; off < mem::page_size; off += 4) {
+            fixture.cpu->read_32bit(mmu_access_fixture::BASE + off, &value);
+            sum += value;
+        }
+
+        return sum;
+    };
+
+    BENCHMARK("Unaligned 32-bit loads") {
+        std::uint32_t sum = 0;
+        std::uint32_t value = 0;
+
+        for (mem::vm_address off = 1; off < mem::page_size - 4; off += 4) {
+            fixture.cpu->read_32bit(mmu_access_fixture::BASE + off, &value);
+            sum += value;
+        }
+
+        return sum;
+    };
+
+    BENCHMARK("Page-straddling 32-bit loads") {
+        std::uint32_t sum = 0;
+        std::uint32_t value = 0;
+
+        for (mem::vm_address off = 1; off < 4; off++) {
+            for (int i = 0; i < 256; i++) {
+                fixture.cpu->read_32bit(mmu_access_fixture::BASE + mem::page_size - off, &value);
+                sum += value;
+            }
+        }
+
+        return sum;
+    };
+}
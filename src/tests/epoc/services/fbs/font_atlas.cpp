@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/itc.h>
+#include <services/fbs/font_atlas.h>
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <string>
+
+using namespace eka2l1;
+
+static constexpr std::uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+// Every glyph is a square of the given size, so the atlas fills up at a known count.
+class square_glyph_adapter : public epoc::adapter::font_file_adapter_base {
+    int glyph_size_;
+
+public:
+    explicit square_glyph_adapter(const int glyph_size)
+        : glyph_size_(glyph_size) {
+    }
+
+    bool is_valid() override {
+        return true;
+    }
+
+    bool vectorizable() const override {
+        return true;
+    }
+
+    bool get_face_attrib(const std::size_t idx, epoc::open_font_face_attrib &face_attrib) override {
+        return false;
+    }
+
+    bool get_metrics(const std::size_t idx, epoc::open_font_metrics &metrics) override {
+        return false;
+    }
+
+    bool get_glyph_metric(const std::size_t idx, std::uint32_t code, epoc::open_font_character_metric &metric,
+        const std::int32_t baseline_horz_off, const std::uint16_t font_size) override {
+        return false;
+    }
+
+    std::uint8_t *get_glyph_bitmap(const std::size_t idx, std::uint32_t code, const std::uint16_t font_size,
+        int *rasterized_width, int *rasterized_height, std::uint32_t &total_size, epoc::glyph_bitmap_type *bmp_type) override {
+        return nullptr;
+    }
+
+    void free_glyph_bitmap(std::uint8_t *data) override {
+    }
+
+    epoc::glyph_bitmap_type get_output_bitmap_type() const override {
+        return epoc::glyph_bitmap_type::antialised_glyph_bitmap;
+    }
+
+    bool does_glyph_exist(std::size_t idx, std::uint32_t code) override {
+        return true;
+    }
+
+    std::int32_t begin_get_atlas(std::uint8_t *atlas_ptr, const eka2l1::vec2 atlas_size) override {
+        return 1;
+    }
+
+    bool get_glyph_atlas(const std::int32_t handle, const std::size_t idx, const char16_t start_code, int *unicode_point,
+        const char16_t num_code, const int font_size, epoc::adapter::character_info *info) override {
+        info->x0 = 0;
+        info->y0 = 0;
+        info->x1 = static_cast<std::uint16_t>(glyph_size_);
+        info->y1 = static_cast<std::uint16_t>(glyph_size_);
+        info->xoff = 0.0f;
+        info->yoff = 0.0f;
+        info->xoff2 = static_cast<float>(glyph_size_);
+        info->yoff2 = static_cast<float>(glyph_size_);
+        info->xadv = static_cast<float>(glyph_size_);
+
+        return true;
+    }
+
+    void end_get_atlas(const std::int32_t handle) override {
+    }
+
+    std::size_t count() override {
+        return 1;
+    }
+
+    std::uint32_t unique_id(const std::size_t face_index) override {
+        return 0;
+    }
+};
+
+// Give the atlas its pixel storage up front, so drawing never needs a driver to create the texture
+static void prepare_atlas_storage(epoc::font_atlas &atlas) {
+    const int width = atlas.get_atlas_width();
+
+    atlas.atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
+    atlas.scratch_size_ = 256;
+    atlas.scratch_data_ = std::make_unique<std::uint8_t[]>(atlas.scratch_size_ * atlas.scratch_size_);
+}
+
+static bool is_glyph_cached(epoc::font_atlas &atlas, const char16_t code) {
+    return atlas.glyph_lookup_.find(code) != atlas.glyph_lookup_.end();
+}
+
+TEST_CASE("font_atlas_shelf_allocation", "font_atlas") {
+    epoc::font_atlas atlas(nullptr, 0, 0, 0, 16);
+    REQUIRE(atlas.get_atlas_width() == 1024);
+
+    std::uint32_t shelf = INVALID_INDEX;
+    int x = -1;
+
+    // Heights of the same class share a shelf
+    REQUIRE(atlas.allocate_cell(100, 10, shelf, x));
+    REQUIRE(shelf == 0);
+    REQUIRE(x == 0);
+
+    REQUIRE(atlas.allocate_cell(100, 16, shelf, x));
+    REQUIRE(shelf == 0);
+    REQUIRE(x == 100);
+
+    REQUIRE(atlas.allocate_cell(100, 20, shelf, x));
+    REQUIRE(shelf == 1);
+    REQUIRE(x == 0);
+
+    REQUIRE(atlas.shelves_.size() == 2);
+    REQUIRE(atlas.shelves_[0].height_ == 16);
+    REQUIRE(atlas.shelves_[1].y_ == 16);
+    REQUIRE(atlas.shelves_[1].height_ == 24);
+    REQUIRE(atlas.shelves_bottom_ == 40);
+
+    // A full shelf opens a new one of the same class
+    REQUIRE(atlas.allocate_cell(824, 10, shelf, x));
+    REQUIRE(shelf == 0);
+    REQUIRE(x == 200);
+
+    REQUIRE(atlas.allocate_cell(1, 10, shelf, x));
+    REQUIRE(shelf == 2);
+    REQUIRE(x == 0);
+}
+
+TEST_CASE("font_atlas_release_merges_free_spans", "font_atlas") {
+    epoc::font_atlas atlas(nullptr, 0, 0, 0, 16);
+
+    std::uint32_t shelf = INVALID_INDEX;
+    int x = -1;
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(atlas.allocate_cell(100, 10, shelf, x));
+        REQUIRE(x == i * 100);
+    }
+
+    REQUIRE(atlas.allocate_cell(100, 20, shelf, x));
+    REQUIRE(shelf == 1);
+
+    // Merge with the right neighbour
+    atlas.release_cell(0, 100, 100);
+    atlas.release_cell(0, 0, 100);
+
+    REQUIRE(atlas.shelves_[0].free_spans_.size() == 1);
+    REQUIRE(atlas.shelves_[0].free_spans_[0] == std::make_pair(0, 200));
+
+    // Merge with the left neighbour
+    atlas.release_cell(0, 200, 100);
+
+    REQUIRE(atlas.shelves_[0].free_spans_.size() == 1);
+    REQUIRE(atlas.shelves_[0].free_spans_[0] == std::make_pair(0, 300));
+
+    // Released cells are reused before the untouched end of the shelf
+    REQUIRE(atlas.allocate_cell(150, 10, shelf, x));
+    REQUIRE(shelf == 0);
+    REQUIRE(x == 0);
+    REQUIRE(atlas.shelves_[0].free_spans_[0] == std::make_pair(150, 150));
+
+    // Merge with both neighbours
+    atlas.release_cell(0, 0, 150);
+    REQUIRE(atlas.shelves_[0].free_spans_[0] == std::make_pair(0, 300));
+    REQUIRE(atlas.shelves_[0].used_width_ == 400);
+
+    // Releasing the last cell gives the shelf width back, but a shelf below the top is never popped
+    atlas.release_cell(0, 300, 100);
+
+    REQUIRE(atlas.shelves_[0].free_spans_.empty());
+    REQUIRE(atlas.shelves_[0].used_width_ == 0);
+    REQUIRE(atlas.shelves_.size() == 2);
+
+    // Emptying the top shelf pops it along with every empty shelf under it
+    atlas.release_cell(1, 0, 100);
+
+    REQUIRE(atlas.shelves_.empty());
+    REQUIRE(atlas.shelves_bottom_ == 0);
+
+    // The space can now be taken by a shelf of another height
+    REQUIRE(atlas.allocate_cell(100, 30, shelf, x));
+    REQUIRE(shelf == 0);
+    REQUIRE(atlas.shelves_[0].height_ == 32);
+}
+
+TEST_CASE("font_atlas_eviction_keeps_current_draw_glyphs", "font_atlas") {
+    // 255 pixels glyphs take 256x256 cells with padding, so the 1024x1024 atlas holds 16 of them
+    square_glyph_adapter adapter(255);
+    epoc::font_atlas atlas(&adapter, 0, 0, 0, 16);
+    prepare_atlas_storage(atlas);
+
+    drivers::server_graphics_command_list cmd_list;
+    drivers::server_graphics_command_list_builder builder(&cmd_list);
+
+    const eka2l1::rect text_box({ 0, 0 }, { 1000, 300 });
+
+    REQUIRE(atlas.draw_text(u"ABCDEFGHIJKLMNOP", text_box, epoc::text_alignment::left, nullptr, &builder));
+    REQUIRE(atlas.glyph_lookup_.size() == 16);
+    REQUIRE(atlas.shelves_bottom_ == 1024);
+
+    const std::uint32_t b_index = atlas.glyph_lookup_[u'B'];
+    const std::uint32_t b_shelf = atlas.glyphs_[b_index].shelf_;
+    const int b_x = atlas.glyphs_[b_index].cell_x_;
+
+    // A is the least recent, but it was just used by this draw. B goes instead.
+    REQUIRE(atlas.draw_text(u"AQ", text_box, epoc::text_alignment::left, nullptr, &builder));
+
+    REQUIRE(is_glyph_cached(atlas, u'A'));
+    REQUIRE(is_glyph_cached(atlas, u'Q'));
+    REQUIRE(!is_glyph_cached(atlas, u'B'));
+
+    const epoc::font_atlas_glyph &q_glyph = atlas.glyphs_[atlas.glyph_lookup_[u'Q']];
+    REQUIRE(q_glyph.shelf_ == b_shelf);
+    REQUIRE(q_glyph.cell_x_ == b_x);
+
+    // Every resident glyph is used before the new one, so nothing can be evicted for it
+    const std::u16string all_resident = u"ACDEFGHIJKLMNOPQ";
+
+    REQUIRE(atlas.draw_text(all_resident + u"Z", text_box, epoc::text_alignment::left, nullptr, &builder));
+    REQUIRE(!is_glyph_cached(atlas, u'Z'));
+
+    for (const char16_t code : all_resident) {
+        REQUIRE(is_glyph_cached(atlas, code));
+    }
+
+    // On the next draw they are no longer pinned
+    REQUIRE(atlas.draw_text(u"Z", text_box, epoc::text_alignment::left, nullptr, &builder));
+    REQUIRE(is_glyph_cached(atlas, u'Z'));
+    REQUIRE(atlas.glyph_lookup_.size() == 16);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <kernel/timing.h>
+
+#include <random>
+
+using namespace eka2l1;
+
+TEST_CASE("event_queue_order", "timing") {
+    event_queue queue;
+
+    queue.push({ 0, 300, 1 });
+    queue.push({ 0, 100, 2 });
+    queue.push({ 1, 200, 3 });
+    queue.push({ 1, 100, 4 });
+
+    // Same time events come out in scheduling order
+    REQUIRE(queue.pop().event_user_data == 2);
+    REQUIRE(queue.pop().event_user_data == 4);
+    REQUIRE(queue.pop().event_user_data == 3);
+    REQUIRE(queue.pop().event_user_data == 1);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("event_queue_remove", "timing") {
+    event_queue queue;
+
+    queue.push({ 0, 500, 1 });
+    queue.push({ 0, 100, 2 });
+    queue.push({ 1, 100, 2 });
+    queue.push({ 0, 300, 3 });
+
+    REQUIRE(queue.remove(0, 2));
+    REQUIRE_FALSE(queue.remove(0, 2));
+    REQUIRE_FALSE(queue.remove(2, 1));
+
+    REQUIRE(queue.size() == 3);
+    REQUIRE(queue.top().event_type == 1);
+
+    REQUIRE(queue.remove(1, 2));
+    REQUIRE(queue.pop().event_user_data == 3);
+    REQUIRE(queue.pop().event_user_data == 1);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("event_queue_stress", "timing") {
+    event_queue queue;
+    std::mt19937 rng(0x1234);
+
+    for (std::uint64_t i = 0; i < 10000; i++) {
+        queue.push({ static_cast<int>(i & 3), rng() % 100000, i });
+    }
+
+    // Cancel every odd event
+    for (std::uint64_t i = 1; i < 10000; i += 2) {
+        REQUIRE(queue.remove(static_cast<int>(i & 3), i));
+    }
+
+    REQUIRE(queue.size() == 5000);
+
+    std::uint64_t last_time = 0;
+
+    while (!queue.empty()) {
+        const event evt = queue.pop();
+
+        REQUIRE(evt.event_time >= last_time);
+        REQUIRE((evt.event_user_data & 1) == 0);
+
+        last_time = evt.event_time;
+    }
+}
+
+TEST_CASE("event_queue_benchmark", "[.benchmark]") {
+    std::mt19937 rng(0x1234);
+    std::vector<std::uint64_t> times(10000);
+
+    for (auto &time : times) {
+        time = rng() % 100000;
+    }
+
+    BENCHMARK("Schedule and cancel 10k events") {
+        event_queue queue;
+
+        for (std::uint64_t i = 0; i < times.size(); i++) {
+            queue.push({ static_cast<int>(i & 7), times[i], i });
+        }
+
+        for (std::uint64_t i = 0; i < times.size(); i++) {
+            queue.remove(static_cast<int>(i & 7), i);
+        }
+
+        return queue.size();
+    };
+
+    BENCHMARK("Schedule and advance 10k events") {
+        event_queue queue;
+
+        for (std::uint64_t i = 0; i < times.size(); i++) {
+            queue.push({ static_cast<int>(i & 7), times[i], i });
+        }
+
+        std::uint64_t sum = 0;
+
+        while (!queue.empty()) {
+            sum += queue.pop().event_time;
+        }
+
+        return sum;
+    };
+}
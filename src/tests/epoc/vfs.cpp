@@ -2,8 +2,13 @@
 #include <common/algorithm.h>
 #include <common/path.h>
 #include <common/types.h>
+#include <common/fileutils.h>
 #include <vfs/vfs.h>
 
+#include <chrono>
+#include <fstream>
+#include <thread>
+
 struct io_scope_guard {
     eka2l1::io_system *io;
 
@@ -37,3 +42,120 @@ TEST_CASE("get_physical", "vfs") {
 
     REQUIRE(eka2l1::common::compare_ignore_case(*actual_path_b, std::u16string(u"drive_b") + static_cast<char16_t>(eka2l1::get_separator()) + u"despacito3leak") == 0);
 }
+
+TEST_CASE("resolve_case_folded_host_entry", "vfs") {
+    if (eka2l1::common::is_system_case_insensitive()) {
+        // Nothing to fold, the host does it already
+        return;
+    }
+
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    eka2l1::create_directories("drive_case/Private");
+    eka2l1::common::remove("drive_case/Private/ShowCase.txt");
+
+    {
+        std::ofstream host_file("drive_case/Private/ShowCase.txt");
+        host_file << "Symbian";
+    }
+
+    io.mount_physical_path(drive_number::drive_c, drive_media::physical, io_attrib_internal,
+        u"drive_case");
+
+    // Not lowercased on the host, but still found
+    const auto actual_path = io.get_raw_path(u"C:\\private\\SHOWCASE.TXT");
+
+    REQUIRE(actual_path);
+    REQUIRE(*actual_path == std::u16string(u"drive_case") + static_cast<char16_t>(eka2l1::get_separator()) + u"Private" + static_cast<char16_t>(eka2l1::get_separator()) + u"ShowCase.txt");
+    REQUIRE(io.exist(u"C:\\private\\showcase.txt"));
+
+    // Deleting through the filesystem drops what was cached about it
+    REQUIRE(io.delete_entry(u"C:\\Private\\ShowCase.txt"));
+    REQUIRE_FALSE(io.exist(u"C:\\private\\showcase.txt"));
+}
+
+TEST_CASE("refresh_case_folded_entries_of_two_directories", "vfs") {
+    if (eka2l1::common::is_system_case_insensitive()) {
+        return;
+    }
+
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    eka2l1::create_directories("drive_watch/First");
+    eka2l1::create_directories("drive_watch/Second");
+
+    eka2l1::common::remove("drive_watch/First/NewOne.TXT");
+    eka2l1::common::remove("drive_watch/Second/NewTwo.Txt");
+
+    std::ofstream("drive_watch/First/Old.Txt") << "1";
+    std::ofstream("drive_watch/Second/Old.Txt") << "2";
+
+    io.mount_physical_path(drive_number::drive_c, drive_media::physical, io_attrib_internal,
+        u"drive_watch");
+
+    // Both directories are now listed and watched
+    REQUIRE(io.exist(u"C:\\first\\old.txt"));
+    REQUIRE(io.exist(u"C:\\second\\old.txt"));
+    REQUIRE_FALSE(io.exist(u"C:\\first\\newone.txt"));
+    REQUIRE_FALSE(io.exist(u"C:\\second\\newtwo.txt"));
+
+    // Created behind the filesystem's back, the changes of both directories usually come in one batch
+    std::ofstream("drive_watch/First/NewOne.TXT") << "3";
+    std::ofstream("drive_watch/Second/NewTwo.Txt") << "4";
+
+    bool both_found = false;
+
+    for (int i = 0; (i < 200) && !both_found; i++) {
+        both_found = io.exist(u"C:\\first\\newone.txt") && io.exist(u"C:\\second\\newtwo.txt");
+
+        if (!both_found) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    REQUIRE(both_found);
+}
+
+TEST_CASE("notify_entry_changes_right_away", "vfs") {
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    eka2l1::create_directories("drive_notify");
+    eka2l1::common::remove("drive_notify/created.txt");
+    eka2l1::common::remove("drive_notify/renamed.txt");
+    eka2l1::common::remove("drive_notify/newdir");
+
+    io.mount_physical_path(drive_number::drive_e, drive_media::physical, io_attrib_internal,
+        u"drive_notify");
+
+    std::vector<std::u16string> changed;
+
+    const std::size_t handle = io.register_entry_change_notify([&](void *userdata, const std::u16string &path) {
+        changed.push_back(path);
+    }, nullptr);
+
+    // Only opening a file that did not exist is a change
+    REQUIRE(io.open_file(u"E:\\created.txt", WRITE_MODE | BIN_MODE));
+    REQUIRE(io.open_file(u"E:\\created.txt", WRITE_MODE | BIN_MODE));
+    REQUIRE(io.open_file(u"E:\\created.txt", READ_MODE | BIN_MODE));
+    REQUIRE(changed == std::vector<std::u16string>{ u"E:\\created.txt" });
+
+    changed.clear();
+
+    REQUIRE(io.rename(u"E:\\created.txt", u"E:\\renamed.txt"));
+    REQUIRE(changed == std::vector<std::u16string>{ u"E:\\created.txt", u"E:\\renamed.txt" });
+
+    changed.clear();
+
+    REQUIRE(io.delete_entry(u"E:\\renamed.txt"));
+    REQUIRE(io.create_directory(u"E:\\newdir\\"));
+    REQUIRE(changed == std::vector<std::u16string>{ u"E:\\renamed.txt", u"E:\\newdir\\" });
+
+    REQUIRE(io.unregister_entry_change_notify(handle));
+    changed.clear();
+
+    REQUIRE(io.delete_entry(u"E:\\newdir\\"));
+    REQUIRE(changed.empty());
+}